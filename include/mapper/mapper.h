@@ -70,7 +70,10 @@ mpr_prop mpr_obj_get_prop_by_idx(mpr_obj object, int index, const char **key, in
 
 /*! Look up a property by name.
  *  \param object       The object to check.
- *  \param key          The name of the property to retrieve.
+ *  \param key          The name of the property to retrieve. If no property has this exact name,
+ *                      the name may contain wildcards ('*') to retrieve the first matching extra
+ *                      property in alphabetical order, and extra properties whose names contain
+ *                      wildcards match any name fitting them.
  *  \param length       A pointer to a location to receive the vector length of
  *                      the property value (Optional, pass `0` to ignore).
  *  \param type         A pointer to a location to receive the type of the
@@ -359,6 +362,25 @@ void mpr_sig_free(mpr_sig signal);
 void mpr_sig_set_value(mpr_sig signal, mpr_id instance, int length, mpr_type type,
                        const void *value);
 
+/*! Queue an update of a local signal instance from any thread, e.g. an audio callback. Unlike
+ *  `mpr_sig_set_value()` this never locks, allocates memory, or processes maps; queued updates
+ *  are applied in order by the thread polling the device (or its data thread, see
+ *  `mpr_graph_start_data_thread()`) before its maps are processed. The signal must not be freed
+ *  while other threads may still queue updates for it.
+ *  \param signal       The signal to operate on.
+ *  \param instance     The identifier of the instance to update, or `0` for the default
+ *                      instance.
+ *  \param length       Length of the value argument, or `0` to release the instance.
+ *  \param type         Data type of the value argument.
+ *  \param value        A pointer to the new value, which is copied. Values of up to 64 bytes
+ *                      can be queued.
+ *  \param time         The time of the update, or `MPR_NOW` to use the time at which it is
+ *                      applied.
+ *  \return             Zero if the update was queued, or nonzero if the queue is full or the
+ *                      value is too large. */
+int mpr_sig_queue_value(mpr_sig signal, mpr_id instance, int length, mpr_type type,
+                        const void *value, mpr_time time);
+
 /*! Get the value of a signal instance.
  *  \param signal       The signal to operate on.
  *  \param instance     A pointer to the identifier of the instance to query,
@@ -368,6 +390,38 @@ void mpr_sig_set_value(mpr_sig signal, mpr_id instance, int length, mpr_type typ
  *                      instance, or `0` if the signal instance has no value. */
 const void *mpr_sig_get_value(mpr_sig signal, mpr_id instance, mpr_time *time);
 
+/*! Enable or disable publishing a snapshot of the latest value of each instance of a local
+ *  signal. Snapshots can be read with `mpr_sig_read_snapshot()` from any thread, e.g. a render
+ *  or audio thread, without locking or waiting for the thread polling the device.
+ *  \param signal       The signal to operate on.
+ *  \param enable       Non-zero to publish snapshots, `0` to stop.
+ *  \return             Zero if successful, nonzero otherwise. */
+int mpr_sig_set_snapshot(mpr_sig signal, int enable);
+
+/*! Copy the latest published value of a signal instance. May be called from any thread; the
+ *  copy is never torn by a concurrent update. Snapshots must be enabled with
+ *  `mpr_sig_set_snapshot()`.
+ *  \param signal       The signal to operate on.
+ *  \param instance     The identifier of the instance to read, ignored for signals without
+ *                      instances.
+ *  \param value        A location to receive the value, large enough to hold a vector of the
+ *                      signal's length and type.
+ *  \param time         A location to receive the value's time tag (Optional, pass `0` to ignore).
+ *  \return             `1` if the instance has a value, `0` otherwise. */
+int mpr_sig_read_snapshot(mpr_sig signal, mpr_id instance, void *value, mpr_time *time);
+
+/*! Copy the latest published values of all active instances of a signal. May be called from any
+ *  thread. Snapshots must be enabled with `mpr_sig_set_snapshot()`.
+ *  \param signal       The signal to operate on.
+ *  \param num          The maximum number of instances to copy.
+ *  \param instances    An array of `num` locations to receive the instance identifiers.
+ *  \param values       A location to receive `num` values of the signal's length and type.
+ *  \param times        An array of `num` locations to receive the values' time tags (Optional,
+ *                      pass `0` to ignore).
+ *  \return             The number of instances copied. */
+int mpr_sig_read_snapshots(mpr_sig signal, int num, mpr_id *instances, void *values,
+                           mpr_time *times);
+
 /*! Return the list of maps associated with a given signal.
  *  \param signal       Signal record to query for maps.
  *  \param direction    The direction of the map relative to the given signal.
@@ -571,7 +625,8 @@ void mpr_map_block_origin(mpr_map map, mpr_dev device);
 /*! @defgroup lists Lists
 
      @{ Lists provide a data structure for lazy retrieval of multiple Objects (Devices, Signals, or
-        Maps) as a result of a query. */
+        Maps) as a result of a query. Lists can also be materialized into an array of results that
+        supports retrieving the size and indexed items in constant time. */
 
 /*! Filter a list of objects using the given property.
  *  \param list         The list of objects to filter.
@@ -587,26 +642,26 @@ void mpr_map_block_origin(mpr_map map, mpr_dev device);
  *                      type instead.
  *  \param value        The value.
  *  \param op           The comparison operator.
- *  \return             A list of results.  Use `mpr_list_get_next()` to iterate. */
+ *  \return             A materialized list of results.  Use `mpr_list_get_next()` to iterate. */
 mpr_list mpr_list_filter(mpr_list list, mpr_prop property, const char *key, int length,
                          mpr_type type, const void *value, mpr_op op);
 
 /*! Get the union of two object lists (objects matching list1 OR list2).
  *  \param list1        The first object list.
  *  \param list2        The second object list.
- *  \return             A list of results.  Use `mpr_list_get_next()` to iterate. */
+ *  \return             A materialized list of results.  Use `mpr_list_get_next()` to iterate. */
 mpr_list mpr_list_get_union(mpr_list list1, mpr_list list2);
 
 /*! Get the intersection of two object lists (objects matching list1 AND list2).
  *  \param list1        The first object list.
  *  \param list2        The second object list.
- *  \return             A list of results.  Use `mpr_list_get_next()` to iterate. */
+ *  \return             A materialized list of results.  Use `mpr_list_get_next()` to iterate. */
 mpr_list mpr_list_get_isect(mpr_list list1, mpr_list list2);
 
 /*! Get the difference between two object lists (objects in list1 but NOT list2).
  *  \param list1        The first object list.
  *  \param list2        The second object list.
- *  \return             A list of results.  Use `mpr_list_get_next()` to iterate. */
+ *  \return             A materialized list of results.  Use `mpr_list_get_next()` to iterate. */
 mpr_list mpr_list_get_diff(mpr_list list1, mpr_list list2);
 
 /*! Get an indexed item in a list of objects.
@@ -625,6 +680,13 @@ mpr_list mpr_list_get_next(mpr_list list);
  *  \return             A copy of the initial list.  Use `mpr_list_get_next()` to iterate. */
 mpr_list mpr_list_get_cpy(mpr_list list);
 
+/*! Evaluate the remaining items of an object list and store them in a new list that can return
+ *  its size and indexed items in constant time. The new list is a snapshot and will not reflect
+ *  later changes to the graph. The original list is consumed.
+ *  \param list         The object list to materialize.
+ *  \return             A materialized list of results.  Use `mpr_list_get_next()` to iterate. */
+mpr_list mpr_list_materialize(mpr_list list);
+
 /*! Compare two lists, returning zero if they are equal or a value different from zero
  *  representing which is greater if they do not.
  *  \param lhs          A previously allocated list to compare.
@@ -713,6 +775,69 @@ int mpr_graph_start_polling(mpr_graph graph, int block_ms);
  *  \return             Zero if successful, less than zero otherwise. */
 int mpr_graph_stop_polling(mpr_graph graph);
 
+/*! Retrieve the file descriptors of the sockets used by a graph and its local devices, so that
+ *  they can be watched by an application's own event loop, e.g. using `poll()` or `epoll`. When
+ *  one becomes readable or the time returned by `mpr_graph_get_deadline()` has elapsed, call
+ *  `mpr_graph_process_fds()`. The set of descriptors changes when local devices are added or
+ *  removed or the network interface is changed, so it should be retrieved again after processing.
+ *  Only listening sockets are included: connections accepted by TCP servers are not exposed by
+ *  liblo, so once a TCP connection has been used the deadline is kept short and TCP data may wait
+ *  up to 100 ms to be processed. Use `mpr_graph_poll()` if this latency matters.
+ *  \param graph        The graph to query.
+ *  \param fds          An array to fill with file descriptors.
+ *  \param num          The size of the array.
+ *  \return             The number of file descriptors in use, which may exceed `num`. */
+int mpr_graph_get_fds(mpr_graph graph, int *fds, int num);
+
+/*! Get the time until the graph next needs processing even if none of its file descriptors
+ *  become readable, for example for timed maps, pending updates, or housekeeping.
+ *  \param graph        The graph to query.
+ *  \return             The number of milliseconds until the next deadline, or `0` if processing
+ *                      is already due. */
+int mpr_graph_get_deadline(mpr_graph graph);
+
+/*! Handle all pending messages and due work without blocking. This is intended for use with
+ *  `mpr_graph_get_fds()` and `mpr_graph_get_deadline()` instead of `mpr_graph_poll()`, and should
+ *  not be called while the graph is being polled in a separate thread.
+ *  \param graph        The graph to process.
+ *  \return             The number of handled messages. */
+int mpr_graph_process_fds(mpr_graph graph);
+
+/*! Service the data servers of the graph's local devices in a separate thread, so that signal
+ *  updates are received and sent independently of the processing of administrative messages by
+ *  `mpr_graph_poll()` or the polling thread. The two threads share a lock on the graph and its
+ *  maps that is released between messages and between housekeeping steps, such as the removal
+ *  of an expired device, so administrative traffic delays signal updates by at most one handler
+ *  or step. Subscribers of a device are updated while holding only that device's part of the
+ *  lock. Signal handlers are called from the data thread, and
+ *  `mpr_sig_set_value()` and `mpr_sig_release_inst()` may be called from any thread. Local
+ *  signals, their instances, handlers, and properties may also be created, modified, or freed
+ *  from any thread, except from a handler running on the data thread of a different device;
+ *  other objects should only be modified from the thread polling the graph. This must be called
+ *  before a polling thread is started, and is only available on platforms with POSIX threads.
+ *  \param graph        The graph to process.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_graph_start_data_thread(mpr_graph graph);
+
+/*! Service the data servers of the graph's local devices with a pool of threads, for processes
+ *  hosting many devices. The devices are assigned to the threads in turn, and each thread
+ *  receives, processes the maps of, and sends updates for its own devices, while administrative
+ *  messages are still handled by `mpr_graph_poll()` or the polling thread. Updates on maps
+ *  between local devices serviced by different threads are handed over without locking. Calling
+ *  `mpr_sig_set_value()` from a handler for a signal of a device serviced by another thread
+ *  queues the update like `mpr_sig_queue_value()`. Otherwise the same rules apply as for
+ *  `mpr_graph_start_data_thread()`.
+ *  \param graph        The graph to process.
+ *  \param num_threads  The number of data threads.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_graph_start_data_threads(mpr_graph graph, int num_threads);
+
+/*! Stop servicing the data servers in separate threads. Afterwards they are handled again by
+ *  `mpr_graph_poll()` or the polling thread.
+ *  \param graph        The graph to process.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_graph_stop_data_thread(mpr_graph graph);
+
 /*! Free a graph.
  *  \param graph        The graph to free. */
 void mpr_graph_free(mpr_graph graph);
@@ -760,6 +885,24 @@ int mpr_graph_add_cb(mpr_graph graph, mpr_graph_handler *handler, int types, con
  *  \return             User data pointer associated with this callback (if any). */
 void *mpr_graph_remove_cb(mpr_graph graph, mpr_graph_handler *handler, const void *data);
 
+/*! Index a property of the objects in a graph. Filtering a list returned by
+ *  `mpr_graph_get_list()` with `mpr_list_filter()` will then look up the matching objects instead
+ *  of testing each one, if the filter has a single value of type `MPR_INT32`, `MPR_INT64`,
+ *  `MPR_TYPE`, `MPR_PTR` or `MPR_STR` and the operator is `MPR_OP_EQ`, `MPR_OP_GT`, `MPR_OP_GTE`,
+ *  `MPR_OP_LT` or `MPR_OP_LTE`. String values containing wildcards are not looked up. The names,
+ *  devices, directions, types and lengths of signals are indexed by default. Only properties that
+ *  change through the property tables can be indexed: extra properties and the device, direction,
+ *  ephemerality, host, id, length, library version, minimum, maximum, name, ordinal, port,
+ *  stealing mode, type and unit. Counters and status such as `MPR_PROP_NUM_INST`,
+ *  `MPR_PROP_NUM_MAPS_IN` or `MPR_PROP_STATUS` are rejected.
+ *  \param graph        The graph to index.
+ *  \param type         The type of objects to index: `MPR_DEV`, `MPR_SIG` or `MPR_MAP`.
+ *  \param property     Symbolic identifier of the property to index.
+ *  \param key          The name of the property to index, used if `property` is
+ *                      `MPR_PROP_UNKNOWN` or `MPR_PROP_EXTRA`.
+ *  \return             One if an index was added, otherwise zero. */
+int mpr_graph_add_index(mpr_graph graph, mpr_type type, mpr_prop property, const char *key);
+
 /*! Return a list of objects.
  *  \param graph        The graph to query.
  *  \param types        Bitflags setting the type of information of interest. Currently restricted
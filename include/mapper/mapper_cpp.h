@@ -994,11 +994,37 @@ namespace mapper {
         Signal& set_value(Values... vals)
             { return _set_value(vals...); }
 
+        /*! Queue a value for this Signal from any thread without locking or allocating
+         *  memory; see mpr_sig_queue_value().
+         *  \param val      The value to queue.
+         *  \param len      The length of the value.
+         *  \return         Zero if the value was queued, nonzero otherwise. */
+        int queue_value(const int *val, unsigned int len) const
+            { return mpr_sig_queue_value(_obj, 0, len, MPR_INT32, val, MPR_NOW); }
+        int queue_value(const float *val, unsigned int len) const
+            { return mpr_sig_queue_value(_obj, 0, len, MPR_FLT, val, MPR_NOW); }
+        int queue_value(const double *val, unsigned int len) const
+            { return mpr_sig_queue_value(_obj, 0, len, MPR_DBL, val, MPR_NOW); }
+
         const void *value() const
             { return mpr_sig_get_value(_obj, 0, 0); }
         const void *value(Time time) const
             { return mpr_sig_get_value(_obj, 0, (mpr_time*)time); }
 
+        /*! Enable or disable publishing value snapshots for this Signal; see
+         *  mpr_sig_set_snapshot().
+         *  \param enable   `true` to publish snapshots.
+         *  \return         Self. */
+        Signal& set_snapshot(bool enable = true)
+            { mpr_sig_set_snapshot(_obj, enable); RETURN_SELF }
+
+        /*! Copy the latest published value of this Signal from any thread; see
+         *  mpr_sig_read_snapshot().
+         *  \param val      Storage for the value.
+         *  \return         `true` if the signal has a value. */
+        bool read_snapshot(void *val) const
+            { return mpr_sig_read_snapshot(_obj, 0, val, 0); }
+
         /*! Signal Instances can be used to describe the multiplicity and/or ephemerality of
          *  phenomena associated with Signals. A signal describes the phenomena, e.g. the position
          *  of a 'blob' in computer vision, and the signal's instances will describe the positions
@@ -1963,6 +1989,42 @@ namespace mapper {
         Graph& stop()
             { mpr_graph_stop_polling(_obj); RETURN_SELF }
 
+        /*! Receive and send signal updates in a separate thread, independently of the
+         *  processing of administrative messages; see mpr_graph_start_data_thread().
+         *  \return         Self. */
+        Graph& start_data_thread()
+            { mpr_graph_start_data_thread(_obj); RETURN_SELF }
+
+        /*! Receive and send signal updates for the local devices with a pool of threads; see
+         *  mpr_graph_start_data_threads().
+         *  \param num_threads  The number of threads.
+         *  \return             Self. */
+        Graph& start_data_threads(int num_threads)
+            { mpr_graph_start_data_threads(_obj, num_threads); RETURN_SELF }
+
+        /*! Stop receiving and sending signal updates in a separate thread.
+         *  \return         Self. */
+        Graph& stop_data_thread()
+            { mpr_graph_stop_data_thread(_obj); RETURN_SELF }
+
+        /*! Retrieve the file descriptors used by this Graph for watching in an external event
+         *  loop; see mpr_graph_get_fds().
+         *  \param fds      An array to fill with file descriptors.
+         *  \param num      The size of the array.
+         *  \return         The number of file descriptors in use. */
+        int fds(int *fds, int num) const
+            { return mpr_graph_get_fds(_obj, fds, num); }
+
+        /*! Get the number of milliseconds until this Graph next needs processing.
+         *  \return         The time until the next deadline, or 0 if processing is due. */
+        int deadline() const
+            { return mpr_graph_get_deadline(_obj); }
+
+        /*! Handle all pending messages and due work without blocking.
+         *  \return         The number of handled messages. */
+        int process_fds() const
+            { return mpr_graph_process_fds(_obj); }
+
         // subscriptions
         /*! Subscribe to information about a specific Device.
          *  \param dev      The Device of interest.
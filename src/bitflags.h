@@ -7,29 +7,53 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
 #include "mpr_inline.h"
 
 typedef char *mpr_bitflags;
 
-/* A mpr_bitflags object consists of a char array with at least num_flags bits.
- * The bit 0 is used to indicate whether all bits are set.
- * Bits 1–7 are used to store the length of the bitflag array.
+/* A mpr_bitflags object consists of a char array with at least num_flags bits, prefixed by a
+ * 32-bit header. Bit 0 of the header is used to indicate whether all bits are set and the
+ * remaining bits store the number of flags.
  * On allocation any extra bits are set to 1 for efficient comparison. */
 
+#define MPR_BITFLAGS_HDR sizeof(uint32_t)
+#define MPR_BITFLAGS_MAX (UINT32_MAX >> 1)
+
+#define _HDR(BITFLAGS) (*(uint32_t*)(BITFLAGS))
+#define _NUM_FLAGS(BITFLAGS) (_HDR(BITFLAGS) >> 1)
+#define _NUM_BYTES(NUM_FLAGS) (((NUM_FLAGS) - 1) / 8 + 1)
+#define _BYTE(BITFLAGS, IDX) ((BITFLAGS)[MPR_BITFLAGS_HDR + (IDX) / 8])
+
+/* Number of bytes needed to store num_flags, rounded up so that consecutive bitflags in a single
+ * allocation keep their headers aligned. */
+MPR_INLINE static size_t mpr_bitflags_get_size(unsigned int num_flags)
+{
+    size_t size = MPR_BITFLAGS_HDR + _NUM_BYTES(num_flags);
+    return (size + MPR_BITFLAGS_HDR - 1) / MPR_BITFLAGS_HDR * MPR_BITFLAGS_HDR;
+}
+
+/* Initialize bitflags in caller-provided memory of at least mpr_bitflags_get_size() bytes. */
+MPR_INLINE static void mpr_bitflags_init(mpr_bitflags bitflags, unsigned int num_flags)
+{
+    unsigned int num_bytes = _NUM_BYTES(num_flags);
+    assert(num_flags && num_flags <= MPR_BITFLAGS_MAX);
+    memset(bitflags + MPR_BITFLAGS_HDR, 0, num_bytes);
+    if (num_flags % 8) {
+        /* set extraneous bits to one */
+        bitflags[MPR_BITFLAGS_HDR + num_bytes - 1] |= 255 << (num_flags % 8);
+    }
+    _HDR(bitflags) = num_flags << 1;
+}
+
 MPR_INLINE static mpr_bitflags mpr_bitflags_new(unsigned int num_flags)
 {
     mpr_bitflags bitflags;
     if (!num_flags)
         return 0;
-    /* allocate an extra byte for length prefix */
-    unsigned int num_bytes = (num_flags - 1) / 8 + 2;
-    assert(num_flags < 128);
-    bitflags = calloc(1, num_bytes);
-    if (num_flags % 8) {
-        /* set extraneous bits to one */
-        bitflags[num_bytes - 1] |= 255 << (num_flags % 8);
-    }
-    bitflags[0] = num_flags << 1;
+    /* allocate extra bytes for the header */
+    bitflags = malloc(mpr_bitflags_get_size(num_flags));
+    mpr_bitflags_init(bitflags, num_flags);
     return bitflags;
 }
 
@@ -42,22 +66,26 @@ MPR_INLINE static void mpr_bitflags_free(mpr_bitflags bitflags)
 MPR_INLINE static mpr_bitflags mpr_bitflags_realloc(mpr_bitflags bitflags,
                                                     unsigned int new_num_flags)
 {
-    unsigned int old_num_flags = bitflags[0] >> 1;
-    unsigned int old_num_bytes = (old_num_flags - 1) / 8 + 2;
+    unsigned int old_num_flags = _NUM_FLAGS(bitflags);
+    unsigned int old_num_bytes = _NUM_BYTES(old_num_flags);
 
     if (new_num_flags < old_num_flags) {
-        char all_set = bitflags[0] & 0x01;
-        unsigned int new_num_bytes = (new_num_flags - 1) / 8 + 2;
+        uint32_t all_set = _HDR(bitflags) & 0x01;
+        unsigned int new_num_bytes = _NUM_BYTES(new_num_flags);
         if (new_num_bytes < old_num_bytes)
-            bitflags = realloc(bitflags, new_num_bytes);
-        bitflags[0] = (new_num_flags << 1) | all_set;
+            bitflags = realloc(bitflags, MPR_BITFLAGS_HDR + new_num_bytes);
+        if (new_num_flags % 8) {
+            /* set extraneous bits to one */
+            bitflags[MPR_BITFLAGS_HDR + new_num_bytes - 1] |= 255 << (new_num_flags % 8);
+        }
+        _HDR(bitflags) = (new_num_flags << 1) | all_set;
     }
-    else if (new_num_flags > (bitflags[0] >> 1)) {
+    else if (new_num_flags > old_num_flags) {
         mpr_bitflags new_bitflags = mpr_bitflags_new(new_num_flags);
-        int i = old_num_bytes - 1;
-        new_bitflags[i] |= (bitflags[i] & (255 >> (8 - (old_num_flags % 8))));
-        while (--i)
-            new_bitflags[i] = bitflags[i];
+        unsigned int last = MPR_BITFLAGS_HDR + old_num_bytes - 1;
+        char mask = (old_num_flags % 8) ? (255 >> (8 - (old_num_flags % 8))) : 255;
+        memcpy(new_bitflags + MPR_BITFLAGS_HDR, bitflags + MPR_BITFLAGS_HDR, old_num_bytes - 1);
+        new_bitflags[last] |= (bitflags[last] & mask);
         /* leave all_set flag at zero since new flags have not been set */
         free(bitflags);
         bitflags = new_bitflags;
@@ -67,40 +95,40 @@ MPR_INLINE static mpr_bitflags mpr_bitflags_realloc(mpr_bitflags bitflags,
 
 MPR_INLINE static void mpr_bitflags_set(mpr_bitflags bitflags, unsigned int idx)
 {
-    bitflags[idx / 8 + 1] |= (1 << (idx % 8));
+    _BYTE(bitflags, idx) |= (1 << (idx % 8));
 }
 
 MPR_INLINE static void mpr_bitflags_set_all(mpr_bitflags bitflags)
 {
-    memset(bitflags + 1, 255, ((bitflags[0] >> 1) - 1) / 8 + 1);
-    bitflags[0] |= 0x01;
+    memset(bitflags + MPR_BITFLAGS_HDR, 255, _NUM_BYTES(_NUM_FLAGS(bitflags)));
+    _HDR(bitflags) |= 0x01;
 }
 
 MPR_INLINE static int mpr_bitflags_get_all(mpr_bitflags bitflags)
 {
-    if (bitflags[0] & 0x01)
+    if (_HDR(bitflags) & 0x01)
         return 1;
     else {
-        unsigned int i, num_bytes = ((bitflags[0] >> 1) - 1) / 8 + 1;
-        for (i = 1; i <= num_bytes; i++) {
+        unsigned int i, num_bytes = _NUM_BYTES(_NUM_FLAGS(bitflags));
+        for (i = MPR_BITFLAGS_HDR; i < MPR_BITFLAGS_HDR + num_bytes; i++) {
             /* bitflags are padded with 1's so we can simply compare byte to 0xFF */
             if (bitflags[i] != (char)0xFF)
                 return 0;
         }
-        bitflags[0] |= 0x01;
+        _HDR(bitflags) |= 0x01;
         return 1;
     }
 }
 
 MPR_INLINE static int mpr_bitflags_get_sum(mpr_bitflags bitflags)
 {
-    if (bitflags[0] & 0x01)
-        return bitflags[0] >> 1;
+    unsigned int num_flags = _NUM_FLAGS(bitflags);
+    if (_HDR(bitflags) & 0x01)
+        return num_flags;
     else {
-        unsigned int num_flags = bitflags[0] >> 1;
-        unsigned int num_bytes = (num_flags - 1) / 8 + 1;
-        unsigned int i = 1, sum = 0;
-        for (i = 1; i <= num_bytes; i++) {
+        unsigned int num_bytes = _NUM_BYTES(num_flags);
+        unsigned int i, sum = 0;
+        for (i = MPR_BITFLAGS_HDR; i < MPR_BITFLAGS_HDR + num_bytes; i++) {
             char byte = bitflags[i];
             if (byte) {
                 int j;
@@ -117,41 +145,42 @@ MPR_INLINE static int mpr_bitflags_get_sum(mpr_bitflags bitflags)
 
 MPR_INLINE static void mpr_bitflags_unset(mpr_bitflags bitflags, unsigned int idx)
 {
-    bitflags[idx / 8 + 1] &= (0xFF ^ (1 << (idx % 8)));
-    bitflags[0] &= ~0x01;
+    _BYTE(bitflags, idx) &= (0xFF ^ (1 << (idx % 8)));
+    _HDR(bitflags) &= ~0x01;
 }
 
 MPR_INLINE static int mpr_bitflags_get(mpr_bitflags bitflags, unsigned int idx)
 {
-    return bitflags[idx / 8 + 1] & (1 << (idx % 8));
+    return _BYTE(bitflags, idx) & (1 << (idx % 8));
 }
 
 MPR_INLINE static int mpr_bitflags_compare(mpr_bitflags l, mpr_bitflags r)
 {
-    return (l[0] != r[0]) || memcmp(l, r, ((l[0] >> 1) - 1) / 8 + 2);
+    return (_HDR(l) != _HDR(r))
+        || memcmp(l + MPR_BITFLAGS_HDR, r + MPR_BITFLAGS_HDR, _NUM_BYTES(_NUM_FLAGS(l)));
 }
 
 MPR_INLINE static void mpr_bitflags_clear(mpr_bitflags bitflags)
 {
-    unsigned int num_flags = bitflags[0] >> 1;
-    unsigned int num_bytes = (num_flags - 1) / 8 + 1;
-    memset(bitflags + 1, 0, num_bytes);
+    unsigned int num_flags = _NUM_FLAGS(bitflags);
+    unsigned int num_bytes = _NUM_BYTES(num_flags);
+    memset(bitflags + MPR_BITFLAGS_HDR, 0, num_bytes);
     if (num_flags % 8) {
         /* set extraneous bits to one */
-        bitflags[num_bytes] |= 255 << (num_flags % 8);
+        bitflags[MPR_BITFLAGS_HDR + num_bytes - 1] |= 255 << (num_flags % 8);
     }
-    bitflags[0] &= ~0x01;
+    _HDR(bitflags) &= ~0x01;
 }
 
 MPR_INLINE static void mpr_bitflags_cpy(mpr_bitflags dst, mpr_bitflags src)
 {
     /* TODO: check whether sizes match? */
-    memcpy(dst, src, ((src[0] >> 1) - 1) / 8 + 2);
+    memcpy(dst, src, MPR_BITFLAGS_HDR + _NUM_BYTES(_NUM_FLAGS(src)));
 }
 
 MPR_INLINE static void mpr_bitflags_print(mpr_bitflags bitflags)
 {
-    unsigned int i, num_flags = bitflags[0] >> 1;
+    unsigned int i, num_flags = _NUM_FLAGS(bitflags);
     printf("%d:[", num_flags);
     for (i = 0; i < num_flags; i++)
         printf("%d", mpr_bitflags_get(bitflags, i) ? 1 : 0);
@@ -160,8 +189,13 @@ MPR_INLINE static void mpr_bitflags_print(mpr_bitflags bitflags)
     for (; i < num_flags; i++)
         printf("%d", mpr_bitflags_get(bitflags, i) ? 1 : 0);
     printf("]");
-    if (bitflags[0] & 0x01)
+    if (_HDR(bitflags) & 0x01)
         printf("*");
 }
 
+#undef _HDR
+#undef _NUM_FLAGS
+#undef _NUM_BYTES
+#undef _BYTE
+
 #endif /* __MPR_BITFLAGS_H__ */
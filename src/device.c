@@ -14,8 +14,10 @@
 
 #include "device.h"
 #include "graph.h"
+#include "hash.h"
 #include "map.h"
 #include "path.h"
+#include "queue.h"
 #include "table.h"
 
 #include "mpr_debug.h"
@@ -25,6 +27,13 @@
 
 extern const char* net_msg_strings[NUM_MSG_STRINGS];
 
+#define MAX_SUB_DSTS 32     /* Number of UDP subscribers sent to in one batch. */
+#define UPDATE_QUEUE_SIZE 256   /* Number of signal updates that can be queued by other threads. */
+#define MAX_QUEUED_VALUE 64     /* Size in bytes of the largest value that can be queued. */
+#define MAX_QUEUED_TYPES 16     /* Longest vector of a slot update that is copied inline. */
+#define RING_IDLE_SEC 0.01      /* Rings are polled instead of waking the device until idle. */
+#define RING_POLL_MS 1          /* Interval at which busy rings are polled. */
+
 #define MPR_DEV_STRUCT_ITEMS                                            \
     mpr_obj_t obj;      /* always first for type punning */             \
     mpr_dev *linked;                                                    \
@@ -38,6 +47,11 @@ extern const char* net_msg_strings[NUM_MSG_STRINGS];
     int num_maps_in;    /*!< Number of associated incoming maps. */     \
     int num_maps_out;   /*!< Number of associated outgoing maps. */     \
     int num_linked;     /*!< Number of linked devices. */               \
+    mpr_sig *sigs;      /*!< Signals belonging to this device. */       \
+    mpr_map *maps;      /*!< Maps connected to this device's signals. */\
+    int num_sigs;                                                       \
+    int num_maps;                                                       \
+    void *queries;      /*!< Queries over the signal and map arrays. */ \
     uint8_t subscribed;
 
 /*! A record that keeps information about a device. */
@@ -48,6 +62,7 @@ struct _mpr_dev {
 typedef struct _mpr_subscriber {
     struct _mpr_subscriber *next;
     lo_address addr;
+    mpr_udp_dst udp;                    /*!< Resolved address for sending serialized data. */
     char *host;
     char *port;
     int protocol; /* TODO: merge with flags */
@@ -66,6 +81,37 @@ typedef struct _mpr_allocated_t {
                                  *   distributed allocation network. */
 } mpr_allocated_t, *mpr_allocated;
 
+/*! Objects waiting for the next processing cycle. */
+typedef struct _mpr_dev_queue {
+    void **items;
+    int num;
+    int size;
+} mpr_dev_queue_t, *mpr_dev_queue;
+
+/*! A signal update queued by another thread with mpr_sig_queue_value(), or a map slot update
+ *  handed over by the data thread servicing another device. */
+typedef struct _mpr_queued_update {
+    mpr_local_sig sig;
+    mpr_id id;                  /*!< Instance id, or instance GID of a slot update. */
+    mpr_time time;
+    char *ext;                  /*!< Types and values of a slot update too long to copy inline. */
+    int len;
+    int slot_id;
+    mpr_type type;
+    uint8_t has_time;
+    uint8_t is_slot;
+    mpr_type types[MAX_QUEUED_TYPES];
+    double val[MAX_QUEUED_VALUE / sizeof(double)];
+} mpr_queued_update_t, *mpr_queued_update;
+
+/*! A scheduled evaluation of a self-timed map instance. */
+typedef struct _mpr_dev_timer {
+    mpr_time time;
+    mpr_local_map map;
+    int *pos;                   /*!< Owned by the map, tracks the position of this timer. */
+    int inst_idx;
+} mpr_dev_timer_t;
+
 struct _mpr_local_dev {
     MPR_DEV_STRUCT_ITEMS
 
@@ -74,17 +120,33 @@ struct _mpr_local_dev {
 
     mpr_subscriber subscribers;         /*!< Linked-list of subscribed peers. */
 
+    mpr_hash sigs_by_name;              /*!< Index of local signals keyed by name. */
+    mpr_hash sigs_by_alias;             /*!< Index of local signals keyed by data alias. */
+    int num_aliases;                    /*!< Number of aliases assigned so far. */
+
     struct {
         struct _mpr_id_map **active;    /*!< The list of active instance id maps. */
         struct _mpr_id_map *reserve;    /*!< The list of reserve instance id maps. */
+        mpr_hash *by_LID;               /*!< Per-group index of active id maps keyed by LID. */
+        mpr_hash *by_GID;               /*!< Per-group index of active id maps keyed by GID. */
     } id_maps;
 
+    mpr_dev_queue_t map_queue;          /*!< Local maps with pending updates or messages. */
+    mpr_dev_queue_t link_queue;         /*!< Local links with pending bundles. */
+    mpr_dev_queue_t ring_links;         /*!< Local links receiving through shared memory. */
+    mpr_time ring_time;                 /*!< Time records were last received through a ring. */
+    mpr_queue updates;                  /*!< Signal updates queued by other threads. */
+
+    struct {
+        mpr_dev_timer_t *items;         /*!< Min-heap of timers ordered by time. */
+        int num;
+        int size;
+    } timers;
+
     mpr_time time;
-    mpr_time t_next;
     int num_sig_groups;
     mpr_dir updated;
     uint8_t time_is_stale;  // only need 1 bit
-    uint8_t timed;          // only need 1 bit
     uint8_t locked;         // only need 1 bit
     uint8_t receiving;      // only need 1 bit
     uint8_t own_graph;
@@ -93,6 +155,7 @@ struct _mpr_local_dev {
 /* prototypes */
 static int check_registration(mpr_local_dev dev);
 static void process_maps(mpr_local_dev dev);
+static void free_subscriber(mpr_subscriber sub);
 
 size_t mpr_dev_get_struct_size(int is_local)
 {
@@ -120,6 +183,12 @@ static int cmp_qry_sigs(const void *context_data, mpr_sig sig)
             && !(((mpr_obj)sig)->status & MPR_STATUS_REMOVED));
 }
 
+static mpr_list new_sig_qry(mpr_dev dev, int start, mpr_dir dir)
+{
+    return mpr_graph_new_adj_query(dev->obj.graph, start, MPR_SIG, &dev->sigs, &dev->num_sigs,
+                                   &dev->queries, (void*)cmp_qry_sigs, "hi", dev->obj.id, dir);
+}
+
 void mpr_dev_init(mpr_dev dev, int is_local, const char *name, mpr_id id)
 {
     mpr_tbl tbl;
@@ -133,7 +202,7 @@ void mpr_dev_init(mpr_dev dev, int is_local, const char *name, mpr_id id)
     }
     if (id) {
         assert(!dev->obj.id);
-        dev->obj.id = id;
+        mpr_obj_set_id((mpr_obj)dev, id);
     }
 
     dev->obj.props.synced = mpr_tbl_new();
@@ -157,8 +226,7 @@ void mpr_dev_init(mpr_dev dev, int is_local, const char *name, mpr_id id)
     link(ORDINAL,      MPR_INT32, &dev->ordinal,      MPR_TBL_MOD_NONE);
     if (!is_local) {
         // why only local devs??
-        qry = mpr_graph_new_query(dev->obj.graph, 0, MPR_SIG, (void*)cmp_qry_sigs,
-                                  "hi", dev->obj.id, MPR_DIR_ANY);
+        qry = new_sig_qry(dev, 0, MPR_DIR_ANY);
         link(SIG,      MPR_LIST,  qry,                MPR_TBL_MOD_NONE | MPR_TBL_OWNED);
     }
     link(STATUS,       MPR_INT32, &dev->obj.status,   MPR_TBL_MOD_NONE | MPR_TBL_ACC_LOC);
@@ -204,7 +272,15 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph graph)
     dev->ordinal_allocator.count_time = mpr_get_current_time();
     dev->id_maps.active = (mpr_id_map*) malloc(sizeof(mpr_id_map));
     dev->id_maps.active[0] = 0;
+    dev->id_maps.by_LID = (mpr_hash*) malloc(sizeof(mpr_hash));
+    dev->id_maps.by_LID[0] = mpr_hash_new();
+    dev->id_maps.by_GID = (mpr_hash*) malloc(sizeof(mpr_hash));
+    dev->id_maps.by_GID[0] = mpr_hash_new();
     dev->num_sig_groups = 1;
+    dev->sigs_by_name = mpr_hash_new();
+    dev->sigs_by_alias = mpr_hash_new();
+    /* allocated up front so that queueing updates never allocates */
+    dev->updates = mpr_queue_new(UPDATE_QUEUE_SIZE, sizeof(mpr_queued_update_t));
 
     return (mpr_dev)dev;
 }
@@ -227,6 +303,7 @@ void mpr_dev_free(mpr_dev dev)
     net = mpr_graph_get_net(graph);
 
     mpr_net_stop_polling(net);
+    mpr_net_stop_data_thread(net);
 
     /* remove local graph handlers here so they are not called when child objects are freed */
     /* CHANGE: if graph is not owned then its callbacks _should_ be called when device is removed. */
@@ -243,11 +320,8 @@ void mpr_dev_free(mpr_dev dev)
     /* remove subscribers */
     while (ldev->subscribers) {
         mpr_subscriber sub = ldev->subscribers;
-        FUNC_IF(lo_address_free, sub->addr);
-        FUNC_IF(free, sub->host);
-        FUNC_IF(free, sub->port);
         ldev->subscribers = sub->next;
-        free(sub);
+        free_subscriber(sub);
     }
 
     process_maps(ldev);
@@ -286,8 +360,12 @@ void mpr_dev_free(mpr_dev dev)
             ldev->id_maps.active[i] = id_map->next;
             free(id_map);
         }
+        mpr_hash_free(ldev->id_maps.by_LID[i]);
+        mpr_hash_free(ldev->id_maps.by_GID[i]);
     }
     free(ldev->id_maps.active);
+    free(ldev->id_maps.by_LID);
+    free(ldev->id_maps.by_GID);
 
     while (ldev->id_maps.reserve) {
         mpr_id_map id_map = ldev->id_maps.reserve;
@@ -295,6 +373,22 @@ void mpr_dev_free(mpr_dev dev)
         free(id_map);
     }
 
+    mpr_hash_free(ldev->sigs_by_name);
+    ldev->sigs_by_name = 0;
+    mpr_hash_free(ldev->sigs_by_alias);
+    ldev->sigs_by_alias = 0;
+
+    FUNC_IF(free, ldev->map_queue.items);
+    FUNC_IF(free, ldev->link_queue.items);
+    FUNC_IF(free, ldev->ring_links.items);
+    FUNC_IF(free, ldev->timers.items);
+    memset(&ldev->map_queue, 0, sizeof(mpr_dev_queue_t));
+    memset(&ldev->link_queue, 0, sizeof(mpr_dev_queue_t));
+    memset(&ldev->ring_links, 0, sizeof(mpr_dev_queue_t));
+    memset(&ldev->timers, 0, sizeof(ldev->timers));
+    mpr_queue_free(ldev->updates);
+    ldev->updates = 0;
+
     dev->obj.status |= MPR_STATUS_REMOVED;
     if (own_graph)
         mpr_graph_free(graph);
@@ -302,13 +396,19 @@ void mpr_dev_free(mpr_dev dev)
 
 void mpr_dev_free_mem(mpr_dev dev)
 {
+    int i;
+    /* signals marked for removal may outlive the device until the next housekeeping */
+    for (i = 0; i < dev->num_sigs; i++)
+        mpr_sig_clear_dev(dev->sigs[i]);
     FUNC_IF(free, dev->linked);
+    mpr_list_adj_release(&dev->queries);
+    FUNC_IF(free, dev->sigs);
+    FUNC_IF(free, dev->maps);
 }
 
 static void on_registered(mpr_local_dev dev)
 {
     char *name;
-    mpr_net net = mpr_graph_get_net(dev->obj.graph);
     mpr_list qry;
 
     /* Add unique device id to locally-activated signal instances. */
@@ -317,10 +417,8 @@ static void on_registered(mpr_local_dev dev)
         mpr_local_sig sig = (mpr_local_sig)*sigs;
         sigs = mpr_list_get_next(sigs);
         mpr_local_sig_set_dev_id(sig, dev->obj.id);
-        mpr_local_sig_add_to_net(sig, net);
     }
-    qry = mpr_graph_new_query(dev->obj.graph, 0, MPR_SIG, (void*)cmp_qry_sigs,
-                              "hi", dev->obj.id, MPR_DIR_ANY);
+    qry = new_sig_qry((mpr_dev)dev, 0, MPR_DIR_ANY);
     mpr_tbl_add_record(dev->obj.props.synced, MPR_PROP_SIG, NULL,
                        1, MPR_LIST, qry, MPR_TBL_MOD_NONE | MPR_TBL_OWNED);
     /* the table makes a copy so we can free this query */
@@ -332,6 +430,7 @@ static void on_registered(mpr_local_dev dev)
     name = strdup(dev->name);
     free(dev->name);
     dev->name = name;
+    mpr_graph_invalidate_indexes(dev->obj.graph);
 
     dev->obj.status &= ~MPR_STATUS_STAGED;
     dev->obj.status |= MPR_STATUS_ACTIVE;
@@ -349,52 +448,92 @@ int mpr_dev_get_is_registered(mpr_dev dev)
 
 void mpr_local_dev_add_sig(mpr_local_dev dev, mpr_local_sig sig, mpr_dir dir)
 {
+    /* the data threads look signals up by name and alias */
+    mpr_net net = mpr_graph_get_net(dev->obj.graph);
+    if (mpr_net_lock_dev(net, dev)) {
+        trace_dev(dev, "signals cannot be added from the data thread of another device.\n");
+        return;
+    }
+
     /* TODO: use & instead? */
     if (dir == MPR_DIR_IN)
         ++dev->num_inputs;
     else
         ++dev->num_outputs;
 
-    if (dev->registered)
-        mpr_local_sig_add_to_net(sig, mpr_graph_get_net(dev->obj.graph));
+    mpr_hash_add_str(dev->sigs_by_name, mpr_sig_get_name((mpr_sig)sig), sig);
+
+    /* aliases are not reused so that stale updates cannot reach a different signal */
+    mpr_sig_set_alias((mpr_sig)sig, ++dev->num_aliases);
+    mpr_hash_add_id(dev->sigs_by_alias, dev->num_aliases, sig);
 
     mpr_obj_incr_version((mpr_obj)dev);
     dev->obj.status |= MPR_DEV_SIG_CHANGED;
+    mpr_net_unlock_dev(net, dev);
 }
 
 void mpr_dev_remove_sig(mpr_dev dev, mpr_sig sig)
 {
     mpr_dir dir = mpr_sig_get_dir(sig);
+    mpr_net net = mpr_graph_get_net(dev->obj.graph);
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    if (dev->obj.is_local && mpr_net_lock_dev(net, ldev)) {
+        trace_dev(dev, "signals cannot be removed from the data thread of another device.\n");
+        return;
+    }
     if (dir & MPR_DIR_IN)
         --dev->num_inputs;
     if (dir & MPR_DIR_OUT)
         --dev->num_outputs;
     if (dev->obj.is_local) {
+        if (mpr_hash_get_str(ldev->sigs_by_name, mpr_sig_get_name(sig)) == sig)
+            mpr_hash_remove_str(ldev->sigs_by_name, mpr_sig_get_name(sig));
+        if (mpr_sig_get_alias(sig))
+            mpr_hash_remove_id(ldev->sigs_by_alias, mpr_sig_get_alias(sig));
         mpr_obj_incr_version((mpr_obj)dev);
         dev->obj.status |= MPR_DEV_SIG_CHANGED;
+        mpr_net_unlock_dev(net, ldev);
     }
 }
 
+void mpr_dev_add_adj_sig(mpr_dev dev, mpr_sig sig)
+{
+    mpr_list_adj_add((void***)&dev->sigs, &dev->num_sigs, sig);
+}
+
+void mpr_dev_remove_adj_sig(mpr_dev dev, mpr_sig sig)
+{
+    mpr_list_adj_remove((void***)&dev->sigs, &dev->num_sigs, sig);
+}
+
+void mpr_dev_add_adj_map(mpr_dev dev, mpr_map map)
+{
+    mpr_list_adj_add((void***)&dev->maps, &dev->num_maps, map);
+}
+
+void mpr_dev_remove_adj_map(mpr_dev dev, mpr_map map)
+{
+    mpr_list_adj_remove((void***)&dev->maps, &dev->num_maps, map);
+}
+
 mpr_list mpr_dev_get_sigs(mpr_dev dev, mpr_dir dir)
 {
     RETURN_ARG_UNLESS(dev, 0);
-    return mpr_graph_new_query(dev->obj.graph, 1, MPR_SIG, (void*)cmp_qry_sigs,
-                               "hi", dev->obj.id, dir);
+    return new_sig_qry(dev, 1, dir);
+}
+
+mpr_local_sig mpr_local_dev_get_sig_by_alias(mpr_local_dev dev, int alias)
+{
+    return alias > 0 ? (mpr_local_sig)mpr_hash_get_id(dev->sigs_by_alias, alias) : 0;
 }
 
 mpr_sig mpr_dev_get_sig_by_name(mpr_dev dev, const char *sig_name)
 {
-    mpr_list sigs;
     RETURN_ARG_UNLESS(dev && sig_name, 0);
-    sigs = mpr_graph_get_list(dev->obj.graph, MPR_SIG);
-    while (sigs) {
-        mpr_sig sig = (mpr_sig)*sigs;
-        if (   mpr_sig_get_dev(sig) == dev
-            && strcmp(mpr_sig_get_name(sig), mpr_path_skip_slash(sig_name))==0)
-            return sig;
-        sigs = mpr_list_get_next(sigs);
-    }
-    return 0;
+    if (dev->obj.is_local && ((mpr_local_dev)dev)->sigs_by_name)
+        return (mpr_sig)mpr_hash_get_str(((mpr_local_dev)dev)->sigs_by_name,
+                                         mpr_path_skip_slash(sig_name));
+    return mpr_graph_get_sig_by_name(dev->obj.graph, dev, sig_name);
 }
 
 static int cmp_qry_maps(const void *context_data, mpr_map map)
@@ -407,8 +546,8 @@ static int cmp_qry_maps(const void *context_data, mpr_map map)
 mpr_list mpr_dev_get_maps(mpr_dev dev, mpr_dir dir)
 {
     RETURN_ARG_UNLESS(dev, 0);
-    return mpr_graph_new_query(dev->obj.graph, 1, MPR_MAP, (void*)cmp_qry_maps,
-                               "hi", dev->obj.id, dir);
+    return mpr_graph_new_adj_query(dev->obj.graph, 1, MPR_MAP, &dev->maps, &dev->num_maps,
+                                   &dev->queries, (void*)cmp_qry_maps, "hi", dev->obj.id, dir);
 }
 
 static int cmp_qry_links(const void *context_data, mpr_link link)
@@ -455,104 +594,356 @@ mpr_link mpr_dev_get_link_by_remote(mpr_dev dev, mpr_dev remote)
     return 0;
 }
 
-static void process_maps(mpr_local_dev dev)
+static void queue_push(mpr_dev_queue q, void *item)
 {
-    mpr_list list;
-    mpr_graph graph;
-    int updated = dev->updated;
-    RETURN_UNLESS(updated && !(dev->locked++));
+    if (q->num >= q->size) {
+        q->size = q->size ? q->size * 2 : 8;
+        q->items = realloc(q->items, q->size * sizeof(void*));
+    }
+    q->items[q->num++] = item;
+}
+
+static void queue_remove(mpr_dev_queue q, void *item)
+{
+    int i;
+    /* clear the entry rather than removing it since the queue may be in use by process_maps() */
+    for (i = 0; i < q->num; i++) {
+        if (q->items[i] == item)
+            q->items[i] = 0;
+    }
+}
 
-    graph = dev->obj.graph;
-    /* process and send updated maps */
-    /* TODO: speed this up! */
-    dev->t_next = MPR_TIME_MAX;
+/* discard the first `num` items, keeping any queued since */
+static void queue_pop(mpr_dev_queue q, int num)
+{
+    q->num -= num;
+    if (q->num)
+        memmove(q->items, q->items + num, q->num * sizeof(void*));
+}
 
-    /* cache and clear the `updated` flags since local maps may be updated during link processing */
-    dev->updated = 0;
+void mpr_local_dev_queue_map(mpr_local_dev dev, mpr_local_map map)
+{
+    queue_push(&dev->map_queue, map);
+}
 
-    /* process updated maps (both incoming and outgoing) */
-    // TODO: is it useful to order the maps based on direction?
-    list = mpr_graph_get_list(graph, MPR_MAP);
-    while (list) {
-        mpr_map map = (mpr_map)*list;
-        mpr_time t;
-        if (!mpr_obj_get_is_local((mpr_obj)map)) {
-            /* local maps are always located at the start of the list */
-            break;
-        }
-        t = mpr_map_process((mpr_local_map)map, dev->time);
-        if (mpr_time_cmp(dev->t_next, t) > 0)
-            dev->t_next = t;
-        list = mpr_list_get_next(list);
+void mpr_local_dev_dequeue_map(mpr_local_dev dev, mpr_local_map map)
+{
+    queue_remove(&dev->map_queue, map);
+}
+
+void mpr_local_dev_queue_link(mpr_local_dev dev, mpr_link link)
+{
+    queue_push(&dev->link_queue, link);
+}
+
+void mpr_local_dev_dequeue_link(mpr_local_dev dev, mpr_link link)
+{
+    queue_remove(&dev->link_queue, link);
+}
+
+void mpr_local_dev_add_ring_link(mpr_local_dev dev, mpr_link link)
+{
+    queue_push(&dev->ring_links, link);
+}
+
+void mpr_local_dev_remove_ring_link(mpr_local_dev dev, mpr_link link)
+{
+    queue_remove(&dev->ring_links, link);
+}
+
+int mpr_local_dev_recv_rings(mpr_local_dev dev, int block)
+{
+    mpr_dev_queue q = &dev->ring_links;
+    int i, j, count = 0;
+    RETURN_ARG_UNLESS(q->num, 0);
+
+    /* Each wakeup costs the producer a datagram, so only ask for one once the rings have been
+     * idle for a while. Until then they are polled, see get_timer_ms(). */
+    if (block && mpr_time_get_diff(dev->time, dev->ring_time) < RING_IDLE_SEC)
+        block = 0;
+
+    for (i = 0; i < q->num; i++) {
+        if (q->items[i])
+            count += mpr_link_recv_ring((mpr_link)q->items[i], block);
     }
+    if (count)
+        dev->ring_time = dev->time;
 
-    /* TODO: consider restricting calls to mpr_dev_set_sending() so this block is only called if
-     * outgoing messages have actually been generated */
-    /* send link bundles */
-    if (MPR_DIR_OUT & updated) {
-        /* need to process outgoing messages */
-        list = mpr_graph_get_list(graph, MPR_LINK);
-        while (list) {
-            mpr_link link = (mpr_link)*list;
-            if (!mpr_obj_get_is_local((mpr_obj)link)) {
-                /* local links are always located at the start of the list */
-                break;
+    /* compact entries cleared by links removed since the last call */
+    for (i = 0, j = 0; i < q->num; i++) {
+        if (q->items[i])
+            q->items[j++] = q->items[i];
+    }
+    q->num = j;
+    return count;
+}
+
+int mpr_local_dev_queue_update(mpr_local_dev dev, mpr_local_sig sig, mpr_id id, int len,
+                               mpr_type type, const void *val, mpr_time time)
+{
+    mpr_queued_update u;
+    size_t size = val ? len * mpr_type_get_size(type) : 0;
+    RETURN_ARG_UNLESS(size <= MAX_QUEUED_VALUE, -1);
+    RETURN_ARG_UNLESS(u = (mpr_queued_update)mpr_queue_reserve(dev->updates), -1);
+    u->sig = sig;
+    u->id = id;
+    u->len = val ? len : 0;
+    u->type = type;
+    u->time = time;
+    /* updates without a timestamp take the time at which they are processed */
+    u->has_time = time.sec || time.frac != MPR_NOW.frac;
+    u->is_slot = 0;
+    if (size)
+        memcpy(u->val, val, size);
+    /* the device may not be locked here so all data threads are woken */
+    if (mpr_queue_commit(dev->updates, u))
+        mpr_net_wake_data(mpr_graph_get_net(dev->obj.graph), NULL);
+    return 0;
+}
+
+int mpr_local_dev_queue_slot_update(mpr_local_dev dev, mpr_local_sig sig, int slot_id, mpr_id GID,
+                                    int len, const mpr_type *types, const void *vals, mpr_time time)
+{
+    mpr_queued_update u;
+    size_t size = len * mpr_type_get_size(mpr_sig_get_type((mpr_sig)sig));
+    size_t types_size = (len + 7) & ~7;
+    char *ext = 0;
+    if (len > MAX_QUEUED_TYPES || size > MAX_QUEUED_VALUE) {
+        /* longer vectors are copied to the heap and freed by the receiving thread */
+        RETURN_ARG_UNLESS(ext = malloc(types_size + size), -1);
+        memcpy(ext, types, len);
+        memcpy(ext + types_size, vals, size);
+    }
+    if (!(u = (mpr_queued_update)mpr_queue_reserve(dev->updates))) {
+        trace_dev(dev, "update queue is full, dropping update from another data thread.\n");
+        FUNC_IF(free, ext);
+        return -1;
+    }
+    u->sig = sig;
+    u->id = GID;
+    u->slot_id = slot_id;
+    u->len = len;
+    u->time = time;
+    u->has_time = u->is_slot = 1;
+    if (!(u->ext = ext)) {
+        memcpy(u->types, types, len);
+        memcpy(u->val, vals, size);
+    }
+    if (mpr_queue_commit(dev->updates, u))
+        mpr_net_wake_data(mpr_graph_get_net(dev->obj.graph), NULL);
+    return 0;
+}
+
+int mpr_local_dev_recv_updates(mpr_local_dev dev, int block)
+{
+    mpr_queued_update u;
+    int count = 0;
+    while (1) {
+        while ((u = (mpr_queued_update)mpr_queue_read(dev->updates))) {
+            if (u->is_slot) {
+                const mpr_type *types = u->ext ? (mpr_type*)u->ext : u->types;
+                const void *vals = u->ext ? u->ext + ((u->len + 7) & ~7) : (char*)u->val;
+                mpr_net_set_bundle_time(mpr_graph_get_net(dev->obj.graph), u->time);
+                mpr_local_sig_handle_update(u->sig, u->slot_id, u->id, u->len, types, vals,
+                                            u->time);
+                FUNC_IF(free, u->ext);
+            }
+            else {
+                if (u->has_time)
+                    mpr_dev_set_time((mpr_dev)dev, u->time);
+                mpr_local_sig_set_value(u->sig, u->id, u->len, u->type, u->len ? u->val : 0);
             }
-            mpr_link_process_bundles(link, dev->time);
-            list = mpr_list_get_next(list);
+            mpr_queue_release(dev->updates);
+            ++count;
+        }
+        /* check again in case updates were queued while the wakeup was being requested */
+        if (count || !block || mpr_queue_wait(dev->updates))
+            return count;
+    }
+}
+
+MPR_INLINE static void timer_move(mpr_local_dev dev, int idx, mpr_dev_timer_t *timer)
+{
+    dev->timers.items[idx] = *timer;
+    *timer->pos = idx;
+}
+
+static void timer_sift_up(mpr_local_dev dev, int idx)
+{
+    mpr_dev_timer_t *items = dev->timers.items;
+    mpr_dev_timer_t timer = items[idx];
+    while (idx > 0) {
+        int parent = (idx - 1) / 2;
+        if (mpr_time_cmp(items[parent].time, timer.time) <= 0)
+            break;
+        timer_move(dev, idx, &items[parent]);
+        idx = parent;
+    }
+    timer_move(dev, idx, &timer);
+}
+
+static void timer_sift_down(mpr_local_dev dev, int idx)
+{
+    mpr_dev_timer_t *items = dev->timers.items;
+    mpr_dev_timer_t timer = items[idx];
+    int num = dev->timers.num;
+    while (1) {
+        int child = idx * 2 + 1;
+        if (child >= num)
+            break;
+        if (child + 1 < num && mpr_time_cmp(items[child + 1].time, items[child].time) < 0)
+            ++child;
+        if (mpr_time_cmp(timer.time, items[child].time) <= 0)
+            break;
+        timer_move(dev, idx, &items[child]);
+        idx = child;
+    }
+    timer_move(dev, idx, &timer);
+}
+
+void mpr_local_dev_set_timer(mpr_local_dev dev, mpr_local_map map, int inst_idx, int *pos,
+                             mpr_time time)
+{
+    mpr_dev_timer_t *timer;
+    if (*pos < 0) {
+        if (dev->timers.num >= dev->timers.size) {
+            dev->timers.size = dev->timers.size ? dev->timers.size * 2 : 8;
+            dev->timers.items = realloc(dev->timers.items,
+                                        dev->timers.size * sizeof(mpr_dev_timer_t));
         }
+        *pos = dev->timers.num++;
+        timer = &dev->timers.items[*pos];
+        timer->map = map;
+        timer->inst_idx = inst_idx;
+        timer->pos = pos;
+        timer->time = time;
+        timer_sift_up(dev, *pos);
+    }
+    else {
+        int later;
+        timer = &dev->timers.items[*pos];
+        later = mpr_time_cmp(time, timer->time) > 0;
+        timer->time = time;
+        if (later)
+            timer_sift_down(dev, *pos);
+        else
+            timer_sift_up(dev, *pos);
+    }
+}
+
+void mpr_local_dev_remove_timer(mpr_local_dev dev, int *pos)
+{
+    int idx = *pos;
+    RETURN_UNLESS(idx >= 0);
+    *pos = -1;
+    RETURN_UNLESS(idx < --dev->timers.num);
+    /* replace with the last timer */
+    timer_move(dev, idx, &dev->timers.items[dev->timers.num]);
+    timer_sift_down(dev, idx);
+    timer_sift_up(dev, idx);
+}
+
+MPR_INLINE static int timer_is_due(mpr_local_dev dev)
+{
+    return dev->timers.num && mpr_time_get_diff(dev->timers.items[0].time, dev->time) <= 0.001;
+}
+
+static void process_maps(mpr_local_dev dev)
+{
+    mpr_local_map *maps;
+    mpr_link *links;
+    int i, num_maps, num_links;
+    RETURN_UNLESS(   (dev->updated || dev->map_queue.num || dev->link_queue.num || timer_is_due(dev))
+                  && !(dev->locked++));
+
+    /* clear the `updated` flags since local maps may be updated during link processing */
+    dev->updated = 0;
+
+    /* queue self-timed map instances that are due; instances rescheduled during processing
+     * will not be due before the next cycle */
+    while (timer_is_due(dev)) {
+        mpr_dev_timer_t *timer = &dev->timers.items[0];
+        mpr_local_map map = timer->map;
+        int inst_idx = timer->inst_idx;
+        mpr_local_dev_remove_timer(dev, timer->pos);
+        mpr_local_map_set_due(map, inst_idx);
+    }
+
+    /* maps queued during processing are left for the next cycle */
+    num_maps = dev->map_queue.num;
+
+    /* process updated maps (both incoming and outgoing) */
+    maps = (mpr_local_map*)dev->map_queue.items;
+    for (i = 0; i < num_maps; i++) {
+        if (maps[i])
+            mpr_map_process(maps[i], dev->time);
+    }
+
+    /* send link bundles, including those generated by the maps processed above */
+    links = (mpr_link*)dev->link_queue.items;
+    num_links = dev->link_queue.num;
+    for (i = 0; i < num_links; i++) {
+        if (links[i])
+            mpr_link_process_bundles(links[i], dev->time);
+    }
+    queue_pop(&dev->link_queue, num_links);
+    if (num_links) {
+        mpr_net net = mpr_graph_get_net(dev->obj.graph);
+        mpr_net_flush_udp(net, mpr_net_get_dev_server(net, dev, SERVER_DATA_UDP));
     }
 
     /* TODO: verify that we are not generating local-map slot messages during the previous step
      * that should not be cleared. If so we could add a logical clock argument to
      * `mpr_slot_build_msg()` and `mpr_map_clear_slot_msgs()` to specify which slots should be
      * cleared */
-    list = mpr_graph_get_list(graph, MPR_MAP);
-    while (list) {
-        mpr_map map = (mpr_map)*list;
-        if (!mpr_obj_get_is_local((mpr_obj)map)) {
-            /* local maps are always located at the start of the list */
-            break;
-        }
-        mpr_map_clear_slot_msgs((mpr_local_map)map);
-        list = mpr_list_get_next(list);
+    maps = (mpr_local_map*)dev->map_queue.items;
+    for (i = 0; i < num_maps; i++) {
+        if (!maps[i])
+            continue;
+        mpr_map_clear_slot_msgs(maps[i]);
+        /* this may queue the map again if it was updated during link processing */
+        mpr_local_map_dequeue(maps[i]);
+        /* reload in case the queue was reallocated */
+        maps = (mpr_local_map*)dev->map_queue.items;
     }
+    queue_pop(&dev->map_queue, num_maps);
     dev->locked = 0;
 }
 
-void mpr_local_dev_check_map_timing(mpr_local_dev dev)
+static int get_timer_ms(mpr_local_dev dev, mpr_time t)
 {
-    mpr_list list = mpr_graph_get_list(dev->obj.graph, MPR_MAP);
-    while (list) {
-        mpr_map map = (mpr_map)*list;
-        if (!mpr_obj_get_is_local((mpr_obj)map)) {
-            /* local maps are always located at the start of the list */
-            break;
-        }
-        if (mpr_local_map_get_is_timed((mpr_local_map)map)) {
-            dev->timed = 1;
-            dev->t_next = MPR_TIME_0;
-            return;
-        }
-        list = mpr_list_get_next(list);
+    int next_ms = INT_MAX;
+    if (dev->timers.num) {
+        /* wake when the earliest self-timed map instance is due */
+        next_ms = floor(mpr_time_get_diff(dev->timers.items[0].time, t) * 1000);
+        if (next_ms < 0)
+            next_ms = 0;
     }
-    dev->timed = 0;
+    /* busy rings do not wake the device, see mpr_local_dev_recv_rings() */
+    if (   dev->ring_links.num && next_ms > RING_POLL_MS
+        && mpr_time_get_diff(t, dev->ring_time) < RING_IDLE_SEC)
+        next_ms = RING_POLL_MS;
+    return next_ms;
 }
 
 int mpr_local_dev_update_maps(mpr_local_dev dev) {
     mpr_time t;
+    /* apply updates queued by other threads so they are processed in this cycle */
+    mpr_local_dev_recv_updates(dev, 0);
     mpr_time_set(&t, MPR_NOW);
     mpr_time_add_dbl(&t, dev->clk_offset);
     mpr_dev_set_time((mpr_dev)dev, t);
+    return get_timer_ms(dev, t);
+}
 
-    if (dev->timed) {
-        int next_ms = floor(mpr_time_get_diff(dev->t_next, t) * 1000);
-        if (next_ms < 0)
-            next_ms = 0;
-        return next_ms;
-    }
-    else
-        return INT_MAX;
+int mpr_local_dev_get_deadline(mpr_local_dev dev)
+{
+    mpr_time t;
+    /* updates made since the last cycle are processed immediately */
+    RETURN_ARG_UNLESS(!dev->map_queue.num && !dev->link_queue.num, 0);
+    mpr_time_set(&t, MPR_NOW);
+    mpr_time_add_dbl(&t, dev->clk_offset);
+    return get_timer_ms(dev, t);
 }
 
 void mpr_dev_update_maps(mpr_dev dev) {
@@ -630,17 +1021,9 @@ void mpr_dev_set_time(mpr_dev dev, mpr_time time)
     ldev->time_is_stale = 0;
 
     if (!ldev->locked) {
-        /* process any updates made under the old timestamp */
+        /* process any updates made under the old timestamp and timed maps that are now due */
         process_maps(ldev);
     }
-
-    if (ldev->timed && mpr_time_get_diff(ldev->t_next, time) <= 0.001) {
-        ldev->updated = MPR_DIR_ANY;
-        if (!ldev->locked) {
-            /* process timed maps due under the new timestamp */
-            process_maps(ldev);
-        }
-    }
 }
 
 void mpr_dev_reserve_id_map(mpr_local_dev dev)
@@ -673,6 +1056,36 @@ void mpr_local_dev_print_id_maps(mpr_local_dev dev)
 }
 #endif
 
+/* Active id maps sharing a key are chained from the index entry in the order they were added,
+ * most recent first, matching the order of the active list. */
+#define ID_MAP_CHAIN(ID_MAP, BY_GID) ((BY_GID) ? &(ID_MAP)->next_GID : &(ID_MAP)->next_LID)
+
+static void index_id_map(mpr_hash index, mpr_id key, mpr_id_map id_map, int by_GID)
+{
+    *ID_MAP_CHAIN(id_map, by_GID) = (mpr_id_map)mpr_hash_get_id(index, key);
+    mpr_hash_add_id(index, key, id_map);
+}
+
+static void unindex_id_map(mpr_hash index, mpr_id key, mpr_id_map id_map, int by_GID)
+{
+    mpr_id_map *chain, head = (mpr_id_map)mpr_hash_get_id(index, key);
+    RETURN_UNLESS(head);
+    if (head == id_map) {
+        if (*ID_MAP_CHAIN(id_map, by_GID))
+            mpr_hash_add_id(index, key, *ID_MAP_CHAIN(id_map, by_GID));
+        else
+            mpr_hash_remove_id(index, key);
+    }
+    else {
+        chain = ID_MAP_CHAIN(head, by_GID);
+        while (*chain && *chain != id_map)
+            chain = ID_MAP_CHAIN(*chain, by_GID);
+        if (*chain)
+            *chain = *ID_MAP_CHAIN(id_map, by_GID);
+    }
+    *ID_MAP_CHAIN(id_map, by_GID) = 0;
+}
+
 mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id GID, int indirect)
 {
     mpr_id_map id_map;
@@ -688,7 +1101,12 @@ mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id G
     id_map->indirect = indirect;
     dev->id_maps.reserve = id_map->next;
     id_map->next = dev->id_maps.active[group];
+    id_map->prev = 0;
+    if (id_map->next)
+        id_map->next->prev = id_map;
     dev->id_maps.active[group] = id_map;
+    index_id_map(dev->id_maps.by_LID[group], id_map->LID, id_map, 0);
+    index_id_map(dev->id_maps.by_GID[group], id_map->GID, id_map, 1);
 #ifdef DEBUG
     mpr_local_dev_print_id_maps(dev);
 #endif
@@ -697,23 +1115,38 @@ mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id G
 
 void mpr_dev_remove_id_map(mpr_local_dev dev, int group, mpr_id_map rem)
 {
-    mpr_id_map *map = &dev->id_maps.active[group];
+    /* ignore id maps that are not in the active list */
+    RETURN_UNLESS(rem && (rem->prev || dev->id_maps.active[group] == rem));
     trace_dev(dev, "mpr_dev_remove_id_map(%s) %"PR_MPR_ID" -> %"PR_MPR_ID"\n",
               dev->name, rem->LID, rem->GID);
-    while (*map) {
-        if ((*map) == rem) {
-            *map = (*map)->next;
-            rem->next = dev->id_maps.reserve;
-            dev->id_maps.reserve = rem;
-            break;
-        }
-        map = &(*map)->next;
-    }
+    unindex_id_map(dev->id_maps.by_LID[group], rem->LID, rem, 0);
+    unindex_id_map(dev->id_maps.by_GID[group], rem->GID, rem, 1);
+    if (rem->prev)
+        rem->prev->next = rem->next;
+    else
+        dev->id_maps.active[group] = rem->next;
+    if (rem->next)
+        rem->next->prev = rem->prev;
+    rem->prev = 0;
+    rem->next = dev->id_maps.reserve;
+    dev->id_maps.reserve = rem;
 #ifdef DEBUG
     mpr_local_dev_print_id_maps(dev);
 #endif
 }
 
+void mpr_dev_set_id_map_GID(mpr_local_dev dev, int group, mpr_id_map id_map, mpr_id GID)
+{
+    if (!id_map->prev && dev->id_maps.active[group] != id_map) {
+        /* id map is in the reserve list and not indexed */
+        id_map->GID = GID;
+        return;
+    }
+    unindex_id_map(dev->id_maps.by_GID[group], id_map->GID, id_map, 1);
+    id_map->GID = GID;
+    index_id_map(dev->id_maps.by_GID[group], id_map->GID, id_map, 1);
+}
+
 int mpr_dev_LID_decref(mpr_local_dev dev, int group, mpr_id_map id_map)
 {
     trace_dev(dev, "mpr_dev_LID_decref(%s) %"PR_MPR_ID" -> %"PR_MPR_ID"\n",
@@ -755,37 +1188,32 @@ int mpr_dev_GID_decref(mpr_local_dev dev, int group, mpr_id_map id_map)
 
 mpr_id_map mpr_dev_get_id_map_by_LID(mpr_local_dev dev, int group, mpr_id LID)
 {
-    mpr_id_map id_map = dev->id_maps.active[group];
+    mpr_id_map id_map = (mpr_id_map)mpr_hash_get_id(dev->id_maps.by_LID[group], LID);
     while (id_map) {
-        if (id_map->LID == LID && id_map->LID_refcount > 0) {
+        if (id_map->LID_refcount > 0)
             return id_map;
-        }
-        id_map = id_map->next;
+        id_map = id_map->next_LID;
     }
     return 0;
 }
 
 mpr_id_map mpr_dev_get_id_map_by_GID(mpr_local_dev dev, int group, mpr_id GID)
 {
-    mpr_id_map id_map = dev->id_maps.active[group];
-    while (id_map) {
-        if (id_map->GID == GID)
-            return id_map;
-        id_map = id_map->next;
-    }
-    return 0;
+    return (mpr_id_map)mpr_hash_get_id(dev->id_maps.by_GID[group], GID);
 }
 
 /* TODO: rename this function */
 mpr_id_map mpr_dev_get_id_map_GID_free(mpr_local_dev dev, int group, mpr_id last_GID)
 {
-    int searching = last_GID != 0;
-    mpr_id_map id_map = dev->id_maps.active[group];
-    while (id_map && searching) {
-        if (id_map->GID == last_GID)
-            searching = 0;
+    mpr_id_map id_map;
+    if (last_GID) {
+        /* resume the search after the id map with the last GID */
+        id_map = mpr_dev_get_id_map_by_GID(dev, group, last_GID);
+        RETURN_ARG_UNLESS(id_map, 0);
         id_map = id_map->next;
     }
+    else
+        id_map = dev->id_maps.active[group];
     while (id_map) {
         if (!id_map->remapped && id_map->GID_refcount <= 0)
             return id_map;
@@ -812,7 +1240,7 @@ void mpr_local_dev_probe_name(mpr_local_dev dev, int start_ordinal, mpr_net net)
     trace_dev(dev, "probing name '%s'\n", dev->name);
 
     /* Calculate an id from the name and store it in id.val */
-    dev->obj.id = mpr_id_from_str(dev->name);
+    mpr_obj_set_id((mpr_obj)dev, mpr_id_from_str(dev->name));
 
     mpr_net_send_name_probe(net, dev->name);
 }
@@ -1107,6 +1535,31 @@ void mpr_dev_set_is_subscribed(mpr_dev dev, int subscribed)
     dev->subscribed = (subscribed != 0);
 }
 
+static void set_subscriber_addr(mpr_subscriber sub, const char *host, const char *port,
+                                mpr_proto proto)
+{
+    if (MPR_PROTO_TCP == proto) {
+        sub->addr = lo_address_new_with_proto(LO_TCP, host, port);
+        lo_address_set_tcp_nodelay(sub->addr, 1);
+        sub->udp = 0;
+    }
+    else {
+        sub->addr = lo_address_new(host, port);
+        /* resolve once so that updates can be sent without re-serializing for each subscriber */
+        sub->udp = mpr_udp_dst_new(host, port);
+    }
+    sub->protocol = proto;
+}
+
+static void free_subscriber(mpr_subscriber sub)
+{
+    FUNC_IF(lo_address_free, sub->addr);
+    mpr_udp_dst_free(sub->udp);
+    FUNC_IF(free, sub->host);
+    FUNC_IF(free, sub->port);
+    free(sub);
+}
+
 /* Add/renew/remove a subscription. */
 void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                                int timeout_sec, int revision, mpr_proto proto)
@@ -1133,10 +1586,7 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                     int prev_flags = sub->flags;
                     trace_dev(dev, "removing subscription from %s:%s\n", sub->host, sub->port);
                     *sublist = sub->next;
-                    FUNC_IF(lo_address_free, sub->addr);
-                    FUNC_IF(free, sub->host);
-                    FUNC_IF(free, sub->port);
-                    free(sub);
+                    free_subscriber(sub);
                     RETURN_UNLESS(flags && (flags &= ~prev_flags));
                     sub = *sublist;
                 }
@@ -1151,14 +1601,8 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                     if (proto != sub->protocol) {
                         /* switching network protocol */
                         lo_address_free(sub->addr);
-                        if (MPR_PROTO_TCP == proto) {
-                            sub->addr = lo_address_new_with_proto(LO_TCP, host, port);
-                            lo_address_set_tcp_nodelay(sub->addr, 1);
-                        }
-                        else {
-                            sub->addr = lo_address_new(host, port);
-                        }
-                        sub->protocol = proto;
+                        mpr_udp_dst_free(sub->udp);
+                        set_subscriber_addr(sub, host, port, proto);
                     }
                     sub->lease_exp = t.sec + timeout_sec;
                     flags &= ~sub->flags;
@@ -1180,14 +1624,7 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
         print_subscription_flags(flags);
 #endif
         sub = malloc(sizeof(mpr_subscriber_t));
-        if (MPR_PROTO_TCP == proto) {
-            sub->addr = lo_address_new_with_proto(LO_TCP, host, port);
-            lo_address_set_tcp_nodelay(sub->addr, 1);
-        }
-        else {
-            sub->addr = lo_address_new(host, port);
-        }
-        sub->protocol = proto;
+        set_subscriber_addr(sub, host, port, proto);
         sub->host = strdup(host);
         sub->port = strdup(port);
         sub->lease_exp = t.sec + timeout_sec;
@@ -1274,10 +1711,13 @@ int mpr_local_dev_has_subscribers(mpr_local_dev dev)
     return dev->subscribers != 0;
 }
 
-void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle,
-                                       int msg_type, lo_server *servers)
+void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle, const char *data,
+                                       size_t len, int msg_type, lo_server *servers)
 {
+    mpr_net net = mpr_graph_get_net(dev->obj.graph);
     mpr_subscriber *sub = &dev->subscribers;
+    mpr_udp_dst dsts[MAX_SUB_DSTS];
+    int num_dsts = 0;
     mpr_time t;
     if (!*sub)
         return;
@@ -1298,14 +1738,26 @@ void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle,
 #endif /* DEBUG */
             mpr_subscriber temp = *sub;
             *sub = temp->next;
-            FUNC_IF(lo_address_free, temp->addr);
-            free(temp);
+            free_subscriber(temp);
             continue;
         }
-        if ((*sub)->flags & msg_type)
-            lo_send_bundle_from((*sub)->addr, servers[MPR_PROTO_TCP == (*sub)->protocol], bundle);
+        if ((*sub)->flags & msg_type) {
+            if (data && (*sub)->udp) {
+                /* the bundle has already been serialized: batch the UDP sends */
+                dsts[num_dsts++] = (*sub)->udp;
+                if (num_dsts >= MAX_SUB_DSTS) {
+                    mpr_net_send_udp(net, data, len, dsts, num_dsts);
+                    num_dsts = 0;
+                }
+            }
+            else
+                lo_send_bundle_from((*sub)->addr, servers[MPR_PROTO_TCP == (*sub)->protocol],
+                                    bundle);
+        }
         sub = &(*sub)->next;
     }
+    if (num_dsts)
+        mpr_net_send_udp(net, data, len, dsts, num_dsts);
 }
 
 void mpr_local_dev_restart_registration(mpr_local_dev dev, int start_ordinal)
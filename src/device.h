@@ -82,6 +82,13 @@ void mpr_dev_update_subscribers(mpr_local_dev dev);
 
 void mpr_dev_remove_sig(mpr_dev dev, mpr_sig sig);
 
+/*! Keep track of the signals and maps involving a device so that mpr_dev_get_sigs() and
+ *  mpr_dev_get_maps() do not need to search the whole graph. */
+void mpr_dev_add_adj_sig(mpr_dev dev, mpr_sig sig);
+void mpr_dev_remove_adj_sig(mpr_dev dev, mpr_sig sig);
+void mpr_dev_add_adj_map(mpr_dev dev, mpr_map map);
+void mpr_dev_remove_adj_map(mpr_dev dev, mpr_map map);
+
 const char *mpr_dev_get_name(mpr_dev dev);
 
 void mpr_dev_send_state(mpr_dev dev, net_msg_t cmd);
@@ -106,10 +113,87 @@ void mpr_local_dev_set_sending(mpr_local_dev dev);
 
 void mpr_local_dev_set_receiving(mpr_local_dev dev);
 
+/*! Add a local map to the queue of maps to process during the device's next processing cycle.
+ *  \param dev          The local device that processes the map.
+ *  \param map          The map to queue. */
+void mpr_local_dev_queue_map(mpr_local_dev dev, mpr_local_map map);
+
+/*! Remove a local map from the device's processing queue. */
+void mpr_local_dev_dequeue_map(mpr_local_dev dev, mpr_local_map map);
+
+/*! Add a link to the queue of links with bundles to send during the device's next processing
+ *  cycle.
+ *  \param dev          The local device of the link.
+ *  \param link         The link to queue. */
+void mpr_local_dev_queue_link(mpr_local_dev dev, mpr_link link);
+
+/*! Remove a link from the device's processing queue. */
+void mpr_local_dev_dequeue_link(mpr_local_dev dev, mpr_link link);
+
+/*! Register a link that receives updates from a co-located device through a shared-memory ring.
+ *  \param dev          The local device of the link.
+ *  \param link         The link to register. */
+void mpr_local_dev_add_ring_link(mpr_local_dev dev, mpr_link link);
+
+/*! Unregister a link added with mpr_local_dev_add_ring_link(). */
+void mpr_local_dev_remove_ring_link(mpr_local_dev dev, mpr_link link);
+
+/*! Dispatch updates waiting in the shared-memory rings of the device's links.
+ *  \param dev          The local device.
+ *  \param block        Non-zero if the caller is about to block waiting on the device's
+ *                      sockets, in which case remote devices are asked to send a wakeup
+ *                      message along with their next update.
+ *  \return             The number of updates dispatched. The caller must not block if this is
+ *                      non-zero. */
+int mpr_local_dev_recv_rings(mpr_local_dev dev, int block);
+
+/*! Queue a signal update from any thread without locking or allocating memory.
+ *  \param dev          The local device of the signal.
+ *  \param sig          The signal to update.
+ *  \param id           The signal instance to update.
+ *  \param len          The length of the value, or zero to release the instance.
+ *  \param type         The type of the value.
+ *  \param val          The value, or NULL to release the instance.
+ *  \param time         The time of the update, or MPR_NOW to use the time it is processed.
+ *  \return             Zero if the update was queued, or nonzero if the queue is full or the value
+ *                      is too large. */
+int mpr_local_dev_queue_update(mpr_local_dev dev, mpr_local_sig sig, mpr_id id, int len,
+                               mpr_type type, const void *val, mpr_time time);
+
+/*! Hand a map slot update over to the data thread servicing another device, without locking.
+ *  \param dev          The local device of the signal.
+ *  \param sig          The signal receiving the update.
+ *  \param slot_id      The id of the map slot, or -1 for destination slots.
+ *  \param GID          The global id of the instance, or 0.
+ *  \param len          The length of the value.
+ *  \param types        Per-element types, using MPR_NULL for elements without a value.
+ *  \param vals         The value.
+ *  \param time         The time of the update.
+ *  \return             Zero if the update was queued, or nonzero if the queue is full. */
+int mpr_local_dev_queue_slot_update(mpr_local_dev dev, mpr_local_sig sig, int slot_id, mpr_id GID,
+                                    int len, const mpr_type *types, const void *vals, mpr_time time);
+
+/*! Apply the signal updates queued with mpr_local_dev_queue_update() and
+ *  mpr_local_dev_queue_slot_update().
+ *  \param dev          The local device.
+ *  \param block        Non-zero if the caller is about to block waiting on the device's sockets,
+ *                      in which case the next thread to queue an update wakes the data thread.
+ *  \return             The number of updates applied. The caller must not block if this is
+ *                      non-zero. */
+int mpr_local_dev_recv_updates(mpr_local_dev dev, int block);
+
 int mpr_local_dev_has_subscribers(mpr_local_dev dev);
 
-void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle, int msg_type,
-                                       lo_server *servers);
+/*! Send a bundle to the subscribers interested in a message type, removing expired
+ *  subscriptions. UDP subscribers are sent the serialized data directly if it is provided.
+ *  \param dev          The local device.
+ *  \param bundle       The bundle to send.
+ *  \param data         The bundle serialized once for all subscribers, or NULL.
+ *  \param len          The length of the serialized data in bytes.
+ *  \param msg_type     The subscription flags matching the bundle contents.
+ *  \param servers      The mesh UDP and TCP servers to send from. */
+void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle, const char *data,
+                                       size_t len, int msg_type, lo_server *servers);
 
 void mpr_local_dev_handler_name(mpr_local_dev dev, const char *name,
                                 int temp_id, int random_id, int hint);
@@ -125,12 +209,25 @@ void mpr_local_dev_handler_logout(mpr_local_dev dev, mpr_dev remote, const char
 
 void mpr_local_dev_add_sig(mpr_local_dev dev, mpr_local_sig sig, mpr_dir dir);
 
+/*! Find a local signal by the alias assigned to it in mpr_local_dev_add_sig().
+ *  \param dev          The local device.
+ *  \param alias        The alias used in the path of a data message.
+ *  \return             The signal, or NULL if the alias is unknown. */
+mpr_local_sig mpr_local_dev_get_sig_by_alias(mpr_local_dev dev, int alias);
+
 mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id GID, int indirect);
 
 mpr_id_map mpr_dev_get_id_map_by_LID(mpr_local_dev dev, int group, mpr_id LID);
 
 mpr_id_map mpr_dev_get_id_map_by_GID(mpr_local_dev dev, int group, mpr_id GID);
 
+/*! Change the GID of an active id map, keeping the device id map indexes consistent.
+ *  \param dev      The local device owning the id map.
+ *  \param group    The signal group of the id map.
+ *  \param id_map   The id map to modify.
+ *  \param GID      The new GID. */
+void mpr_dev_set_id_map_GID(mpr_local_dev dev, int group, mpr_id_map id_map, mpr_id GID);
+
 /* TODO: rename this function */
 mpr_id_map mpr_dev_get_id_map_GID_free(mpr_local_dev dev, int group, mpr_id last_GID);
 
@@ -145,9 +242,23 @@ void mpr_local_dev_print_id_maps(mpr_local_dev dev);
 double mpr_dev_get_offset(mpr_dev dev);
 double mpr_dev_set_offset(mpr_dev dev, double offset, double weight);
 
-void mpr_local_dev_check_map_timing(mpr_local_dev dev);
+/*! Schedule or reschedule the evaluation of a self-timed map instance.
+ *  \param dev          The local device that processes the map.
+ *  \param map          The map to evaluate.
+ *  \param inst_idx     Index of the map instance to evaluate.
+ *  \param pos          Location owned by the map used to track the timer; must be initialized to
+ *                      -1 and is reset to -1 when the timer expires or is removed.
+ *  \param time         Time at which the instance should be evaluated. */
+void mpr_local_dev_set_timer(mpr_local_dev dev, mpr_local_map map, int inst_idx, int *pos,
+                             mpr_time time);
+
+/*! Cancel a timer set using mpr_local_dev_set_timer(). */
+void mpr_local_dev_remove_timer(mpr_local_dev dev, int *pos);
 
 /* returns the number of ms until next device event */
 int mpr_local_dev_update_maps(mpr_local_dev dev);
 
+/* returns the number of ms until the device needs to be processed, without processing it */
+int mpr_local_dev_get_deadline(mpr_local_dev dev);
+
 #endif /* __MPR_DEVICE_H__ */
@@ -7,8 +7,10 @@
 #include "expression/expr_buffer.h"
 #include "expression/expr_evaluator.h"
 #include "expression/expr_function.h"
+#include "expression/expr_kernel.h"
 #include "expression/expr_operator.h"
 #include "expression/expr_parser.h"
+#include "expression/expr_program.h"
 #include "expression/expr_stack.h"
 #include "expression/expr_struct.h"
 #include "expression/expr_token.h"
@@ -26,10 +28,13 @@
 #define REDUCES_INST 0x04
 #define MANAGES_TIME 0x08
 
-/* Reallocate evaluation stack if necessary. */
+/* Reallocate evaluation stack if necessary. The required size is cached since this is called
+ * before every evaluation. */
 void mpr_expr_realloc_eval_buffer(mpr_expr expr, mpr_expr_eval_buffer buff)
 {
-    ebuffer_realloc(buff, estack_get_eval_buffer_size(expr->stack), expr->stack->vec_len);
+    if (!expr->eval_slots)
+        expr->eval_slots = estack_get_eval_buffer_size(expr->stack);
+    ebuffer_realloc(buff, expr->eval_slots, expr->stack->vec_len);
 }
 
 mpr_expr_eval_buffer mpr_expr_new_eval_buffer(mpr_expr expr)
@@ -80,6 +85,7 @@ void mpr_expr_cpy_stack_and_vars(mpr_expr expr, void *stack, void *vars, int num
 {
     estack_cpy(expr->stack, (estack)stack);
     expr->flags |= OWN_STACK;
+    expr->eval_slots = 0;
 
     if (num_var) {
         int i;
@@ -113,6 +119,8 @@ mpr_expr mpr_expr_new_from_str(const char *str, unsigned int num_src, const mpr_
 
     RETURN_ARG_UNLESS(str && num_src && src_types && src_lens, 0);
 
+    ekernel_init_once();
+
     expr = mpr_expr_new(num_src, num_dst, NULL);
 
     if (expr_parser_build_stack(expr, str, num_src, src_types, src_lens,
@@ -133,6 +141,8 @@ mpr_expr mpr_expr_new_from_str(const char *str, unsigned int num_src, const mpr_
     if (expr->inst_ctl >= 0)
         expr->flags |= MANAGES_INST;
 
+    expr->prog = eprog_new(expr);
+
 #if TRACE_PARSE
     printf("expression allocated and initialized with %d tokens\n", expr->stack->num_tokens);
 #endif
@@ -143,6 +153,7 @@ void mpr_expr_free(mpr_expr expr)
 {
     int i;
     FUNC_IF(free, expr->src_mlen);
+    FUNC_IF(eprog_free, expr->prog);
     if (expr->flags & OWN_STACK)
         estack_free(expr->stack, 1);
     if (expr->num_vars && expr->vars) {
@@ -306,6 +317,23 @@ void mpr_expr_set_var_updated(mpr_expr expr, int var_idx)
     return;
 }
 
+int mpr_expr_set_use_program(mpr_expr expr, int use)
+{
+    RETURN_ARG_UNLESS(expr, 0);
+    if (!use) {
+        FUNC_IF(eprog_free, expr->prog);
+        expr->prog = 0;
+    }
+    else if (!expr->prog)
+        expr->prog = eprog_new(expr);
+    return expr->prog != 0;
+}
+
+const char *mpr_expr_set_use_simd(int enable)
+{
+    return ekernel_init(enable);
+}
+
 int mpr_expr_get_num_tokens(mpr_expr expr)
 {
     return expr->stack->num_tokens;
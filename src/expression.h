@@ -64,6 +64,22 @@ void mpr_expr_set_var_updated(mpr_expr expr, int var_idx);
 int mpr_expr_eval(mpr_expr expr, mpr_expr_eval_buffer buff, mpr_value *srcs, mpr_value *expr_vars,
                   mpr_value result, mpr_time *time, mpr_value next, int inst_idx);
 
+/*! Evaluate an expression for several instances at once using its compiled program. Expressions
+ *  that are interpreted, or whose result may not depend on the instance, are not batched.
+ *  \param expr         The expression to evaluate.
+ *  \param srcs         Source values, as for mpr_expr_eval().
+ *  \param expr_vars    User variable values, as for mpr_expr_eval().
+ *  \param result       The output value.
+ *  \param time         Timetag for the evaluation.
+ *  \param inst_idx     Array of `num_inst` instance indices to evaluate.
+ *  \param num_inst     Number of instances to evaluate.
+ *  \param status       Array of `num_inst` statuses to fill, in the format returned by
+ *                      mpr_expr_eval(). An entry of -1 means the instance must be evaluated
+ *                      separately using mpr_expr_eval().
+ *  \return             1 if the instances were evaluated, 0 if the expression cannot be batched. */
+int mpr_expr_eval_batch(mpr_expr expr, mpr_value *srcs, mpr_value *expr_vars, mpr_value result,
+                        mpr_time *time, const int *inst_idx, int num_inst, int *status);
+
 int mpr_expr_get_num_src(mpr_expr expr);
 
 mpr_expr_eval_buffer mpr_expr_new_eval_buffer(mpr_expr expr);
@@ -78,6 +94,19 @@ int mpr_expr_get_num_subexpr(mpr_expr expr);
 
 int mpr_expr_get_num_tokens(mpr_expr expr);
 
+/*! Enable or disable evaluation using the register bytecode compiled from the expression stack.
+ *  Expressions containing constructs that cannot be compiled are always interpreted.
+ *  \param expr         The expression to use.
+ *  \param use          1 to use the compiled program if possible, 0 to always interpret.
+ *  \return             1 if the expression will be evaluated using a compiled program. */
+int mpr_expr_set_use_program(mpr_expr expr, int use);
+
+/*! Enable or disable the vectorized kernels used to evaluate operations on long vectors. This
+ *  setting is global; kernels are enabled by default on processors that support them.
+ *  \param enable       1 to use vectorized kernels if available, 0 to use only scalar loops.
+ *  \return             The name of the instruction set in use, or "scalar". */
+const char *mpr_expr_set_use_simd(int enable);
+
 void mpr_expr_restart(mpr_expr expr);
 
 #if DEBUG
@@ -5,6 +5,7 @@
 #include <math.h>
 #include <errno.h>
 #include "expr_buffer.h"
+#include "expr_program.h"
 #include "expr_struct.h"
 #include "expr_token.h"
 #include <mapper/mapper.h>
@@ -25,6 +26,20 @@
         break;                                                      \
     }
 
+/* Binary operators with a vectorized kernel; the kernel is used when the right operand is either
+ * broadcast or at least as long as the left, so that no modulo indexing is required. */
+#define KERNEL_OP_CASE(OP, KOP, SYM, T)                             \
+    case OP: {                                                      \
+        int i, j;                                                   \
+        if ((1 == rlen || rlen >= lens[dp])                         \
+            && ekernel_run(KOP, EK_TYPE_##T, vals + sp, vals + sp,  \
+                           vals + sp + vlen, 0, lens[dp], 1, 1 != rlen, 0))\
+            break;                                                  \
+        for (i = 0, j = sp; i < lens[dp]; i++, j++)                 \
+            vals[j].T = vals[j].T SYM vals[sp + vlen + i % rlen].T; \
+        break;                                                      \
+    }
+
 #define CONDITIONAL_CASES(T)                                        \
     case OP_IF_ELSE: {                                              \
         int i, j;                                                   \
@@ -45,19 +60,19 @@
         break;                                                      \
     }
 
-#define OP_CASES_META(EL)                                   \
-    BINARY_OP_CASE(OP_ADD, +, EL);                          \
-    BINARY_OP_CASE(OP_SUBTRACT, -, EL);                     \
-    BINARY_OP_CASE(OP_MULTIPLY, *, EL);                     \
-    BINARY_OP_CASE(OP_IS_EQUAL, ==, EL);                    \
-    BINARY_OP_CASE(OP_IS_NOT_EQUAL, !=, EL);                \
-    BINARY_OP_CASE(OP_IS_LESS_THAN, <, EL);                 \
-    BINARY_OP_CASE(OP_IS_LESS_THAN_OR_EQUAL, <=, EL);       \
-    BINARY_OP_CASE(OP_IS_GREATER_THAN, >, EL);              \
-    BINARY_OP_CASE(OP_IS_GREATER_THAN_OR_EQUAL, >=, EL);    \
-    BINARY_OP_CASE(OP_LOGICAL_AND, &&, EL);                 \
-    BINARY_OP_CASE(OP_LOGICAL_OR, ||, EL);                  \
-    UNARY_OP_CASE(OP_LOGICAL_NOT, =!, EL);                  \
+#define OP_CASES_META(EL)                                       \
+    KERNEL_OP_CASE(OP_ADD, EK_ADD, +, EL);                      \
+    KERNEL_OP_CASE(OP_SUBTRACT, EK_SUB, -, EL);                 \
+    KERNEL_OP_CASE(OP_MULTIPLY, EK_MUL, *, EL);                 \
+    KERNEL_OP_CASE(OP_IS_EQUAL, EK_EQ, ==, EL);                 \
+    KERNEL_OP_CASE(OP_IS_NOT_EQUAL, EK_NE, !=, EL);             \
+    KERNEL_OP_CASE(OP_IS_LESS_THAN, EK_LT, <, EL);              \
+    KERNEL_OP_CASE(OP_IS_LESS_THAN_OR_EQUAL, EK_LE, <=, EL);    \
+    KERNEL_OP_CASE(OP_IS_GREATER_THAN, EK_GT, >, EL);           \
+    KERNEL_OP_CASE(OP_IS_GREATER_THAN_OR_EQUAL, EK_GE, >=, EL); \
+    BINARY_OP_CASE(OP_LOGICAL_AND, &&, EL);                     \
+    BINARY_OP_CASE(OP_LOGICAL_OR, ||, EL);                      \
+    UNARY_OP_CASE(OP_LOGICAL_NOT, =!, EL);                      \
     CONDITIONAL_CASES(EL);
 
 MPR_INLINE static int _max(int a, int b)
@@ -65,6 +80,16 @@ MPR_INLINE static int _max(int a, int b)
     return a > b ? a : b;
 }
 
+/* Vectorized kernel equivalent to a function token, or -1 if there is none. */
+MPR_INLINE static int _fn_kernel_op(int idx, int arity)
+{
+    if (1 == arity)
+        return FN_SQRT == idx ? EK_SQRT : FN_ABS == idx ? EK_ABS : -1;
+    if (2 == arity)
+        return FN_MIN == idx ? EK_MIN : FN_MAX == idx ? EK_MAX : -1;
+    return -1;
+}
+
 #define SET_STACK_PTR(ADDEND)           \
     dp = ADDEND;                        \
     assert(dp >= 0 || dp < buff->size); \
@@ -99,6 +124,15 @@ MPR_INLINE static int _newest_val_idx(mpr_value *vals, int num_vals, int inst_id
     return newest_idx;
 }
 
+int mpr_expr_eval_batch(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars, mpr_value v_out,
+                        mpr_time *time, const int *inst_idx, int num_inst, int *status)
+{
+    estack stk = expr->stack;
+    RETURN_ARG_UNLESS(expr->prog && (stk->initialized || !stk->init_offset), 0);
+    return eprog_eval_batch(expr->prog, expr, v_in, v_vars, v_out, time, inst_idx, num_inst,
+                            status);
+}
+
 #define BAIL_UNLESS(X)  \
     if (!X) goto bail;
 
@@ -112,14 +146,23 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
     estack stk = expr->stack;
     etoken_t *tok = stk->tokens, *end = tok + stk->num_tokens, *init = tok + stk->init_offset;
     int dp = -1, sp = -stk->vec_len, status = 1 | EXPR_EVAL_DONE;
-    /* Note: signal, history, and vector reduce are currently limited to 255 items here */
-    uint8_t alive = 1, muted = 0, cache = 0, vlen = stk->vec_len;
-    uint8_t hist_offset = 0, sig_offset = 0, vec_offset = 0;
+    /* Note: signal and history reduce are currently limited to 255 items here */
+    uint8_t alive = 1, muted = 0, cache = 0;
+    uint8_t hist_offset = 0, sig_offset = 0;
+    uint16_t vlen = stk->vec_len, vec_offset = 0;
     mpr_value x = NULL;
     mpr_time then;
 
+    /* use the compiled program once any initialization tokens have been evaluated */
+    if (expr->prog && (stk->initialized || !stk->init_offset)) {
+        int prog_status = eprog_eval(expr->prog, expr, v_in, v_vars, v_out, time, inst_idx);
+        if (prog_status >= 0)
+            return prog_status;
+    }
+
     evalue vals = buff->vals;
-    uint8_t *lens = buff->lens, src_updated = 0;
+    uint16_t *lens = buff->lens;
+    uint8_t src_updated = 0;
     mpr_type *types = buff->types;
 
     if (v_out) {
@@ -521,7 +564,8 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
             break;
         }
         case TOK_OP: {
-            uint8_t i, max_len, rlen, arity = tok->op.arity;
+            uint8_t arity = tok->op.arity;
+            uint16_t i, max_len, rlen;
             INCR_STACK_PTR(1 - arity);
             /* first copy vals[sp] elements if necessary */
             max_len = lens[dp];
@@ -569,7 +613,7 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
                 case MPR_FLT: {
                     switch (tok->op.idx) {
                         OP_CASES_META(f);
-                        BINARY_OP_CASE(OP_DIVIDE, /, f);
+                        KERNEL_OP_CASE(OP_DIVIDE, EK_DIV, /, f);
                         case OP_MODULO: {
                             int i;
                             for (i = 0; i < max_len; i++)
@@ -583,7 +627,7 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
                 case MPR_DBL: {
                     switch (tok->op.idx) {
                         OP_CASES_META(d);
-                        BINARY_OP_CASE(OP_DIVIDE, /, d);
+                        KERNEL_OP_CASE(OP_DIVIDE, EK_DIV, /, d);
                         case OP_MODULO: {
                             int i;
                             for (i = 0; i < max_len; i++)
@@ -606,8 +650,9 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
             break;
         }
         case TOK_FN: {
-            int i, diff;
-            uint8_t max_len, llen, rlen = 0, arity = tok->fn.arity;
+            int i, diff, kop;
+            uint8_t arity = tok->fn.arity;
+            uint16_t max_len, llen, rlen = 0;
             INCR_STACK_PTR(1 - arity);
             /* TODO: use preprocessor macro or inline func here */
             /* first copy vals[sp] elements if necessary */
@@ -624,6 +669,7 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
             llen = lens[dp];
             if (arity > 1)
                 rlen = lens[dp + 1];
+            kop = _fn_kernel_op(tok->fn.idx, arity);
             SET_TYPE(tok->gen.datatype);
             switch (types[dp]) {
 #define TYPED_CASE(MTYPE, FN, T)                                                        \
@@ -634,11 +680,17 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
                         vals[sp + i].T = ((FN##_arity0*)fn_tbl[tok->fn.idx].FN)();      \
                     break;                                                              \
                 case 1:                                                                 \
+                    if (ekernel_run(kop, EK_TYPE_##T, vals + sp, vals + sp, 0, 0, llen, 1, 0, 0))\
+                        break;                                                          \
                     for (i = 0; i < llen; i++)                                          \
                         vals[sp + i].T = (((FN##_arity1*)fn_tbl[tok->fn.idx].FN)        \
                                           (vals[sp + i].T));                            \
                     break;                                                              \
                 case 2:                                                                 \
+                    if ((1 == rlen || rlen >= llen)                                     \
+                        && ekernel_run(kop, EK_TYPE_##T, vals + sp, vals + sp,          \
+                                       vals + sp + vlen, 0, llen, 1, 1 != rlen, 0))     \
+                        break;                                                          \
                     for (i = 0; i < llen; i++)                                          \
                         vals[sp + i].T = (((FN##_arity2*)fn_tbl[tok->fn.idx].FN)        \
                                           (vals[sp + i].T, vals[sp + vlen + i % rlen].T));\
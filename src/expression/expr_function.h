@@ -71,18 +71,18 @@ static double periodicd(double period, double t_start, double t_now)
     return (floor((t_now - t_start + 0.001) / period) + 1) * period + t_start;
 }
 
-#define COMP_VFUNC(NAME, TYPE, OP, CMP, RET, T)     \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE ret = 1 - RET;                    \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        if (val[i].T OP CMP) {                      \
-            ret = RET;                              \
-            break;                                  \
-        }                                           \
-    }                                               \
-    val[0].T = ret;                                 \
+#define COMP_VFUNC(NAME, TYPE, OP, CMP, RET, T)      \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE ret = 1 - RET;                     \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        if (val[i].T OP CMP) {                       \
+            ret = RET;                               \
+            break;                                   \
+        }                                            \
+    }                                                \
+    val[0].T = ret;                                  \
 }
 COMP_VFUNC(valli, int, ==, 0, 0, i)
 COMP_VFUNC(vallf, float, ==, 0.f, 0, f)
@@ -91,76 +91,76 @@ COMP_VFUNC(vanyi, int, !=, 0, 1, i)
 COMP_VFUNC(vanyf, float, !=, 0.f, 1, f)
 COMP_VFUNC(vanyd, double, !=, 0., 1, d)
 
-#define LEN_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    val[0].T = dim[0];                              \
+#define LEN_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    val[0].T = dim[0];                               \
 }
 LEN_VFUNC(vleni, int, i)
 LEN_VFUNC(vlenf, float, f)
 LEN_VFUNC(vlend, double, d)
 
-#define SUM_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE aggregate = 0;                    \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        aggregate += val[i].T;                      \
-    val[0].T = aggregate;                           \
+#define SUM_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE aggregate = 0;                     \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++)                        \
+        aggregate += val[i].T;                       \
+    val[0].T = aggregate;                            \
 }
 SUM_VFUNC(vsumi, int, i)
 SUM_VFUNC(vsumf, float, f)
 SUM_VFUNC(vsumd, double, d)
 
-#define PROD_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE product = 0;                      \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        product *= val[i].T;                        \
-    val[0].T = product;                             \
+#define PROD_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE product = 0;                       \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++)                        \
+        product *= val[i].T;                         \
+    val[0].T = product;                              \
 }
 PROD_VFUNC(vprodi, int, i)
 PROD_VFUNC(vprodf, float, f)
 PROD_VFUNC(vprodd, double, d)
 
-#define MEAN_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    vsum##T(val, dim, inc);                         \
-    val[0].T /= dim[0];                             \
+#define MEAN_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    vsum##T(val, dim, inc);                          \
+    val[0].T /= dim[0];                              \
 }
 MEAN_VFUNC(vmeanf, float, f)
 MEAN_VFUNC(vmeand, double, d)
 
-#define CENTER_VFUNC(NAME, TYPE, T)                 \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE max = val[0].T, min = max;        \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        if (val[i].T > max)                         \
-            max = val[i].T;                         \
-        if (val[i].T < min)                         \
-            min = val[i].T;                         \
-    }                                               \
-    val[0].T = (max + min) * 0.5;                   \
+#define CENTER_VFUNC(NAME, TYPE, T)                  \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE max = val[0].T, min = max;         \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        if (val[i].T > max)                          \
+            max = val[i].T;                          \
+        if (val[i].T < min)                          \
+            min = val[i].T;                          \
+    }                                                \
+    val[0].T = (max + min) * 0.5;                    \
 }
 CENTER_VFUNC(vcenterf, float, f)
 CENTER_VFUNC(vcenterd, double, d)
 
-#define EXTREMA_VFUNC(NAME, OP, TYPE, T)            \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE extrema = val[0].T;               \
-    int i, len = dim[0];                            \
-    for (i = 1; i < len; i++) {                     \
-        if (val[i].T OP extrema)                    \
-            extrema = val[i].T;                     \
-    }                                               \
-    val[0].T = extrema;                             \
+#define EXTREMA_VFUNC(NAME, OP, TYPE, T)             \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE extrema = val[0].T;                \
+    int i, len = dim[0];                             \
+    for (i = 1; i < len; i++) {                      \
+        if (val[i].T OP extrema)                     \
+            extrema = val[i].T;                      \
+    }                                                \
+    val[0].T = extrema;                              \
 }
 EXTREMA_VFUNC(vmaxi, >, int, i)
 EXTREMA_VFUNC(vmini, <, int, i)
@@ -186,7 +186,7 @@ DEC_SORT_FUNC(float, f)
 DEC_SORT_FUNC(double, d)
 
 #define SORT_VFUNC(NAME, TYPE, T)                               \
-static void NAME(evalue val, uint8_t *dim, int inc)             \
+static void NAME(evalue val, uint16_t *dim, int inc)            \
 {                                                               \
     evalue dir = val + inc;                                     \
     if (dir[0].T >= 0)                                          \
@@ -199,7 +199,7 @@ SORT_VFUNC(vsortf, float, f)
 SORT_VFUNC(vsortd, double, d)
 
 #define MEDIAN_VFUNC(NAME, TYPE, T)                         \
-static void NAME(evalue val, uint8_t *dim, int inc)         \
+static void NAME(evalue val, uint16_t *dim, int inc)        \
 {                                                           \
     register int idx = floor(dim[0] * 0.5);                 \
     register double tmp;                                    \
@@ -215,20 +215,20 @@ MEDIAN_VFUNC(vmediani, int, i)
 MEDIAN_VFUNC(vmedianf, float, f)
 MEDIAN_VFUNC(vmediand, double, d)
 
-#define NORM_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE tmp = 0;                          \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        tmp += pow##T(val[i].T, 2);                 \
-    val[0].T = sqrt##T(tmp);                        \
+#define NORM_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE tmp = 0;                           \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++)                        \
+        tmp += pow##T(val[i].T, 2);                  \
+    val[0].T = sqrt##T(tmp);                         \
 }
 NORM_VFUNC(vnormf, float, f)
 NORM_VFUNC(vnormd, double, d)
 
 #define DOT_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue a, uint8_t *dim, int inc)   \
+static void NAME(evalue a, uint16_t *dim, int inc)  \
 {                                                   \
     register TYPE dot = 0;                          \
     evalue b = a + inc;                             \
@@ -242,7 +242,7 @@ DOT_VFUNC(vdotf, float, f)
 DOT_VFUNC(vdotd, double, d)
 
 #define INDEX_VFUNC(NAME, TYPE, T)                  \
-static void NAME(evalue a, uint8_t *dim, int inc)   \
+static void NAME(evalue a, uint16_t *dim, int inc)  \
 {                                                   \
     evalue b = a + inc;                             \
     int i, len = dim[0];                            \
@@ -263,7 +263,7 @@ INDEX_VFUNC(vindexd, double, d)
 
 #define atan2d atan2
 #define ANGLE_VFUNC(NAME, TYPE, T)                              \
-static void NAME(evalue a, uint8_t *dim, int inc)               \
+static void NAME(evalue a, uint16_t *dim, int inc)              \
 {                                                               \
     register TYPE theta;                                        \
     evalue b = a + inc;                                         \
@@ -277,41 +277,41 @@ static void NAME(evalue a, uint8_t *dim, int inc)               \
 ANGLE_VFUNC(vanglef, float, f)
 ANGLE_VFUNC(vangled, double, d)
 
-#define MAXMIN_VFUNC(NAME, TYPE, T)                 \
-static void NAME(evalue max, uint8_t *dim, int inc) \
-{                                                   \
-    evalue min = max + inc, new = min + inc;        \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        if (new[i].T > max[i].T)                    \
-            max[i].T = new[i].T;                    \
-        if (new[i].T < min[i].T)                    \
-            min[i].T = new[i].T;                    \
-    }                                               \
+#define MAXMIN_VFUNC(NAME, TYPE, T)                  \
+static void NAME(evalue max, uint16_t *dim, int inc) \
+{                                                    \
+    evalue min = max + inc, new = min + inc;         \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        if (new[i].T > max[i].T)                     \
+            max[i].T = new[i].T;                     \
+        if (new[i].T < min[i].T)                     \
+            min[i].T = new[i].T;                     \
+    }                                                \
 }
 MAXMIN_VFUNC(vmaxmini, int, i)
 MAXMIN_VFUNC(vmaxminf, float, f)
 MAXMIN_VFUNC(vmaxmind, double, d)
 
-#define SUMNUM_VFUNC(NAME, TYPE, T)                 \
-static void NAME(evalue sum, uint8_t *dim, int inc) \
-{                                                   \
-    evalue num = sum + inc, new = num + inc;        \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        sum[i].T += new[i].T;                       \
-        num[i].T += 1;                              \
-    }                                               \
+#define SUMNUM_VFUNC(NAME, TYPE, T)                  \
+static void NAME(evalue sum, uint16_t *dim, int inc) \
+{                                                    \
+    evalue num = sum + inc, new = num + inc;         \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        sum[i].T += new[i].T;                        \
+        num[i].T += 1;                               \
+    }                                                \
 }
 SUMNUM_VFUNC(vsumnumi, int, i)
 SUMNUM_VFUNC(vsumnumf, float, f)
 SUMNUM_VFUNC(vsumnumd, double, d)
 
 #define CONCAT_VFUNC(NAME, TYPE, T)                                     \
-static void NAME(evalue cat, uint8_t *dim, int inc)                     \
+static void NAME(evalue cat, uint16_t *dim, int inc)                    \
 {                                                                       \
     evalue num = cat + inc, new = num + inc;                            \
-    uint8_t i, j, newlen = dim[2];                                      \
+    uint16_t i, j, newlen = dim[2];                                     \
     for (i = dim[0], j = 0; j < newlen && i < (int)num[0].T; i++, j++)  \
         cat[i].T = new[j].T;                                            \
     dim[0] = i;                                                         \
@@ -320,15 +320,15 @@ CONCAT_VFUNC(vconcati, int, i)
 CONCAT_VFUNC(vconcatf, float, f)
 CONCAT_VFUNC(vconcatd, double, d)
 
-#define REV_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    int i = 0, j = dim[0] - 1;                      \
-    while (i < j) {                                 \
-        register TYPE tmp = val[i].T;               \
-        val[i++].T = val[j].T;                      \
-        val[j--].T = tmp;                           \
-    }                                               \
+#define REV_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    int i = 0, j = dim[0] - 1;                       \
+    while (i < j) {                                  \
+        register TYPE tmp = val[i].T;                \
+        val[i++].T = val[j].T;                       \
+        val[j--].T = tmp;                            \
+    }                                                \
 }
 REV_VFUNC(vrevi, int, i)
 REV_VFUNC(vrevf, float, f)
@@ -337,7 +337,7 @@ REV_VFUNC(vrevd, double, d)
 /* Fast quaternion multiplication adapted from:
  * http://www.j3d.org/matrix_faq/matrfaq_latest.html#Q53 */
 #define MULT_QFUNC(NAME, TYPE, T)                                   \
-static void NAME(evalue l, uint8_t *dim, int inc)                   \
+static void NAME(evalue l, uint16_t *dim, int inc)                  \
 {                                                                   \
     evalue r = l + inc;                                             \
     TYPE ww = (l[3].T + l[1].T) * (r[1].T + r[2].T);                \
@@ -358,7 +358,7 @@ MULT_QFUNC(qmultf, float, f)
 MULT_QFUNC(qmultd, double, d)
 
 #define CONJ_QFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue q, uint8_t *dim, int inc)   \
+static void NAME(evalue q, uint16_t *dim, int inc)  \
 {                                                   \
     q[1].T *= -1;                                   \
     q[2].T *= -1;                                   \
@@ -373,7 +373,7 @@ CONJ_QFUNC(qconjd, double, d)
 #define qinvmagd(Q) (1. / qmagd(Q))
 
 #define INV_QFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue q, uint8_t *dim, int inc)   \
+static void NAME(evalue q, uint16_t *dim, int inc)  \
 {                                                   \
     TYPE m = qmag##T(q);                            \
     if (m == 0)                                     \
@@ -389,7 +389,7 @@ INV_QFUNC(qinvf, float, f)
 INV_QFUNC(qinvd, double, d)
 
 #define SLERP_QFUNC(NAME, TYPE, T)                                                              \
-static void NAME(evalue l, uint8_t *dim, int inc)                                               \
+static void NAME(evalue l, uint16_t *dim, int inc)                                              \
 {                                                                                               \
     evalue r = l + inc;                                                                         \
     TYPE w = (r + inc)[0].T;                                                                    \
@@ -446,17 +446,17 @@ SLERP_QFUNC(qslerpd, double, d)
 
 /* TODO: consider merits of adding an `accum` function. */
 
-#define DIFF_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue out, uint8_t *dim, int inc) \
-{                                                   \
-    evalue mem = out + inc;                         \
-    evalue new = mem + inc;                         \
-    uint8_t i;                                      \
-    for (i = 0; i < dim[0]; i++) {                  \
-        out[i].T = new[i].T - mem[i].T;             \
-        /* store current value of `new` */          \
-        mem[i].T = new[i].T;                        \
-    }                                               \
+#define DIFF_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue out, uint16_t *dim, int inc) \
+{                                                    \
+    evalue mem = out + inc;                          \
+    evalue new = mem + inc;                          \
+    uint16_t i;                                      \
+    for (i = 0; i < dim[0]; i++) {                   \
+        out[i].T = new[i].T - mem[i].T;              \
+        /* store current value of `new` */           \
+        mem[i].T = new[i].T;                         \
+    }                                                \
 }
 DIFF_VFUNC(vdiffi, int, i)
 DIFF_VFUNC(vdifff, float, f)
@@ -471,11 +471,11 @@ DIFF_VFUNC(vdiffd, double, d)
  */
 
 #define EDGE_VFUNC(NAME, TYPE, T)                     \
-static void NAME(evalue out, uint8_t *dim, int inc)   \
+static void NAME(evalue out, uint16_t *dim, int inc)  \
 {                                                     \
     evalue mem = out + inc;                           \
     evalue new = mem + inc;                           \
-    uint8_t i;                                        \
+    uint16_t i;                                       \
     for (i = 0; i < dim[0]; i++) {                    \
         out[i].T = (new[i].T != 0) - (mem[i].T != 0); \
         /* store current value of `new` */            \
@@ -487,10 +487,10 @@ EDGE_VFUNC(vedgef, float, f)
 EDGE_VFUNC(vedged, double, d)
 
 #define EMA_VFUNC(NAME, TYPE, T)                                 \
-static void NAME(evalue ema, uint8_t *dim, int inc)              \
+static void NAME(evalue ema, uint16_t *dim, int inc)             \
 {                                                                \
     evalue new = ema + inc, weight = new + inc;                  \
-    uint8_t i;                                                   \
+    uint16_t i;                                                  \
     for (i = 0; i < dim[0]; i++) {                               \
         ema[i].T += (new[i].T - ema[i].T) * abs##T(weight[i].T); \
     }                                                            \
@@ -499,12 +499,12 @@ EMA_VFUNC(vemaf, float, f)
 EMA_VFUNC(vemad, double, d)
 
 #define EMD_VFUNC(NAME, TYPE, T)                        \
-static void NAME(evalue emd, uint8_t *dim, int inc)     \
+static void NAME(evalue emd, uint16_t *dim, int inc)    \
 {                                                       \
     evalue ema = emd + inc,                             \
            new = ema + inc,                             \
            weight = new + inc;                          \
-    uint8_t i;                                          \
+    uint16_t i;                                         \
     for (i = 0; i < dim[0]; i++) {                      \
         register TYPE diff = new[i].T - ema[i].T;       \
         register TYPE w = abs##T(weight[i].T);          \
@@ -516,12 +516,12 @@ EMD_VFUNC(vemdf, float, f)
 EMD_VFUNC(vemdd, double, d)
 
 #define SCHMITT_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue mem, uint8_t *dim, int inc)     \
+static void NAME(evalue mem, uint16_t *dim, int inc)    \
 {                                                       \
     evalue new = mem + inc,                             \
            low = new + inc,                             \
            high = low + inc;                            \
-    uint8_t i;                                          \
+    uint16_t i;                                         \
     for (i = 0; i < dim[0]; i++) {                      \
         if (mem[i].T)                                   \
             mem[i].T = new[i].T > low[i].T;             \
@@ -709,9 +709,9 @@ static struct {
     uint8_t memory;
     uint8_t reduce;
     uint8_t len;
-    void (*fn_int)(evalue, uint8_t*, int);
-    void (*fn_flt)(evalue, uint8_t*, int);
-    void (*fn_dbl)(evalue, uint8_t*, int);
+    void (*fn_int)(evalue, uint16_t*, int);
+    void (*fn_flt)(evalue, uint16_t*, int);
+    void (*fn_dbl)(evalue, uint16_t*, int);
 } vfn_tbl[] = {
     { "all",     1, 0, 1, 0, valli,    vallf,    valld    },
     { "any",     1, 0, 1, 0, vanyi,    vanyf,    vanyd    },
@@ -811,7 +811,7 @@ typedef double fn_dbl_arity1(double);
 typedef double fn_dbl_arity2(double,double);
 typedef double fn_dbl_arity3(double,double,double);
 typedef double fn_dbl_arity4(double,double,double,double);
-typedef void vfn_template(evalue, uint8_t*, int);
+typedef void vfn_template(evalue, uint16_t*, int);
 
 static int strncmp_lc(const char *a, const char *b, int len)
 {
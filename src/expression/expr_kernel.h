@@ -0,0 +1,630 @@
+#ifndef __MPR_EXPR_KERNEL_H__
+#define __MPR_EXPR_KERNEL_H__
+
+#include <math.h>
+#include <string.h>
+#include "../mpr_inline.h"
+#include "expr_value.h"
+
+/* Vectorized kernels for elementwise operations on long vector signals. Expression values are
+ * stored in arrays of 8-byte evalue unions, so int and float elements sit at a stride of two
+ * lanes: the kernels gather them with shuffles on load and duplicate them on store. Each kernel
+ * ends with a scalar tail that uses the same expressions as the interpreter, and the selection
+ * of kernels is made once at runtime so that a single build can run on any CPU of its family. */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define EKERNEL_SSE2 1
+    #include <emmintrin.h>
+    #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        #define EKERNEL_AVX 1
+        #include <immintrin.h>
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define EKERNEL_NEON 1
+    #include <arm_neon.h>
+#endif
+
+/* evaluation type indices */
+#define ET_INT 0
+#define ET_FLT 1
+#define ET_DBL 2
+
+#define EK_TYPE_i ET_INT
+#define EK_TYPE_f ET_FLT
+#define EK_TYPE_d ET_DBL
+
+/* vectors shorter than this are left to the scalar loops */
+#define EKERNEL_MIN_LEN 8
+
+typedef enum {
+    EK_ADD,
+    EK_SUB,
+    EK_MUL,
+    EK_DIV,
+    EK_MIN,
+    EK_MAX,
+    EK_EQ,
+    EK_NE,
+    EK_LT,
+    EK_LE,
+    EK_GT,
+    EK_GE,
+    EK_MULADD,      /* (a * b) + c */
+    EK_MULSUB,      /* (a * b) - c */
+    EK_ADDMUL,      /* c + (a * b) */
+    EK_SUBMUL,      /* c - (a * b) */
+    EK_MAXMIN,      /* min(max(a, b), c) */
+    EK_MINMAX,      /* max(min(a, b), c) */
+    EK_SQRT,
+    EK_ABS,
+    N_EK_OPS
+} ekernel_op;
+
+/* Operands b and c are broadcast when their stride is 0. */
+typedef void ekernel_fn(evalue d, evalue a, evalue b, evalue c, int len, int sa, int sb, int sc);
+/* Conversion between evalue arrays and packed arrays of 32-bit elements. */
+typedef void ekernel_pack_fn(void *dst, evalue src, int len);
+typedef void ekernel_unpack_fn(evalue dst, const void *src, int len);
+
+typedef struct {
+    const char *isa;
+    ekernel_fn *fn[N_EK_OPS][3];
+    ekernel_pack_fn *pack;
+    ekernel_unpack_fn *unpack;
+} ekernel_table;
+
+static ekernel_table ekernels = { 0 };
+
+/* The table may be selected by several threads creating their first expressions at once, so the
+ * name of the instruction set is published only after the kernels are in place. */
+#ifdef __GNUC__
+    #define EK_GET_ISA()    __atomic_load_n(&ekernels.isa, __ATOMIC_ACQUIRE)
+    #define EK_SET_ISA(X)   __atomic_store_n(&ekernels.isa, X, __ATOMIC_RELEASE)
+#else
+    /* MSVC gives volatile accesses acquire and release semantics */
+    #define EK_GET_ISA()    (*(const char * volatile *)&ekernels.isa)
+    #define EK_SET_ISA(X)   (*(const char * volatile *)&ekernels.isa = (X))
+#endif
+
+/* Scalar helpers used for the kernel tails; returning through a function keeps intermediate
+ * results rounded to the element type exactly as the interpreter does. */
+#define EK_SCALAR_HELPERS(TYPE, T)                                              \
+MPR_INLINE static TYPE _ek_min_##T(TYPE x, TYPE y) { return (x < y) ? x : y; }  \
+MPR_INLINE static TYPE _ek_max_##T(TYPE x, TYPE y) { return (x > y) ? x : y; }  \
+MPR_INLINE static TYPE _ek_mul_##T(TYPE x, TYPE y) { return x * y; }
+EK_SCALAR_HELPERS(int, i)
+EK_SCALAR_HELPERS(float, f)
+EK_SCALAR_HELPERS(double, d)
+
+#define _ek_sqrt_f sqrtf
+#define _ek_sqrt_d sqrt
+#define _ek_abs_f fabsf
+#define _ek_abs_d fabs
+
+#define EK_S_ADD(T, X, Y, Z)    X + Y
+#define EK_S_SUB(T, X, Y, Z)    X - Y
+#define EK_S_MUL(T, X, Y, Z)    X * Y
+#define EK_S_DIV(T, X, Y, Z)    X / Y
+#define EK_S_MIN(T, X, Y, Z)    _ek_min_##T(X, Y)
+#define EK_S_MAX(T, X, Y, Z)    _ek_max_##T(X, Y)
+#define EK_S_EQ(T, X, Y, Z)     X == Y
+#define EK_S_NE(T, X, Y, Z)     X != Y
+#define EK_S_LT(T, X, Y, Z)     X < Y
+#define EK_S_LE(T, X, Y, Z)     X <= Y
+#define EK_S_GT(T, X, Y, Z)     X > Y
+#define EK_S_GE(T, X, Y, Z)     X >= Y
+#define EK_S_MULADD(T, X, Y, Z) _ek_mul_##T(X, Y) + Z
+#define EK_S_MULSUB(T, X, Y, Z) _ek_mul_##T(X, Y) - Z
+#define EK_S_ADDMUL(T, X, Y, Z) Z + _ek_mul_##T(X, Y)
+#define EK_S_SUBMUL(T, X, Y, Z) Z - _ek_mul_##T(X, Y)
+#define EK_S_MAXMIN(T, X, Y, Z) _ek_min_##T(_ek_max_##T(X, Y), Z)
+#define EK_S_MINMAX(T, X, Y, Z) _ek_max_##T(_ek_min_##T(X, Y), Z)
+#define EK_S_SQRT(T, X, Y, Z)   _ek_sqrt_##T(X)
+#define EK_S_ABS(T, X, Y, Z)    _ek_abs_##T(X)
+
+/* Vector operations, expressed in terms of the primitives P##_ADD, P##_MIN etc. provided by each
+ * instruction set below. Fused operations are deliberately not contracted to FMA instructions
+ * since the result must match the unfused interpreter bit for bit. */
+#define EK_V_ADD(P, X, Y, Z)    P##_ADD(X, Y)
+#define EK_V_SUB(P, X, Y, Z)    P##_SUB(X, Y)
+#define EK_V_MUL(P, X, Y, Z)    P##_MUL(X, Y)
+#define EK_V_DIV(P, X, Y, Z)    P##_DIV(X, Y)
+#define EK_V_MIN(P, X, Y, Z)    P##_MIN(X, Y)
+#define EK_V_MAX(P, X, Y, Z)    P##_MAX(X, Y)
+#define EK_V_EQ(P, X, Y, Z)     P##_EQ(X, Y)
+#define EK_V_NE(P, X, Y, Z)     P##_NE(X, Y)
+#define EK_V_LT(P, X, Y, Z)     P##_LT(X, Y)
+#define EK_V_LE(P, X, Y, Z)     P##_LE(X, Y)
+#define EK_V_GT(P, X, Y, Z)     P##_GT(X, Y)
+#define EK_V_GE(P, X, Y, Z)     P##_GE(X, Y)
+#define EK_V_MULADD(P, X, Y, Z) P##_ADD(P##_MUL(X, Y), Z)
+#define EK_V_MULSUB(P, X, Y, Z) P##_SUB(P##_MUL(X, Y), Z)
+#define EK_V_ADDMUL(P, X, Y, Z) P##_ADD(Z, P##_MUL(X, Y))
+#define EK_V_SUBMUL(P, X, Y, Z) P##_SUB(Z, P##_MUL(X, Y))
+#define EK_V_MAXMIN(P, X, Y, Z) P##_MIN(P##_MAX(X, Y), Z)
+#define EK_V_MINMAX(P, X, Y, Z) P##_MAX(P##_MIN(X, Y), Z)
+#define EK_V_SQRT(P, X, Y, Z)   P##_SQRT(X)
+#define EK_V_ABS(P, X, Y, Z)    P##_ABS(X)
+
+/* Elementwise kernel over NSRC operands. Broadcast operands are splatted once before the loop
+ * rather than indexed with a modulo. */
+#define EK_KERNEL(NAME, P, T, NSRC, VOP, SOP, ATTR)                             \
+ATTR static void NAME(evalue d, evalue a, evalue b, evalue c,                   \
+                      int len, int sa, int sb, int sc)                          \
+{                                                                               \
+    int i = 0;                                                                  \
+    P##_VT v[3];                                                                \
+    v[0] = v[1] = v[2] = P##_SET1(a[0].T);                                      \
+    if (NSRC > 1)                                                               \
+        v[1] = P##_SET1(b[0].T);                                                \
+    if (NSRC > 2)                                                               \
+        v[2] = P##_SET1(c[0].T);                                                \
+    for (; i + P##_W <= len; i += P##_W) {                                      \
+        if (sa)                                                                 \
+            v[0] = P##_LOAD(a + i);                                             \
+        if (NSRC > 1 && sb)                                                     \
+            v[1] = P##_LOAD(b + i);                                             \
+        if (NSRC > 2 && sc)                                                     \
+            v[2] = P##_LOAD(c + i);                                             \
+        P##_STORE(d + i, VOP(P, v[0], v[1], v[2]));                             \
+    }                                                                           \
+    for (; i < len; i++)                                                        \
+        d[i].T = SOP(T, a[i * sa].T, b[i * sb].T, c[i * sc].T);                 \
+}
+
+/* Packing kernels move 32-bit elements as raw bits, so they serve both int and float values. */
+#define EK_PACK_KERNELS(ISA, P, ATTR)                                           \
+ATTR static void _ek_##ISA##_pack(void *dst, evalue src, int len)               \
+{                                                                               \
+    int i = 0;                                                                  \
+    for (; i + P##_W <= len; i += P##_W)                                        \
+        P##_STOREU((float*)dst + i, P##_LOAD(src + i));                         \
+    for (; i < len; i++)                                                        \
+        ((int*)dst)[i] = src[i].i;                                              \
+}                                                                               \
+ATTR static void _ek_##ISA##_unpack(evalue dst, const void *src, int len)       \
+{                                                                               \
+    int i = 0;                                                                  \
+    for (; i + P##_W <= len; i += P##_W)                                        \
+        P##_STORE(dst + i, P##_LOADU((const float*)src + i));                   \
+    for (; i < len; i++)                                                        \
+        dst[i].i = ((const int*)src)[i];                                        \
+}
+
+/* Kernel sets: arithmetic and comparisons for every type, plus division and square roots for
+ * floating-point types. */
+#define EK_COMMON_KERNELS(ISA, P, T, ATTR)                                      \
+    EK_KERNEL(_ek_##ISA##_##T##_add, P, T, 2, EK_V_ADD, EK_S_ADD, ATTR)         \
+    EK_KERNEL(_ek_##ISA##_##T##_sub, P, T, 2, EK_V_SUB, EK_S_SUB, ATTR)         \
+    EK_KERNEL(_ek_##ISA##_##T##_min, P, T, 2, EK_V_MIN, EK_S_MIN, ATTR)         \
+    EK_KERNEL(_ek_##ISA##_##T##_max, P, T, 2, EK_V_MAX, EK_S_MAX, ATTR)         \
+    EK_KERNEL(_ek_##ISA##_##T##_eq, P, T, 2, EK_V_EQ, EK_S_EQ, ATTR)            \
+    EK_KERNEL(_ek_##ISA##_##T##_ne, P, T, 2, EK_V_NE, EK_S_NE, ATTR)            \
+    EK_KERNEL(_ek_##ISA##_##T##_lt, P, T, 2, EK_V_LT, EK_S_LT, ATTR)            \
+    EK_KERNEL(_ek_##ISA##_##T##_le, P, T, 2, EK_V_LE, EK_S_LE, ATTR)            \
+    EK_KERNEL(_ek_##ISA##_##T##_gt, P, T, 2, EK_V_GT, EK_S_GT, ATTR)            \
+    EK_KERNEL(_ek_##ISA##_##T##_ge, P, T, 2, EK_V_GE, EK_S_GE, ATTR)            \
+    EK_KERNEL(_ek_##ISA##_##T##_maxmin, P, T, 3, EK_V_MAXMIN, EK_S_MAXMIN, ATTR)\
+    EK_KERNEL(_ek_##ISA##_##T##_minmax, P, T, 3, EK_V_MINMAX, EK_S_MINMAX, ATTR)
+
+#define EK_MUL_KERNELS(ISA, P, T, ATTR)                                         \
+    EK_KERNEL(_ek_##ISA##_##T##_mul, P, T, 2, EK_V_MUL, EK_S_MUL, ATTR)         \
+    EK_KERNEL(_ek_##ISA##_##T##_muladd, P, T, 3, EK_V_MULADD, EK_S_MULADD, ATTR)\
+    EK_KERNEL(_ek_##ISA##_##T##_mulsub, P, T, 3, EK_V_MULSUB, EK_S_MULSUB, ATTR)\
+    EK_KERNEL(_ek_##ISA##_##T##_addmul, P, T, 3, EK_V_ADDMUL, EK_S_ADDMUL, ATTR)\
+    EK_KERNEL(_ek_##ISA##_##T##_submul, P, T, 3, EK_V_SUBMUL, EK_S_SUBMUL, ATTR)
+
+#define EK_FLOAT_KERNELS(ISA, P, T, ATTR)                                       \
+    EK_COMMON_KERNELS(ISA, P, T, ATTR)                                          \
+    EK_MUL_KERNELS(ISA, P, T, ATTR)                                             \
+    EK_KERNEL(_ek_##ISA##_##T##_div, P, T, 2, EK_V_DIV, EK_S_DIV, ATTR)         \
+    EK_KERNEL(_ek_##ISA##_##T##_sqrt, P, T, 1, EK_V_SQRT, EK_S_SQRT, ATTR)      \
+    EK_KERNEL(_ek_##ISA##_##T##_abs, P, T, 1, EK_V_ABS, EK_S_ABS, ATTR)
+
+#define EK_INT_KERNELS(ISA, P, ATTR)                                            \
+    EK_COMMON_KERNELS(ISA, P, i, ATTR)
+
+#define EK_SET_COMMON(ISA, T)                                                   \
+    t.fn[EK_ADD][EK_TYPE_##T] = _ek_##ISA##_##T##_add;                          \
+    t.fn[EK_SUB][EK_TYPE_##T] = _ek_##ISA##_##T##_sub;                          \
+    t.fn[EK_MIN][EK_TYPE_##T] = _ek_##ISA##_##T##_min;                          \
+    t.fn[EK_MAX][EK_TYPE_##T] = _ek_##ISA##_##T##_max;                          \
+    t.fn[EK_EQ][EK_TYPE_##T] = _ek_##ISA##_##T##_eq;                            \
+    t.fn[EK_NE][EK_TYPE_##T] = _ek_##ISA##_##T##_ne;                            \
+    t.fn[EK_LT][EK_TYPE_##T] = _ek_##ISA##_##T##_lt;                            \
+    t.fn[EK_LE][EK_TYPE_##T] = _ek_##ISA##_##T##_le;                            \
+    t.fn[EK_GT][EK_TYPE_##T] = _ek_##ISA##_##T##_gt;                            \
+    t.fn[EK_GE][EK_TYPE_##T] = _ek_##ISA##_##T##_ge;                            \
+    t.fn[EK_MAXMIN][EK_TYPE_##T] = _ek_##ISA##_##T##_maxmin;                    \
+    t.fn[EK_MINMAX][EK_TYPE_##T] = _ek_##ISA##_##T##_minmax;
+
+#define EK_SET_MUL(ISA, T)                                                      \
+    t.fn[EK_MUL][EK_TYPE_##T] = _ek_##ISA##_##T##_mul;                          \
+    t.fn[EK_MULADD][EK_TYPE_##T] = _ek_##ISA##_##T##_muladd;                    \
+    t.fn[EK_MULSUB][EK_TYPE_##T] = _ek_##ISA##_##T##_mulsub;                    \
+    t.fn[EK_ADDMUL][EK_TYPE_##T] = _ek_##ISA##_##T##_addmul;                    \
+    t.fn[EK_SUBMUL][EK_TYPE_##T] = _ek_##ISA##_##T##_submul;
+
+#define EK_SET_FLOAT(ISA, T)                                                    \
+    EK_SET_COMMON(ISA, T)                                                       \
+    EK_SET_MUL(ISA, T)                                                          \
+    t.fn[EK_DIV][EK_TYPE_##T] = _ek_##ISA##_##T##_div;                          \
+    t.fn[EK_SQRT][EK_TYPE_##T] = _ek_##ISA##_##T##_sqrt;                        \
+    t.fn[EK_ABS][EK_TYPE_##T] = _ek_##ISA##_##T##_abs;
+
+#define EK_NO_ATTR
+
+#if EKERNEL_SSE2
+
+/* SSE2: 4 x float, 4 x int32, 2 x double */
+MPR_INLINE static __m128 _ek_sse_load_f(evalue p)
+{
+    __m128 lo = _mm_loadu_ps(&p[0].f), hi = _mm_loadu_ps(&p[2].f);
+    return _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+MPR_INLINE static void _ek_sse_store_f(evalue p, __m128 v)
+{
+    _mm_storeu_ps(&p[0].f, _mm_unpacklo_ps(v, v));
+    _mm_storeu_ps(&p[2].f, _mm_unpackhi_ps(v, v));
+}
+
+MPR_INLINE static __m128i _ek_sse_load_i(evalue p)
+{
+    return _mm_castps_si128(_ek_sse_load_f(p));
+}
+
+MPR_INLINE static void _ek_sse_store_i(evalue p, __m128i v)
+{
+    _mm_storeu_si128((__m128i*)&p[0], _mm_unpacklo_epi32(v, v));
+    _mm_storeu_si128((__m128i*)&p[2], _mm_unpackhi_epi32(v, v));
+}
+
+MPR_INLINE static __m128i _ek_sse_select_i(__m128i mask, __m128i x, __m128i y)
+{
+    return _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, y));
+}
+
+MPR_INLINE static __m128i _ek_sse_min_i(__m128i x, __m128i y)
+{
+    return _ek_sse_select_i(_mm_cmplt_epi32(x, y), x, y);
+}
+
+MPR_INLINE static __m128i _ek_sse_max_i(__m128i x, __m128i y)
+{
+    return _ek_sse_select_i(_mm_cmpgt_epi32(x, y), x, y);
+}
+
+#define EK_SSEF_W           4
+#define EK_SSEF_VT          __m128
+#define EK_SSEF_SET1        _mm_set1_ps
+#define EK_SSEF_LOAD        _ek_sse_load_f
+#define EK_SSEF_STORE       _ek_sse_store_f
+#define EK_SSEF_LOADU       _mm_loadu_ps
+#define EK_SSEF_STOREU      _mm_storeu_ps
+#define EK_SSEF_ADD         _mm_add_ps
+#define EK_SSEF_SUB         _mm_sub_ps
+#define EK_SSEF_MUL         _mm_mul_ps
+#define EK_SSEF_DIV         _mm_div_ps
+#define EK_SSEF_MIN         _mm_min_ps
+#define EK_SSEF_MAX         _mm_max_ps
+#define EK_SSEF_EQ(X, Y)    _mm_and_ps(_mm_cmpeq_ps(X, Y), _mm_set1_ps(1.f))
+#define EK_SSEF_NE(X, Y)    _mm_and_ps(_mm_cmpneq_ps(X, Y), _mm_set1_ps(1.f))
+#define EK_SSEF_LT(X, Y)    _mm_and_ps(_mm_cmplt_ps(X, Y), _mm_set1_ps(1.f))
+#define EK_SSEF_LE(X, Y)    _mm_and_ps(_mm_cmple_ps(X, Y), _mm_set1_ps(1.f))
+#define EK_SSEF_GT(X, Y)    _mm_and_ps(_mm_cmpgt_ps(X, Y), _mm_set1_ps(1.f))
+#define EK_SSEF_GE(X, Y)    _mm_and_ps(_mm_cmpge_ps(X, Y), _mm_set1_ps(1.f))
+#define EK_SSEF_SQRT        _mm_sqrt_ps
+#define EK_SSEF_ABS(X)      _mm_andnot_ps(_mm_set1_ps(-0.f), X)
+
+#define EK_SSED_W           2
+#define EK_SSED_VT          __m128d
+#define EK_SSED_SET1        _mm_set1_pd
+#define EK_SSED_LOAD(P)     _mm_loadu_pd(&(P)[0].d)
+#define EK_SSED_STORE(P, V) _mm_storeu_pd(&(P)[0].d, V)
+#define EK_SSED_ADD         _mm_add_pd
+#define EK_SSED_SUB         _mm_sub_pd
+#define EK_SSED_MUL         _mm_mul_pd
+#define EK_SSED_DIV         _mm_div_pd
+#define EK_SSED_MIN         _mm_min_pd
+#define EK_SSED_MAX         _mm_max_pd
+#define EK_SSED_EQ(X, Y)    _mm_and_pd(_mm_cmpeq_pd(X, Y), _mm_set1_pd(1.))
+#define EK_SSED_NE(X, Y)    _mm_and_pd(_mm_cmpneq_pd(X, Y), _mm_set1_pd(1.))
+#define EK_SSED_LT(X, Y)    _mm_and_pd(_mm_cmplt_pd(X, Y), _mm_set1_pd(1.))
+#define EK_SSED_LE(X, Y)    _mm_and_pd(_mm_cmple_pd(X, Y), _mm_set1_pd(1.))
+#define EK_SSED_GT(X, Y)    _mm_and_pd(_mm_cmpgt_pd(X, Y), _mm_set1_pd(1.))
+#define EK_SSED_GE(X, Y)    _mm_and_pd(_mm_cmpge_pd(X, Y), _mm_set1_pd(1.))
+#define EK_SSED_SQRT        _mm_sqrt_pd
+#define EK_SSED_ABS(X)      _mm_andnot_pd(_mm_set1_pd(-0.), X)
+
+/* SSE2 has no packed 32-bit multiply, so integer multiplication stays scalar */
+#define EK_SSEI_W           4
+#define EK_SSEI_VT          __m128i
+#define EK_SSEI_SET1        _mm_set1_epi32
+#define EK_SSEI_LOAD        _ek_sse_load_i
+#define EK_SSEI_STORE       _ek_sse_store_i
+#define EK_SSEI_ADD         _mm_add_epi32
+#define EK_SSEI_SUB         _mm_sub_epi32
+#define EK_SSEI_MIN         _ek_sse_min_i
+#define EK_SSEI_MAX         _ek_sse_max_i
+#define EK_SSEI_EQ(X, Y)    _mm_and_si128(_mm_cmpeq_epi32(X, Y), _mm_set1_epi32(1))
+#define EK_SSEI_NE(X, Y)    _mm_andnot_si128(_mm_cmpeq_epi32(X, Y), _mm_set1_epi32(1))
+#define EK_SSEI_LT(X, Y)    _mm_and_si128(_mm_cmplt_epi32(X, Y), _mm_set1_epi32(1))
+#define EK_SSEI_LE(X, Y)    _mm_andnot_si128(_mm_cmpgt_epi32(X, Y), _mm_set1_epi32(1))
+#define EK_SSEI_GT(X, Y)    _mm_and_si128(_mm_cmpgt_epi32(X, Y), _mm_set1_epi32(1))
+#define EK_SSEI_GE(X, Y)    _mm_andnot_si128(_mm_cmplt_epi32(X, Y), _mm_set1_epi32(1))
+
+EK_FLOAT_KERNELS(sse, EK_SSEF, f, EK_NO_ATTR)
+EK_FLOAT_KERNELS(sse, EK_SSED, d, EK_NO_ATTR)
+EK_INT_KERNELS(sse, EK_SSEI, EK_NO_ATTR)
+EK_PACK_KERNELS(sse, EK_SSEF, EK_NO_ATTR)
+
+#endif /* EKERNEL_SSE2 */
+
+#if EKERNEL_AVX
+
+/* AVX: 8 x float, 4 x double; compiled for AVX regardless of the baseline target and only
+ * selected if the CPU reports support at runtime. */
+#define EK_AVX_ATTR __attribute__((target("avx")))
+
+EK_AVX_ATTR MPR_INLINE static __m256 _ek_avx_load_f(evalue p)
+{
+    __m256 lo = _mm256_loadu_ps(&p[0].f), hi = _mm256_loadu_ps(&p[4].f);
+    return _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+EK_AVX_ATTR MPR_INLINE static void _ek_avx_store_f(evalue p, __m256 v)
+{
+    _mm256_storeu_ps(&p[0].f, _mm256_unpacklo_ps(v, v));
+    _mm256_storeu_ps(&p[4].f, _mm256_unpackhi_ps(v, v));
+}
+
+#define EK_AVXF_W           8
+#define EK_AVXF_VT          __m256
+#define EK_AVXF_SET1        _mm256_set1_ps
+#define EK_AVXF_LOAD        _ek_avx_load_f
+#define EK_AVXF_STORE       _ek_avx_store_f
+#define EK_AVXF_LOADU       _mm256_loadu_ps
+#define EK_AVXF_STOREU      _mm256_storeu_ps
+#define EK_AVXF_ADD         _mm256_add_ps
+#define EK_AVXF_SUB         _mm256_sub_ps
+#define EK_AVXF_MUL         _mm256_mul_ps
+#define EK_AVXF_DIV         _mm256_div_ps
+#define EK_AVXF_MIN         _mm256_min_ps
+#define EK_AVXF_MAX         _mm256_max_ps
+#define EK_AVXF_CMP(X, Y, C) _mm256_and_ps(_mm256_cmp_ps(X, Y, C), _mm256_set1_ps(1.f))
+#define EK_AVXF_EQ(X, Y)    EK_AVXF_CMP(X, Y, _CMP_EQ_OQ)
+#define EK_AVXF_NE(X, Y)    EK_AVXF_CMP(X, Y, _CMP_NEQ_UQ)
+#define EK_AVXF_LT(X, Y)    EK_AVXF_CMP(X, Y, _CMP_LT_OS)
+#define EK_AVXF_LE(X, Y)    EK_AVXF_CMP(X, Y, _CMP_LE_OS)
+#define EK_AVXF_GT(X, Y)    EK_AVXF_CMP(X, Y, _CMP_GT_OS)
+#define EK_AVXF_GE(X, Y)    EK_AVXF_CMP(X, Y, _CMP_GE_OS)
+#define EK_AVXF_SQRT        _mm256_sqrt_ps
+#define EK_AVXF_ABS(X)      _mm256_andnot_ps(_mm256_set1_ps(-0.f), X)
+
+#define EK_AVXD_W           4
+#define EK_AVXD_VT          __m256d
+#define EK_AVXD_SET1        _mm256_set1_pd
+#define EK_AVXD_LOAD(P)     _mm256_loadu_pd(&(P)[0].d)
+#define EK_AVXD_STORE(P, V) _mm256_storeu_pd(&(P)[0].d, V)
+#define EK_AVXD_ADD         _mm256_add_pd
+#define EK_AVXD_SUB         _mm256_sub_pd
+#define EK_AVXD_MUL         _mm256_mul_pd
+#define EK_AVXD_DIV         _mm256_div_pd
+#define EK_AVXD_MIN         _mm256_min_pd
+#define EK_AVXD_MAX         _mm256_max_pd
+#define EK_AVXD_CMP(X, Y, C) _mm256_and_pd(_mm256_cmp_pd(X, Y, C), _mm256_set1_pd(1.))
+#define EK_AVXD_EQ(X, Y)    EK_AVXD_CMP(X, Y, _CMP_EQ_OQ)
+#define EK_AVXD_NE(X, Y)    EK_AVXD_CMP(X, Y, _CMP_NEQ_UQ)
+#define EK_AVXD_LT(X, Y)    EK_AVXD_CMP(X, Y, _CMP_LT_OS)
+#define EK_AVXD_LE(X, Y)    EK_AVXD_CMP(X, Y, _CMP_LE_OS)
+#define EK_AVXD_GT(X, Y)    EK_AVXD_CMP(X, Y, _CMP_GT_OS)
+#define EK_AVXD_GE(X, Y)    EK_AVXD_CMP(X, Y, _CMP_GE_OS)
+#define EK_AVXD_SQRT        _mm256_sqrt_pd
+#define EK_AVXD_ABS(X)      _mm256_andnot_pd(_mm256_set1_pd(-0.), X)
+
+EK_FLOAT_KERNELS(avx, EK_AVXF, f, EK_AVX_ATTR)
+EK_FLOAT_KERNELS(avx, EK_AVXD, d, EK_AVX_ATTR)
+EK_PACK_KERNELS(avx, EK_AVXF, EK_AVX_ATTR)
+
+#endif /* EKERNEL_AVX */
+
+#if EKERNEL_NEON
+
+/* NEON: 4 x float, 4 x int32, 2 x double */
+MPR_INLINE static float32x4_t _ek_neon_load_f(evalue p)
+{
+    return vld2q_f32(&p[0].f).val[0];
+}
+
+MPR_INLINE static void _ek_neon_store_f(evalue p, float32x4_t v)
+{
+    float32x4x2_t s;
+    s.val[0] = s.val[1] = v;
+    vst2q_f32(&p[0].f, s);
+}
+
+MPR_INLINE static int32x4_t _ek_neon_load_i(evalue p)
+{
+    return vld2q_s32(&p[0].i).val[0];
+}
+
+MPR_INLINE static void _ek_neon_store_i(evalue p, int32x4_t v)
+{
+    int32x4x2_t s;
+    s.val[0] = s.val[1] = v;
+    vst2q_s32(&p[0].i, s);
+}
+
+#define EK_NEONF_MASK(M)    vreinterpretq_f32_u32(vandq_u32(M, vreinterpretq_u32_f32(vdupq_n_f32(1.f))))
+#define EK_NEONF_W          4
+#define EK_NEONF_VT         float32x4_t
+#define EK_NEONF_SET1       vdupq_n_f32
+#define EK_NEONF_LOAD       _ek_neon_load_f
+#define EK_NEONF_STORE      _ek_neon_store_f
+#define EK_NEONF_LOADU      vld1q_f32
+#define EK_NEONF_STOREU     vst1q_f32
+#define EK_NEONF_ADD        vaddq_f32
+#define EK_NEONF_SUB        vsubq_f32
+#define EK_NEONF_MUL        vmulq_f32
+#define EK_NEONF_DIV        vdivq_f32
+#define EK_NEONF_MIN(X, Y)  vbslq_f32(vcltq_f32(X, Y), X, Y)
+#define EK_NEONF_MAX(X, Y)  vbslq_f32(vcgtq_f32(X, Y), X, Y)
+#define EK_NEONF_EQ(X, Y)   EK_NEONF_MASK(vceqq_f32(X, Y))
+#define EK_NEONF_NE(X, Y)   EK_NEONF_MASK(vmvnq_u32(vceqq_f32(X, Y)))
+#define EK_NEONF_LT(X, Y)   EK_NEONF_MASK(vcltq_f32(X, Y))
+#define EK_NEONF_LE(X, Y)   EK_NEONF_MASK(vcleq_f32(X, Y))
+#define EK_NEONF_GT(X, Y)   EK_NEONF_MASK(vcgtq_f32(X, Y))
+#define EK_NEONF_GE(X, Y)   EK_NEONF_MASK(vcgeq_f32(X, Y))
+#define EK_NEONF_SQRT       vsqrtq_f32
+#define EK_NEONF_ABS        vabsq_f32
+
+#define EK_NEOND_MASK(M)    vreinterpretq_f64_u64(vandq_u64(M, vreinterpretq_u64_f64(vdupq_n_f64(1.))))
+#define EK_NEOND_W          2
+#define EK_NEOND_VT         float64x2_t
+#define EK_NEOND_SET1       vdupq_n_f64
+#define EK_NEOND_LOAD(P)    vld1q_f64(&(P)[0].d)
+#define EK_NEOND_STORE(P, V) vst1q_f64(&(P)[0].d, V)
+#define EK_NEOND_ADD        vaddq_f64
+#define EK_NEOND_SUB        vsubq_f64
+#define EK_NEOND_MUL        vmulq_f64
+#define EK_NEOND_DIV        vdivq_f64
+#define EK_NEOND_MIN(X, Y)  vbslq_f64(vcltq_f64(X, Y), X, Y)
+#define EK_NEOND_MAX(X, Y)  vbslq_f64(vcgtq_f64(X, Y), X, Y)
+#define EK_NEOND_EQ(X, Y)   EK_NEOND_MASK(vceqq_f64(X, Y))
+#define EK_NEOND_NE(X, Y)   EK_NEOND_MASK(vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_f64(X, Y)))))
+#define EK_NEOND_LT(X, Y)   EK_NEOND_MASK(vcltq_f64(X, Y))
+#define EK_NEOND_LE(X, Y)   EK_NEOND_MASK(vcleq_f64(X, Y))
+#define EK_NEOND_GT(X, Y)   EK_NEOND_MASK(vcgtq_f64(X, Y))
+#define EK_NEOND_GE(X, Y)   EK_NEOND_MASK(vcgeq_f64(X, Y))
+#define EK_NEOND_SQRT       vsqrtq_f64
+#define EK_NEOND_ABS        vabsq_f64
+
+#define EK_NEONI_MASK(M)    vreinterpretq_s32_u32(vandq_u32(M, vdupq_n_u32(1)))
+#define EK_NEONI_W          4
+#define EK_NEONI_VT         int32x4_t
+#define EK_NEONI_SET1       vdupq_n_s32
+#define EK_NEONI_LOAD       _ek_neon_load_i
+#define EK_NEONI_STORE      _ek_neon_store_i
+#define EK_NEONI_ADD        vaddq_s32
+#define EK_NEONI_SUB        vsubq_s32
+#define EK_NEONI_MUL        vmulq_s32
+#define EK_NEONI_MIN(X, Y)  vbslq_s32(vcltq_s32(X, Y), X, Y)
+#define EK_NEONI_MAX(X, Y)  vbslq_s32(vcgtq_s32(X, Y), X, Y)
+#define EK_NEONI_EQ(X, Y)   EK_NEONI_MASK(vceqq_s32(X, Y))
+#define EK_NEONI_NE(X, Y)   EK_NEONI_MASK(vmvnq_u32(vceqq_s32(X, Y)))
+#define EK_NEONI_LT(X, Y)   EK_NEONI_MASK(vcltq_s32(X, Y))
+#define EK_NEONI_LE(X, Y)   EK_NEONI_MASK(vcleq_s32(X, Y))
+#define EK_NEONI_GT(X, Y)   EK_NEONI_MASK(vcgtq_s32(X, Y))
+#define EK_NEONI_GE(X, Y)   EK_NEONI_MASK(vcgeq_s32(X, Y))
+
+EK_FLOAT_KERNELS(neon, EK_NEONF, f, EK_NO_ATTR)
+EK_FLOAT_KERNELS(neon, EK_NEOND, d, EK_NO_ATTR)
+EK_INT_KERNELS(neon, EK_NEONI, EK_NO_ATTR)
+EK_MUL_KERNELS(neon, EK_NEONI, i, EK_NO_ATTR)
+EK_PACK_KERNELS(neon, EK_NEONF, EK_NO_ATTR)
+
+#endif /* EKERNEL_NEON */
+
+/*! Select the kernels for the running CPU.
+ *  \param enable       Zero to disable vectorized kernels and use only the scalar loops.
+ *  \return             The name of the selected instruction set. */
+static const char *ekernel_init(int enable)
+{
+    ekernel_table t;
+    memset(&t, 0, sizeof(t));
+    t.isa = "scalar";
+#if EKERNEL_SSE2
+    if (enable) {
+        EK_SET_FLOAT(sse, f)
+        EK_SET_FLOAT(sse, d)
+        EK_SET_COMMON(sse, i)
+        t.pack = _ek_sse_pack;
+        t.unpack = _ek_sse_unpack;
+        t.isa = "sse2";
+#if EKERNEL_AVX
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx")) {
+            EK_SET_FLOAT(avx, f)
+            EK_SET_FLOAT(avx, d)
+            t.pack = _ek_avx_pack;
+            t.unpack = _ek_avx_unpack;
+            t.isa = "avx";
+        }
+#endif
+    }
+#elif EKERNEL_NEON
+    if (enable) {
+        EK_SET_FLOAT(neon, f)
+        EK_SET_FLOAT(neon, d)
+        EK_SET_COMMON(neon, i)
+        EK_SET_MUL(neon, i)
+        t.pack = _ek_neon_pack;
+        t.unpack = _ek_neon_unpack;
+        t.isa = "neon";
+    }
+#endif
+    /* every kernel matches the scalar loops exactly, so a thread reading the table while it is
+     * being copied computes the same results whichever entries it sees */
+    memcpy(ekernels.fn, t.fn, sizeof(t.fn));
+    ekernels.pack = t.pack;
+    ekernels.unpack = t.unpack;
+    EK_SET_ISA(t.isa);
+    return t.isa;
+}
+
+/*! Select the kernels for the running CPU unless a selection has already been made. */
+MPR_INLINE static void ekernel_init_once(void)
+{
+    if (!EK_GET_ISA())
+        ekernel_init(1);
+}
+
+/*! Run an elementwise kernel if one is available for this operation, type and length.
+ *  \param op           The kernel operation, or -1 for none.
+ *  \param ti           The evaluation type index.
+ *  \param d            Destination values.
+ *  \param a            First operand.
+ *  \param b            Second operand, or 0 for unary operations.
+ *  \param c            Third operand, or 0 for unary and binary operations.
+ *  \param len          The number of elements to process.
+ *  \param sa           1 if operand a is a vector, 0 if it should be broadcast.
+ *  \param sb           1 if operand b is a vector, 0 if it should be broadcast.
+ *  \param sc           1 if operand c is a vector, 0 if it should be broadcast.
+ *  \return             1 if the operation was performed, 0 if the caller must fall back. */
+MPR_INLINE static int ekernel_run(int op, int ti, evalue d, evalue a, evalue b, evalue c,
+                                  int len, int sa, int sb, int sc)
+{
+    ekernel_fn *fn;
+    RETURN_ARG_UNLESS(op >= 0 && len >= EKERNEL_MIN_LEN && (fn = ekernels.fn[op][ti]), 0);
+    if (!b) {
+        b = a;
+        sb = sa;
+    }
+    if (!c) {
+        c = a;
+        sc = sa;
+    }
+    fn(d, a, b, c, len, sa, sb, sc);
+    return 1;
+}
+
+/*! Copy elements from an evalue array to a packed array of the evaluation type if a kernel is
+ *  available; 64-bit elements are already packed and are left to the caller. */
+MPR_INLINE static int ekernel_pack(int ti, void *dst, evalue src, int len)
+{
+    RETURN_ARG_UNLESS(ET_DBL != ti && len >= EKERNEL_MIN_LEN && ekernels.pack, 0);
+    ekernels.pack(dst, src, len);
+    return 1;
+}
+
+/*! Copy elements from a packed array of the evaluation type to an evalue array if a kernel is
+ *  available. */
+MPR_INLINE static int ekernel_unpack(int ti, evalue dst, const void *src, int len)
+{
+    RETURN_ARG_UNLESS(ET_DBL != ti && len >= EKERNEL_MIN_LEN && ekernels.unpack, 0);
+    ekernels.unpack(dst, src, len);
+    return 1;
+}
+
+#endif /* __MPR_EXPR_KERNEL_H__ */
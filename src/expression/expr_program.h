@@ -0,0 +1,1139 @@
+#ifndef __MPR_EXPR_PROGRAM_H__
+#define __MPR_EXPR_PROGRAM_H__
+
+#include <fenv.h>
+#include <math.h>
+#include <errno.h>
+#include "expr_function.h"
+#include "expr_kernel.h"
+#include "expr_operator.h"
+#include "expr_struct.h"
+#include "expr_token.h"
+#include "expr_value.h"
+#include "expr_variable.h"
+#include <mapper/mapper.h>
+
+/* After parsing and type checking, straight-line token stacks are lowered to a register-addressed
+ * instruction stream. Each stack value is given its own register, so vector lengths, types and
+ * broadcasting between operands are resolved once at compile time instead of being checked for
+ * every token in every evaluation. Common operator sequences are fused into single instructions:
+ *      a*b+c, a*b-c, c+a*b, c-a*b      multiply-add
+ *      min(max(x,lo),hi)               clamp (and the reverse max(min(x,hi),lo))
+ * Stacks containing tokens that are not supported here (loops, reductions, history or vector
+ * indices, instance management, timetags, vector functions...) are left to the interpreter in
+ * expr_evaluator.h, which remains the reference implementation. */
+
+/* Typed opcodes are packed as (op * 3 + type index). */
+enum eprog_op {
+    EOP_ADD,
+    EOP_SUB,
+    EOP_MUL,
+    EOP_DIV,
+    EOP_MOD,
+    EOP_EQ,
+    EOP_NE,
+    EOP_LT,
+    EOP_LE,
+    EOP_GT,
+    EOP_GE,
+    EOP_AND,
+    EOP_OR,
+    EOP_NOT,
+    EOP_SHL,
+    EOP_SHR,
+    EOP_BAND,
+    EOP_BOR,
+    EOP_BXOR,
+    EOP_IF_ELSE,    /* d = a ? a : b */
+    EOP_SELECT,     /* d = a ? b : c */
+    EOP_MIN,
+    EOP_MAX,
+    EOP_MULADD,     /* d = (a * b) + c */
+    EOP_MULSUB,     /* d = (a * b) - c */
+    EOP_ADDMUL,     /* d = c + (a * b) */
+    EOP_SUBMUL,     /* d = c - (a * b) */
+    EOP_MAXMIN,     /* d = min(max(a, b), c) */
+    EOP_MINMAX,     /* d = max(min(a, b), c) */
+    EOP_SQRT,       /* floating-point types only */
+    EOP_ABS,
+    EOP_FN1,
+    EOP_FN2,
+    EOP_FN3,
+    EOP_FN4,
+    EOP_TO_INT,     /* cast from the instruction type */
+    EOP_TO_FLT,
+    EOP_TO_DBL,
+    EOP_LOAD,       /* copy the current value of a signal or variable into a register */
+    EOP_ASSIGN,     /* copy a register to the output or a user variable */
+    N_EOP_TYPED,
+    /* untyped instructions */
+    EOP_NOP = N_EOP_TYPED * 3,
+    EOP_NOW,        /* load the evaluation timestamp */
+    EOP_COPY        /* copy a register into part of another, used for building vectors */
+};
+
+#define EOP_TYPED(OP, TYPE_IDX) ((OP) * 3 + (TYPE_IDX))
+#define EOP_BASE(OPCODE)        ((OPCODE) / 3)
+
+/* resuming at this instruction means the evaluation returns without a result */
+#define EOP_SKIP_RETURN 0xFFFF
+
+typedef struct _einstr {
+    uint8_t opcode;
+    uint8_t check;          /* test for arithmetic errors after execution */
+    uint8_t stride[3];      /* 0 to broadcast the first element of a source, 1 to step through */
+    uint16_t len;           /* number of elements to compute */
+    uint16_t dst;
+    uint16_t src[3];
+    uint16_t offset;        /* destination offset for EOP_COPY */
+    uint16_t skip;          /* instruction to resume at if an arithmetic error is detected */
+    union {
+        void *fn;           /* function pointer for EOP_FN* */
+        etoken tok;         /* source token for EOP_LOAD and EOP_ASSIGN */
+    } arg;
+} einstr_t, *einstr;
+
+typedef struct _eprog {
+    einstr_t *instrs;
+    uint16_t *refs;         /* indices of instructions that read or write an mpr_value */
+    evalue regs;
+    uint16_t num_instrs;
+    uint16_t num_refs;
+    uint16_t vec_len;       /* register stride */
+    uint16_t num_regs;
+    uint8_t batchable;      /* every path through the program reads a source */
+    evalue batch_regs;      /* one register bank per instance for batched evaluation */
+} eprog_t, *eprog;
+
+/* number of instances evaluated together by eprog_eval_batch() */
+#define EPROG_BATCH_SIZE 64
+
+/* Compile-time register properties. */
+typedef struct _ereg {
+    int def;                /* defining instruction, or -1 for constants */
+    uint16_t len;           /* logical vector length */
+    mpr_type type;
+    uint8_t uniform;        /* all elements equal the first element */
+} ereg_t;
+
+typedef struct _eprog_ctx {
+    eprog prog;
+    estack stk;
+    ereg_t *regs;
+    int num_regs;
+    int size_regs;
+    int *stack;
+    int dp;
+    int barrier;            /* last instruction that instructions may not be moved across */
+} eprog_ctx_t, *eprog_ctx;
+
+MPR_INLINE static int _eprog_type_idx(mpr_type type)
+{
+    switch (type) {
+        case MPR_INT32: return ET_INT;
+        case MPR_FLT:   return ET_FLT;
+        case MPR_DBL:   return ET_DBL;
+        default:        return -1;
+    }
+}
+
+static int _eprog_add_reg(eprog_ctx ctx, mpr_type type, int len, int uniform, int def)
+{
+    ereg_t *reg;
+    if (ctx->num_regs >= ctx->size_regs) {
+        ctx->size_regs *= 2;
+        ctx->regs = realloc(ctx->regs, ctx->size_regs * sizeof(ereg_t));
+        ctx->prog->regs = realloc(ctx->prog->regs,
+                                  ctx->size_regs * ctx->prog->vec_len * sizeof(evalue_t));
+    }
+    reg = &ctx->regs[ctx->num_regs];
+    reg->def = def;
+    reg->len = len;
+    reg->type = type;
+    reg->uniform = uniform || 1 == len;
+    return ctx->num_regs++;
+}
+
+MPR_INLINE static evalue _eprog_reg(eprog prog, int reg)
+{
+    return prog->regs + reg * prog->vec_len;
+}
+
+static einstr _eprog_add_instr(eprog_ctx ctx, int opcode)
+{
+    einstr ins = &ctx->prog->instrs[ctx->prog->num_instrs++];
+    memset(ins, 0, sizeof(einstr_t));
+    ins->opcode = opcode;
+    ins->skip = EOP_SKIP_RETURN;
+    return ins;
+}
+
+/* Find the stride for reading a source operand the way the interpreter does: element i of the
+ * result reads element (i % mod_len) of the operand. Returns 0 if the result would depend on stale
+ * stack contents, in which case the expression is left to the interpreter. */
+static int _eprog_stride(eprog_ctx ctx, int reg, int mod_len, int max_len, uint8_t *stride)
+{
+    ereg_t *r = &ctx->regs[reg];
+    int num_read = mod_len < max_len ? mod_len : max_len;
+    if (r->uniform) {
+        RETURN_ARG_UNLESS(r->len >= num_read, 0);
+        *stride = 0;
+    }
+    else if (1 == mod_len)
+        *stride = 0;
+    else {
+        RETURN_ARG_UNLESS(mod_len >= max_len && r->len >= max_len, 0);
+        *stride = 1;
+    }
+    return 1;
+}
+
+/* The first operand of an operator or function is tiled up to the longest operand. */
+static int _eprog_first_stride(eprog_ctx ctx, int reg, int max_len, uint8_t *stride)
+{
+    ereg_t *r = &ctx->regs[reg];
+    if (r->uniform)
+        *stride = 0;
+    else {
+        RETURN_ARG_UNLESS(r->len == max_len, 0);
+        *stride = 1;
+    }
+    return 1;
+}
+
+/* Return the instruction defining a register if it can be fused into the current instruction. */
+static einstr _eprog_fusable(eprog_ctx ctx, int reg, int opcode)
+{
+    int def = ctx->regs[reg].def;
+    RETURN_ARG_UNLESS(def >= 0 && def > ctx->barrier, 0);
+    RETURN_ARG_UNLESS(ctx->prog->instrs[def].opcode == opcode, 0);
+    return &ctx->prog->instrs[def];
+}
+
+static int _eprog_compile_op(eprog_ctx ctx, etoken tok)
+{
+    int i, ti, base, arity = tok->op.arity, max_len = 0, uniform = 1, dst, *args;
+    mpr_type type;
+    einstr ins, mul;
+
+    RETURN_ARG_UNLESS(arity >= 1 && arity <= 3 && ctx->dp + 1 >= arity, 0);
+    args = &ctx->stack[ctx->dp + 1 - arity];
+    type = ctx->regs[args[0]].type;
+    RETURN_ARG_UNLESS(tok->gen.datatype == type, 0);
+    ti = _eprog_type_idx(type);
+    RETURN_ARG_UNLESS(ti >= 0, 0);
+    for (i = 0; i < arity; i++) {
+        RETURN_ARG_UNLESS(ctx->regs[args[i]].type == type, 0);
+        if (ctx->regs[args[i]].len > max_len)
+            max_len = ctx->regs[args[i]].len;
+        uniform &= ctx->regs[args[i]].uniform;
+    }
+
+    switch (tok->op.idx) {
+        case OP_ADD:                    base = EOP_ADD;     break;
+        case OP_SUBTRACT:               base = EOP_SUB;     break;
+        case OP_MULTIPLY:               base = EOP_MUL;     break;
+        case OP_DIVIDE:                 base = EOP_DIV;     break;
+        case OP_MODULO:                 base = EOP_MOD;     break;
+        case OP_IS_EQUAL:               base = EOP_EQ;      break;
+        case OP_IS_NOT_EQUAL:           base = EOP_NE;      break;
+        case OP_IS_LESS_THAN:           base = EOP_LT;      break;
+        case OP_IS_LESS_THAN_OR_EQUAL:  base = EOP_LE;      break;
+        case OP_IS_GREATER_THAN:        base = EOP_GT;      break;
+        case OP_IS_GREATER_THAN_OR_EQUAL: base = EOP_GE;    break;
+        case OP_LOGICAL_AND:            base = EOP_AND;     break;
+        case OP_LOGICAL_OR:             base = EOP_OR;      break;
+        case OP_LOGICAL_NOT:            base = EOP_NOT;     break;
+        case OP_IF_ELSE:                base = EOP_IF_ELSE; break;
+        case OP_IF_THEN_ELSE:           base = EOP_SELECT;  break;
+        case OP_LEFT_BIT_SHIFT:         base = EOP_SHL;     break;
+        case OP_RIGHT_BIT_SHIFT:        base = EOP_SHR;     break;
+        case OP_BITWISE_AND:            base = EOP_BAND;    break;
+        case OP_BITWISE_OR:             base = EOP_BOR;     break;
+        case OP_BITWISE_XOR:            base = EOP_BXOR;    break;
+        default:                        return 0;
+    }
+    if (base >= EOP_SHL && base <= EOP_BXOR)
+        RETURN_ARG_UNLESS(ET_INT == ti, 0);
+    /* the interpreter only implements these arities */
+    RETURN_ARG_UNLESS(arity == (EOP_NOT == base ? 1 : EOP_SELECT == base ? 3 : 2), 0);
+
+    ins = _eprog_add_instr(ctx, EOP_TYPED(base, ti));
+    RETURN_ARG_UNLESS(_eprog_first_stride(ctx, args[0], max_len, &ins->stride[0]), 0);
+    if (2 == arity) {
+        RETURN_ARG_UNLESS(_eprog_stride(ctx, args[1], ctx->regs[args[1]].len, max_len,
+                                        &ins->stride[1]), 0);
+    }
+    else if (3 == arity) {
+        /* the interpreter indexes both branches using the length of the last operand */
+        int mod_len = ctx->regs[args[2]].len;
+        RETURN_ARG_UNLESS(_eprog_stride(ctx, args[1], mod_len, max_len, &ins->stride[1]), 0);
+        RETURN_ARG_UNLESS(_eprog_stride(ctx, args[2], mod_len, max_len, &ins->stride[2]), 0);
+    }
+    for (i = 0; i < arity; i++)
+        ins->src[i] = args[i];
+    ins->len = uniform ? 1 : max_len;
+    /* integer operations cannot raise floating point exceptions; division by zero is checked
+     * explicitly */
+    ins->check = ET_INT != ti || EOP_DIV == base;
+
+    /* fuse multiply-add sequences */
+    if (EOP_ADD == base || EOP_SUB == base) {
+        int sum = EOP_ADD == base;
+        if ((mul = _eprog_fusable(ctx, args[0], EOP_TYPED(EOP_MUL, ti)))) {
+            ins->opcode = EOP_TYPED(sum ? EOP_MULADD : EOP_MULSUB, ti);
+            ins->src[2] = ins->src[1];
+            ins->stride[2] = ins->stride[1];
+        }
+        else if ((mul = _eprog_fusable(ctx, args[1], EOP_TYPED(EOP_MUL, ti)))) {
+            ins->opcode = EOP_TYPED(sum ? EOP_ADDMUL : EOP_SUBMUL, ti);
+            ins->src[2] = ins->src[0];
+            ins->stride[2] = ins->stride[0];
+        }
+        if (mul) {
+            /* the product is read with the stride of the operand it replaces; if this is 0 the
+             * product is uniform and so are its operands */
+            int mul_stride = ins->stride[mul->dst == args[0] ? 0 : 1];
+            ins->src[0] = mul->src[0];
+            ins->src[1] = mul->src[1];
+            ins->stride[0] = mul->stride[0] & mul_stride;
+            ins->stride[1] = mul->stride[1] & mul_stride;
+            ins->check |= mul->check;
+            mul->opcode = EOP_NOP;
+        }
+    }
+
+    ctx->dp -= arity;
+    dst = _eprog_add_reg(ctx, type, max_len, uniform, ins - ctx->prog->instrs);
+    ins->dst = dst;
+    ctx->stack[++ctx->dp] = dst;
+    return 1;
+}
+
+static int _eprog_compile_fn(eprog_ctx ctx, etoken tok)
+{
+    int i, ti, arity = tok->fn.arity, max_len = 0, uniform = 1, dst, *args;
+    mpr_type type = tok->gen.datatype;
+    einstr ins, inner;
+    void *fn = 0;
+
+    /* functions below FN_DEL_IDX have state, side effects or are handled elsewhere */
+    RETURN_ARG_UNLESS(tok->fn.idx >= 0 && tok->fn.idx < FN_DEL_IDX, 0);
+    RETURN_ARG_UNLESS(arity >= 1 && arity <= 4 && ctx->dp + 1 >= arity, 0);
+    ti = _eprog_type_idx(type);
+    switch (ti) {
+        case ET_INT:    fn = fn_tbl[tok->fn.idx].fn_int;    break;
+        case ET_FLT:    fn = fn_tbl[tok->fn.idx].fn_flt;    break;
+        case ET_DBL:    fn = fn_tbl[tok->fn.idx].fn_dbl;    break;
+        default:        return 0;
+    }
+    RETURN_ARG_UNLESS(fn, 0);
+    args = &ctx->stack[ctx->dp + 1 - arity];
+    for (i = 0; i < arity; i++) {
+        RETURN_ARG_UNLESS(ctx->regs[args[i]].type == type, 0);
+        if (ctx->regs[args[i]].len > max_len)
+            max_len = ctx->regs[args[i]].len;
+        uniform &= ctx->regs[args[i]].uniform;
+    }
+
+    if (2 == arity && (FN_MIN == tok->fn.idx || FN_MAX == tok->fn.idx))
+        ins = _eprog_add_instr(ctx, EOP_TYPED(FN_MIN == tok->fn.idx ? EOP_MIN : EOP_MAX, ti));
+    else if (1 == arity && ET_INT != ti && (FN_SQRT == tok->fn.idx || FN_ABS == tok->fn.idx))
+        ins = _eprog_add_instr(ctx, EOP_TYPED(FN_SQRT == tok->fn.idx ? EOP_SQRT : EOP_ABS, ti));
+    else {
+        ins = _eprog_add_instr(ctx, EOP_TYPED(EOP_FN1 + arity - 1, ti));
+        ins->arg.fn = fn;
+    }
+    RETURN_ARG_UNLESS(_eprog_first_stride(ctx, args[0], max_len, &ins->stride[0]), 0);
+    for (i = 1; i < arity && i < 3; i++) {
+        RETURN_ARG_UNLESS(_eprog_stride(ctx, args[i], ctx->regs[args[i]].len, max_len,
+                                        &ins->stride[i]), 0);
+    }
+    /* registers for a fourth argument are stored in the offset field */
+    if (4 == arity) {
+        uint8_t stride;
+        RETURN_ARG_UNLESS(args[3] < 0x8000, 0);
+        RETURN_ARG_UNLESS(_eprog_stride(ctx, args[3], ctx->regs[args[3]].len, max_len, &stride), 0);
+        ins->offset = args[3] | (stride << 15);
+    }
+    for (i = 0; i < arity && i < 3; i++)
+        ins->src[i] = args[i];
+    ins->len = uniform ? 1 : max_len;
+    ins->check = 1;
+
+    /* fuse clamping sequences */
+    if (EOP_TYPED(EOP_MIN, ti) == ins->opcode)
+        inner = _eprog_fusable(ctx, args[0], EOP_TYPED(EOP_MAX, ti));
+    else if (EOP_TYPED(EOP_MAX, ti) == ins->opcode)
+        inner = _eprog_fusable(ctx, args[0], EOP_TYPED(EOP_MIN, ti));
+    else
+        inner = 0;
+    if (inner) {
+        int inner_stride = ins->stride[0];
+        ins->opcode = EOP_TYPED(EOP_BASE(ins->opcode) == EOP_MIN ? EOP_MAXMIN : EOP_MINMAX, ti);
+        ins->src[2] = ins->src[1];
+        ins->stride[2] = ins->stride[1];
+        ins->src[0] = inner->src[0];
+        ins->src[1] = inner->src[1];
+        ins->stride[0] = inner->stride[0] & inner_stride;
+        ins->stride[1] = inner->stride[1] & inner_stride;
+        ins->check |= inner->check;
+        inner->opcode = EOP_NOP;
+    }
+
+    ctx->dp -= arity;
+    dst = _eprog_add_reg(ctx, type, max_len, uniform, ins - ctx->prog->instrs);
+    ins->dst = dst;
+    ctx->stack[++ctx->dp] = dst;
+    return 1;
+}
+
+static int _eprog_compile_cast(eprog_ctx ctx, mpr_type type)
+{
+    int i, src, dst, ti = _eprog_type_idx(type), src_ti;
+    ereg_t *r;
+    evalue s, d;
+    einstr ins;
+
+    RETURN_ARG_UNLESS(ctx->dp >= 0 && ti >= 0, 0);
+    src = ctx->stack[ctx->dp];
+    r = &ctx->regs[src];
+    src_ti = _eprog_type_idx(r->type);
+    RETURN_ARG_UNLESS(src_ti >= 0, 0);
+    if (src_ti == ti)
+        return 1;
+
+    if (r->def >= 0) {
+        ins = _eprog_add_instr(ctx, EOP_TYPED(EOP_TO_INT + ti, src_ti));
+        ins->src[0] = src;
+        ins->stride[0] = !r->uniform;
+        ins->len = r->uniform ? 1 : r->len;
+        dst = _eprog_add_reg(ctx, type, ctx->regs[src].len, ctx->regs[src].uniform,
+                             ins - ctx->prog->instrs);
+        ins->dst = dst;
+    }
+    else {
+        /* fold casts of constants */
+        int len = r->uniform ? 1 : r->len;
+        dst = _eprog_add_reg(ctx, type, r->len, r->uniform, -1);
+        s = _eprog_reg(ctx->prog, src);
+        d = _eprog_reg(ctx->prog, dst);
+        for (i = 0; i < len; i++) {
+            switch (src_ti * 3 + ti) {
+                case ET_INT * 3 + ET_FLT:   d[i].f = (float)s[i].i;     break;
+                case ET_INT * 3 + ET_DBL:   d[i].d = (double)s[i].i;    break;
+                case ET_FLT * 3 + ET_INT:   d[i].i = (int)s[i].f;       break;
+                case ET_FLT * 3 + ET_DBL:   d[i].d = (double)s[i].f;    break;
+                case ET_DBL * 3 + ET_INT:   d[i].i = (int)s[i].d;       break;
+                case ET_DBL * 3 + ET_FLT:   d[i].f = (float)s[i].d;     break;
+            }
+        }
+    }
+    ctx->stack[ctx->dp] = dst;
+    return 1;
+}
+
+/* Find the token at which the interpreter resumes after an arithmetic error in token `idx`: the
+ * first token following the next run of assignment tokens. */
+static int _eprog_resume_tok(estack stk, int idx, int *clears)
+{
+    etoken_t *tok = stk->tokens;
+    *clears = 0;
+    while (++idx < stk->num_tokens && !(tok[idx].toktype & TOK_ASSIGN)) {}
+    while (idx < stk->num_tokens && (tok[idx].toktype & TOK_ASSIGN)) {
+        *clears = tok[idx].gen.flags & CLEAR_STACK;
+        ++idx;
+    }
+    return idx;
+}
+
+static int _eprog_compile_tok(eprog_ctx ctx, etoken tok, mpr_expr expr)
+{
+    eprog prog = ctx->prog;
+    int i, ti, dst;
+    evalue d;
+    einstr ins;
+
+    switch (tok->toktype & TOKEN_MASK) {
+        case TOK_LITERAL:
+        case TOK_VLITERAL: {
+            int vliteral = TOK_VLITERAL == tok->toktype;
+            RETURN_ARG_UNLESS(vliteral || TOK_LITERAL == tok->toktype, 0);
+            ti = _eprog_type_idx(tok->gen.datatype);
+            RETURN_ARG_UNLESS(ti >= 0 && tok->gen.vec_len, 0);
+            dst = _eprog_add_reg(ctx, tok->gen.datatype, tok->gen.vec_len, !vliteral, -1);
+            d = _eprog_reg(prog, dst);
+            for (i = 0; i < (vliteral ? tok->gen.vec_len : 1); i++) {
+                switch (ti) {
+                    case ET_INT: d[i].i = vliteral ? tok->lit.val.ip[i] : tok->lit.val.i; break;
+                    case ET_FLT: d[i].f = vliteral ? tok->lit.val.fp[i] : tok->lit.val.f; break;
+                    case ET_DBL: d[i].d = vliteral ? tok->lit.val.dp[i] : tok->lit.val.d; break;
+                }
+            }
+            ctx->stack[++ctx->dp] = dst;
+            break;
+        }
+        case TOK_VAR: {
+            int idx = tok->var.idx;
+            RETURN_ARG_UNLESS(TOK_VAR == tok->toktype && !(tok->gen.flags & VAR_IDXS), 0);
+            RETURN_ARG_UNLESS(tok->gen.vec_len, 0);
+            if (VAR_NOW == idx) {
+                ins = _eprog_add_instr(ctx, EOP_NOW);
+                ins->len = 1;
+                dst = _eprog_add_reg(ctx, MPR_DBL, tok->gen.vec_len, 1, ins - prog->instrs);
+            }
+            else {
+                if (idx >= VAR_X) {
+                    RETURN_ARG_UNLESS(idx - VAR_X < expr->num_src, 0);
+                }
+                else if (VAR_Y != idx) {
+                    RETURN_ARG_UNLESS(idx >= 0 && idx < expr->num_vars, 0);
+                }
+                ti = _eprog_type_idx(tok->gen.datatype);
+                RETURN_ARG_UNLESS(ti >= 0, 0);
+                ins = _eprog_add_instr(ctx, EOP_TYPED(EOP_LOAD, ti));
+                ins->len = tok->gen.vec_len;
+                ins->arg.tok = tok;
+                dst = _eprog_add_reg(ctx, tok->gen.datatype, tok->gen.vec_len, 0,
+                                     ins - prog->instrs);
+                /* reading a source changes the evaluation status so cannot be reordered */
+                if (idx >= VAR_X)
+                    ctx->barrier = ins - prog->instrs;
+            }
+            ins->dst = dst;
+            ctx->stack[++ctx->dp] = dst;
+            break;
+        }
+        case TOK_OP:
+            return _eprog_compile_op(ctx, tok);
+        case TOK_FN:
+            return _eprog_compile_fn(ctx, tok);
+        case TOK_VECTORIZE: {
+            int arity = tok->fn.arity, len = 0, *args;
+            RETURN_ARG_UNLESS(arity >= 1 && ctx->dp + 1 >= arity, 0);
+            args = &ctx->stack[ctx->dp + 1 - arity];
+            for (i = 0; i < arity; i++) {
+                RETURN_ARG_UNLESS(ctx->regs[args[i]].type == tok->gen.datatype, 0);
+                len += ctx->regs[args[i]].len;
+            }
+            RETURN_ARG_UNLESS(len <= prog->vec_len, 0);
+            dst = _eprog_add_reg(ctx, tok->gen.datatype, len, 0, prog->num_instrs);
+            for (i = 0, len = 0; i < arity; i++) {
+                ins = _eprog_add_instr(ctx, EOP_COPY);
+                ins->src[0] = args[i];
+                ins->stride[0] = !ctx->regs[args[i]].uniform;
+                ins->len = ctx->regs[args[i]].len;
+                ins->offset = len;
+                ins->dst = dst;
+                len += ins->len;
+            }
+            ctx->dp -= arity;
+            ctx->stack[++ctx->dp] = dst;
+            break;
+        }
+        case TOK_MOVE: {
+            int offset = tok->ctl.cache_offset;
+            RETURN_ARG_UNLESS(offset >= 0 && ctx->dp - offset >= 0, 0);
+            ctx->stack[ctx->dp - offset] = ctx->stack[ctx->dp];
+            ctx->dp -= offset;
+            break;
+        }
+        case TOK_SP_ADD:
+            /* growing the stack would expose stale values */
+            RETURN_ARG_UNLESS(tok->lit.val.i <= 0 && ctx->dp + tok->lit.val.i >= -1, 0);
+            ctx->dp += tok->lit.val.i;
+            break;
+        case TOK_ASSIGN: {
+            int idx = tok->var.idx, src;
+            RETURN_ARG_UNLESS(!NUM_VAR_IDXS(tok->gen.flags) && !tok->gen.casttype, 0);
+            RETURN_ARG_UNLESS(VAR_Y == idx || (idx >= 0 && idx < expr->num_vars), 0);
+            RETURN_ARG_UNLESS(ctx->dp >= 0, 0);
+            src = ctx->stack[ctx->dp];
+            ti = _eprog_type_idx(ctx->regs[src].type);
+            RETURN_ARG_UNLESS(ti >= 0, 0);
+            ins = _eprog_add_instr(ctx, EOP_TYPED(EOP_ASSIGN, ti));
+            ins->src[0] = src;
+            ins->stride[0] = !ctx->regs[src].uniform;
+            ins->len = ctx->regs[src].len;
+            ins->arg.tok = tok;
+            ctx->barrier = ins - prog->instrs;
+            if (tok->gen.flags & CLEAR_STACK)
+                ctx->dp = -1;
+            else if (ctx->dp && !(tok->toktype & ASSIGN_KEEP_ARG))
+                --ctx->dp;
+            return 1;
+        }
+        default:
+            return 0;
+    }
+    if (tok->gen.casttype)
+        return _eprog_compile_cast(ctx, tok->gen.casttype);
+    return 1;
+}
+
+void eprog_free(eprog prog)
+{
+    RETURN_UNLESS(prog);
+    FUNC_IF(free, prog->instrs);
+    FUNC_IF(free, prog->refs);
+    FUNC_IF(free, prog->regs);
+    FUNC_IF(free, prog->batch_regs);
+    free(prog);
+}
+
+/* Compile the non-initialization part of an expression's token stack. Returns NULL if the stack
+ * contains constructs that must be evaluated by the interpreter. */
+eprog eprog_new(mpr_expr expr)
+{
+    estack stk = expr->stack;
+    int i, j, ok = 1, max_instrs = 0, start = stk->init_offset, *tok_instr = 0;
+    eprog_ctx_t ctx;
+    eprog prog;
+
+    /* instance and mute control have side effects on the evaluation status */
+    RETURN_ARG_UNLESS(expr->inst_ctl < 0 && expr->mute_ctl < 0, 0);
+    RETURN_ARG_UNLESS(stk->num_tokens > start, 0);
+
+    for (i = start; i < stk->num_tokens; i++) {
+        max_instrs += 2;
+        if (TOK_VECTORIZE == (stk->tokens[i].toktype & TOKEN_MASK))
+            max_instrs += stk->tokens[i].fn.arity;
+    }
+    /* registers are allocated at most twice per token and must fit in 15 bits */
+    RETURN_ARG_UNLESS(max_instrs < 0x8000, 0);
+
+    prog = (eprog) calloc(1, sizeof(eprog_t));
+    prog->vec_len = stk->vec_len ? stk->vec_len : 1;
+    prog->instrs = malloc(max_instrs * sizeof(einstr_t));
+    ctx.prog = prog;
+    ctx.stk = stk;
+    ctx.size_regs = 8;
+    ctx.num_regs = 0;
+    ctx.regs = malloc(ctx.size_regs * sizeof(ereg_t));
+    prog->regs = malloc(ctx.size_regs * prog->vec_len * sizeof(evalue_t));
+    ctx.stack = malloc(stk->num_tokens * sizeof(int));
+    ctx.dp = -1;
+    ctx.barrier = -1;
+    /* also used for remapping instruction indices below */
+    tok_instr = malloc(((stk->num_tokens > max_instrs ? stk->num_tokens : max_instrs) + 1)
+                       * sizeof(int));
+
+    for (i = start; i < stk->num_tokens && ok; i++) {
+        tok_instr[i] = prog->num_instrs;
+        ok = _eprog_compile_tok(&ctx, &stk->tokens[i], expr);
+    }
+    tok_instr[stk->num_tokens] = EOP_SKIP_RETURN;
+    if (!ok)
+        goto fail;
+
+    /* Set the resume points for arithmetic errors. Since the interpreter only resets the stack for
+     * assignments that clear it, only allow resuming after a statement that ends this way. */
+    for (i = start; i < stk->num_tokens; i++) {
+        int resume, clears, end = i + 1 < stk->num_tokens ? tok_instr[i + 1] : prog->num_instrs;
+        for (j = tok_instr[i]; j < end; j++) {
+            einstr ins = &prog->instrs[j];
+            if (!ins->check || EOP_NOP == ins->opcode)
+                continue;
+            resume = _eprog_resume_tok(stk, i, &clears);
+            if (resume < stk->num_tokens && !clears)
+                goto fail;
+            ins->skip = tok_instr[resume];
+        }
+    }
+
+    /* remove fused instructions and remap resume points */
+    for (i = 0, j = 0; i < prog->num_instrs; i++) {
+        tok_instr[i] = j;
+        if (EOP_NOP != prog->instrs[i].opcode)
+            ++j;
+    }
+    tok_instr[prog->num_instrs] = j;
+    for (i = 0, j = 0; i < prog->num_instrs; i++) {
+        einstr ins = &prog->instrs[i];
+        if (EOP_NOP == ins->opcode)
+            continue;
+        if (EOP_SKIP_RETURN != ins->skip)
+            ins->skip = tok_instr[ins->skip];
+        if (i != j)
+            memcpy(&prog->instrs[j], ins, sizeof(einstr_t));
+        ++j;
+    }
+    prog->num_instrs = j;
+
+    /* collect instructions that reference signal or variable values */
+    prog->refs = malloc((prog->num_instrs ? prog->num_instrs : 1) * sizeof(uint16_t));
+    for (i = 0; i < prog->num_instrs; i++) {
+        int base = EOP_BASE(prog->instrs[i].opcode);
+        if (EOP_LOAD == base || EOP_ASSIGN == base)
+            prog->refs[prog->num_refs++] = i;
+    }
+    prog->num_regs = ctx.num_regs;
+
+    /* Programs can be evaluated in batches if a source is always read, since the result then
+     * depends on the instance and the interpreter never reports EXPR_EVAL_DONE. Variables shared
+     * between instances must be updated in instance order so also prevent batching. */
+    for (i = 0; i < prog->num_refs; i++) {
+        int idx = prog->instrs[prog->refs[i]].arg.tok->var.idx;
+        if (idx < VAR_NOW && !(expr->vars[idx].flags & VAR_INSTANCED))
+            break;
+    }
+    if (i == prog->num_refs) {
+        for (i = 0; i < prog->num_instrs && !prog->batchable; i++) {
+            einstr ins = &prog->instrs[i];
+            if (EOP_LOAD != EOP_BASE(ins->opcode) || ins->arg.tok->var.idx < VAR_X)
+                continue;
+            for (j = 0; j < i; j++) {
+                uint16_t skip = prog->instrs[j].skip;
+                if (prog->instrs[j].check && EOP_SKIP_RETURN != skip && skip > i)
+                    break;
+            }
+            prog->batchable = (j == i);
+        }
+    }
+
+    free(ctx.regs);
+    free(ctx.stack);
+    free(tok_instr);
+    return prog;
+
+  fail:
+    free(ctx.regs);
+    free(ctx.stack);
+    free(tok_instr);
+    eprog_free(prog);
+    return 0;
+}
+
+MPR_INLINE static mpr_value _eprog_get_value(int idx, mpr_value *v_in, mpr_value *v_vars,
+                                             mpr_value v_out)
+{
+    if (VAR_Y == idx)
+        return v_out;
+    else if (idx >= VAR_X)
+        return v_in ? v_in[idx - VAR_X] : 0;
+    else
+        return v_vars ? v_vars[idx] : 0;
+}
+
+#define REG(IDX) (regs + (IDX) * vlen)
+
+#define EOP_BINARY_CASE(OP, KOP, SYM, TI, T)                            \
+    case EOP_TYPED(OP, TI): {                                           \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        int sa = ins->stride[0], sb = ins->stride[1];                   \
+        if (ekernel_run(KOP, TI, d, a, b, 0, ins->len, sa, sb, 0))      \
+            break;                                                      \
+        if (sa && sb) {                                                 \
+            for (i = 0; i < ins->len; i++)                              \
+                d[i].T = a[i].T SYM b[i].T;                             \
+        }                                                               \
+        else {                                                          \
+            for (i = 0; i < ins->len; i++)                              \
+                d[i].T = a[i * sa].T SYM b[i * sb].T;                   \
+        }                                                               \
+        break;                                                          \
+    }
+
+#define EOP_FUSED_CASE(OP, KOP, TI, T, TYPE, CALC)                      \
+    case EOP_TYPED(OP, TI): {                                           \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        evalue c = REG(ins->src[2]);                                    \
+        int sa = ins->stride[0], sb = ins->stride[1], sc = ins->stride[2];\
+        if (ekernel_run(KOP, TI, d, a, b, c, ins->len, sa, sb, sc))     \
+            break;                                                      \
+        for (i = 0; i < ins->len; i++) {                                \
+            TYPE x = a[i * sa].T, y = b[i * sb].T, z = c[i * sc].T, t;  \
+            CALC;                                                       \
+        }                                                               \
+        break;                                                          \
+    }
+
+#define EOP_MATH_CASE(OP, KOP, TI, T, FN)                               \
+    case EOP_TYPED(OP, TI): {                                           \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]);                 \
+        int sa = ins->stride[0];                                        \
+        if (ekernel_run(KOP, TI, d, a, 0, 0, ins->len, sa, 0, 0))       \
+            break;                                                      \
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = FN(a[i * sa].T);                                   \
+        break;                                                          \
+    }
+
+#define EOP_FN_CASES(TI, T, FN)                                         \
+    case EOP_TYPED(EOP_FN1, TI): {                                      \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]);                 \
+        int sa = ins->stride[0];                                        \
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = ((FN##_arity1*)ins->arg.fn)(a[i * sa].T);          \
+        break;                                                          \
+    }                                                                   \
+    case EOP_TYPED(EOP_FN2, TI): {                                      \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        int sa = ins->stride[0], sb = ins->stride[1];                   \
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = ((FN##_arity2*)ins->arg.fn)(a[i * sa].T, b[i * sb].T);\
+        break;                                                          \
+    }                                                                   \
+    case EOP_TYPED(EOP_FN3, TI): {                                      \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        evalue c = REG(ins->src[2]);                                    \
+        int sa = ins->stride[0], sb = ins->stride[1], sc = ins->stride[2];\
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = ((FN##_arity3*)ins->arg.fn)(a[i * sa].T, b[i * sb].T, c[i * sc].T);\
+        break;                                                          \
+    }                                                                   \
+    case EOP_TYPED(EOP_FN4, TI): {                                      \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        evalue c = REG(ins->src[2]), e = REG(ins->offset & 0x7FFF);     \
+        int sa = ins->stride[0], sb = ins->stride[1], sc = ins->stride[2];\
+        int se = ins->offset >> 15;                                     \
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = ((FN##_arity4*)ins->arg.fn)(a[i * sa].T, b[i * sb].T, c[i * sc].T,\
+                                                 e[i * se].T);          \
+        break;                                                          \
+    }
+
+#define EOP_CAST_CASE(TI0, T0, TI1, TYPE1, T1)                          \
+    case EOP_TYPED(EOP_TO_INT + TI1, TI0): {                            \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]);                 \
+        int sa = ins->stride[0];                                        \
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T1 = (TYPE1)a[i * sa].T0;                              \
+        break;                                                          \
+    }
+
+#define EOP_VALUE_CASES(TI, TYPE, T)                                    \
+    case EOP_TYPED(EOP_LOAD, TI): {                                     \
+        etoken tok = ins->arg.tok;                                      \
+        mpr_value v = _eprog_get_value(tok->var.idx, v_in, v_vars, v_out);\
+        TYPE *s = (TYPE*)mpr_value_get_value(v, inst_idx, 0);           \
+        evalue d = REG(ins->dst);                                       \
+        int n = mpr_value_get_vlen(v), vidx = tok->var.vec_idx;         \
+        if (vidx + ins->len <= n) {                                     \
+            s += vidx;                                                  \
+            if (!ekernel_unpack(TI, d, s, ins->len)) {                  \
+                for (i = 0; i < ins->len; i++)                          \
+                    d[i].T = s[i];                                      \
+            }                                                           \
+        }                                                               \
+        else {                                                          \
+            for (i = 0; i < ins->len; i++)                              \
+                d[i].T = s[(i + vidx) % n];                             \
+        }                                                               \
+        if (tok->var.idx >= VAR_X)                                      \
+            *status &= ~EXPR_EVAL_DONE;                                 \
+        break;                                                          \
+    }                                                                   \
+    case EOP_TYPED(EOP_ASSIGN, TI): {                                   \
+        etoken tok = ins->arg.tok;                                      \
+        mpr_value v;                                                    \
+        evalue s = REG(ins->src[0]);                                    \
+        int j, vidx, ss = ins->stride[0];                               \
+        TYPE *a;                                                        \
+        if (VAR_Y == tok->var.idx) {                                    \
+            *status |= EXPR_UPDATE;                                     \
+            v = v_out;                                                  \
+        }                                                               \
+        else if (expr->vars[tok->var.idx].flags & VAR_SET_EXTERN)       \
+            break;                                                      \
+        else                                                            \
+            v = v_vars[tok->var.idx];                                   \
+        vidx = tok->var.vec_idx % (int)mpr_value_get_vlen(v);           \
+        mpr_value_set_time(v, inst_idx, 0, *time);                      \
+        a = (TYPE*)mpr_value_get_value(v, inst_idx, 0);                 \
+        if (!ss || vidx || tok->var.offset || tok->gen.vec_len > ins->len\
+            || !ekernel_pack(TI, a, s, tok->gen.vec_len)) {             \
+            for (i = vidx, j = tok->var.offset; i < tok->gen.vec_len + vidx; i++, j++) {\
+                if (j >= ins->len) j = 0;                               \
+                a[i] = s[j * ss].T;                                     \
+            }                                                           \
+        }                                                               \
+        mpr_value_set_elements_known(v, inst_idx, vidx, tok->gen.vec_len);\
+        break;                                                          \
+    }
+
+#define EOP_TYPED_CASES(TI, TYPE, T)                                    \
+    EOP_BINARY_CASE(EOP_ADD, EK_ADD, +, TI, T)                          \
+    EOP_BINARY_CASE(EOP_SUB, EK_SUB, -, TI, T)                          \
+    EOP_BINARY_CASE(EOP_MUL, EK_MUL, *, TI, T)                          \
+    EOP_BINARY_CASE(EOP_EQ, EK_EQ, ==, TI, T)                           \
+    EOP_BINARY_CASE(EOP_NE, EK_NE, !=, TI, T)                           \
+    EOP_BINARY_CASE(EOP_LT, EK_LT, <, TI, T)                            \
+    EOP_BINARY_CASE(EOP_LE, EK_LE, <=, TI, T)                           \
+    EOP_BINARY_CASE(EOP_GT, EK_GT, >, TI, T)                            \
+    EOP_BINARY_CASE(EOP_GE, EK_GE, >=, TI, T)                           \
+    EOP_BINARY_CASE(EOP_AND, -1, &&, TI, T)                             \
+    EOP_BINARY_CASE(EOP_OR, -1, ||, TI, T)                              \
+    case EOP_TYPED(EOP_NOT, TI): {                                      \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]);                 \
+        int sa = ins->stride[0];                                        \
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = !a[i * sa].T;                                      \
+        break;                                                          \
+    }                                                                   \
+    case EOP_TYPED(EOP_IF_ELSE, TI): {                                  \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        int sa = ins->stride[0], sb = ins->stride[1];                   \
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = a[i * sa].T ? a[i * sa].T : b[i * sb].T;           \
+        break;                                                          \
+    }                                                                   \
+    case EOP_TYPED(EOP_SELECT, TI): {                                   \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        evalue c = REG(ins->src[2]);                                    \
+        int sa = ins->stride[0], sb = ins->stride[1], sc = ins->stride[2];\
+        for (i = 0; i < ins->len; i++)                                  \
+            d[i].T = a[i * sa].T ? b[i * sb].T : c[i * sc].T;           \
+        break;                                                          \
+    }                                                                   \
+    EOP_FUSED_CASE(EOP_MULADD, EK_MULADD, TI, T, TYPE, t = x * y; d[i].T = t + z)  \
+    EOP_FUSED_CASE(EOP_MULSUB, EK_MULSUB, TI, T, TYPE, t = x * y; d[i].T = t - z)  \
+    EOP_FUSED_CASE(EOP_ADDMUL, EK_ADDMUL, TI, T, TYPE, t = x * y; d[i].T = z + t)  \
+    EOP_FUSED_CASE(EOP_SUBMUL, EK_SUBMUL, TI, T, TYPE, t = x * y; d[i].T = z - t)  \
+    EOP_FUSED_CASE(EOP_MAXMIN, EK_MAXMIN, TI, T, TYPE, t = (x > y) ? x : y; d[i].T = (t < z) ? t : z)\
+    EOP_FUSED_CASE(EOP_MINMAX, EK_MINMAX, TI, T, TYPE, t = (x < y) ? x : y; d[i].T = (t > z) ? t : z)\
+    case EOP_TYPED(EOP_MIN, TI): {                                      \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        int sa = ins->stride[0], sb = ins->stride[1];                   \
+        if (ekernel_run(EK_MIN, TI, d, a, b, 0, ins->len, sa, sb, 0))    \
+            break;                                                      \
+        for (i = 0; i < ins->len; i++) {                                \
+            TYPE x = a[i * sa].T, y = b[i * sb].T;                      \
+            d[i].T = (x < y) ? x : y;                                   \
+        }                                                               \
+        break;                                                          \
+    }                                                                   \
+    case EOP_TYPED(EOP_MAX, TI): {                                      \
+        evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);\
+        int sa = ins->stride[0], sb = ins->stride[1];                   \
+        if (ekernel_run(EK_MAX, TI, d, a, b, 0, ins->len, sa, sb, 0))    \
+            break;                                                      \
+        for (i = 0; i < ins->len; i++) {                                \
+            TYPE x = a[i * sa].T, y = b[i * sb].T;                      \
+            d[i].T = (x > y) ? x : y;                                   \
+        }                                                               \
+        break;                                                          \
+    }                                                                   \
+    EOP_VALUE_CASES(TI, TYPE, T)
+
+/* Check that the values referenced by a program are in the state it was compiled for, then
+ * advance the output history. Returns -1 if the instance must be left to the interpreter. */
+static int _eprog_begin(eprog prog, mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
+                        mpr_value v_out, mpr_time *time, int inst_idx)
+{
+    int i;
+
+    RETURN_ARG_UNLESS(v_out && time, -1);
+
+    /* Values that are missing, empty or of an unexpected type are reported by the interpreter. */
+    for (i = 0; i < prog->num_refs; i++) {
+        einstr ins = &prog->instrs[prog->refs[i]];
+        etoken tok = ins->arg.tok;
+        mpr_value v = _eprog_get_value(tok->var.idx, v_in, v_vars, v_out);
+        RETURN_ARG_UNLESS(v && _eprog_type_idx(mpr_value_get_type(v)) == ins->opcode % 3, -1);
+        /* the output history is advanced below so always has a sample */
+        if (EOP_LOAD == EOP_BASE(ins->opcode) && VAR_Y != tok->var.idx)
+            RETURN_ARG_UNLESS(mpr_value_get_num_samps(v, inst_idx) > 0, -1);
+    }
+
+    expr->stack->initialized = 1;
+
+    /* Increment index position of output data structure.
+     * Also copy last value in case only certain elements are set in this update. */
+    mpr_value_cpy_next(v_out, inst_idx, *time);
+    return 0;
+}
+
+/* Execute a single instruction using the register bank `regs`. Returns 0 on success, 1 if an
+ * arithmetic error means evaluation should resume at the instruction's skip target, or -1 if the
+ * instruction is invalid. */
+MPR_INLINE static int _eprog_exec(eprog prog, einstr ins, evalue regs, mpr_expr expr,
+                                  mpr_value *v_in, mpr_value *v_vars, mpr_value v_out,
+                                  mpr_time *time, int inst_idx, int *status)
+{
+    int i, vlen = prog->vec_len;
+    if (ins->check) {
+        feclearexcept(FE_ALL_EXCEPT);
+        errno = 0;
+    }
+    switch (ins->opcode) {
+        EOP_TYPED_CASES(ET_INT, int, i)
+        EOP_TYPED_CASES(ET_FLT, float, f)
+        EOP_TYPED_CASES(ET_DBL, double, d)
+        EOP_BINARY_CASE(EOP_MOD, -1, %, ET_INT, i)
+        EOP_BINARY_CASE(EOP_SHL, -1, <<, ET_INT, i)
+        EOP_BINARY_CASE(EOP_SHR, -1, >>, ET_INT, i)
+        EOP_BINARY_CASE(EOP_BAND, -1, &, ET_INT, i)
+        EOP_BINARY_CASE(EOP_BOR, -1, |, ET_INT, i)
+        EOP_BINARY_CASE(EOP_BXOR, -1, ^, ET_INT, i)
+        EOP_BINARY_CASE(EOP_DIV, EK_DIV, /, ET_FLT, f)
+        EOP_BINARY_CASE(EOP_DIV, EK_DIV, /, ET_DBL, d)
+        EOP_MATH_CASE(EOP_SQRT, EK_SQRT, ET_FLT, f, sqrtf)
+        EOP_MATH_CASE(EOP_SQRT, EK_SQRT, ET_DBL, d, sqrtd)
+        EOP_MATH_CASE(EOP_ABS, EK_ABS, ET_FLT, f, absf)
+        EOP_MATH_CASE(EOP_ABS, EK_ABS, ET_DBL, d, absd)
+        case EOP_TYPED(EOP_DIV, ET_INT): {
+            evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);
+            int sa = ins->stride[0], sb = ins->stride[1];
+            for (i = 0; i < ins->len; i++) {
+                /* check for divide-by-zero */
+                if (!b[i * sb].i)
+                    return 1;
+                d[i].i = a[i * sa].i / b[i * sb].i;
+            }
+            break;
+        }
+        case EOP_TYPED(EOP_MOD, ET_FLT): {
+            evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);
+            int sa = ins->stride[0], sb = ins->stride[1];
+            for (i = 0; i < ins->len; i++)
+                d[i].f = fmodf(a[i * sa].f, b[i * sb].f);
+            break;
+        }
+        case EOP_TYPED(EOP_MOD, ET_DBL): {
+            evalue d = REG(ins->dst), a = REG(ins->src[0]), b = REG(ins->src[1]);
+            int sa = ins->stride[0], sb = ins->stride[1];
+            for (i = 0; i < ins->len; i++)
+                d[i].d = fmod(a[i * sa].d, b[i * sb].d);
+            break;
+        }
+        EOP_FN_CASES(ET_INT, i, fn_int)
+        EOP_FN_CASES(ET_FLT, f, fn_flt)
+        EOP_FN_CASES(ET_DBL, d, fn_dbl)
+        EOP_CAST_CASE(ET_INT, i, ET_FLT, float, f)
+        EOP_CAST_CASE(ET_INT, i, ET_DBL, double, d)
+        EOP_CAST_CASE(ET_FLT, f, ET_INT, int, i)
+        EOP_CAST_CASE(ET_FLT, f, ET_DBL, double, d)
+        EOP_CAST_CASE(ET_DBL, d, ET_INT, int, i)
+        EOP_CAST_CASE(ET_DBL, d, ET_FLT, float, f)
+        case EOP_NOW:
+            REG(ins->dst)[0].d = mpr_time_as_dbl(*time);
+            break;
+        case EOP_COPY: {
+            evalue d = REG(ins->dst) + ins->offset, s = REG(ins->src[0]);
+            if (ins->stride[0])
+                evalue_cpy(d, s, ins->len);
+            else {
+                for (i = 0; i < ins->len; i++)
+                    d[i] = s[0];
+            }
+            break;
+        }
+        default:
+            return -1;
+    }
+    return ins->check && (errno || fetestexcept(FE_DIVBYZERO | FE_INVALID));
+}
+
+/* Evaluate a compiled expression. Returns the same status as mpr_expr_eval(), or -1 if the
+ * referenced values are not in the state the program was compiled for, in which case the caller
+ * should fall back to the interpreter. */
+int eprog_eval(eprog prog, mpr_expr expr, mpr_value *v_in, mpr_value *v_vars, mpr_value v_out,
+               mpr_time *time, int inst_idx)
+{
+    einstr ins = prog->instrs, end = prog->instrs + prog->num_instrs;
+    int status = 1 | EXPR_EVAL_DONE;
+
+    RETURN_ARG_UNLESS(!_eprog_begin(prog, expr, v_in, v_vars, v_out, time, inst_idx), -1);
+
+    while (ins < end) {
+        switch (_eprog_exec(prog, ins, prog->regs, expr, v_in, v_vars, v_out, time, inst_idx,
+                            &status)) {
+            case 0:
+                ++ins;
+                break;
+            case 1:
+                /* skip to after the next assignment */
+                if (EOP_SKIP_RETURN != ins->skip) {
+                    ins = prog->instrs + ins->skip;
+                    break;
+                }
+            default:
+                return 0;
+        }
+    }
+
+    if (!(status & (EXPR_UPDATE | EXPR_MUTED_UPDATE))) {
+        /* Undo position increment if nothing was updated. */
+        mpr_value_decr_idx(v_out, inst_idx);
+    }
+    return status;
+}
+
+/* Evaluate a compiled expression for several instances at once. Each instruction is executed for
+ * every instance in the batch before moving on to the next, using a separate register bank per
+ * instance. Instances that hit an arithmetic error stay idle until their resume point is reached.
+ * Statuses are written to `status`, with -1 for instances that must be left to the interpreter.
+ * Returns 0 if the program cannot be evaluated in batches. */
+int eprog_eval_batch(eprog prog, mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
+                     mpr_value v_out, mpr_time *time, const int *inst_idx, int num_inst,
+                     int *status)
+{
+    uint16_t resume[EPROG_BATCH_SIZE];
+    int i, j, k, bank_size = prog->num_regs * prog->vec_len;
+
+    RETURN_ARG_UNLESS(prog->batchable, 0);
+
+    if (!prog->batch_regs) {
+        /* constant registers are never written so each bank is initialized once */
+        prog->batch_regs = malloc(EPROG_BATCH_SIZE * bank_size * sizeof(evalue_t));
+        for (i = 0; i < EPROG_BATCH_SIZE; i++)
+            evalue_cpy(prog->batch_regs + i * bank_size, prog->regs, bank_size);
+    }
+
+    for (i = 0; i < num_inst; i += EPROG_BATCH_SIZE) {
+        int num = num_inst - i < EPROG_BATCH_SIZE ? num_inst - i : EPROG_BATCH_SIZE;
+        const int *idx = inst_idx + i;
+        int *stat = status + i;
+
+        for (j = 0; j < num; j++) {
+            if (_eprog_begin(prog, expr, v_in, v_vars, v_out, time, idx[j])) {
+                stat[j] = -1;
+                resume[j] = EOP_SKIP_RETURN;
+            }
+            else {
+                stat[j] = 1 | EXPR_EVAL_DONE;
+                resume[j] = 0;
+            }
+        }
+
+        for (k = 0; k < prog->num_instrs; k++) {
+            einstr ins = &prog->instrs[k];
+            for (j = 0; j < num; j++) {
+                if (resume[j] > k)
+                    continue;
+                switch (_eprog_exec(prog, ins, prog->batch_regs + j * bank_size, expr, v_in,
+                                    v_vars, v_out, time, idx[j], &stat[j])) {
+                    case 0:
+                        break;
+                    case 1:
+                        if (EOP_SKIP_RETURN != ins->skip) {
+                            resume[j] = ins->skip;
+                            break;
+                        }
+                    default:
+                        resume[j] = EOP_SKIP_RETURN;
+                        stat[j] = 0;
+                }
+            }
+        }
+
+        for (j = 0; j < num; j++) {
+            if (stat[j] > 0 && !(stat[j] & (EXPR_UPDATE | EXPR_MUTED_UPDATE))) {
+                /* Undo position increment if nothing was updated. */
+                mpr_value_decr_idx(v_out, idx[j]);
+            }
+        }
+    }
+    return 1;
+}
+
+#undef EOP_BINARY_CASE
+#undef EOP_FUSED_CASE
+#undef EOP_MATH_CASE
+#undef EOP_FN_CASES
+#undef EOP_CAST_CASE
+#undef EOP_VALUE_CASES
+#undef EOP_TYPED_CASES
+
+#endif /* __MPR_EXPR_PROGRAM_H__ */
@@ -7,12 +7,14 @@
 struct _mpr_expr
 {
     estack stack;
+    struct _eprog *prog;
     expr_var_t *vars;
     mpr_time next;
     uint16_t *src_mlen;
     uint16_t max_src_mlen;
     uint16_t dst_mlen;
     uint8_t num_vars;
+    uint8_t eval_slots;             /* cached evaluation buffer size, zero until computed */
     int8_t inst_ctl;
     int8_t mute_ctl;
     int8_t num_src;
@@ -9,7 +9,9 @@
 #endif
 
 #include "graph.h"
+#include "hash.h"
 #include "link.h"
+#include "mpr_atomic.h"
 #include "mpr_time.h"
 #include "path.h"
 #include "property.h"
@@ -55,6 +57,33 @@ typedef struct _mpr_subscription {
     uint32_t lease_expiration_sec;
 } *mpr_subscription;
 
+/*! An entry in a property index. Integer and pointer values are stored as unsigned keys that sort
+ *  in the same order as the values are compared by `mpr_list_filter()`. */
+typedef struct _mpr_prop_idx_entry {
+    union {
+        uint64_t u;
+        const char *s;
+    } val;
+    mpr_obj obj;
+    int pos;                        /*!< Position of the object in the graph list. */
+} mpr_prop_idx_entry_t, *mpr_prop_idx_entry;
+
+/*! A secondary index of one property of the objects of a type. The entries are rebuilt lazily
+ *  when objects were added or removed, or the property tables of the indexed objects counted a
+ *  change to the property, since they were sorted. */
+typedef struct _mpr_prop_idx {
+    struct _mpr_prop_idx *next;
+    char *key;                      /*!< Name of an extra property, or NULL. */
+    mpr_prop prop;
+    int obj_type;
+    mpr_type type;                  /*!< Type of the indexed values, or 0 if not yet built. */
+    uint32_t graph_changes;
+    uint32_t prop_changes;
+    int num;
+    mpr_prop_idx_entry entries;     /*!< Entries sorted by value, then by position. */
+    mpr_hash by_val;                /*!< First entry with each value, for equality lookups. */
+} mpr_prop_idx_t, *mpr_prop_idx;
+
 typedef struct _mpr_graph {
     mpr_obj_t obj;                  /* always first */
     mpr_net net;
@@ -62,19 +91,35 @@ typedef struct _mpr_graph {
     mpr_list sigs;                  /*!< List of signals. */
     mpr_list maps;                  /*!< List of maps. */
     mpr_list links;                 /*!< List of links. */
+    mpr_hash devs_by_id;            /*!< Index of devices keyed by id. */
+    mpr_hash sigs_by_id;            /*!< Index of signals keyed by id. */
+    mpr_hash maps_by_id;            /*!< Index of maps keyed by id. */
+    mpr_hash sigs_by_name;          /*!< Index of remote signals keyed by device and signal name. */
+    mpr_prop_idx prop_idxs;         /*!< Secondary indexes used for filtering lists. */
     fptr_list callbacks;            /*!< List of object record callbacks. */
 
     /*! Linked-list of autorenewing device subscriptions. */
     mpr_subscription subscriptions;
 
-    mpr_expr_eval_buffer expr_eval_buff;
-
     /*! Flags indicating whether information on signals and mappings should
      *  be automatically subscribed to when a new device is seen.*/
     int autosub;
 
     int own;
     int staged_maps;
+    int num_maps;
+
+    /*! Number of index entries that replaced a different object with the same key. Once this is
+     *  non-zero, lookups that miss the indexes fall back to searching the lists. */
+    int shadowed;
+
+    /*! Number of times objects were added, removed or modified outside of their property tables,
+     *  used to detect stale property indexes. */
+    uint32_t num_changes;
+
+    /*! Number of changes to each property of indexed objects, counted by their property tables
+     *  and shared by all extra properties. */
+    uint32_t prop_changes[MPR_TBL_NUM_PROP_IDX];
 
     uint32_t resource_counter;
 } mpr_graph_t;
@@ -274,7 +319,18 @@ mpr_graph mpr_graph_new(int subscribe_flags)
     mpr_obj_init((mpr_obj)g, g, MPR_GRAPH);
     g->obj.id = 0;
     g->own = 1;
+    g->devs_by_id = mpr_hash_new();
+    g->sigs_by_id = mpr_hash_new();
+    g->maps_by_id = mpr_hash_new();
+    g->sigs_by_name = mpr_hash_new();
     g->net = mpr_net_new(g);
+
+    /* index the signal properties most often used for filtering */
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_NAME, NULL);
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_DEV, NULL);
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_DIR, NULL);
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_TYPE, NULL);
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_LEN, NULL);
     if (subscribe_flags)
         autosubscribe(g, subscribe_flags);
 
@@ -285,8 +341,6 @@ mpr_graph mpr_graph_new(int subscribe_flags)
     mpr_tbl_add_record(tbl, MPR_PROP_LIBVER, NULL, 1, MPR_STR, PACKAGE_VERSION, MPR_TBL_MOD_NONE);
     /* TODO: add object queries as properties. */
 
-    g->expr_eval_buff = mpr_expr_new_eval_buffer(NULL);
-
     return g;
 }
 
@@ -348,17 +402,72 @@ void mpr_graph_free(mpr_graph g)
         mpr_graph_remove_dev(g, (mpr_dev)dev, MPR_STATUS_REMOVED);
     }
 
-    FUNC_IF(mpr_expr_free_eval_buffer, g->expr_eval_buff);
     mpr_net_free(g->net);
+    mpr_hash_free(g->devs_by_id);
+    mpr_hash_free(g->sigs_by_id);
+    mpr_hash_free(g->maps_by_id);
+    mpr_hash_free(g->sigs_by_name);
+    while (g->prop_idxs) {
+        mpr_prop_idx idx = g->prop_idxs;
+        g->prop_idxs = idx->next;
+        FUNC_IF(free, idx->key);
+        FUNC_IF(free, idx->entries);
+        mpr_hash_free(idx->by_val);
+        free(idx);
+    }
     mpr_obj_free(&g->obj);
     free(g);
 }
 
 /**** Generic records ****/
 
-static mpr_obj get_obj_by_id(mpr_graph g, void *obj_list, mpr_id id)
+static mpr_hash get_id_index(mpr_graph g, int obj_type)
 {
-    mpr_list objs = mpr_list_from_data(obj_list);
+    switch (obj_type) {
+        case MPR_DEV:  return g->devs_by_id;
+        case MPR_MAP:  return g->maps_by_id;
+        case MPR_SIG:  return g->sigs_by_id;
+        default:       return 0;
+    }
+}
+
+static void index_obj(mpr_graph g, mpr_obj o)
+{
+    mpr_hash index = get_id_index(g, o->type);
+    mpr_obj prev;
+    RETURN_UNLESS(index && o->id);
+    prev = (mpr_obj)mpr_hash_get_id(index, o->id);
+    if (prev && prev != o)
+        ++g->shadowed;
+    mpr_hash_add_id(index, o->id, o);
+}
+
+static void unindex_obj(mpr_graph g, mpr_obj o)
+{
+    mpr_hash index = get_id_index(g, o->type);
+    RETURN_UNLESS(index && o->id);
+    if (mpr_hash_get_id(index, o->id) == o)
+        mpr_hash_remove_id(index, o->id);
+}
+
+void mpr_graph_set_obj_id(mpr_graph g, mpr_obj o, mpr_id id)
+{
+    RETURN_UNLESS(o->id != id);
+    unindex_obj(g, o);
+    o->id = id;
+    index_obj(g, o);
+    ++g->num_changes;
+}
+
+static mpr_obj get_obj_by_id(mpr_graph g, int obj_type, mpr_id id)
+{
+    mpr_list objs;
+    mpr_obj o;
+    if (id && (o = (mpr_obj)mpr_hash_get_id(get_id_index(g, obj_type), id)))
+        return o;
+    /* objects without an id and objects sharing an id with another are not indexed */
+    RETURN_ARG_UNLESS(!id || g->shadowed, NULL);
+    objs = mpr_list_from_data(*get_list_internal(g, obj_type));
     while (objs) {
         if (id == (*objs)->id)
             return *objs;
@@ -370,11 +479,11 @@ static mpr_obj get_obj_by_id(mpr_graph g, void *obj_list, mpr_id id)
 mpr_obj mpr_graph_get_obj(mpr_graph g, mpr_id id, mpr_type type)
 {
     mpr_obj o;
-    if ((type & MPR_DEV) && (o = get_obj_by_id(g, g->devs, id)))
+    if ((type & MPR_DEV) && (o = get_obj_by_id(g, MPR_DEV, id)))
         return o;
-    if ((type & MPR_SIG) && (o = get_obj_by_id(g, g->sigs, id)))
+    if ((type & MPR_SIG) && (o = get_obj_by_id(g, MPR_SIG, id)))
         return o;
-    if ((type & MPR_MAP) && (o = get_obj_by_id(g, g->maps, id)))
+    if ((type & MPR_MAP) && (o = get_obj_by_id(g, MPR_MAP, id)))
         return o;
     return 0;
 }
@@ -399,6 +508,19 @@ mpr_list mpr_graph_new_query(mpr_graph g, int start, int obj_type,
     return start ? mpr_list_start(qry) : qry;
 }
 
+mpr_list mpr_graph_new_adj_query(mpr_graph g, int start, int obj_type, void *adj, int *num,
+                                 void **queries, const void *func, const char *types, ...)
+{
+    mpr_list qry = 0, *list = get_list_internal(g, obj_type);
+    va_list aq;
+    RETURN_ARG_UNLESS(list && (!start || *num), 0);
+    va_start(aq, types);
+    qry = vmpr_list_new_adj_query((const void**)list, (void***)adj, num, queries, func,
+                                  types, aq);
+    va_end(aq);
+    return start ? mpr_list_start(qry) : qry;
+}
+
 int mpr_graph_add_cb(mpr_graph g, mpr_graph_handler *h, int types, const void *user)
 {
     fptr_list cb = g->callbacks;
@@ -477,6 +599,256 @@ static void remove_by_qry(mpr_graph g, mpr_list l, mpr_graph_evt e)
     }
 }
 
+/**** Property indexes ****/
+
+/* Properties that are only ever changed through the property tables, or together with
+ * `num_changes`. Others, such as instance and map counts or status, are updated directly in the
+ * object structures and would leave their indexes stale. */
+static int get_is_indexable(mpr_prop prop)
+{
+    switch (MASK_PROP_BITFLAGS(prop)) {
+        case MPR_PROP_DEV:
+        case MPR_PROP_DIR:
+        case MPR_PROP_EPHEM:
+        case MPR_PROP_HOST:
+        case MPR_PROP_ID:
+        case MPR_PROP_LEN:
+        case MPR_PROP_LIBVER:
+        case MPR_PROP_MAX:
+        case MPR_PROP_MIN:
+        case MPR_PROP_NAME:
+        case MPR_PROP_ORDINAL:
+        case MPR_PROP_PORT:
+        case MPR_PROP_STEAL_MODE:
+        case MPR_PROP_TYPE:
+        case MPR_PROP_UNIT:
+        case MPR_PROP_EXTRA:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int mpr_graph_add_index(mpr_graph g, mpr_type obj_type, mpr_prop prop, const char *key)
+{
+    mpr_prop_idx idx;
+    RETURN_ARG_UNLESS(g && (MPR_DEV == obj_type || MPR_SIG == obj_type || MPR_MAP == obj_type), 0);
+    if (MPR_PROP_UNKNOWN == prop || MPR_PROP_EXTRA == prop) {
+        /* standard properties may also be named by key */
+        RETURN_ARG_UNLESS(key && key[0], 0);
+        prop = mpr_prop_from_str(key);
+        if (MPR_PROP_UNKNOWN != prop && MPR_PROP_EXTRA != prop)
+            key = NULL;
+    }
+    else
+        key = NULL;
+    TRACE_RETURN_UNLESS(get_is_indexable(prop), 0, "property '%s' cannot be indexed.\n",
+                        mpr_prop_as_str(prop, 1));
+    for (idx = g->prop_idxs; idx; idx = idx->next) {
+        if (   idx->obj_type == obj_type
+            && (key ? (idx->key && !strcmp(idx->key, key)) : (!idx->key && idx->prop == prop)))
+            return 0;
+    }
+    idx = (mpr_prop_idx)calloc(1, sizeof(mpr_prop_idx_t));
+    idx->obj_type = obj_type;
+    idx->prop = key ? MPR_PROP_EXTRA : prop;
+    idx->key = key ? strdup(key) : NULL;
+    idx->by_val = mpr_hash_new();
+    idx->next = g->prop_idxs;
+    g->prop_idxs = idx;
+    return 1;
+}
+
+void mpr_graph_invalidate_indexes(mpr_graph g)
+{
+    ++g->num_changes;
+}
+
+#define SIGN_BIT 0x8000000000000000ULL
+
+/* Convert a filter value to an index key. Signed integers are offset so that their keys sort in
+ * the same order as the values. Returns 0 if values of this type are not indexed. */
+static int get_idx_val(mpr_type type, const void *val, mpr_prop_idx_entry e)
+{
+    switch (type) {
+        case MPR_INT32: e->val.u = (uint64_t)(int64_t)*(int*)val ^ SIGN_BIT;          break;
+        case MPR_TYPE:  e->val.u = (uint64_t)(int64_t)*(mpr_type*)val ^ SIGN_BIT;     break;
+        case MPR_INT64: e->val.u = *(uint64_t*)val;                                   break;
+        case MPR_PTR:   e->val.u = (uint64_t)(uintptr_t)val;                          break;
+        case MPR_STR:   e->val.s = (const char*)val;                                  break;
+        default:        return 0;
+    }
+    return 1;
+}
+
+static int cmp_idx_val(mpr_type type, mpr_prop_idx_entry l, mpr_prop_idx_entry r)
+{
+    if (MPR_STR == type)
+        return strcmp(l->val.s, r->val.s);
+    return (l->val.u > r->val.u) - (l->val.u < r->val.u);
+}
+
+static int cmp_qsort_entry(const void *l, const void *r)
+{
+    mpr_prop_idx_entry el = (mpr_prop_idx_entry)l, er = (mpr_prop_idx_entry)r;
+    int cmp = (el->val.u > er->val.u) - (el->val.u < er->val.u);
+    return cmp ? cmp : el->pos - er->pos;
+}
+
+static int cmp_qsort_str_entry(const void *l, const void *r)
+{
+    mpr_prop_idx_entry el = (mpr_prop_idx_entry)l, er = (mpr_prop_idx_entry)r;
+    int cmp = strcmp(el->val.s, er->val.s);
+    return cmp ? cmp : el->pos - er->pos;
+}
+
+static int cmp_qsort_pos(const void *l, const void *r)
+{
+    return ((mpr_prop_idx_entry)l)->pos - ((mpr_prop_idx_entry)r)->pos;
+}
+
+/* Rebuild an index for values of the given type, including only objects holding a single value
+ * that filters of this type could match. */
+static void build_idx(mpr_graph g, mpr_prop_idx idx, mpr_type type)
+{
+    mpr_list list = mpr_list_from_data(*get_list_internal(g, idx->obj_type));
+    int size = 0, pos = 0;
+
+    /* read before the values so that changes made meanwhile are detected by the next lookup */
+    idx->prop_changes = mpr_atomic_load(&g->prop_changes[PROP_TO_INDEX(idx->prop)]);
+    idx->num = 0;
+    mpr_hash_clear(idx->by_val);
+    while (list) {
+        mpr_obj o = *list;
+        mpr_prop_idx_entry e;
+        mpr_type _type;
+        const void *_val;
+        mpr_prop p;
+        int _len;
+        list = mpr_list_get_next(list);
+        ++pos;
+
+        /* objects added since the last build start counting changes to their properties */
+        mpr_tbl_set_change_counters(o->props.synced, g->prop_changes);
+        if (idx->key)
+            p = mpr_obj_get_prop_by_key(o, idx->key, &_len, &_type, &_val, 0);
+        else
+            p = mpr_obj_get_prop_by_idx(o, idx->prop, NULL, &_len, &_type, &_val, 0);
+        if (MPR_PROP_UNKNOWN == p || 1 != _len || !_val)
+            continue;
+        /* pointer filters also match object properties, compared by address */
+        if (_type != type && (MPR_PTR != type || _type > MPR_OBJ))
+            continue;
+
+        if (idx->num == size) {
+            size = size ? size * 2 : 64;
+            idx->entries = realloc(idx->entries, size * sizeof(mpr_prop_idx_entry_t));
+        }
+        e = &idx->entries[idx->num];
+        if (!get_idx_val(type, _val, e))
+            continue;
+        e->obj = o;
+        e->pos = pos;
+        ++idx->num;
+    }
+    if (idx->num)
+        qsort(idx->entries, idx->num, sizeof(mpr_prop_idx_entry_t),
+              MPR_STR == type ? cmp_qsort_str_entry : cmp_qsort_entry);
+    for (pos = 0; pos < idx->num; pos++) {
+        mpr_prop_idx_entry e = &idx->entries[pos];
+        /* string keys are not copied, but the index is rebuilt before any lookup after they
+         * may have changed */
+        if (!pos || cmp_idx_val(type, e - 1, e)) {
+            if (MPR_STR == type)
+                mpr_hash_add_str(idx->by_val, e->val.s, e);
+            else
+                mpr_hash_add_id(idx->by_val, e->val.u, e);
+        }
+    }
+    idx->type = type;
+    idx->graph_changes = g->num_changes;
+}
+
+/* Return the position of the first entry not less than (or greater than if `upper`) a value. */
+static int find_idx_bound(mpr_prop_idx idx, mpr_prop_idx_entry val, int upper)
+{
+    int lo = 0, hi = idx->num;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2, cmp = cmp_idx_val(idx->type, &idx->entries[mid], val);
+        if (cmp < 0 || (upper && !cmp))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int mpr_graph_get_indexed(mpr_graph g, int obj_type, mpr_prop p, const char *key, mpr_type type,
+                          const void *val, mpr_op op, mpr_obj **objs)
+{
+    mpr_prop_idx idx;
+    mpr_prop_idx_entry_t v;
+    mpr_prop_idx_entry e, first;
+    int i, lo = 0, hi = 0, num = 0;
+
+    /* other operators and operators on vector elements always need to test every object */
+    RETURN_ARG_UNLESS(MPR_OP_EQ == op || (op >= MPR_OP_GT && op <= MPR_OP_LTE), -1);
+    RETURN_ARG_UNLESS(val && get_idx_val(type, val, &v), -1);
+    /* string patterns with wildcards can match anywhere in the value */
+    RETURN_ARG_UNLESS(MPR_STR != type || !strchr(v.val.s, '*'), -1);
+    if (key) {
+        /* standard properties may also be named by key */
+        mpr_prop kp = mpr_prop_from_str(key);
+        if (MPR_PROP_UNKNOWN != kp && MPR_PROP_EXTRA != kp) {
+            p = kp;
+            key = NULL;
+        }
+    }
+
+    for (idx = g->prop_idxs; idx; idx = idx->next) {
+        if (   idx->obj_type == obj_type
+            && (key ? (idx->key && !strcmp(idx->key, key)) : (!idx->key && idx->prop == p)))
+            break;
+    }
+    RETURN_ARG_UNLESS(idx, -1);
+
+    if (   idx->type != type || idx->graph_changes != g->num_changes
+        || idx->prop_changes != mpr_atomic_load(&g->prop_changes[PROP_TO_INDEX(idx->prop)]))
+        build_idx(g, idx, type);
+
+    switch (op) {
+        case MPR_OP_EQ:
+            /* equal values are stored together in list order */
+            if (MPR_STR == type)
+                first = (mpr_prop_idx_entry)mpr_hash_get_str(idx->by_val, v.val.s);
+            else
+                first = (mpr_prop_idx_entry)mpr_hash_get_id(idx->by_val, v.val.u);
+            RETURN_ARG_UNLESS(first, 0);
+            lo = hi = first - idx->entries;
+            while (hi < idx->num && !cmp_idx_val(type, &idx->entries[hi], &v))
+                ++hi;
+            break;
+        case MPR_OP_GT:     lo = find_idx_bound(idx, &v, 1);    hi = idx->num;  break;
+        case MPR_OP_GTE:    lo = find_idx_bound(idx, &v, 0);    hi = idx->num;  break;
+        case MPR_OP_LT:     lo = 0;     hi = find_idx_bound(idx, &v, 0);        break;
+        case MPR_OP_LTE:    lo = 0;     hi = find_idx_bound(idx, &v, 1);        break;
+        default:                                                                break;
+    }
+    RETURN_ARG_UNLESS(hi > lo, 0);
+
+    e = (mpr_prop_idx_entry)malloc((hi - lo) * sizeof(mpr_prop_idx_entry_t));
+    memcpy(e, &idx->entries[lo], (hi - lo) * sizeof(mpr_prop_idx_entry_t));
+    if (MPR_OP_EQ != op) {
+        /* restore the order of the graph list */
+        qsort(e, hi - lo, sizeof(mpr_prop_idx_entry_t), cmp_qsort_pos);
+    }
+    *objs = (mpr_obj*)malloc((hi - lo) * sizeof(mpr_obj));
+    for (i = lo; i < hi; i++)
+        (*objs)[num++] = e[i - lo].obj;
+    free(e);
+    return num;
+}
+
 /**** Device records ****/
 
 static mpr_subscription get_subscription(mpr_graph g, mpr_dev d)
@@ -513,6 +885,7 @@ mpr_dev mpr_graph_add_dev(mpr_graph g, const char *name, mpr_msg props, const ch
         mpr_id id = mpr_id_from_str(no_slash);
         dev = (mpr_dev)mpr_list_add_item((void**)&g->devs, mpr_dev_get_struct_size(0), 0);
         mpr_obj_init((mpr_obj)dev, g, MPR_DEV);
+        ++g->num_changes;
         mpr_dev_init(dev, 0, no_slash, id);
 #ifdef DEBUG
         trace_graph(g, "added device ");
@@ -574,7 +947,9 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e)
     remove_by_qry(g, mpr_dev_get_links(d, MPR_DIR_UNDEFINED), e);
     remove_by_qry(g, mpr_dev_get_sigs(d, MPR_DIR_ANY), e);
 
+    unindex_obj(g, (mpr_obj)d);
     mpr_list_remove_item((void**)&g->devs, d);
+    ++g->num_changes;
     mpr_graph_call_cbs(g, (mpr_obj)d, MPR_DEV, e);
 
 #ifdef DEBUG
@@ -591,7 +966,12 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e)
 mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name)
 {
     const char *no_slash = mpr_path_skip_slash(name);
-    mpr_list devs = mpr_list_from_data(g->devs);
+    mpr_list devs;
+    /* device ids are derived from their names, so try the id index first */
+    mpr_dev dev = (mpr_dev)mpr_hash_get_id(g->devs_by_id, mpr_id_from_str(no_slash));
+    if (dev && (name = mpr_dev_get_name(dev)) && 0 == strcmp(name, no_slash))
+        return dev;
+    devs = mpr_list_from_data(g->devs);
     while (devs) {
         mpr_dev dev = (mpr_dev)*devs;
         name = mpr_dev_get_name(dev);
@@ -604,6 +984,55 @@ mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name)
 
 /**** Signals ****/
 
+/* Signals belonging to remote devices are indexed by a key combining hashes of the device and
+ * signal names, neither of which changes while the signal is in the graph. */
+static mpr_id get_sig_name_key(const char *dev_name, const char *sig_name)
+{
+    return mpr_id_from_str(dev_name) | (mpr_id_from_str(sig_name) >> 32);
+}
+
+static void index_sig_name(mpr_graph g, mpr_sig s)
+{
+    mpr_dev dev = mpr_sig_get_dev(s);
+    mpr_id key;
+    mpr_sig prev;
+    RETURN_UNLESS(!mpr_obj_get_is_local((mpr_obj)dev));
+    key = get_sig_name_key(mpr_dev_get_name(dev), mpr_sig_get_name(s));
+    prev = (mpr_sig)mpr_hash_get_id(g->sigs_by_name, key);
+    if (prev && prev != s)
+        ++g->shadowed;
+    mpr_hash_add_id(g->sigs_by_name, key, s);
+}
+
+static void unindex_sig_name(mpr_graph g, mpr_sig s)
+{
+    mpr_dev dev = mpr_sig_get_dev(s);
+    mpr_id key;
+    RETURN_UNLESS(dev && !mpr_obj_get_is_local((mpr_obj)dev));
+    key = get_sig_name_key(mpr_dev_get_name(dev), mpr_sig_get_name(s));
+    if (mpr_hash_get_id(g->sigs_by_name, key) == s)
+        mpr_hash_remove_id(g->sigs_by_name, key);
+}
+
+mpr_sig mpr_graph_get_sig_by_name(mpr_graph g, mpr_dev dev, const char *name)
+{
+    mpr_list sigs;
+    mpr_sig sig;
+    name = mpr_path_skip_slash(name);
+    sig = (mpr_sig)mpr_hash_get_id(g->sigs_by_name, get_sig_name_key(mpr_dev_get_name(dev), name));
+    if (sig && mpr_sig_get_dev(sig) == dev && 0 == strcmp(mpr_sig_get_name(sig), name))
+        return sig;
+    RETURN_ARG_UNLESS(g->shadowed, 0);
+    sigs = mpr_list_from_data(g->sigs);
+    while (sigs) {
+        sig = (mpr_sig)*sigs;
+        if (mpr_sig_get_dev(sig) == dev && 0 == strcmp(mpr_sig_get_name(sig), name))
+            return sig;
+        sigs = mpr_list_get_next(sigs);
+    }
+    return 0;
+}
+
 mpr_sig mpr_graph_add_sig(mpr_graph g, const char *name, const char *dev_name, mpr_msg msg)
 {
     mpr_sig sig = 0;
@@ -629,8 +1058,10 @@ mpr_sig mpr_graph_add_sig(mpr_graph g, const char *name, const char *dev_name, m
     else if ((sig = (mpr_sig)mpr_list_add_item((void**)&g->sigs, mpr_sig_get_struct_size(0), 0))) {
         int num_inst = 1;
         mpr_obj_init((mpr_obj)sig, g, MPR_SIG);
+        ++g->num_changes;
         mpr_sig_init(sig, dev, 0, MPR_DIR_UNDEFINED, name, 0, 0, 0, 0, 0, &num_inst);
         mpr_sig_set_from_msg(sig, msg);
+        index_sig_name(g, sig);
 #ifdef DEBUG
         trace_graph(g, "added signal ");
         mpr_prop_print(1, MPR_SIG, sig);
@@ -648,7 +1079,10 @@ void mpr_graph_remove_sig(mpr_graph g, mpr_sig s, mpr_graph_evt e)
     /* remove any stored maps using this signal */
     remove_by_qry(g, mpr_sig_get_maps(s, MPR_DIR_ANY), e);
 
+    unindex_obj(g, (mpr_obj)s);
+    unindex_sig_name(g, s);
     mpr_list_remove_item((void**)&g->sigs, s);
+    ++g->num_changes;
     mpr_graph_call_cbs(g, (mpr_obj)s, MPR_SIG, e);
 
 #ifdef DEBUG
@@ -743,8 +1177,9 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
     /* We could be part of larger "convergent" mapping, so we will retrieve
      * record by mapping id instead of names. */
     if (id) {
-        map = (mpr_map)get_obj_by_id(g, g->maps, id);
-        if (!map && get_obj_by_id(g, g->maps, 0)) {
+        map = (mpr_map)get_obj_by_id(g, MPR_MAP, id);
+        /* every map with an id is indexed, so any shortfall means some have no id yet */
+        if (!map && mpr_hash_get_count(g->maps_by_id) < g->num_maps) {
             /* may have staged map stored locally */
             map = mpr_graph_get_map_by_names(g, num_src, src_names, dst_name);
         }
@@ -766,7 +1201,9 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
 
         map = (mpr_map)mpr_list_add_item((void**)&g->maps, mpr_map_get_struct_size(is_local),
                                          is_local);
+        ++g->num_maps;
         mpr_obj_init((mpr_obj)map, g, MPR_MAP);
+        ++g->num_changes;
         mpr_map_init(map, num_src, src_sigs, dst_sig, is_local);
         if (id && !mpr_obj_get_id((mpr_obj)map))
             mpr_obj_set_id((mpr_obj)map, id);
@@ -798,6 +1235,7 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
             }
         }
         if (changed) {
+            ++g->num_changes;
             /* check again if this mirrors a staged map */
             mpr_list maps = mpr_list_from_data(g->maps);
             while (maps) {
@@ -808,8 +1246,12 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
                      * 'ready', so we will copy the new map properties to the original map and
                      * return it instead. */
 
-                    /* swap contents of new and old maps */
+                    /* swap contents of new and old maps, moving the id index entry along with
+                     * the id of the newer map */
+                    unindex_obj(g, (mpr_obj)map);
+                    unindex_obj(g, (mpr_obj)map2);
                     mpr_map_memswap(map, map2);
+                    index_obj(g, (mpr_obj)map2);
 
                     /* remove the newer map */
                     mpr_graph_remove_map(g, map, 0);
@@ -830,7 +1272,10 @@ void mpr_graph_remove_map(mpr_graph g, mpr_map m, mpr_graph_evt e)
 {
     RETURN_UNLESS(m);
     mpr_map_process_before_free(m);
+    unindex_obj(g, (mpr_obj)m);
     mpr_list_remove_item((void**)&g->maps, m);
+    ++g->num_changes;
+    --g->num_maps;
     if (mpr_obj_get_status((mpr_obj)m, 0) & MPR_STATUS_ACTIVE)
         mpr_graph_call_cbs(g, (mpr_obj)m, MPR_MAP, e);
 
@@ -896,7 +1341,10 @@ void mpr_graph_print(mpr_graph g, int properties)
 }
 
 /* TODO: consider throttling */
-void mpr_graph_housekeeping(mpr_graph g)
+/* Each step restarts its scan of the graph, since the caller may release its locks between
+ * steps and objects may be added or removed in the meantime. Every step that returns nonzero
+ * changes the status of, or removes, the object it handled, so the scans make progress. */
+int mpr_graph_housekeeping_step(mpr_graph g)
 {
     mpr_list list = mpr_list_from_data(g->devs);
     mpr_subscription s;
@@ -916,6 +1364,8 @@ void mpr_graph_housekeeping(mpr_graph g)
                     /* remove subscription */
                     mpr_graph_subscribe(g, (mpr_dev)dev, 0, 0);
                     mpr_graph_remove_dev(g, (mpr_dev)dev, MPR_STATUS_EXPIRED);
+                    mpr_list_free(list);
+                    return 1;
                 }
                 continue;
             }
@@ -932,6 +1382,10 @@ void mpr_graph_housekeeping(mpr_graph g)
             }
             else if (dev->status & MPR_STATUS_MODIFIED)
                 mpr_graph_call_cbs(g, dev, MPR_DEV, MPR_STATUS_MODIFIED);
+            else
+                continue;
+            mpr_list_free(list);
+            return 1;
         }
     }
 
@@ -940,8 +1394,11 @@ void mpr_graph_housekeeping(mpr_graph g)
     while (list) {
         mpr_obj sig = *list;
         list = mpr_list_get_next(list);
-        if (sig->status & MPR_STATUS_REMOVED)
+        if (sig->status & MPR_STATUS_REMOVED) {
             mpr_graph_remove_sig(g, (mpr_sig)sig, MPR_STATUS_REMOVED);
+            mpr_list_free(list);
+            return 1;
+        }
     }
 
     /* check if any maps need to be removed */
@@ -957,6 +1414,8 @@ void mpr_graph_housekeeping(mpr_graph g)
             else {
                 trace_graph(g, "Cleaning up removed map.\n");
                 mpr_graph_remove_map(g, (mpr_map)map, MPR_STATUS_REMOVED);
+                mpr_list_free(list);
+                return 1;
             }
         }
     }
@@ -973,6 +1432,12 @@ void mpr_graph_housekeeping(mpr_graph g)
         }
         s = s->next;
     }
+    return 0;
+}
+
+void mpr_graph_housekeeping(mpr_graph g)
+{
+    while (mpr_graph_housekeeping_step(g)) {}
 }
 
 int mpr_graph_poll(mpr_graph g, int block_ms)
@@ -990,6 +1455,41 @@ int mpr_graph_stop_polling(mpr_graph g)
     return mpr_net_stop_polling(g->net);
 }
 
+int mpr_graph_get_fds(mpr_graph g, int *fds, int num)
+{
+    RETURN_ARG_UNLESS(g, 0);
+    return mpr_net_get_fds(g->net, fds, num);
+}
+
+int mpr_graph_get_deadline(mpr_graph g)
+{
+    RETURN_ARG_UNLESS(g, 0);
+    return mpr_net_get_deadline(g->net);
+}
+
+int mpr_graph_process_fds(mpr_graph g)
+{
+    RETURN_ARG_UNLESS(g, 0);
+    return mpr_net_process(g->net);
+}
+
+int mpr_graph_start_data_thread(mpr_graph g)
+{
+    return mpr_graph_start_data_threads(g, 1);
+}
+
+int mpr_graph_start_data_threads(mpr_graph g, int num_threads)
+{
+    RETURN_ARG_UNLESS(g && num_threads > 0, -1);
+    return mpr_net_start_data_thread(g->net, num_threads);
+}
+
+int mpr_graph_stop_data_thread(mpr_graph g)
+{
+    RETURN_ARG_UNLESS(g, -1);
+    return mpr_net_stop_data_thread(g->net);
+}
+
 void mpr_graph_subscribe(mpr_graph g, mpr_dev d, int flags, int timeout)
 {
     RETURN_UNLESS(g && flags <= MPR_OBJ);
@@ -1005,7 +1505,7 @@ void mpr_graph_subscribe(mpr_graph g, mpr_dev d, int flags, int timeout)
         }
         else {
             trace_graph(g, "subscribing to device from another graph.\n")
-            mpr_dev ld = (mpr_dev)get_obj_by_id(g, g->devs, ((mpr_obj)d)->id);
+            mpr_dev ld = (mpr_dev)get_obj_by_id(g, MPR_DEV, ((mpr_obj)d)->id);
             if (ld) {
                 trace_graph(g, "  found local copy\n")
                 d = ld;
@@ -1152,9 +1652,12 @@ mpr_obj mpr_graph_add_obj(mpr_graph g, int obj_type, int is_local)
 
     obj = mpr_list_add_item((void**)list, size, is_local && (MPR_MAP == obj_type));
     mpr_obj_init(obj, g, obj_type);
+    ++g->num_changes;
 
-    if (MPR_MAP == obj_type)
+    if (MPR_MAP == obj_type) {
         ++g->staged_maps;
+        ++g->num_maps;
+    }
 
     return obj;
 }
@@ -1197,11 +1700,6 @@ int mpr_graph_get_autosub(mpr_graph g)
     return g->autosub;
 }
 
-mpr_expr_eval_buffer mpr_graph_get_expr_eval_buffer(mpr_graph g)
-{
-    return g->expr_eval_buff;
-}
-
 void mpr_graph_reset_obj_statuses(mpr_graph g)
 {
     mpr_list list = mpr_list_from_data(g->devs);
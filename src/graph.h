@@ -20,6 +20,36 @@ typedef struct _mpr_graph *mpr_graph;
  *  \return             Information about the device, or zero if not found. */
 mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name);
 
+/*! Find a signal belonging to a non-local device.
+ *  \param g            The graph to query.
+ *  \param dev          The device owning the signal.
+ *  \param name         Name of the signal to find.
+ *  \return             The signal, or zero if not found. */
+mpr_sig mpr_graph_get_sig_by_name(mpr_graph g, mpr_dev dev, const char *name);
+
+/*! Change the id of an object, keeping the graph's id indexes up to date.
+ *  \param g            The graph containing the object.
+ *  \param o            The object to modify.
+ *  \param id           The new id. */
+void mpr_graph_set_obj_id(mpr_graph g, mpr_obj o, mpr_id id);
+
+/*! Find candidate objects for a property filter using a property index.
+ *  \param g            The graph to query.
+ *  \param obj_type     The type of objects to find.
+ *  \param p            Symbolic identifier of the property, ignored if `key` is set.
+ *  \param key          The name of an extra property, or NULL.
+ *  \param type         The type of the filter value.
+ *  \param val          The filter value, as passed to `mpr_list_filter()`.
+ *  \param op           The comparison operator.
+ *  \param objs         Storage for an array of objects in list order, to be freed by the caller.
+ *  \return             The number of objects found, or -1 if no index can serve the filter. */
+int mpr_graph_get_indexed(mpr_graph g, int obj_type, mpr_prop p, const char *key, mpr_type type,
+                          const void *val, mpr_op op, mpr_obj **objs);
+
+/*! Mark property indexes as out of date after changing a property without using the
+ *  object's property table. */
+void mpr_graph_invalidate_indexes(mpr_graph g);
+
 mpr_map mpr_graph_get_map_by_names(mpr_graph g, int num_src, const char **srcs, const char *dst);
 
 /*! Call registered graph callbacks for a given object type.
@@ -33,6 +63,11 @@ void mpr_graph_cleanup(mpr_graph g);
 
 void mpr_graph_housekeeping(mpr_graph g);
 
+/*! Perform one housekeeping task, see mpr_graph_housekeeping(). Locks may be released between
+ *  steps.
+ *  \return             Nonzero if more tasks may be pending. */
+int mpr_graph_housekeeping_step(mpr_graph g);
+
 mpr_link mpr_graph_add_link(mpr_graph g, mpr_dev dev1, mpr_dev dev2, int is_local);
 
 /*! Add or update a device entry in the graph using parsed message parameters.
@@ -87,6 +122,21 @@ void mpr_graph_free_cbs(mpr_graph g);
 mpr_list mpr_graph_new_query(mpr_graph g, int allow_empty, int obj_type,
                              const void *func, const char *types, ...);
 
+/*! Create a query over the objects adjacent to another object, such as the signals of a device.
+ *  Only the objects in the array are tested, but the query behaves like one created with
+ *  mpr_graph_new_query() over the graph-wide list of the same type.
+ *  \param g            The graph to query.
+ *  \param start        1 to start the query before returning it.
+ *  \param obj_type     The type of the objects in the array.
+ *  \param adj          Address of the array of adjacent objects.
+ *  \param num          Address of the length of the array.
+ *  \param queries      Address of the owner's record of queries over its arrays.
+ *  \param func         Comparison function accepting objects that belong in the query.
+ *  \param types        Types of the arguments passed to the comparison function.
+ *  \return             The new query. */
+mpr_list mpr_graph_new_adj_query(mpr_graph g, int start, int obj_type, void *adj, int *num,
+                                 void **queries, const void *func, const char *types, ...);
+
 void mpr_graph_set_owned(mpr_graph g, int own);
 
 mpr_net mpr_graph_get_net(mpr_graph g);
@@ -101,8 +151,6 @@ void mpr_graph_sync_dev(mpr_graph g, const char *name);
 
 int mpr_graph_get_autosub(mpr_graph g);
 
-mpr_expr_eval_buffer mpr_graph_get_expr_eval_buffer(mpr_graph g);
-
 void mpr_graph_reset_obj_statuses(mpr_graph g);
 
 #endif /* __MPR_GRAPH_H__ */
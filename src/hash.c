@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "mpr_debug.h"
+
+#define MIN_SIZE 16
+
+typedef struct _mpr_hash_entry {
+    uint64_t key;       /*!< Integer key, or the hash of the string key. */
+    const char *str;    /*!< String key, or NULL for integer keys. */
+    void *val;          /*!< NULL for empty slots. */
+} mpr_hash_entry_t, *mpr_hash_entry;
+
+struct _mpr_hash {
+    mpr_hash_entry entries;
+    unsigned int size;  /*!< Always a power of two. */
+    unsigned int count; /*!< Number of live entries. */
+    unsigned int used;  /*!< Number of live entries plus tombstones. */
+};
+
+/* sentinel value marking removed entries so that probe sequences are not broken */
+static char tombstone;
+#define TOMBSTONE ((void*)&tombstone)
+
+/* 64-bit FNV-1a */
+static uint64_t hash_str(const char *str)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (*str) {
+        h ^= (unsigned char)*str++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* finalizer from MurmurHash3 to spread integer ids across the table */
+static unsigned int mix(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (unsigned int)key;
+}
+
+mpr_hash mpr_hash_new(void)
+{
+    mpr_hash hash = (mpr_hash) calloc(1, sizeof(struct _mpr_hash));
+    hash->size = MIN_SIZE;
+    hash->entries = (mpr_hash_entry) calloc(1, sizeof(mpr_hash_entry_t) * hash->size);
+    return hash;
+}
+
+void mpr_hash_free(mpr_hash hash)
+{
+    RETURN_UNLESS(hash);
+    FUNC_IF(free, hash->entries);
+    free(hash);
+}
+
+int mpr_hash_get_count(mpr_hash hash)
+{
+    return hash ? hash->count : 0;
+}
+
+void mpr_hash_clear(mpr_hash hash)
+{
+    RETURN_UNLESS(hash);
+    memset(hash->entries, 0, sizeof(mpr_hash_entry_t) * hash->size);
+    hash->count = hash->used = 0;
+}
+
+static mpr_hash_entry find(mpr_hash hash, uint64_t key, const char *str)
+{
+    unsigned int mask = hash->size - 1, idx = mix(key) & mask;
+    while (1) {
+        mpr_hash_entry e = &hash->entries[idx];
+        if (!e->val)
+            return NULL;
+        if (   TOMBSTONE != e->val && e->key == key
+            && (!str || (e->str && 0 == strcmp(e->str, str))))
+            return e;
+        idx = (idx + 1) & mask;
+    }
+}
+
+static void resize(mpr_hash hash, unsigned int size)
+{
+    unsigned int i, mask = size - 1;
+    mpr_hash_entry old = hash->entries;
+    unsigned int old_size = hash->size;
+
+    hash->entries = (mpr_hash_entry) calloc(1, sizeof(mpr_hash_entry_t) * size);
+    hash->size = size;
+    hash->used = hash->count;
+    for (i = 0; i < old_size; i++) {
+        unsigned int idx;
+        if (!old[i].val || TOMBSTONE == old[i].val)
+            continue;
+        idx = mix(old[i].key) & mask;
+        while (hash->entries[idx].val)
+            idx = (idx + 1) & mask;
+        hash->entries[idx] = old[i];
+    }
+    free(old);
+}
+
+static void add(mpr_hash hash, uint64_t key, const char *str, void *val)
+{
+    unsigned int mask, idx;
+    mpr_hash_entry e;
+    RETURN_UNLESS(hash && val);
+
+    if ((e = find(hash, key, str))) {
+        e->str = str;
+        e->val = val;
+        return;
+    }
+
+    /* keep load factor (including tombstones) below 3/4 */
+    if ((hash->used + 1) * 4 > hash->size * 3)
+        resize(hash, (hash->count + 1) * 2 > hash->size ? hash->size * 2 : hash->size);
+
+    mask = hash->size - 1;
+    idx = mix(key) & mask;
+    while (hash->entries[idx].val && TOMBSTONE != hash->entries[idx].val)
+        idx = (idx + 1) & mask;
+    e = &hash->entries[idx];
+    if (!e->val)
+        ++hash->used;
+    e->key = key;
+    e->str = str;
+    e->val = val;
+    ++hash->count;
+}
+
+static void *remove_entry(mpr_hash hash, uint64_t key, const char *str)
+{
+    void *val;
+    mpr_hash_entry e;
+    RETURN_ARG_UNLESS(hash && (e = find(hash, key, str)), NULL);
+    val = e->val;
+    e->val = TOMBSTONE;
+    e->str = NULL;
+    --hash->count;
+    if (!hash->count)
+        mpr_hash_clear(hash);
+    return val;
+}
+
+void mpr_hash_add_str(mpr_hash hash, const char *key, void *val)
+{
+    RETURN_UNLESS(key);
+    add(hash, hash_str(key), key, val);
+}
+
+void *mpr_hash_get_str(mpr_hash hash, const char *key)
+{
+    mpr_hash_entry e;
+    RETURN_ARG_UNLESS(hash && key, NULL);
+    e = find(hash, hash_str(key), key);
+    return e ? e->val : NULL;
+}
+
+void *mpr_hash_remove_str(mpr_hash hash, const char *key)
+{
+    RETURN_ARG_UNLESS(key, NULL);
+    return remove_entry(hash, hash_str(key), key);
+}
+
+void mpr_hash_add_id(mpr_hash hash, uint64_t key, void *val)
+{
+    add(hash, key, NULL, val);
+}
+
+void *mpr_hash_get_id(mpr_hash hash, uint64_t key)
+{
+    mpr_hash_entry e;
+    RETURN_ARG_UNLESS(hash, NULL);
+    e = find(hash, key, NULL);
+    return e ? e->val : NULL;
+}
+
+void *mpr_hash_remove_id(mpr_hash hash, uint64_t key)
+{
+    return remove_entry(hash, key, NULL);
+}
@@ -0,0 +1,40 @@
+
+#ifndef __MPR_HASH_H__
+#define __MPR_HASH_H__
+
+#include <stdint.h>
+
+/*! An open-addressing hash table mapping either strings or 64-bit integer ids to pointers.
+ *  A given table should only be used with one kind of key. String keys are not copied and must
+ *  remain valid until the entry is removed. Stored values must be non-NULL. */
+typedef struct _mpr_hash *mpr_hash;
+
+mpr_hash mpr_hash_new(void);
+
+void mpr_hash_free(mpr_hash hash);
+
+/*! Return the number of entries currently stored in the table. */
+int mpr_hash_get_count(mpr_hash hash);
+
+/*! Remove all entries without releasing the table memory. */
+void mpr_hash_clear(mpr_hash hash);
+
+/*! Add or replace the entry for a string key. */
+void mpr_hash_add_str(mpr_hash hash, const char *key, void *val);
+
+/*! Retrieve the value stored for a string key, or NULL if not found. */
+void *mpr_hash_get_str(mpr_hash hash, const char *key);
+
+/*! Remove the entry for a string key, returning the removed value or NULL if not found. */
+void *mpr_hash_remove_str(mpr_hash hash, const char *key);
+
+/*! Add or replace the entry for an integer key. */
+void mpr_hash_add_id(mpr_hash hash, uint64_t key, void *val);
+
+/*! Retrieve the value stored for an integer key, or NULL if not found. */
+void *mpr_hash_get_id(mpr_hash hash, uint64_t key);
+
+/*! Remove the entry for an integer key, returning the removed value or NULL if not found. */
+void *mpr_hash_remove_id(mpr_hash hash, uint64_t key);
+
+#endif /* __MPR_HASH_H__ */
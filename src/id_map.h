@@ -16,6 +16,9 @@
  *  remote and local instances. */
 typedef struct _mpr_id_map {
     struct _mpr_id_map *next;       /*!< The next id map in the list. */
+    struct _mpr_id_map *prev;       /*!< The previous id map in the active list. */
+    struct _mpr_id_map *next_LID;   /*!< The next active id map sharing this LID. */
+    struct _mpr_id_map *next_GID;   /*!< The next active id map sharing this GID. */
 
     uint64_t GID;                   /*!< Hash for originating device. */
     uint64_t LID;                   /*!< Local instance id to map. */
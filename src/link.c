@@ -10,18 +10,29 @@
 #include "mpr_time.h"
 #include "network.h"
 #include "object.h"
+#include "ring.h"
 #include "table.h"
 #include "mpr_debug.h"
 
 #include <mapper/mapper.h>
 
 #define NUM_BUNDLES 2
+#define RING_SIZE 65536
 
 typedef struct _mpr_bundle {
     lo_bundle udp;
     lo_bundle tcp;
 } mpr_bundle_t, *mpr_bundle;
 
+/*! Slots with pending updates on local-only links. Updates are delivered directly to the
+ *  destination signals without building or parsing OSC messages. */
+typedef struct _mpr_local_queue {
+    mpr_local_slot *slots;
+    mpr_time time;
+    int num;
+    int size;
+} mpr_local_queue_t, *mpr_local_queue;
+
 /*! Clock and timing information. */
 typedef struct _mpr_sync_time_t {
     mpr_time time;
@@ -43,19 +54,30 @@ typedef struct _mpr_link {
     mpr_dev devs[2];
     mpr_map *maps;
     int num_maps;
+    void *queries;                      /*!< Queries over the map array. */
 
     struct {
         lo_address admin;               /*!< Network address of remote endpoint */
         struct {
             lo_address udp;             /*!< Network address of remote endpoint */
             lo_address tcp;             /*!< Network address of remote endpoint */
+            mpr_udp_dst udp_dst;        /*!< Resolved UDP address for batched sends. */
         } data;
     } addr;
 
+    struct {
+        mpr_ring out;                   /*!< Updates sent to a remote device on the same host. */
+        mpr_ring in;                    /*!< Updates received from a remote device on the same host. */
+        uint8_t sent;                   /*!< 1 if records were written since the last wakeup check. */
+        int port;                       /*!< Remote data port the rings are named after. */
+    } ring;
+
     int is_local_only;
     uint8_t bundle_idx;
+    uint8_t queued;                     /*!< 1 if queued for processing by the local device. */
 
     mpr_bundle_t bundles[NUM_BUNDLES];  /*!< Circular buffer to handle interrupts during poll() */
+    mpr_local_queue_t queues[NUM_BUNDLES][2];   /*!< Used instead of bundles for local-only links. */
 
     mpr_sync_clock_t clock;
 } mpr_link_t;
@@ -73,6 +95,11 @@ mpr_link mpr_link_new(mpr_local_dev local_dev, mpr_dev remote_dev)
                               remote_dev, is_local);
 }
 
+int mpr_link_get_is_local_only(mpr_link link)
+{
+    return link->is_local_only;
+}
+
 int mpr_link_get_is_ready(mpr_link link)
 {
     return link && link->addr.data.udp;
@@ -139,6 +166,50 @@ void mpr_link_init(mpr_link link, mpr_graph g, mpr_dev dev1, mpr_dev dev2)
     mpr_net_send(net);
 }
 
+/* Rings are named by the device ids and data ports of the sender and receiver. The device ids
+ * are derived from the device names, which may be reused by devices on another bus or by a
+ * restarted process, but a data port is only bound by one live process on the host. The segment
+ * names stay within the 31 character limit of some platforms. */
+static void ring_name(char *name, mpr_dev from, mpr_dev to)
+{
+    int from_port = mpr_obj_get_prop_as_int32((mpr_obj)from, MPR_PROP_PORT, NULL);
+    int to_port = mpr_obj_get_prop_as_int32((mpr_obj)to, MPR_PROP_PORT, NULL);
+    snprintf(name, 32, "/mpr.%08x%08x.%04x%04x",
+             (unsigned int)(mpr_obj_get_id((mpr_obj)from) >> 32),
+             (unsigned int)(mpr_obj_get_id((mpr_obj)to) >> 32),
+             from_port & 0xFFFF, to_port & 0xFFFF);
+}
+
+static void close_rings(mpr_link link)
+{
+    if (link->ring.in) {
+        mpr_local_dev_remove_ring_link((mpr_local_dev)link->devs[LINK_LOCAL_DEV], link);
+        mpr_ring_free(link->ring.in);
+        link->ring.in = 0;
+    }
+    if (link->ring.out) {
+        mpr_ring_free(link->ring.out);
+        link->ring.out = 0;
+    }
+}
+
+/* Create the ring for outgoing updates and try attaching to the ring created by the remote device.
+ * The remote device may connect later, so attaching is retried in mpr_link_housekeeping(). */
+static void open_rings(mpr_link link)
+{
+    char name[32];
+    if (!link->ring.out) {
+        ring_name(name, link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
+        RETURN_UNLESS(link->ring.out = mpr_ring_new(name, RING_SIZE));
+    }
+    ring_name(name, link->devs[LINK_REMOTE_DEV], link->devs[LINK_LOCAL_DEV]);
+    if ((link->ring.in = mpr_ring_open(name))) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "receiving from device '%s' through shared memory\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+        mpr_local_dev_add_ring_link((mpr_local_dev)link->devs[LINK_LOCAL_DEV], link);
+    }
+}
+
 void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_port)
 {
     if (!link->is_local_only) {
@@ -147,12 +218,21 @@ void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_
         mpr_tbl_add_record(tbl, MPR_PROP_PORT, NULL, 1, MPR_INT32, &data_port, MPR_TBL_MOD_REM);
         sprintf(str, "%d", data_port);
         link->addr.data.udp = lo_address_new(host, str);
+        link->addr.data.udp_dst = mpr_udp_dst_new(host, str);
         link->addr.data.tcp = lo_address_new_with_proto(LO_TCP, host, str);
         lo_address_set_tcp_nodelay(link->addr.data.tcp, 1);
         sprintf(str, "%d", admin_port);
         link->addr.admin = lo_address_new(host, str);
         trace_dev(link->devs[LINK_LOCAL_DEV], "activated link to device '%s' at %s:%d\n",
                   mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]), host, data_port);
+        /* bypass the loopback sockets if the remote device shares our host */
+        if (link->ring.port != data_port) {
+            /* the remote device restarted, so its rings have different names */
+            close_rings(link);
+            link->ring.port = data_port;
+        }
+        if (!link->ring.in && mpr_net_get_is_host_local(mpr_graph_get_net(link->obj.graph), host))
+            open_rings(link);
     }
     else {
         trace_dev(link->devs[LINK_LOCAL_DEV], "activating link to local device '%s'\n",
@@ -174,22 +254,24 @@ void mpr_link_free(mpr_link link)
     mpr_obj_free(&link->obj);
     FUNC_IF(lo_address_free, link->addr.admin);
     FUNC_IF(lo_address_free, link->addr.data.udp);
+    mpr_udp_dst_free(link->addr.data.udp_dst);
     FUNC_IF(lo_address_free, link->addr.data.tcp);
     for (i = 0; i < NUM_BUNDLES; i++) {
         FUNC_IF(lo_bundle_free_recursive, link->bundles[i].udp);
         FUNC_IF(lo_bundle_free_recursive, link->bundles[i].tcp);
+        FUNC_IF(free, link->queues[i][0].slots);
+        FUNC_IF(free, link->queues[i][1].slots);
     }
+    if (link->queued)
+        mpr_local_dev_dequeue_link((mpr_local_dev)link->devs[LINK_LOCAL_DEV], link);
+    close_rings(link);
     mpr_dev_remove_link(link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
+    mpr_list_adj_release(&link->queries);
     FUNC_IF(free, link->maps);
 }
 
-/* note on memory handling of mpr_link_add_msg(): messages are owned by slot */
-void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t, mpr_proto proto)
+static void add_offset(mpr_link link, mpr_time *t, mpr_proto proto)
 {
-    lo_bundle *b;
-    uint8_t bundle_idx = link->bundle_idx;
-    RETURN_UNLESS(msg);
-
     /* add offset to timetag */
     /* retrieve clock offset for remote device */
     double offset = mpr_dev_get_offset(link->devs[LINK_REMOTE_DEV]);
@@ -203,7 +285,45 @@ void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time
     /* TODO: consider adding jitter compensation here */
     /* offset += link->clock.jitter; */
 
-    mpr_time_add_dbl(&t, offset);
+    mpr_time_add_dbl(t, offset);
+}
+
+static void enqueue(mpr_link link)
+{
+    RETURN_UNLESS(!link->queued);
+    link->queued = 1;
+    mpr_local_dev_queue_link((mpr_local_dev)link->devs[LINK_LOCAL_DEV], link);
+}
+
+/* note on memory handling of mpr_link_add_msg(): messages are owned by slot */
+void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto)
+{
+    lo_bundle *b;
+    uint8_t bundle_idx = link->bundle_idx;
+    /* local-only links deliver slot updates directly using mpr_link_add_slot_updates() */
+    RETURN_UNLESS(msg && !link->is_local_only);
+
+    add_offset(link, &t, proto);
+
+    if (MPR_PROTO_UDP == proto && link->ring.out && mpr_ring_get_is_attached(link->ring.out)) {
+        /* Serialize the message directly into shared memory, preceded by its timetag. If the ring
+         * is full the update is dropped like a datagram overflowing a socket buffer: sending it
+         * over the network instead could deliver it before the records still in the ring. */
+        size_t len = lo_message_length(msg, path);
+        char *rec = mpr_ring_reserve(link->ring.out, sizeof(mpr_time) + len);
+        if (!rec) {
+            trace_dev(link->devs[LINK_LOCAL_DEV], "shared memory ring to device '%s' is full, "
+                      "dropping update\n", mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+            return;
+        }
+        memcpy(rec, &t, sizeof(mpr_time));
+        lo_message_serialise(msg, path, rec + sizeof(mpr_time), &len);
+        mpr_ring_commit(link->ring.out);
+        link->ring.sent = 1;
+        enqueue(link);
+        return;
+    }
 
     /* add message to existing bundles */
     b = (proto == MPR_PROTO_UDP) ? &link->bundles[bundle_idx].udp : &link->bundles[bundle_idx].tcp;
@@ -212,6 +332,52 @@ void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time
     else if (!lo_bundle_count(*b))
         lo_bundle_set_timestamp(*b, t);
     lo_bundle_add_message(*b, path, msg);
+    enqueue(link);
+}
+
+/* note on memory handling of mpr_link_add_slot_updates(): updates are owned by slot */
+void mpr_link_add_slot_updates(mpr_link link, mpr_local_slot slot, mpr_time t, mpr_proto proto)
+{
+    mpr_local_queue q = &link->queues[link->bundle_idx][MPR_PROTO_UDP == proto ? 0 : 1];
+
+    add_offset(link, &t, proto);
+
+    if (!mpr_net_get_is_same_shard(mpr_graph_get_net(link->obj.graph),
+                                   (mpr_local_dev)link->devs[LINK_LOCAL_DEV],
+                                   (mpr_local_dev)link->devs[LINK_REMOTE_DEV])) {
+        /* The devices are serviced by different data threads, which may not touch each other's
+         * link queues or signals: hand the updates over through the receiving device's queue. */
+        mpr_local_slot_handoff(slot, t);
+        return;
+    }
+
+    /* like a bundle, all updates in the queue share the timetag of the first update */
+    if (!q->num)
+        q->time = t;
+    if (q->num >= q->size) {
+        q->size = q->size ? q->size * 2 : 4;
+        q->slots = realloc(q->slots, q->size * sizeof(mpr_local_slot));
+    }
+    q->slots[q->num++] = slot;
+    enqueue(link);
+}
+
+void mpr_link_remove_slot_updates(mpr_link link, mpr_local_slot slot)
+{
+    int i, j, k;
+    RETURN_UNLESS(link && link->is_local_only);
+    for (i = 0; i < NUM_BUNDLES; i++) {
+        for (j = 0; j < 2; j++) {
+            mpr_local_queue q = &link->queues[i][j];
+            for (k = 0; k < q->num; k++) {
+                if (q->slots[k] != slot)
+                    continue;
+                memmove(&q->slots[k], &q->slots[k + 1], (q->num - k - 1) * sizeof(mpr_local_slot));
+                --q->num;
+                --k;
+            }
+        }
+    }
 }
 
 /* TODO: interrupt driven signal updates may not be followed by mpr_dev_process_outputs(); in the
@@ -226,11 +392,29 @@ int mpr_link_process_bundles(mpr_link link, mpr_time t)
 
     /* increment index for circular buffer of lo_bundles */
     link->bundle_idx = (link->bundle_idx + 1) % NUM_BUNDLES;
+    /* messages added from now on use the next bundle so need another processing cycle */
+    link->queued = 0;
 
     if (!link->is_local_only) {
         mpr_local_dev ldev = (mpr_local_dev)link->devs[LINK_LOCAL_DEV];
+        if (link->ring.sent) {
+            link->ring.sent = 0;
+            /* The remote device may be blocked on its sockets: an empty bundle wakes it. It only
+             * asks for this once its rings have been idle for a while, and the bundle is sent in
+             * the same batch as the other bundles of this cycle. */
+            if (mpr_ring_wake(link->ring.out) && !(mb->udp && lo_bundle_count(mb->udp))) {
+                lo_bundle wake = lo_bundle_new(t);
+                if (mpr_net_queue_udp(net, wake, link->addr.data.udp_dst)) {
+                    lo_send_bundle_from(link->addr.data.udp,
+                                        mpr_net_get_dev_server(net, ldev, SERVER_DATA_UDP), wake);
+                }
+                lo_bundle_free(wake);
+            }
+        }
         if ((lb = mb->udp)) {
-            if ((num_msg = lo_bundle_count(lb))) {
+            /* queue the bundle so that all links processed in this cycle are sent together */
+            if (   (num_msg = lo_bundle_count(lb))
+                && mpr_net_queue_udp(net, lb, link->addr.data.udp_dst)) {
                 lo_send_bundle_from(link->addr.data.udp, mpr_net_get_dev_server(net, ldev, SERVER_DATA_UDP), lb);
             }
             lo_bundle_clear(lb);
@@ -245,35 +429,52 @@ int mpr_link_process_bundles(mpr_link link, mpr_time t)
         }
     }
     else {
-        mpr_net net = mpr_graph_get_net(link->obj.graph);
-        lo_bundle *lbs = (lo_bundle*)mb;
-        int i;
+        int i, j;
         for (i = 0; i < 2; i++) {
-            if ((lb = lbs[i])) {
-                const char *path;
-                int j = 0, count;
-
-                /* set out-of-band timestamp */
-                mpr_net_set_bundle_time(net, lo_bundle_get_timestamp(lb));
-                /* call handler directly instead of sending over the network */
-                count = lo_bundle_count(lb);
-                while (j < count) {
-                    /* Find the local signal matching the message path in the destination device. */
-                    lo_message m = lo_bundle_get_message(lb, j, &path);
-                    mpr_sig dst = mpr_dev_get_sig_by_name(link->devs[i], path + 1);
-                    if (dst)
-                        mpr_sig_osc_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
-                                            lo_message_get_argc(m), m, dst);
-                    ++j;
-                }
-                lo_bundle_clear(lb);
-                num_msg += count;
-            }
+            mpr_local_queue q = &link->queues[idx][i];
+            if (!q->num)
+                continue;
+
+            /* set out-of-band timestamp */
+            mpr_net_set_bundle_time(net, q->time);
+            /* deliver updates directly instead of sending over the network */
+            for (j = 0; j < q->num; j++)
+                mpr_local_slot_deliver(q->slots[j], q->time);
+            num_msg += q->num;
+            q->num = 0;
         }
     }
     return num_msg;
 }
 
+int mpr_link_recv_ring(mpr_link link, int block)
+{
+    mpr_net net = mpr_graph_get_net(link->obj.graph);
+    lo_server server = mpr_net_get_dev_server(net, (mpr_local_dev)link->devs[LINK_LOCAL_DEV],
+                                              SERVER_DATA_UDP);
+    const char *rec;
+    size_t len;
+    int count = 0;
+
+    do {
+        while ((rec = mpr_ring_read(link->ring.in, &len))) {
+            mpr_time t;
+            if (len <= sizeof(mpr_time)) {
+                mpr_ring_release(link->ring.in);
+                continue;
+            }
+            memcpy(&t, rec, sizeof(mpr_time));
+            /* set out-of-band timestamp and dispatch without going through the socket */
+            mpr_net_set_bundle_time(net, t);
+            lo_server_dispatch_data(server, (void*)(rec + sizeof(mpr_time)), len - sizeof(mpr_time));
+            mpr_ring_release(link->ring.in);
+            ++count;
+        }
+        /* before blocking, recheck for records that arrived before the producer saw the flag */
+    } while (!count && block && !mpr_ring_wait(link->ring.in));
+    return count;
+}
+
 static int cmp_qry_maps(const void *context_data, mpr_map map)
 {
     mpr_id link_id = *(mpr_id*)context_data;
@@ -287,7 +488,8 @@ mpr_list mpr_link_get_maps(mpr_link link)
 
     RETURN_ARG_UNLESS(link, 0);
     /* TODO: can we use link->obj.graph here? */
-    return mpr_graph_new_query(link->obj.graph, 1, MPR_MAP, (void*)cmp_qry_maps, "h", link->obj.id);
+    return mpr_graph_new_adj_query(link->obj.graph, 1, MPR_MAP, &link->maps, &link->num_maps,
+                                   &link->queries, (void*)cmp_qry_maps, "h", link->obj.id);
 }
 
 int mpr_link_get_has_maps(mpr_link link, mpr_dir dir)
@@ -349,9 +551,7 @@ void mpr_link_add_map(mpr_link link, mpr_map map)
         if (link->maps[i] == map)
             return;
     }
-    ++link->num_maps;
-    link->maps = realloc(link->maps, link->num_maps * sizeof(mpr_map));
-    link->maps[link->num_maps - 1] = map;
+    mpr_list_adj_add((void***)&link->maps, &link->num_maps, map);
 
     if (link->is_local_only)
         link->clock.rcvd.time.sec = 0;
@@ -372,10 +572,7 @@ void mpr_link_remove_map(mpr_link link, mpr_map map)
     }
     if (i >= link->num_maps)
         return;
-    for (; i < link->num_maps - 1; i++)
-        link->maps[i] = link->maps[i + 1];
-    --link->num_maps;
-    link->maps = realloc(link->maps, link->num_maps * sizeof(mpr_map));
+    mpr_list_adj_remove((void***)&link->maps, &link->num_maps, map);
 
     if (link->is_local_only && !link->num_maps) {
         mpr_time_set(&link->clock.rcvd.time, MPR_NOW);
@@ -498,6 +695,10 @@ void mpr_link_housekeeping(mpr_link link, mpr_time now)
         }
     }
 
+    /* retry attaching to the ring of a co-located device that connected after us */
+    if (link->ring.out && !link->ring.in)
+        open_rings(link);
+
     /* Only send pings if this link has associated maps, ensuring empty
      * links are removed after the ping timeout. */
     if (!link->is_local_only && link->num_maps) {
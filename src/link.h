@@ -8,6 +8,7 @@ typedef struct _mpr_link *mpr_link;
 #include "graph.h"
 #include "list.h"
 #include "map.h"
+#include "slot.h"
 
 #define MPR_LINK 0x20
 
@@ -40,7 +41,33 @@ void mpr_link_free(mpr_link link);
 
 int mpr_link_process_bundles(mpr_link link, mpr_time t);
 
-void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t, mpr_proto proto);
+/*! Dispatch updates received from a co-located device through shared memory.
+ *  \param link         The link to receive on.
+ *  \param block        Non-zero if the caller will block waiting on its sockets if nothing was
+ *                      received, in which case the remote device is asked for a wakeup.
+ *  \return             The number of updates dispatched. */
+int mpr_link_recv_ring(mpr_link link, int block);
+
+/*! Add a message to the bundle of a link, or to its shared-memory ring.
+ *  \param link         The link to send on.
+ *  \param path         The OSC path of the message: a signal path or an alias path.
+ *  \param msg          The message, owned by the slot that built it.
+ *  \param t            Timetag of the message.
+ *  \param proto        The protocol to use. */
+void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto);
+
+/*! Queue the pending updates of a slot for in-process delivery over a local-only link.
+ *  \param link         The local-only link.
+ *  \param slot         The slot holding the updates.
+ *  \param t            Timetag for the updates.
+ *  \param proto        The protocol selecting the link direction. */
+void mpr_link_add_slot_updates(mpr_link link, mpr_local_slot slot, mpr_time t, mpr_proto proto);
+
+/*! Remove any queued references to a slot, e.g. before the slot is freed. */
+void mpr_link_remove_slot_updates(mpr_link link, mpr_local_slot slot);
+
+int mpr_link_get_is_local_only(mpr_link link);
 
 int mpr_link_get_is_ready(mpr_link link);
 
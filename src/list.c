@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stddef.h>
 
+#include "graph.h"
 #include "object.h"
 #include "path.h"
 #include "property.h"
@@ -54,9 +55,6 @@ typedef int query_compare_func_t(const void *ctx_data, const void *item);
 /*! Function for freeing query context */
 typedef void query_free_func_t(mpr_list_header_t *lh);
 
-/*! Function for handling parallel queries. */
-static int cmp_parallel_query(const void *ctx_data, const void *dev);
-
 /*! Contains some function pointers and data for handling query context. */
 typedef struct _query_info {
     unsigned int size;
@@ -64,6 +62,13 @@ typedef struct _query_info {
     uint16_t reset;
     query_compare_func_t *query_compare;
     query_free_func_t *query_free;
+    void ***adj;                    /*!< Array of candidate items, or NULL to search the list. */
+    int *num_adj;                   /*!< Length of the candidate array. */
+    int adj_idx;                    /*!< Index of the current item in the candidate array. */
+    struct _query_info *adj_next;   /*!< Next query over the same candidate array. */
+    struct _query_info **adj_prev;  /*!< Link to this query from the owner of the array. */
+    void **items;                   /*!< Results owned by a materialized list. */
+    int num_items;
     int *data; /* stub */
 } query_info_t;
 
@@ -184,6 +189,67 @@ void mpr_list_free_item(void *item)
         free(mpr_list_header_by_data(item));
 }
 
+void mpr_list_adj_add(void ***adj, int *num, void *item)
+{
+    int i;
+    for (i = 0; i < *num; i++) {
+        if ((*adj)[i] == item)
+            return;
+    }
+    /* the capacity is the next power of two, so only grow the array when a power is reached */
+    if (!(*num & (*num - 1)))
+        *adj = realloc(*adj, (*num ? *num * 2 : 1) * sizeof(void*));
+    (*adj)[(*num)++] = item;
+}
+
+void mpr_list_adj_remove(void ***adj, int *num, void *item)
+{
+    int i;
+    for (i = 0; i < *num; i++) {
+        if ((*adj)[i] == item)
+            break;
+    }
+    RETURN_UNLESS(i < *num);
+    /* preserve the order of the remaining items for queries iterating the array */
+    memmove(&(*adj)[i], &(*adj)[i + 1], (*num - i - 1) * sizeof(void*));
+    --(*num);
+}
+
+/*! Track a query over a candidate array so it can be ended when the array is freed. */
+static void adj_link(query_info_t *ctx, query_info_t **prev)
+{
+    ctx->adj_prev = prev;
+    ctx->adj_next = *prev;
+    if (ctx->adj_next)
+        ctx->adj_next->adj_prev = &ctx->adj_next;
+    *prev = ctx;
+}
+
+static void adj_unlink(query_info_t *ctx)
+{
+    RETURN_UNLESS(ctx->adj_prev);
+    *ctx->adj_prev = ctx->adj_next;
+    if (ctx->adj_next)
+        ctx->adj_next->adj_prev = ctx->adj_prev;
+    ctx->adj_prev = 0;
+    ctx->adj_next = 0;
+}
+
+void mpr_list_adj_release(void **queries)
+{
+    query_info_t *ctx = *(query_info_t**)queries;
+    while (ctx) {
+        query_info_t *next = ctx->adj_next;
+        /* point the query at its own empty results so that it ends at the next step */
+        ctx->adj = &ctx->items;
+        ctx->num_adj = &ctx->num_items;
+        ctx->adj_prev = 0;
+        ctx->adj_next = 0;
+        ctx = next;
+    }
+    *queries = 0;
+}
+
 /** Structures and functions for performing dynamic queries **/
 
 /* Here are some generalized routines for dealing with typical context
@@ -223,20 +289,109 @@ void **mpr_list_query_continuation(mpr_list_header_t *lh)
     return 0;
 }
 
-static void free_query_single_ctx(mpr_list_header_t *lh)
+/* Continuation for queries that test the items of a candidate array instead of walking the list.
+ * Items may have been added to or removed from the array since the last call, so the position of
+ * the current item is checked before moving on. */
+static void **mpr_list_adj_continuation(mpr_list_header_t *lh)
 {
-    if (cmp_parallel_query == lh->query_ctx->query_compare) {
-        /* this is a parallel query – we need to free components also */
-        void *data = &lh->query_ctx->data;
-        mpr_list_header_t *lh1 = *(mpr_list_header_t**)data;
-        mpr_list_header_t *lh2 = *(mpr_list_header_t**)((char*)data + sizeof(void*));
-        free_query_single_ctx(lh1);
-        free_query_single_ctx(lh2);
+    query_info_t *ctx = lh->query_ctx;
+    void **adj = *ctx->adj;
+    int i = ctx->adj_idx, num = *ctx->num_adj;
+    if (i >= 0 && (i >= num || adj[i] != lh->self)) {
+        for (i = 0; i < num && adj[i] != lh->self; i++) {}
+        if (i == num) {
+            /* the current item was removed, so its successor has taken its place */
+            i = ctx->adj_idx - 1;
+        }
+    }
+    for (++i; i < num; i++) {
+        if (ctx->query_compare(&ctx->data, adj[i])) {
+            ctx->adj_idx = i;
+            lh->self = adj[i];
+            return &lh->self;
+        }
     }
+
+    /* Clean up */
+    if (ctx->query_free)
+        ctx->query_free(lh);
+    return 0;
+}
+
+static void free_query_single_ctx(mpr_list_header_t *lh)
+{
+    adj_unlink(lh->query_ctx);
+    FUNC_IF(free, lh->query_ctx->items);
     free(lh->query_ctx);
     free(lh);
 }
 
+/** Materialized lists **/
+
+/* A materialized list holds its results in an array owned by the query context, and is iterated
+ * by the candidate array continuation with a comparison that accepts every item. This gives
+ * constant-time size and indexing, at the cost of not reflecting later changes to the graph. */
+
+static int cmp_array_item(const void *ctx_data, const void *item)
+{
+    return 1;
+}
+
+static int is_array(mpr_list_header_t *lh)
+{
+    return QUERY_DYNAMIC == lh->query_type && lh->query_ctx->items;
+}
+
+/*! Point a list header at the results array owned by its context. */
+static void set_array(mpr_list_header_t *lh, void **items, int num)
+{
+    query_info_t *ctx = lh->query_ctx;
+    ctx->items = items;
+    ctx->num_items = num;
+    ctx->adj = &ctx->items;
+    ctx->num_adj = &ctx->num_items;
+    lh->start = items;
+}
+
+/*! Create a materialized list from an array of items, taking ownership of the array. */
+static mpr_list new_array_list(void **items, int num)
+{
+    mpr_list_header_t *lh;
+    if (!num) {
+        FUNC_IF(free, items);
+        return 0;
+    }
+    lh = (mpr_list_header_t*)malloc(LIST_HEADER_SIZE);
+    lh->next = (void*)mpr_list_adj_continuation;
+    lh->query_type = QUERY_DYNAMIC;
+    lh->query_ctx = (query_info_t*)calloc(1, sizeof(query_info_t));
+    lh->query_ctx->size = sizeof(query_info_t);
+    lh->query_ctx->index_offset = -1;
+    lh->query_ctx->query_compare = (query_compare_func_t*)cmp_array_item;
+    lh->query_ctx->query_free = (query_free_func_t*)free_query_single_ctx;
+    set_array(lh, items, num);
+    lh->query_ctx->adj_idx = 0;
+    lh->self = items[0];
+    return (mpr_list)&lh->self;
+}
+
+/*! Move the remaining items of a list into a new array, consuming the list.
+ *  \return             The number of items. */
+static int collect_items(mpr_list list, void ***items)
+{
+    int num = 0, size = 0;
+    *items = 0;
+    while (list) {
+        if (num == size) {
+            size = size ? size * 2 : 8;
+            *items = realloc(*items, size * sizeof(void*));
+        }
+        (*items)[num++] = *list;
+        list = mpr_list_get_next(list);
+    }
+    return num;
+}
+
 #define GET_TYPE_SIZE(TYPE) \
 va_arg(aq_copy, TYPE);      \
 size += sizeof(TYPE);
@@ -339,11 +494,30 @@ mpr_list vmpr_list_new_query(const void **list, const void *func, const char *ty
     lh->query_ctx->reset = 0;
     lh->query_ctx->query_compare = (query_compare_func_t*)func;
     lh->query_ctx->query_free = (query_free_func_t*)free_query_single_ctx;
+    lh->query_ctx->adj = 0;
+    lh->query_ctx->adj_next = 0;
+    lh->query_ctx->adj_prev = 0;
+    lh->query_ctx->items = 0;
     lh->start = (void**)list;
     lh->self = *lh->start;
     return (mpr_list)&lh->self;
 }
 
+mpr_list vmpr_list_new_adj_query(const void **list, void ***adj, int *num, void **queries,
+                                 const void *func, const char *types, va_list aq)
+{
+    mpr_list_header_t *lh;
+    mpr_list qry = vmpr_list_new_query(list, func, types, aq);
+    RETURN_ARG_UNLESS(qry, 0);
+    lh = mpr_list_header_by_self(qry);
+    lh->next = (void*)mpr_list_adj_continuation;
+    lh->query_ctx->adj = adj;
+    lh->query_ctx->num_adj = num;
+    lh->query_ctx->adj_idx = -1;
+    adj_link(lh->query_ctx, (query_info_t**)queries);
+    return qry;
+}
+
 mpr_list mpr_list_new_query(const void **list, const void *func, const char *types, ...)
 {
     va_list aq;
@@ -367,7 +541,11 @@ mpr_list mpr_list_start(mpr_list list)
         *idx = 0;
     }
     lh->query_ctx->reset = 0;
-    if (QUERY_DYNAMIC == lh->query_type) {
+    if (QUERY_DYNAMIC == lh->query_type && lh->query_ctx->adj) {
+        lh->query_ctx->adj_idx = -1;
+        return (mpr_list)mpr_list_adj_continuation(lh);
+    }
+    else if (QUERY_DYNAMIC == lh->query_type) {
         int res;
         if (!*list)
             return 0;
@@ -430,6 +608,13 @@ mpr_obj mpr_list_get_idx(mpr_list list, unsigned int idx)
     RETURN_ARG_UNLESS(list && idx >= 0, 0);
     lh = mpr_list_header_by_self(list);
 
+    if (is_array(lh)) {
+        RETURN_ARG_UNLESS(idx < lh->query_ctx->num_items, 0);
+        lh->query_ctx->adj_idx = idx;
+        lh->self = lh->query_ctx->items[idx];
+        return (mpr_obj)lh->self;
+    }
+
     /* Reset to beginning of list */
     lh->self = *lh->start;
     mpr_list_start(list);
@@ -443,30 +628,6 @@ mpr_obj mpr_list_get_idx(mpr_list list, unsigned int idx)
     return 0;
 }
 
-/* Functions for handling parallel queries: unions, intersections, etc. */
-static int cmp_parallel_query(const void *ctx_data, const void *list)
-{
-    mpr_list_header_t *lh1 = *(mpr_list_header_t**)ctx_data;
-    mpr_list_header_t *lh2 = *(mpr_list_header_t**)((char*)ctx_data + sizeof(void*));
-    binary_op_t op = *(binary_op_t*)((char*)ctx_data + sizeof(void*) * 2);
-    query_info_t *c1 = lh1->query_ctx, *c2 = lh2->query_ctx;
-
-    int res1 = c1->query_compare(&c1->data, list);
-    int res2 = c2->query_compare(&c2->data, list);
-
-    if (2 == res1)
-        c1->reset = 1;
-    if (2 == res2)
-        c2->reset = 1;
-
-    switch (op) {
-        case OP_UNION:          return res1 || res2;
-        case OP_INTERSECTION:   return res1 && res2;
-        case OP_DIFFERENCE:     return res1 && !res2;
-        default:                return 0;
-    }
-}
-
 static mpr_list_header_t *mpr_list_header_cpy(mpr_list_header_t *lh)
 {
     mpr_list_header_t *cpy = (mpr_list_header_t*)malloc(LIST_HEADER_SIZE);
@@ -475,18 +636,22 @@ static mpr_list_header_t *mpr_list_header_cpy(mpr_list_header_t *lh)
 
     cpy->query_ctx = (query_info_t*)malloc(lh->query_ctx->size);
     memcpy(cpy->query_ctx, lh->query_ctx, lh->query_ctx->size);
+    if (lh->query_ctx->adj_prev) {
+        /* the copy reads the same candidate array */
+        adj_link(cpy->query_ctx, &lh->query_ctx->adj_next);
+    }
+    else if (lh->query_ctx->adj == &lh->query_ctx->items) {
+        /* the copy reads its own results, or nothing if the candidate array was released */
+        cpy->query_ctx->adj = &cpy->query_ctx->items;
+        cpy->query_ctx->num_adj = &cpy->query_ctx->num_items;
+    }
 
-    if (cmp_parallel_query == cpy->query_ctx->query_compare) {
-        /* this is a parallel query – we need to copy components */
-        void *data = &cpy->query_ctx->data;
-        mpr_list_header_t *lh1 = *(mpr_list_header_t**)data;
-        mpr_list_header_t *lh2 = *(mpr_list_header_t**)((char*)data + sizeof(void*));
-        lh1 = mpr_list_header_cpy(lh1);
-        lh2 = mpr_list_header_cpy(lh2);
-        memcpy(data, &lh1, sizeof(void*));
-        memcpy((char*)data + sizeof(void*), &lh2, sizeof(void*));
-        lh1 = *(mpr_list_header_t**)data;
-        lh2 = *(mpr_list_header_t**)((char*)data + sizeof(void*));
+    if (is_array(lh)) {
+        /* materialized lists own their results */
+        int num = lh->query_ctx->num_items;
+        void **items = malloc(num * sizeof(void*));
+        memcpy(items, lh->query_ctx->items, num * sizeof(void*));
+        set_array(cpy, items, num);
     }
     return cpy;
 }
@@ -500,25 +665,70 @@ mpr_list mpr_list_get_cpy(mpr_list list)
     return (mpr_list)&cpy->self;
 }
 
+mpr_list mpr_list_materialize(mpr_list list)
+{
+    void **items;
+    int num;
+    RETURN_ARG_UNLESS(list, 0);
+    RETURN_ARG_UNLESS(!is_array(mpr_list_header_by_self(list)), list);
+    num = collect_items(list, &items);
+    return new_array_list(items, num);
+}
+
+static int cmp_ptr(const void *l, const void *r)
+{
+    uintptr_t lp = (uintptr_t)*(void**)l, rp = (uintptr_t)*(void**)r;
+    return (lp > rp) - (lp < rp);
+}
+
+/* Combine two lists into a materialized list, consuming both. Results keep the order of list1,
+ * followed for unions by the items found only in list2. */
+static mpr_list get_set_op(mpr_list list1, mpr_list list2, binary_op_t op)
+{
+    void **items1, **items2, **sorted;
+    int i, num = 0, num1, num2;
+
+    num1 = collect_items(list1, &items1);
+    num2 = collect_items(list2, &items2);
+
+    if (OP_UNION == op) {
+        /* search a sorted copy of list1 for the items of list2 */
+        sorted = malloc((num1 + 1) * sizeof(void*));
+        if (num1) {
+            memcpy(sorted, items1, num1 * sizeof(void*));
+            qsort(sorted, num1, sizeof(void*), cmp_ptr);
+        }
+        items1 = realloc(items1, (num1 + num2 + 1) * sizeof(void*));
+        num = num1;
+        for (i = 0; i < num2; i++) {
+            if (!num1 || !bsearch(&items2[i], sorted, num1, sizeof(void*), cmp_ptr))
+                items1[num++] = items2[i];
+        }
+        free(sorted);
+    }
+    else {
+        /* search the items of list2 in place since their order is not needed */
+        int keep = OP_INTERSECTION == op;
+        if (num2)
+            qsort(items2, num2, sizeof(void*), cmp_ptr);
+        for (i = 0; i < num1; i++) {
+            int found = num2 && bsearch(&items1[i], items2, num2, sizeof(void*), cmp_ptr);
+            if (found == keep)
+                items1[num++] = items1[i];
+        }
+    }
+    FUNC_IF(free, items2);
+    return new_array_list(items1, num);
+}
+
 mpr_list mpr_list_get_union(mpr_list list1, mpr_list list2)
 {
-    mpr_list_header_t *lh1, *lh2;
-    RETURN_ARG_UNLESS(list1, list2);
-    RETURN_ARG_UNLESS(list2, list1);
-    lh1 = mpr_list_header_by_self(list1);
-    lh2 = mpr_list_header_by_self(list2);
-    return mpr_list_start(mpr_list_new_query((const void **)lh1->start, (void*)cmp_parallel_query,
-                                             "vvi", &lh1, &lh2, OP_UNION));
+    return get_set_op(list1, list2, OP_UNION);
 }
 
 mpr_list mpr_list_get_isect(mpr_list list1, mpr_list list2)
 {
-    mpr_list_header_t *lh1, *lh2;
-    RETURN_ARG_UNLESS(list1 && list2, 0);
-    lh1 = mpr_list_header_by_self(list1);
-    lh2 = mpr_list_header_by_self(list2);
-    return mpr_list_start(mpr_list_new_query((const void **)lh1->start, (void*)cmp_parallel_query,
-                                             "vvi", &lh1, &lh2, OP_INTERSECTION));
+    return get_set_op(list1, list2, OP_INTERSECTION);
 }
 
 #define COMPARE_TYPE(TYPE)                  \
@@ -668,7 +878,7 @@ static int compare_val(mpr_op op, mpr_type type, int l1, int l2, const void *v1,
     else {
         switch (op & 0xF) {
             case MPR_OP_EQ:     ret = (gt + lt) == 0;   break;
-            case MPR_OP_GT:     ret = (eq + gt) == 0;   break;
+            case MPR_OP_GT:     ret = (eq + lt) == 0;   break;
             case MPR_OP_GTE:    ret = lt == 0;          break;
             case MPR_OP_LT:     ret = (eq + gt) == 0;   break;
             case MPR_OP_LTE:    ret = gt == 0;          break;
@@ -729,12 +939,12 @@ static int filter_by_prop(const void *ctx, mpr_obj o)
     return compare_val(op, type, _len, len, _val, val);
 }
 
-/* TODO: we need to cache the value to be compared incase is goes out of scope. */
 mpr_list mpr_list_filter(mpr_list list, mpr_prop p, const char *key, int len,
                          mpr_type type, const void *val, mpr_op op)
 {
-    mpr_list_header_t *filter, *lh;
-    int i = 0, size, offset = 0, mask = MPR_OP_ALL | MPR_OP_ANY;
+    int i = 0, num = 0, size, offset = 0, mask = MPR_OP_ALL | MPR_OP_ANY;
+    void **items = 0;
+    mpr_list_header_t *lh;
     char *data;
 
     if (!list || op <= MPR_OP_UNDEFINED || (op | mask) > (MPR_OP_BOR | mask)
@@ -766,13 +976,7 @@ mpr_list mpr_list_filter(mpr_list list, mpr_prop p, const char *key, int len,
     else
         size += mpr_type_get_size(type) * len;
 
-    lh = mpr_list_header_by_self(list);
-    filter = (mpr_list_header_t*)malloc(LIST_HEADER_SIZE);
-    filter->next = (void*)mpr_list_query_continuation;
-    filter->query_type = QUERY_DYNAMIC;
-    filter->query_ctx = (query_info_t*)malloc(sizeof(query_info_t) + size);
-
-    data = (char*)&filter->query_ctx->data;
+    data = (char*)malloc(size);
 
     ((int*)data)[0] = p;    /* Property */
     ((int*)data)[1] = op;   /* Operator */
@@ -823,33 +1027,31 @@ mpr_list mpr_list_filter(mpr_list list, mpr_prop p, const char *key, int len,
             break;
     }
 
-    filter->query_ctx->size = sizeof(query_info_t) + size;
-    filter->query_ctx->index_offset = -1;
-    filter->query_ctx->reset = 0;
-    filter->query_ctx->query_compare = (query_compare_func_t*)filter_by_prop;
-    filter->query_ctx->query_free = (query_free_func_t*)free_query_single_ctx;
-    filter->start = (void**)list;
-    filter->self = *filter->start;
-
-    if (QUERY_STATIC == lh->query_type) {
-        /* TODO: should we free the original list here? memory leak? */
-        return mpr_list_start((mpr_list)&filter->self);
+    lh = mpr_list_header_by_self(list);
+    size = -1;
+    if (QUERY_STATIC == lh->query_type && 1 == len) {
+        /* a property index can provide the candidates when filtering a whole graph list */
+        mpr_obj o = (mpr_obj)*list;
+        mpr_graph g = mpr_obj_get_graph(o);
+        int obj_type = mpr_obj_get_type(o);
+        if (list == mpr_graph_get_list(g, obj_type))
+            size = mpr_graph_get_indexed(g, obj_type, p, key, type, val, op, (mpr_obj**)&items);
     }
+    if (size < 0)
+        size = collect_items(list, &items);
 
-    /* return intersection */
-    return mpr_list_start(mpr_list_new_query((const void **)lh->start, (void*)cmp_parallel_query,
-                                             "vvi", &lh, &filter, OP_INTERSECTION));
+    /* keep the matching items in place */
+    for (i = 0; i < size; i++) {
+        if (filter_by_prop(data, (mpr_obj)items[i]))
+            items[num++] = items[i];
+    }
+    free(data);
+    return new_array_list(items, num);
 }
 
 mpr_list mpr_list_get_diff(mpr_list list1, mpr_list list2)
 {
-    mpr_list_header_t *lh1, *lh2;
-    RETURN_ARG_UNLESS(list1, 0);
-    RETURN_ARG_UNLESS(list2, list1);
-    lh1 = mpr_list_header_by_self(list1);
-    lh2 = mpr_list_header_by_self(list2);
-    return mpr_list_start(mpr_list_new_query((const void **)lh1->start, (void*)cmp_parallel_query,
-                                             "vvi", &lh1, &lh2, OP_DIFFERENCE));
+    return get_set_op(list1, list2, OP_DIFFERENCE);
 }
 
 int mpr_list_cmp(mpr_list lhs, mpr_list rhs)
@@ -877,7 +1079,11 @@ int mpr_list_get_size(mpr_list list)
     RETURN_ARG_UNLESS(list, 0);
     lh = mpr_list_header_by_self(list);
     RETURN_ARG_UNLESS(lh->start && *lh->start, 0);
-    if (QUERY_DYNAMIC == lh->query_type) {
+    if (is_array(lh)) {
+        /* count from the current position like the copied queries below */
+        return lh->query_ctx->num_items - lh->query_ctx->adj_idx;
+    }
+    else if (QUERY_DYNAMIC == lh->query_type) {
         /* use a copy */
         list = mpr_list_get_cpy(list);
         while ((list = mpr_list_get_next(list)))
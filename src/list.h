@@ -21,6 +21,26 @@ mpr_list mpr_list_new_query(const void **list, const void *func,
 mpr_list vmpr_list_new_query(const void **list, const void *func,
                              const mpr_type *types, va_list aq);
 
+/*! Create a query that only tests the items of a candidate array, such as the maps connected to a
+ *  signal, instead of walking the whole list. The array is read through pointers to its storage
+ *  and length, so it may grow or shrink while the query is in use. Unions, intersections and
+ *  filters built from the query still search `list`, so the array must hold every item of `list`
+ *  accepted by `func`. The query and its copies are recorded in `queries`, which the owner of the
+ *  array must pass to mpr_list_adj_release() before freeing it. */
+mpr_list vmpr_list_new_adj_query(const void **list, void ***adj, int *num, void **queries,
+                                 const void *func, const mpr_type *types, va_list aq);
+
+/*! End the outstanding queries over the candidate arrays of an object that is being freed, so
+ *  that they return no further items instead of reading freed memory. */
+void mpr_list_adj_release(void **queries);
+
+/*! Add an item to a candidate array if it is not already present. The array is grown
+ *  geometrically. */
+void mpr_list_adj_add(void ***adj, int *num, void *item);
+
+/*! Remove an item from a candidate array, keeping the remaining items in order. */
+void mpr_list_adj_remove(void ***adj, int *num, void *item);
+
 mpr_list mpr_list_start(mpr_list list);
 
 #endif /* __MPR_LIST_H__ */
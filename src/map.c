@@ -67,9 +67,13 @@ typedef struct _mpr_local_map {
 
     mpr_id_map_t id_map;            /*!< Associated mpr_id_map. */
 
-    mpr_time t_next;
     mpr_expr expr;                  /*!< The mapping expression. */
     mpr_bitflags updated_inst;      /*!< Bitflags to indicate updated instances. */
+    mpr_bitflags due_inst;          /*!< Bitflags to indicate instances due for evaluation. */
+    int *timer_pos;                 /*!< Device timer position for each self-timed instance. */
+    mpr_local_dev timer_dev;        /*!< Device scheduling self-timed evaluation. */
+    int *batch;                     /*!< Updated instance indices and their evaluation status. */
+    mpr_local_dev queued;           /*!< Device whose processing queue holds this map. */
     mpr_value next_inst_val;
     mpr_value *var_vals;            /*!< User variables values. */
     const char **var_names;         /*!< User variables names. */
@@ -93,6 +97,54 @@ MPR_INLINE static int mpr_max(int a, int b) { return a > b ? a : b; }
 
 MPR_INLINE static int mpr_min(int a, int b) { return a < b ? a : b; }
 
+/* Returns the local device that processes the map, using the same device as mpr_map_process(). */
+static mpr_local_dev get_process_dev(mpr_local_map m)
+{
+    mpr_sig sig = mpr_slot_get_sig((MPR_LOC_SRC & m->locality) ? (mpr_slot)m->src[0]
+                                                               : (mpr_slot)m->dst);
+    return mpr_obj_get_is_local((mpr_obj)sig) ? (mpr_local_dev)mpr_sig_get_dev(sig) : 0;
+}
+
+/* Schedule the next evaluation of a self-timed map instance. Muted maps are rescheduled when
+ * they are unmuted. */
+static void schedule(mpr_local_map m, int inst_idx)
+{
+    if (m->muted || (!m->timer_dev && !(m->timer_dev = get_process_dev(m))))
+        return;
+    mpr_local_dev_set_timer(m->timer_dev, m, inst_idx, &m->timer_pos[inst_idx],
+                            mpr_value_get_time(m->next_inst_val, inst_idx, 0));
+}
+
+static void unschedule(mpr_local_map m)
+{
+    int i;
+    RETURN_UNLESS(m->timer_dev);
+    for (i = 0; i < m->num_inst; i++)
+        mpr_local_dev_remove_timer(m->timer_dev, &m->timer_pos[i]);
+    m->timer_dev = 0;
+}
+
+/* Update the timers of a self-timed map after it has been muted or unmuted. */
+static void set_muted(mpr_local_map m)
+{
+    int i;
+    RETURN_UNLESS(m->is_self_timed);
+    if (m->muted)
+        unschedule(m);
+    else {
+        for (i = 0; i < m->num_inst; i++)
+            schedule(m, i);
+    }
+}
+
+/* Discard pending updates so that the map is not queued again. */
+static void clear_updated(mpr_local_map m)
+{
+    mpr_bitflags_clear(m->updated_inst);
+    mpr_bitflags_clear(m->due_inst);
+    m->updated = 0;
+}
+
 static int cmp_qry_scope(const void *ctx, mpr_dev d)
 {
     mpr_map m = *(mpr_map*)ctx;
@@ -445,9 +497,7 @@ void mpr_map_process_before_free(mpr_map map)
                 mpr_sig sig = mpr_slot_get_sig(map->dst);
                 mpr_time_add_dbl(&t_now, mpr_dev_get_offset(mpr_sig_get_dev(sig)));
                 mpr_net_set_bundle_time(mpr_graph_get_net(lmap->obj.graph), t_now);
-                lo_message msg = mpr_slot_get_msg(lmap->dst);
-                mpr_sig_osc_handler(NULL, lo_message_get_types(msg), lo_message_get_argv(msg),
-                                    lo_message_get_argc(msg), msg, (void*)sig);
+                mpr_local_slot_deliver(lmap->dst, t_now);
             }
             else {
                 mpr_local_dev dev = (mpr_local_dev)mpr_sig_get_dev(mpr_slot_get_sig(map->src[0]));
@@ -521,14 +571,9 @@ void mpr_map_free(mpr_map map)
             }
         }
 
-        if (lmap->is_self_timed) {
-            /* trigger parent device to recheck whether it is timed */
-            lmap->is_self_timed = 0;
-            if (MPR_LOC_SRC & lmap->locality)
-                mpr_local_dev_check_map_timing((mpr_local_dev)mpr_sig_get_dev(mpr_slot_get_sig(map->src[0])));
-            else if (MPR_LOC_DST & lmap->locality)
-                mpr_local_dev_check_map_timing((mpr_local_dev)mpr_sig_get_dev(mpr_slot_get_sig(map->dst)));
-        }
+        /* cancel scheduled evaluations */
+        unschedule(lmap);
+        lmap->is_self_timed = 0;
 
         /* free buffers associated with user-defined expression variables */
         if (lmap->var_vals) {
@@ -545,7 +590,12 @@ void mpr_map_free(mpr_map map)
             FUNC_IF(free, (void*)lmap->old_var_names[i]);
         }
         FUNC_IF(free, lmap->old_var_names);
+        if (lmap->queued)
+            mpr_local_dev_dequeue_map(lmap->queued, lmap);
         mpr_bitflags_free(lmap->updated_inst);
+        FUNC_IF(mpr_bitflags_free, lmap->due_inst);
+        FUNC_IF(free, lmap->timer_pos);
+        FUNC_IF(free, lmap->batch);
         FUNC_IF(mpr_expr_free, lmap->expr);
     }
 
@@ -922,9 +972,9 @@ void mpr_map_clear_slot_msgs(mpr_local_map m)
  */
 
 /* combines receiving, timed update, and sending */
-mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
+void mpr_map_process(mpr_local_map m, mpr_time t_now)
 {
-    int i, status;
+    int i, status, num_batch = 0, batch_pos = 0;
     mpr_sig_group group;
     mpr_type manage_inst = 0;
     mpr_loc process_loc = m->process_loc;
@@ -934,6 +984,7 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
     mpr_local_sig dst_sig;
     mpr_id_map id_map = 0;
     mpr_value src_vals[MAX_NUM_MAP_SRC], dst_val;
+    mpr_expr_eval_buffer buff;
 
     assert(m->obj.is_local);
 
@@ -947,18 +998,18 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
             // alternately if source is not referenced in expression we could force process_loc to DST
             for (i = 0; i < m->num_src; i++) {
                 /* We need to send message prepared by source slot through destination link */
-                lo_message msg;
-                if ((msg = mpr_slot_get_msg(m->src[i])))
-                    mpr_local_slot_send_msg(m->dst, msg, t_now, m->protocol);
+                mpr_local_slot_send_msg(m->dst, m->src[i], t_now, m->protocol);
             }
         }
-        return MPR_TIME_MAX;
+        clear_updated(m);
+        return;
     }
 
-    RETURN_ARG_UNLESS(m->expr && !m->muted, m->t_next);
-
-    if (!m->updated && (!m->is_self_timed || mpr_time_get_diff(m->t_next, t_now) > 0.001)) {
-        return m->t_next;
+    RETURN_UNLESS(m->updated);
+    if (!m->expr || m->muted) {
+        /* updates received while muted are dropped */
+        clear_updated(m);
+        return;
     }
 
     /* temporary solution: use most multitudinous source signal for id_map
@@ -985,6 +1036,9 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
     }
     dst_val = mpr_slot_get_value(m->dst);
 
+    /* maps on different shards are processed concurrently, so use this thread's buffer */
+    buff = mpr_net_get_expr_eval_buffer(mpr_graph_get_net(m->obj.graph), m->expr);
+
     if (m->use_inst) {
         if (mpr_sig_get_use_inst((mpr_sig)src_sig) && !mpr_expr_get_manages_inst(m->expr)) {
             manage_inst = MPR_SIG;
@@ -1011,48 +1065,51 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
          * whether EXPR_EVAL_DONE flag is added. If not, go back and handle releases for previous
          * instances */
 
-    m->t_next = MPR_TIME_MAX;
+    /* Evaluate updated instances together if possible. Instances that are scheduled by the
+     * expression itself are left to the loop below. */
+    if (m->num_inst > 1 && !m->is_self_timed
+        && mpr_value_get_num_inst(dst_val) >= (unsigned int)m->num_inst) {
+        for (i = 0; i < m->num_inst; i++) {
+            if (mpr_bitflags_get(m->updated_inst, i))
+                m->batch[num_batch++] = i;
+        }
+        if (num_batch < 2 || !mpr_expr_eval_batch(m->expr, src_vals, m->var_vals, dst_val, &t_now,
+                                                  m->batch, num_batch, m->batch + num_batch))
+            num_batch = 0;
+    }
 
     for (i = 0; i < m->num_inst; i++) {
         /* Check if this instance has been updated */
         if (!mpr_bitflags_get(m->updated_inst, i)) {
-            if (m->is_self_timed) {
-                mpr_time t_next_inst = mpr_value_get_time(m->next_inst_val, i, 0);
-                int j;
-                if (mpr_time_get_diff(t_next_inst, t_now) > 0.001) {
-                    /* not yet time for this instance */
-                    if (mpr_time_cmp(t_next_inst, m->t_next) < 0)
-                        m->t_next = t_next_inst;
-                    continue;
-                }
-
-                /* check if source signals have a value for this instance */
-                /* TODO: check whether source signal is actually referenced in the map expression */
-                for (j = 0; j < m->num_src; j++) {
-                    if (   mpr_local_slot_get_is_used(m->src[0])
-                        && !mpr_value_get_has_value(src_vals[0], i))
-                        break;
-                }
-                if (j < m->num_src)
-                    continue;
+            int j;
+            if (!m->is_self_timed || !mpr_bitflags_get(m->due_inst, i))
+                continue;
 
-                /* this instance is ready for next scheduled evaluation */
+            /* check if source signals have a value for this instance; if not it will be
+             * rescheduled when it is next updated */
+            for (j = 0; j < m->num_src; j++) {
+                if (   mpr_local_slot_get_is_used(m->src[j])
+                    && !mpr_value_get_has_value(src_vals[j], i))
+                    break;
             }
-            else {
+            if (j < m->num_src)
                 continue;
-            }
+
+            /* this instance is ready for next scheduled evaluation */
         }
 
         trace("processing map instance %d\n", i);
 
         /* TODO: Check if this instance has enough history to process the expression */
-        status = mpr_expr_eval(m->expr, mpr_graph_get_expr_eval_buffer(m->obj.graph),
-                               src_vals, m->var_vals, dst_val, &t_now, m->next_inst_val, i);
-        if (m->is_self_timed) {
-            mpr_time t_next_inst = mpr_value_get_time(m->next_inst_val, i, 0);
-            if (mpr_time_cmp(t_next_inst, m->t_next) < 0)
-                m->t_next = t_next_inst;
-        }
+        if (batch_pos < num_batch && m->batch[batch_pos] == i)
+            status = m->batch[num_batch + batch_pos++];
+        else
+            status = -1;
+        if (status < 0)
+            status = mpr_expr_eval(m->expr, buff, src_vals, m->var_vals, dst_val, &t_now,
+                                   m->next_inst_val, i);
+        if (m->is_self_timed)
+            schedule(m, i);
         if (!m->use_inst) {
             /* remove EXPR_RELEASE* event flags */
             status &= (EXPR_UPDATE | EXPR_EVAL_DONE);
@@ -1146,11 +1203,7 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
     if (MPR_LOC_SRC & process_loc) {
         mpr_local_slot_send_msg(m->dst, NULL, t_now, m->protocol);
     }
-    if (0 == mpr_time_cmp(m->t_next, MPR_TIME_MAX))
-        m->t_next = t_now;
-    mpr_bitflags_clear(m->updated_inst);
-    m->updated = 0;
-    return m->t_next;
+    clear_updated(m);
 }
 
 void mpr_map_alloc_values(mpr_local_map m, int quiet)
@@ -1283,7 +1336,22 @@ void mpr_map_alloc_values(mpr_local_map m, int quiet)
         m->updated_inst = mpr_bitflags_realloc(m->updated_inst, num_inst);
     else
         m->updated_inst = mpr_bitflags_new(num_inst);
+    if (m->due_inst)
+        m->due_inst = mpr_bitflags_realloc(m->due_inst, num_inst);
+    else
+        m->due_inst = mpr_bitflags_new(num_inst);
+    m->batch = realloc(m->batch, num_inst * 2 * sizeof(int));
+
+    /* timers reference the positions array so must be cancelled before it is reallocated */
+    unschedule(m);
+    m->timer_pos = realloc(m->timer_pos, num_inst * sizeof(int));
+    for (i = 0; i < num_inst; i++)
+        m->timer_pos[i] = -1;
     m->num_inst = num_inst;
+    if (m->is_self_timed) {
+        for (i = 0; i < num_inst; i++)
+            schedule(m, i);
+    }
 
     if (!quiet) {
         /* Inform remote peers of the change */
@@ -1328,9 +1396,6 @@ static int replace_expr_str(mpr_local_map m, const char *expr_str)
                                  1, dst_types, dst_lens);
     TRACE_RETURN_UNLESS(expr, 1, "Error creating expression\n");
 
-    /* reallocate the central evaluation buffer if necessary */
-    mpr_expr_realloc_eval_buffer(expr, mpr_graph_get_expr_eval_buffer(m->obj.graph));
-
     /* expression update may force processing location to change
      * e.g. if expression combines signals from different devices
      * e.g. if expression refers to current/past value of destination */
@@ -1692,6 +1757,7 @@ static int set_expr(mpr_local_map m, const char *expr_str)
 
     if (!replace_expr_str(m, expr_str)) {
         mpr_value dst_val = mpr_slot_get_value(m->dst);
+        mpr_expr_eval_buffer buff;
         mpr_map_alloc_values(m, 1);
 
         /* evaluate expression to initialise literals */
@@ -1704,9 +1770,10 @@ static int set_expr(mpr_local_map m, const char *expr_str)
             mpr_value_set_time(m->next_inst_val, i, 0, t_now);
         }
 
+        buff = mpr_net_get_expr_eval_buffer(mpr_graph_get_net(m->obj.graph), m->expr);
         for (i = 0; i < m->num_inst; i++) {
-            int status = mpr_expr_eval(m->expr, mpr_graph_get_expr_eval_buffer(m->obj.graph), 0,
-                                       m->var_vals, dst_val, &t_now, m->next_inst_val, i);
+            int status = mpr_expr_eval(m->expr, buff, 0, m->var_vals, dst_val, &t_now,
+                                       m->next_inst_val, i);
             if (!(status & EXPR_EVAL_DONE))
                 mpr_expr_restart(m->expr);
         }
@@ -1750,16 +1817,11 @@ static int set_expr(mpr_local_map m, const char *expr_str)
     }
 
     /* check whether expression manages recalculation scheduling */
+    unschedule(m);
     if ((m->is_self_timed = mpr_expr_get_manages_time(m->expr))) {
-        mpr_local_dev dev = 0;
-        for (i = 0; i < m->num_src; i++) {
-            mpr_sig sig = mpr_slot_get_sig((mpr_slot)m->src[i]);
-            if (mpr_obj_get_is_local((mpr_obj)sig) && (dev != (mpr_local_dev)mpr_sig_get_dev(sig)))
-                mpr_local_dev_check_map_timing((dev = (mpr_local_dev)mpr_sig_get_dev(sig)));
-        }
-        if (mpr_obj_get_is_local((mpr_obj)dst_sig))
-            mpr_local_dev_check_map_timing((mpr_local_dev)mpr_sig_get_dev(dst_sig));
-        m->t_next = MPR_NOW;
+        /* evaluate all instances at the time set above */
+        for (i = 0; i < m->num_inst; i++)
+            schedule(m, i);
     }
 
 done:
@@ -2071,10 +2133,18 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg)
                 /* otherwise continue to mpr_tbl_add_record_from_msg_atom() below */
             }
             case MPR_PROP_ID:
-            case MPR_PROP_MUTED:
             case MPR_PROP_VERSION:
                 updated += mpr_tbl_add_record_from_msg_atom(tbl, a, MPR_TBL_MOD_REM);
                 break;
+            case MPR_PROP_MUTED: {
+                int muted = m->muted;
+                if (mpr_tbl_add_record_from_msg_atom(tbl, a, MPR_TBL_MOD_REM)) {
+                    ++updated;
+                    if (m->obj.is_local && muted != m->muted)
+                        set_muted((mpr_local_map)m);
+                }
+                break;
+            }
             default:
                 break;
         }
@@ -2555,6 +2625,27 @@ void mpr_local_map_set_updated(mpr_local_map map, int inst_idx)
     else
         mpr_bitflags_set(map->updated_inst, inst_idx);
     map->updated = 1;
+    mpr_local_map_enqueue(map);
+}
+
+void mpr_local_map_enqueue(mpr_local_map map)
+{
+    RETURN_UNLESS(!map->queued && (map->queued = get_process_dev(map)));
+    mpr_local_dev_queue_map(map->queued, map);
+}
+
+void mpr_local_map_set_due(mpr_local_map map, int inst_idx)
+{
+    mpr_bitflags_set(map->due_inst, inst_idx);
+    map->updated = 1;
+    mpr_local_map_enqueue(map);
+}
+
+void mpr_local_map_dequeue(mpr_local_map map)
+{
+    map->queued = 0;
+    if (map->updated)
+        mpr_local_map_enqueue(map);
 }
 
 int mpr_map_get_use_inst(mpr_map map)
@@ -23,11 +23,11 @@ size_t mpr_map_get_struct_size(int is_local);
 
 void mpr_map_alloc_values(mpr_local_map map, int quiet);
 
-/*! Process updated instance values according to mapping properties.
+/*! Process updated and due instance values according to mapping properties. Self-timed instances
+ *  are rescheduled with their device after evaluation.
  *  \param map          The mapping process to perform.
- *  \param time         Timestamp for this update.
- *  \return             Timestamp for the next scheduled execution if applicable. */
-mpr_time mpr_map_process(mpr_local_map map, mpr_time time);
+ *  \param time         Timestamp for this update. */
+void mpr_map_process(mpr_local_map map, mpr_time time);
 
 void mpr_map_clear_slot_msgs(mpr_local_map map);
 
@@ -88,6 +88,16 @@ mpr_slot mpr_map_get_src_slot_by_id(mpr_map map, int id);
 
 void mpr_local_map_set_updated(mpr_local_map map, int inst_idx);
 
+/*! Queue a local map for processing by its device if it is not already queued. */
+void mpr_local_map_enqueue(mpr_local_map map);
+
+/*! Mark a local map as removed from its device's processing queue. Maps that were updated while
+ *  queued are queued again. */
+void mpr_local_map_dequeue(mpr_local_map map);
+
+/*! Mark a self-timed map instance as due for evaluation and queue the map for processing. */
+void mpr_local_map_set_due(mpr_local_map map, int inst_idx);
+
 void mpr_map_status_decr(mpr_map map);
 
 int mpr_map_get_use_inst(mpr_map map);
@@ -0,0 +1,59 @@
+#ifndef __MPR_ATOMIC_H__
+#define __MPR_ATOMIC_H__
+
+#include <stdint.h>
+#include "mpr_inline.h"
+
+/* Minimal atomic operations on 32-bit counters and pointers shared between threads. Loads
+ * acquire, stores release, and read-modify-write operations are sequentially consistent. */
+
+#if defined(__GNUC__) || defined(__clang__)
+
+#define mpr_atomic_load(PTR)        __atomic_load_n(PTR, __ATOMIC_ACQUIRE)
+#define mpr_atomic_store(PTR, VAL)  __atomic_store_n(PTR, VAL, __ATOMIC_RELEASE)
+#define mpr_atomic_swap(PTR, VAL)   __atomic_exchange_n(PTR, VAL, __ATOMIC_SEQ_CST)
+#define mpr_atomic_incr(PTR)        __atomic_add_fetch(PTR, 1, __ATOMIC_SEQ_CST)
+#define mpr_atomic_fence()          __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#define mpr_atomic_load_ptr(PTR)        __atomic_load_n(PTR, __ATOMIC_ACQUIRE)
+#define mpr_atomic_store_ptr(PTR, VAL)  __atomic_store_n(PTR, VAL, __ATOMIC_RELEASE)
+
+/*! Replace the value at `ptr` with `val` if it equals `*expected`, otherwise load the current
+ *  value into `*expected`.
+ *  \return             Non-zero if the value was replaced. */
+MPR_INLINE static int mpr_atomic_cas(volatile uint32_t *ptr, uint32_t *expected, uint32_t val)
+{
+    return __atomic_compare_exchange_n(ptr, expected, val, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+#elif defined(_MSC_VER)
+
+#include <windows.h>
+
+#define mpr_atomic_load(PTR)        ((uint32_t)InterlockedOr((volatile LONG*)(PTR), 0))
+#define mpr_atomic_store(PTR, VAL)  InterlockedExchange((volatile LONG*)(PTR), (LONG)(VAL))
+#define mpr_atomic_swap(PTR, VAL)   ((uint32_t)InterlockedExchange((volatile LONG*)(PTR), \
+                                                                   (LONG)(VAL)))
+#define mpr_atomic_incr(PTR)        ((uint32_t)InterlockedIncrement((volatile LONG*)(PTR)))
+#define mpr_atomic_fence()          MemoryBarrier()
+
+#define mpr_atomic_load_ptr(PTR)        InterlockedCompareExchangePointer((PVOID volatile*)(PTR), \
+                                                                          NULL, NULL)
+#define mpr_atomic_store_ptr(PTR, VAL)  InterlockedExchangePointer((PVOID volatile*)(PTR), \
+                                                                   (PVOID)(VAL))
+
+MPR_INLINE static int mpr_atomic_cas(volatile uint32_t *ptr, uint32_t *expected, uint32_t val)
+{
+    uint32_t prev = (uint32_t)InterlockedCompareExchange((volatile LONG*)ptr, (LONG)val,
+                                                         (LONG)*expected);
+    if (prev == *expected)
+        return 1;
+    *expected = prev;
+    return 0;
+}
+
+#else
+#error "atomic operations are not available for this compiler"
+#endif
+
+#endif /* __MPR_ATOMIC_H__ */
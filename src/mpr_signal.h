@@ -20,12 +20,27 @@ size_t mpr_sig_get_struct_size(int is_local);
 int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
                         lo_message msg, void *data);
 
+/*! Handler registered for all paths on the device's data servers. Signal paths are resolved
+ *  through the device's signal name index and alias paths through its alias index, so no
+ *  per-signal methods need to be added to the servers. The user data is the local device. */
+int mpr_sig_data_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                         lo_message msg, void *data);
+
+/*! Apply an update delivered in-process over a local-only link, bypassing OSC serialization.
+ *  \param sig      The destination signal.
+ *  \param slot_id  The map slot id, or -1 if the update is not addressed to a map slot.
+ *  \param GID      The instance GID, or 0 if the update is not instanced.
+ *  \param len      The number of vector elements.
+ *  \param types    Per-element types, using MPR_NULL for elements without a value.
+ *  \param vals     Contiguous vector of `len` elements.
+ *  \param time     Timetag of the update. */
+void mpr_local_sig_handle_update(mpr_local_sig sig, int slot_id, mpr_id GID, int len,
+                                 const mpr_type *types, const void *vals, mpr_time time);
+
 /*! Initialize an already-allocated mpr_sig structure. */
 void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const char *name, int len,
                   mpr_type type, const char *unit, const void *min, const void *max, int *num_inst);
 
-void mpr_local_sig_add_to_net(mpr_local_sig sig, mpr_net net);
-
 void mpr_sig_call_handler(mpr_local_sig sig, int evt, mpr_id inst, unsigned int inst_idx);
 
 int mpr_sig_set_from_msg(mpr_sig sig, mpr_msg msg);
@@ -35,6 +50,14 @@ int mpr_sig_set_from_msg(mpr_sig sig, mpr_msg msg);
  *  \param sig      The signal to free. */
 void mpr_sig_free_internal(mpr_sig sig);
 
+/*! Keep track of the maps connected to a signal and its device so that mpr_sig_get_maps() and
+ *  mpr_dev_get_maps() do not need to search the whole graph. */
+void mpr_sig_add_adj_map(mpr_sig sig, mpr_map map);
+void mpr_sig_remove_adj_map(mpr_sig sig, mpr_map map);
+
+/*! Forget the parent device of a signal when the device is freed before the signal. */
+void mpr_sig_clear_dev(mpr_sig sig);
+
 void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd);
 
 void mpr_local_sig_set_dev_id(mpr_local_sig sig, mpr_id id);
@@ -55,6 +78,13 @@ const char *mpr_sig_get_name(mpr_sig sig);
 
 const char *mpr_sig_get_path(mpr_sig sig);
 
+/*! Get the alias assigned to a signal by its device for addressing data messages.
+ *  \param sig      The signal to query.
+ *  \return         The alias, or 0 if none is known. */
+int mpr_sig_get_alias(mpr_sig sig);
+
+void mpr_sig_set_alias(mpr_sig sig, int alias);
+
 mpr_type mpr_sig_get_type(mpr_sig sig);
 
 int mpr_sig_compare_names(mpr_sig l, mpr_sig r);
@@ -73,6 +103,11 @@ int mpr_sig_get_num_inst_internal(mpr_sig sig);
 
 int mpr_sig_get_use_inst(mpr_sig sig);
 
+/*! Update the value of a local signal instance, see mpr_sig_set_value(). The caller must hold
+ *  the network lock if a data thread is running. */
+void mpr_local_sig_set_value(mpr_local_sig sig, mpr_id id, int len, mpr_type type,
+                             const void *val);
+
 void mpr_local_sig_set_inst_value(mpr_local_sig sig, const void *value, int inst_idx,
                                   mpr_id_map id_map, int status, int map_manages_inst,
                                   mpr_time time);
@@ -1,5 +1,9 @@
 #include "config.h"
 
+#if (defined(HAVE_SENDMMSG) || defined(HAVE_RECVMMSG)) && !defined(_GNU_SOURCE)
+ #define _GNU_SOURCE    /* for sendmmsg() and recvmmsg() */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -14,6 +18,8 @@
 
 #ifdef HAVE_ARPA_INET_H
  #include <arpa/inet.h>
+ #include <netdb.h>
+ #include <sys/socket.h>
 #else
  #ifdef HAVE_WINSOCK2_H
   #include <winsock2.h>
@@ -38,9 +44,22 @@
 
 #include <mapper/mapper.h>
 
+#ifdef HAVE_EPOLL
+ #include <errno.h>
+ #include <sys/epoll.h>
+ #include <unistd.h>
+#endif
+
 #ifdef HAVE_LIBPTHREAD
 #include <pthread.h>
 static void* net_thread_func(void *data);
+#ifndef WIN32
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <unistd.h>
+ #define MPR_DATA_THREAD    /* the device servers can be serviced by a separate thread */
+static void* data_thread_func(void *data);
+#endif
 #endif
 
 #ifdef HAVE_WIN32_THREADS
@@ -57,6 +76,12 @@ extern const char* prop_msg_strings[MPR_PROP_EXTRA+1];
 #define SERVER_MESH_TCP 2   /* TCP Mesh comms. */
 
 #define MAX_BUNDLE_LEN 8192
+#define UDP_BATCH_SIZE 32   /* Maximum number of datagrams passed to sendmmsg() or recvmmsg(). */
+#define MAX_UDP_MSG_LEN 65536
+
+#define HOUSEKEEPING_MS 1000    /* Longest wait between housekeeping runs. */
+#define SHORT_POLL_MS   100     /* Wait used while registering or serving TCP connections. */
+#define DATA_POLL_MS    100     /* Longest wait of the data thread, also bounding TCP latency. */
 #define FIND 0
 #define UPDATE 1
 #define ADD 2
@@ -68,6 +93,55 @@ typedef enum {
     BUNDLE_DST_SUBSCRIBERS
 } bundle_dst;
 
+struct _mpr_udp_dst {
+    struct sockaddr_storage addr;
+    socklen_t len;
+};
+
+/*! A bundle serialized for a batched UDP send. */
+typedef struct _udp_item {
+    mpr_udp_dst dst;
+    size_t offset;
+    size_t len;
+} udp_item_t, *udp_item;
+
+/*! Buffers used while receiving and sending data, kept separately by each data thread. */
+typedef struct _net_io {
+    mpr_time bundle_time;           /*!< Timetag of the bundle being dispatched. */
+    mpr_expr_eval_buffer eval_buff; /*!< Expression evaluation stack, allocated on first use. */
+
+    struct {
+        char *data;                 /*!< Bundles serialized for the next batched send. */
+        size_t size;
+        size_t len;
+        udp_item items;
+        int num;
+        int num_alloc;
+    } out;
+
+#ifdef HAVE_RECVMMSG
+    struct {
+        char *data;                 /*!< Receive buffers, allocated on first use. */
+        struct mmsghdr msgs[UDP_BATCH_SIZE];
+        struct iovec iov[UDP_BATCH_SIZE];
+    } in;
+#endif
+} net_io_t, *net_io;
+
+#ifdef MPR_DATA_THREAD
+/*! A data thread servicing the servers of a subset of the local devices. */
+typedef struct _net_shard {
+    struct _mpr_net *net;
+    pthread_t thread;
+    pthread_mutex_t lock;           /*!< Held while the devices of this shard are processed. */
+    struct pollfd *pfds;            /*!< Sockets waited on by the data thread. */
+    int num_pfds;
+    int wake[2];                    /*!< Pipe used to wake the data thread. */
+    int idx;
+    net_io_t io;
+} net_shard_t, *net_shard;
+#endif
+
 /*! A structure that keeps information about network communications. */
 typedef struct _mpr_net {
     mpr_graph graph;
@@ -92,7 +166,21 @@ typedef struct _mpr_net {
 
     struct _mpr_local_dev **devs;   /*!< Local devices managed by this network structure. */
     lo_bundle bundle;               /*!< Bundle pointer for sending messages on the multicast bus. */
-    mpr_time bundle_time;
+
+    struct {
+        char *data;                 /*!< Reusable buffer for serialized bundles. */
+        size_t size;
+        uint8_t busy;               /*!< Set while the buffer is being dispatched locally. */
+    } ser;
+
+    net_io_t io;                    /*!< Buffers used by the thread polling the network. */
+
+#ifdef HAVE_EPOLL
+    struct {
+        int fd;                     /*!< Epoll instance watching the server sockets, or -1. */
+        uint8_t dirty;              /*!< Set when servers have been added or replaced. */
+    } epoll;
+#endif
 
     struct {
         char *group;
@@ -108,8 +196,154 @@ typedef struct _mpr_net {
     uint8_t generic_dev_methods_added;
     uint8_t registered;
     uint8_t polling;
+    uint8_t tcp_active;             /*!< Set once a TCP server has received data. */
+
+#ifdef MPR_DATA_THREAD
+    struct {
+        pthread_mutex_t lock;       /*!< Held while graph, map, or server state is touched. */
+        pthread_key_t shard;        /*!< The shard serviced by the calling data thread. */
+        net_shard shards;
+        int num_shards;
+        volatile int active;        /*!< Set while the device servers have their own threads. */
+        volatile int stopping;      /*!< Set to ask the data threads to exit. */
+    } data;
+#endif
 } mpr_net_t;
 
+#ifdef MPR_DATA_THREAD
+/* Local devices are assigned to the shards in turn. The device list may only change while all
+ * shards are locked, so this is safe to call with any of them held. */
+static int get_dev_shard(mpr_net net, mpr_local_dev dev)
+{
+    int i;
+    for (i = 0; i < net->num_devs; i++) {
+        if (dev == net->devs[i])
+            return i % net->data.num_shards;
+    }
+    return -1;
+}
+#endif
+
+/* The buffers of the calling thread. */
+MPR_INLINE static net_io get_io(mpr_net net)
+{
+#ifdef MPR_DATA_THREAD
+    net_shard shard = (net_shard)pthread_getspecific(net->data.shard);
+    if (shard)
+        return &shard->io;
+#endif
+    return &net->io;
+}
+
+mpr_expr_eval_buffer mpr_net_get_expr_eval_buffer(mpr_net net, mpr_expr expr)
+{
+    net_io io = get_io(net);
+    if (!io->eval_buff)
+        io->eval_buff = mpr_expr_new_eval_buffer(NULL);
+    mpr_expr_realloc_eval_buffer(expr, io->eval_buff);
+    return io->eval_buff;
+}
+
+void mpr_net_lock(mpr_net net)
+{
+#ifdef MPR_DATA_THREAD
+    int i;
+    net_shard shard = (net_shard)pthread_getspecific(net->data.shard);
+    if (shard) {
+        /* data threads only ever hold the lock of their own shard to avoid lock-order cycles */
+        pthread_mutex_lock(&shard->lock);
+        return;
+    }
+    pthread_mutex_lock(&net->data.lock);
+    for (i = 0; i < net->data.num_shards; i++)
+        pthread_mutex_lock(&net->data.shards[i].lock);
+#endif
+}
+
+void mpr_net_unlock(mpr_net net)
+{
+#ifdef MPR_DATA_THREAD
+    int i;
+    net_shard shard = (net_shard)pthread_getspecific(net->data.shard);
+    if (shard) {
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
+    for (i = net->data.num_shards - 1; i >= 0; i--)
+        pthread_mutex_unlock(&net->data.shards[i].lock);
+    pthread_mutex_unlock(&net->data.lock);
+#endif
+}
+
+int mpr_net_lock_dev(mpr_net net, mpr_local_dev dev)
+{
+#ifdef MPR_DATA_THREAD
+    int idx;
+    net_shard shard = (net_shard)pthread_getspecific(net->data.shard);
+    if (shard) {
+        /* waiting on another shard could deadlock, so the caller must hand the work over */
+        RETURN_ARG_UNLESS(get_dev_shard(net, dev) == shard->idx, 1);
+        pthread_mutex_lock(&shard->lock);
+        return 0;
+    }
+    pthread_mutex_lock(&net->data.lock);
+    if (net->data.num_shards && (idx = get_dev_shard(net, dev)) >= 0)
+        pthread_mutex_lock(&net->data.shards[idx].lock);
+#endif
+    return 0;
+}
+
+void mpr_net_unlock_dev(mpr_net net, mpr_local_dev dev)
+{
+#ifdef MPR_DATA_THREAD
+    int idx;
+    net_shard shard = (net_shard)pthread_getspecific(net->data.shard);
+    if (shard) {
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
+    if (net->data.num_shards && (idx = get_dev_shard(net, dev)) >= 0)
+        pthread_mutex_unlock(&net->data.shards[idx].lock);
+    pthread_mutex_unlock(&net->data.lock);
+#endif
+}
+
+int mpr_net_get_is_same_shard(mpr_net net, mpr_local_dev dev1, mpr_local_dev dev2)
+{
+#ifdef MPR_DATA_THREAD
+    RETURN_ARG_UNLESS(net->data.num_shards > 1, 1);
+    return get_dev_shard(net, dev1) == get_dev_shard(net, dev2);
+#else
+    return 1;
+#endif
+}
+
+void mpr_net_wake_data(mpr_net net, mpr_local_dev dev)
+{
+#ifdef MPR_DATA_THREAD
+    int i = 0, num;
+    RETURN_UNLESS(net->data.active);
+    num = net->data.num_shards;
+    if (dev && (i = get_dev_shard(net, dev)) >= 0)
+        num = i + 1;
+    else
+        i = 0;
+    for (; i < num; i++) {
+        /* the pipe is non-blocking; if it is full a wakeup is already pending */
+        if (write(net->data.shards[i].wake[1], "", 1) < 0)
+            continue;
+    }
+#endif
+}
+
+MPR_INLINE static void servers_changed(mpr_net net)
+{
+#ifdef HAVE_EPOLL
+    /* the epoll set is rebuilt before the next wait */
+    net->epoll.dirty = 1;
+#endif
+}
+
 static int is_alphabetical(int num, lo_arg **names)
 {
     int i;
@@ -224,13 +458,13 @@ static void handler_error(int num, const char *msg, const char *where)
 
 int mpr_net_bundle_start(lo_timetag t, void *data)
 {
-    mpr_time_set(&((mpr_net)data)->bundle_time, t);
+    mpr_time_set(&get_io((mpr_net)data)->bundle_time, t);
     return 0;
 }
 
 mpr_time mpr_net_get_bundle_time(mpr_net net)
 {
-    return net->bundle_time;
+    return get_io(net)->bundle_time;
 }
 
 /*! Local function to get the IP address of a network interface. */
@@ -446,6 +680,8 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
     lo_server temp, temp2;
     RETURN_UNLESS(dev);
 
+    mpr_net_lock(net);
+
     /* Check if device was already added. */
     for (dev_idx = 0; dev_idx < net->num_devs; dev_idx++) {
         if (net->devs[dev_idx] == dev)
@@ -477,6 +713,8 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
     lo_server_enable_queue(temp, 0, 1);
     /* Add bundle handlers */
     lo_server_add_bundle_handlers(temp, mpr_net_bundle_start, NULL, (void*)net);
+    /* Add a single handler resolving signal paths and aliases for all data messages */
+    lo_server_add_method(temp, NULL, NULL, mpr_sig_data_handler, dev);
 
     /* Swap and free old server structure if necessary */
     temp2 = net->servers[server_idx];
@@ -495,6 +733,8 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
     lo_server_enable_queue(temp, 0, 1);
     /* Add bundle handlers */
     lo_server_add_bundle_handlers(temp, mpr_net_bundle_start, NULL, (void*)net);
+    /* Add a single handler resolving signal paths and aliases for all data messages */
+    lo_server_add_method(temp, NULL, NULL, mpr_sig_data_handler, dev);
 
     /* Swap and free old server structure if necessary */
     temp2 = net->servers[server_idx + 1];
@@ -519,6 +759,7 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
 
     mpr_local_dev_restart_registration(dev, net->num_devs);
     net->registered = 0;
+    servers_changed(net);
 
     if (1 == net->num_devs) {
         /* Seed the random number generator. */
@@ -537,6 +778,7 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
 
     /* Probe potential name. */
     mpr_local_dev_probe_name(dev, dev_idx + 1, net);
+    mpr_net_unlock(net);
 }
 
 void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
@@ -552,12 +794,14 @@ void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
         trace("error in mpr_net_remove_dev: device not found in local list\n");
         return;
     }
+    mpr_net_lock(net);
     --net->num_devs;
     net->num_servers -= NUM_DEV_SERVERS;
 
     /* free device servers */
     lo_server_free(net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS]); /* UDP server */
     lo_server_free(net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS + 1]); /* TCP server */
+    servers_changed(net);
 
     for (; i < net->num_devs; i++) {
         net->devs[i] = net->devs[i + 1];
@@ -577,6 +821,7 @@ void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
             lo_server_del_method(net->servers[j], path, dev_handlers_specific[i].types);
         }
     }
+    mpr_net_unlock(net);
 }
 
 int mpr_net_get_num_devs(mpr_net net)
@@ -594,35 +839,6 @@ lo_server mpr_net_get_dev_server(mpr_net net, mpr_local_dev dev, dev_server_t id
     return 0;
 }
 
-void mpr_net_add_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path,
-                                   lo_method_handler h, void *data)
-{
-    int i;
-    for (i = 0; i < net->num_devs; i++) {
-        int start, end, j;
-        if (dev != net->devs[i])
-            continue;
-        start = NUM_NET_SERVERS + i * NUM_DEV_SERVERS;
-        end = start + NUM_DEV_SERVERS;
-        for (j = start; j < end; j++)
-            lo_server_add_method(net->servers[j], path, NULL, h, data);
-    }
-}
-
-void mpr_net_remove_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path)
-{
-    int i;
-    for (i = 0; i < net->num_devs; i++) {
-        int start, end, j;
-        if (dev != net->devs[i])
-            continue;
-        start = NUM_NET_SERVERS + i * NUM_DEV_SERVERS;
-        end = start + NUM_DEV_SERVERS;
-        for (j = start; j < end; j++)
-            lo_server_del_method(net->servers[j], path, NULL);
-    }
-}
-
 static void mpr_net_add_graph_methods(mpr_net net, lo_server server)
 {
     /* add graph methods */
@@ -634,10 +850,34 @@ static void mpr_net_add_graph_methods(mpr_net net, lo_server server)
     return;
 }
 
+static void free_io(net_io io)
+{
+    FUNC_IF(mpr_expr_free_eval_buffer, io->eval_buff);
+    FUNC_IF(free, io->out.data);
+    FUNC_IF(free, io->out.items);
+#ifdef HAVE_RECVMMSG
+    FUNC_IF(free, io->in.data);
+#endif
+}
+
 mpr_net mpr_net_new(mpr_graph g)
 {
+#ifdef MPR_DATA_THREAD
+    pthread_mutexattr_t attr;
+#endif
     mpr_net net = (mpr_net) calloc(1, sizeof(mpr_net_t));
     net->graph = g;
+#ifdef MPR_DATA_THREAD
+    /* the lock is recursive since handlers called with it held may update signals */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&net->data.lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_key_create(&net->data.shard, NULL);
+#endif
+#ifdef HAVE_EPOLL
+    net->epoll.fd = -1;
+#endif
     mpr_net_init(net, 0, 0, 0);
     return net;
 }
@@ -755,6 +995,7 @@ int mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
     temp_server2 = net->servers[SERVER_MESH_TCP];
     net->servers[SERVER_MESH_TCP] = temp_server1;
     FUNC_IF(lo_server_free, temp_server2);
+    servers_changed(net);
 
     for (i = 0; i < net->num_devs; i++) {
         mpr_net_add_dev(net, net->devs[i]);
@@ -768,6 +1009,13 @@ const char *mpr_net_get_interface(mpr_net net)
     return net->iface.name;
 }
 
+int mpr_net_get_is_host_local(mpr_net net, const char *host)
+{
+    RETURN_ARG_UNLESS(host, 0);
+    return (   !strcmp(host, inet_ntoa(net->iface.addr))
+            || !strcmp(host, "127.0.0.1") || !strcmp(host, "localhost"));
+}
+
 const char *mpr_net_get_address(mpr_net net)
 {
     if (!net->addr.url)
@@ -780,6 +1028,193 @@ const char *mpr_get_version(void)
     return PACKAGE_VERSION;
 }
 
+/* Serialize a bundle into the reusable buffer. Handlers called during local dispatch may send
+ * bundles of their own, in which case a separate buffer is allocated. */
+static char *serialise_bundle(mpr_net net, lo_bundle bundle, size_t *len)
+{
+    *len = lo_bundle_length(bundle);
+    if (net->ser.busy)
+        return (char*)lo_bundle_serialise(bundle, NULL, len);
+    if (*len > net->ser.size) {
+        char *data = realloc(net->ser.data, *len);
+        RETURN_ARG_UNLESS(data, 0);
+        net->ser.data = data;
+        net->ser.size = *len;
+    }
+    return (char*)lo_bundle_serialise(bundle, net->ser.data, len);
+}
+
+static void release_serialised(mpr_net net, char *data)
+{
+    if (data != net->ser.data)
+        free(data);
+}
+
+mpr_udp_dst mpr_udp_dst_new(const char *host, const char *port)
+{
+    struct addrinfo hints, *ai = NULL;
+    mpr_udp_dst dst = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    RETURN_ARG_UNLESS(!getaddrinfo(host, port, &hints, &ai) && ai, 0);
+    if (ai->ai_addrlen <= sizeof(struct sockaddr_storage)) {
+        dst = (mpr_udp_dst)calloc(1, sizeof(struct _mpr_udp_dst));
+        memcpy(&dst->addr, ai->ai_addr, ai->ai_addrlen);
+        dst->len = ai->ai_addrlen;
+    }
+    freeaddrinfo(ai);
+    return dst;
+}
+
+void mpr_udp_dst_free(mpr_udp_dst dst)
+{
+    FUNC_IF(free, dst);
+}
+
+#ifdef HAVE_SENDMMSG
+/* Send a batch of datagrams, skipping any destination that fails rather than retrying it. */
+static void send_batch(int fd, struct mmsghdr *msgs, int num)
+{
+    while (num > 0) {
+        int sent = sendmmsg(fd, msgs, num, 0);
+        if (sent <= 0) {
+            trace("error sending to UDP destination\n");
+            sent = 1;
+        }
+        msgs += sent;
+        num -= sent;
+    }
+}
+#endif
+
+void mpr_net_send_udp(mpr_net net, const char *data, size_t len, mpr_udp_dst *dsts, int num)
+{
+    int fd = lo_server_get_socket_fd(net->servers[SERVER_MESH_UDP]), i;
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[UDP_BATCH_SIZE];
+    struct iovec iov;
+    iov.iov_base = (void*)data;
+    iov.iov_len = len;
+    memset(msgs, 0, sizeof(msgs));
+    while (num > 0) {
+        int n = num < UDP_BATCH_SIZE ? num : UDP_BATCH_SIZE;
+        for (i = 0; i < n; i++) {
+            msgs[i].msg_hdr.msg_name = &dsts[i]->addr;
+            msgs[i].msg_hdr.msg_namelen = dsts[i]->len;
+            msgs[i].msg_hdr.msg_iov = &iov;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        send_batch(fd, msgs, n);
+        dsts += n;
+        num -= n;
+    }
+#else
+    for (i = 0; i < num; i++)
+        sendto(fd, data, len, 0, (struct sockaddr*)&dsts[i]->addr, dsts[i]->len);
+#endif
+}
+
+#ifdef HAVE_SENDMMSG
+
+int mpr_net_queue_udp(mpr_net net, lo_bundle bundle, mpr_udp_dst dst)
+{
+    size_t len = lo_bundle_length(bundle);
+    net_io io = get_io(net);
+    RETURN_ARG_UNLESS(dst, 1);
+    if (io->out.len + len > io->out.size) {
+        size_t size = io->out.size ? io->out.size : MAX_BUNDLE_LEN;
+        char *data;
+        while (size < io->out.len + len)
+            size *= 2;
+        RETURN_ARG_UNLESS(data = realloc(io->out.data, size), 1);
+        io->out.data = data;
+        io->out.size = size;
+    }
+    if (io->out.num >= io->out.num_alloc) {
+        int num_alloc = io->out.num_alloc ? io->out.num_alloc * 2 : UDP_BATCH_SIZE;
+        udp_item items = realloc(io->out.items, num_alloc * sizeof(udp_item_t));
+        RETURN_ARG_UNLESS(items, 1);
+        io->out.items = items;
+        io->out.num_alloc = num_alloc;
+    }
+    RETURN_ARG_UNLESS(lo_bundle_serialise(bundle, io->out.data + io->out.len, &len), 1);
+    io->out.items[io->out.num].dst = dst;
+    io->out.items[io->out.num].offset = io->out.len;
+    io->out.items[io->out.num].len = len;
+    ++io->out.num;
+    io->out.len += len;
+    return 0;
+}
+
+void mpr_net_flush_udp(mpr_net net, lo_server from)
+{
+    struct mmsghdr msgs[UDP_BATCH_SIZE];
+    struct iovec iov[UDP_BATCH_SIZE];
+    int fd, i = 0, n;
+    net_io io = get_io(net);
+    RETURN_UNLESS(io->out.num);
+    fd = lo_server_get_socket_fd(from);
+    memset(msgs, 0, sizeof(msgs));
+    while (i < io->out.num) {
+        for (n = 0; n < UDP_BATCH_SIZE && i < io->out.num; n++, i++) {
+            udp_item item = &io->out.items[i];
+            iov[n].iov_base = io->out.data + item->offset;
+            iov[n].iov_len = item->len;
+            msgs[n].msg_hdr.msg_name = &item->dst->addr;
+            msgs[n].msg_hdr.msg_namelen = item->dst->len;
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+        }
+        send_batch(fd, msgs, n);
+    }
+    io->out.num = 0;
+    io->out.len = 0;
+}
+
+#else /* !HAVE_SENDMMSG */
+
+int mpr_net_queue_udp(mpr_net net, lo_bundle bundle, mpr_udp_dst dst)
+{
+    return 1;
+}
+
+void mpr_net_flush_udp(mpr_net net, lo_server from) {}
+
+#endif /* HAVE_SENDMMSG */
+
+#ifdef HAVE_RECVMMSG
+
+/* Drain one batch of datagrams waiting on a UDP server and dispatch them through liblo. */
+static int recv_udp(mpr_net net, lo_server server)
+{
+    int i, num;
+    net_io io = get_io(net);
+    if (!io->in.data) {
+        io->in.data = malloc(UDP_BATCH_SIZE * MAX_UDP_MSG_LEN);
+        RETURN_ARG_UNLESS(io->in.data, 0);
+    }
+    memset(io->in.msgs, 0, sizeof(io->in.msgs));
+    for (i = 0; i < UDP_BATCH_SIZE; i++) {
+        io->in.iov[i].iov_base = io->in.data + i * MAX_UDP_MSG_LEN;
+        io->in.iov[i].iov_len = MAX_UDP_MSG_LEN;
+        io->in.msgs[i].msg_hdr.msg_iov = &io->in.iov[i];
+        io->in.msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    num = recvmmsg(lo_server_get_socket_fd(server), io->in.msgs, UDP_BATCH_SIZE,
+                   MSG_DONTWAIT, NULL);
+    RETURN_ARG_UNLESS(num > 0, 0);
+    for (i = 0; i < num; i++) {
+        if (io->in.msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            continue;
+        lo_server_dispatch_data(server, io->in.iov[i].iov_base, io->in.msgs[i].msg_len);
+    }
+    return num;
+}
+
+#endif /* HAVE_RECVMMSG */
+
 void mpr_net_send(mpr_net net)
 {
     lo_bundle bundle = net->bundle;
@@ -787,10 +1222,14 @@ void mpr_net_send(mpr_net net)
     net->bundle = 0;
 
     switch (net->addr.dst) {
-        case BUNDLE_DST_SUBSCRIBERS:
-            mpr_local_dev_send_to_subscribers(net->addr.dev, bundle, net->msg_type,
-                                              &net->servers[SERVER_MESH_UDP]);
+        case BUNDLE_DST_SUBSCRIBERS: {
+            size_t data_len;
+            char *data = serialise_bundle(net, bundle, &data_len);
+            mpr_local_dev_send_to_subscribers(net->addr.dev, bundle, data, data_len,
+                                              net->msg_type, &net->servers[SERVER_MESH_UDP]);
+            release_serialised(net, data);
             break;
+        }
         case BUNDLE_DST_MESH:
             if (net->addr.mesh) {
                 int idx = (  LO_TCP == lo_address_get_protocol(net->addr.mesh)
@@ -801,10 +1240,13 @@ void mpr_net_send(mpr_net net)
             /* otherwise fall back to local */
         case BUNDLE_DST_LOCAL: {
             size_t data_len;
-            char *data = (char*) lo_bundle_serialise(bundle, NULL, &data_len);
+            char *data = serialise_bundle(net, bundle, &data_len);
             if (data) {
+                uint8_t busy = net->ser.busy;
+                net->ser.busy = 1;
                 lo_server_dispatch_data(net->servers[SERVER_MESH_UDP], data, data_len);
-                free(data);
+                net->ser.busy = busy;
+                release_serialised(net, data);
                 break;
             }
             /* otherwise fall back to bus */
@@ -898,10 +1340,22 @@ void mpr_net_free(mpr_net net)
 {
     int i;
 
+    mpr_net_stop_data_thread(net);
+
     /* send out any cached messages */
     mpr_net_send(net);
     FUNC_IF(free, net->iface.name);
     FUNC_IF(free, net->multicast.group);
+    FUNC_IF(free, net->ser.data);
+    free_io(&net->io);
+#ifdef HAVE_EPOLL
+    if (net->epoll.fd >= 0)
+        close(net->epoll.fd);
+#endif
+#ifdef MPR_DATA_THREAD
+    pthread_mutex_destroy(&net->data.lock);
+    pthread_key_delete(net->data.shard);
+#endif
 
     for (i = 0; i < net->num_servers; i++)
         FUNC_IF(lo_server_free, net->servers[i]);
@@ -981,9 +1435,8 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
     }
 }
 
-/*! This is the main function to be called once in a while from a program so
- *  that the libmapper bus can be automatically managed. */
-static void mpr_net_housekeeping(mpr_net net, int force_ping)
+/* Send cached messages and pings, leaving the graph to mpr_graph_housekeeping(). */
+static void net_housekeeping(mpr_net net, int force_ping)
 {
     int i, num_devs = net->num_devs, registered = 0;
 
@@ -1008,9 +1461,14 @@ static void mpr_net_housekeeping(mpr_net net, int force_ping)
     else {
         mpr_net_maybe_send_ping(net, 0);
     }
+}
 
+/*! This is the main function to be called once in a while from a program so
+ *  that the libmapper bus can be automatically managed. */
+static void mpr_net_housekeeping(mpr_net net, int force_ping)
+{
+    net_housekeeping(net, force_ping);
     mpr_graph_housekeeping(net->graph);
-    return;
 }
 
 MPR_INLINE static int mpr_min(int a, int b)
@@ -1018,6 +1476,150 @@ MPR_INLINE static int mpr_min(int a, int b)
     return a < b ? a : b;
 }
 
+/* Milliseconds until housekeeping is next needed. */
+static int get_housekeeping_ms(mpr_net net)
+{
+    mpr_time now;
+    uint32_t next;
+    int ms;
+
+    /* liblo does not expose the sockets of accepted TCP connections, so keep checking them */
+    RETURN_ARG_UNLESS(!net->tcp_active && net->registered >= net->num_devs, SHORT_POLL_MS);
+
+    mpr_time_set(&now, MPR_NOW);
+    next = net->num_devs && net->next_bus_ping < net->next_sub_ping
+         ? net->next_bus_ping : net->next_sub_ping;
+    /* pings are sent once the current second has passed the scheduled one */
+    ms = ((double)next + 1 - mpr_time_as_dbl(now)) * 1000.;
+    return ms < 0 ? 0 : mpr_min(ms, HOUSEKEEPING_MS);
+}
+
+/* Wait until a server socket is readable. Returns the number of ready sockets, or -1 if the wait
+ * should be left to liblo. */
+static int wait_servers(mpr_net net, int timeout_ms)
+{
+#ifdef HAVE_EPOLL
+    struct epoll_event events[8];
+    int num;
+    /* only liblo can wait on the sockets of accepted TCP connections */
+    RETURN_ARG_UNLESS(!net->tcp_active, -1);
+    if (net->epoll.dirty) {
+        int i;
+        /* sockets are removed from the set automatically when they are closed */
+        if (net->epoll.fd < 0)
+            net->epoll.fd = epoll_create1(EPOLL_CLOEXEC);
+        RETURN_ARG_UNLESS(net->epoll.fd >= 0, -1);
+        for (i = 0; i < net->num_servers; i++) {
+            struct epoll_event ev;
+            int fd = lo_server_get_socket_fd(net->servers[i]);
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            if (epoll_ctl(net->epoll.fd, EPOLL_CTL_ADD, fd, &ev) && EEXIST != errno)
+                trace("error adding socket to epoll set\n");
+        }
+        net->epoll.dirty = 0;
+    }
+    num = epoll_wait(net->epoll.fd, events, 8, timeout_ms);
+    /* treat interruptions as possible readiness so the sockets are checked */
+    return num < 0 ? 1 : num;
+#else
+    return -1;
+#endif
+}
+
+#ifdef MPR_DATA_THREAD
+/* Graph housekeeping while the data threads are running: the graph is cleaned up one object at
+ * a time so that the data threads are held up by at most one step. */
+static void housekeeping_graph(mpr_net net)
+{
+    int more;
+    do {
+        mpr_net_lock(net);
+        more = mpr_graph_housekeeping_step(net->graph);
+        mpr_net_unlock(net);
+    } while (more);
+}
+
+/* Inform the subscribers of each device of changes, holding only the lock of that device. */
+static void update_subscribers(mpr_net net)
+{
+    int i;
+    for (i = 0; ; i++) {
+        mpr_local_dev dev;
+        /* devices are only added and removed with the data lock held */
+        pthread_mutex_lock(&net->data.lock);
+        if (i >= net->num_devs) {
+            pthread_mutex_unlock(&net->data.lock);
+            break;
+        }
+        dev = net->devs[i];
+        mpr_net_lock_dev(net, dev);
+        pthread_mutex_unlock(&net->data.lock);
+        mpr_dev_update_subscribers(dev);
+        mpr_net_unlock_dev(net, dev);
+    }
+}
+
+/* Poll only the admin servers while the device servers are serviced by the data thread. The
+ * wait happens without the lock so that the data thread is never held up by it, and the lock is
+ * released between messages and housekeeping steps so that a burst of admin traffic delays data
+ * by at most one handler or step. */
+static int poll_admin(mpr_net net, int block_ms)
+{
+    int i, count = 0, left_ms, elapsed_ms = 0, admin_elapsed_ms = 0;
+    double then = mpr_get_current_time();
+
+    mpr_net_lock(net);
+    net_housekeeping(net, 0);
+    mpr_net_unlock(net);
+    housekeeping_graph(net);
+
+    do {
+        int recvd, housekeeping_ms;
+
+        left_ms = housekeeping_ms = get_housekeeping_ms(net);
+        if (block_ms > 0) {
+            elapsed_ms = (mpr_get_current_time() - then) * 1000.;
+            left_ms = mpr_min(left_ms, block_ms - elapsed_ms);
+            if (left_ms < 0)
+                left_ms = 0;
+        }
+        else
+            left_ms = 0;
+
+        if (left_ms > 0)
+            lo_servers_wait(net->servers, net->server_status, NUM_NET_SERVERS, left_ms);
+
+        mpr_net_lock(net);
+        recvd = lo_servers_recv_noblock(net->servers, net->server_status, NUM_NET_SERVERS, 0);
+        if (recvd) {
+            for (i = 0; i < NUM_NET_SERVERS; i++)
+                count += (net->server_status[i] > 0);
+            if (net->server_status[SERVER_MESH_TCP] > 0)
+                net->tcp_active = 1;
+        }
+        mpr_net_unlock(net);
+
+        elapsed_ms = (mpr_get_current_time() - then) * 1000;
+        if (   (!housekeeping_ms || (elapsed_ms - admin_elapsed_ms) > 100)
+            && (block_ms - elapsed_ms) > 50) {
+            mpr_net_lock(net);
+            net_housekeeping(net, 0);
+            mpr_net_unlock(net);
+            housekeeping_graph(net);
+            admin_elapsed_ms = elapsed_ms;
+        }
+
+        if (!recvd && block_ms < 0)
+            break;
+    } while (block_ms < 0 || elapsed_ms < block_ms);
+
+    update_subscribers(net);
+    housekeeping_graph(net);
+    return count;
+}
+#endif /* MPR_DATA_THREAD */
+
 static int mpr_net_poll_internal(mpr_net net, int block_ms)
 {
     int i, count = 0, left_ms = 0, elapsed_ms = 0, admin_elapsed_ms = 0;
@@ -1028,6 +1630,14 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
         return 0;
     }
 
+#ifdef MPR_DATA_THREAD
+    if (net->data.active) {
+        count = poll_admin(net, block_ms);
+        net->polling = 0;
+        return count;
+    }
+#endif
+
     then = mpr_get_current_time();
 
     mpr_net_housekeeping(net, 0);
@@ -1041,15 +1651,15 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
      */
 
     do {
-        register int recvd = 0;
+        register int recvd = 0, ready = 1, housekeeping_ms;
 
-        left_ms = 100;
+        left_ms = housekeeping_ms = get_housekeeping_ms(net);
         for (i = 0; i < net->num_devs; i++) {
             /* reduce the time if devices need to be updated within left_ms window */
             left_ms = mpr_min(left_ms, mpr_local_dev_update_maps(net->devs[i]));
         }
         if (block_ms > 0) {
-            /* set timeout to a minimum of remaining block time or 100ms */
+            /* set timeout to a minimum of remaining block time or next deadline */
             elapsed_ms = (mpr_get_current_time() - then) * 1000.;
             left_ms = mpr_min(left_ms, block_ms - elapsed_ms);
             if (left_ms < 0)
@@ -1058,10 +1668,39 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
         else
             left_ms = 0;
 
-        if (lo_servers_recv_noblock(net->servers, net->server_status, net->num_servers, left_ms)) {
+        /* dispatch updates from co-located devices; don't block if any were received */
+        for (i = 0; i < net->num_devs; i++) {
+            int num = mpr_local_dev_recv_rings(net->devs[i], left_ms > 0);
+            if (num) {
+                count += num;
+                recvd = 1;
+                left_ms = 0;
+            }
+        }
+
+#ifdef HAVE_RECVMMSG
+        /* drain the device data servers in batches; don't block if anything was received */
+        for (i = 0; i < net->num_devs; i++) {
+            int num = recv_udp(net, net->servers[NUM_NET_SERVERS + i * NUM_DEV_SERVERS
+                                                 + SERVER_DATA_UDP]);
+            if (num) {
+                count += num;
+                recvd = 1;
+                left_ms = 0;
+            }
+        }
+#endif
+
+        /* wait for readiness ourselves if possible; liblo then only reads the ready sockets */
+        if (left_ms > 0 && (ready = wait_servers(net, left_ms)) >= 0)
+            left_ms = 0;
+
+        if (ready && lo_servers_recv_noblock(net->servers, net->server_status, net->num_servers, left_ms)) {
             int idx = NUM_NET_SERVERS;
             for (i = 0; i < NUM_NET_SERVERS; i++)
                 count += (net->server_status[i] > 0);
+            if (net->server_status[SERVER_MESH_TCP] > 0)
+                net->tcp_active = 1;
             for (i = 0; i < net->num_devs; i++) {
                 int j;
                 for (j = 0; j < NUM_DEV_SERVERS; j++) {
@@ -1070,6 +1709,8 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
                         break;
                     }
                 }
+                if (net->server_status[idx + SERVER_DATA_TCP] > 0)
+                    net->tcp_active = 1;
                 idx += NUM_DEV_SERVERS;
             }
             recvd = 1;
@@ -1078,9 +1719,10 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
         if (!recvd && block_ms < 0)
             break;
 
-        /* Only run mpr_net_housekeeping() again if more than 100ms have elapsed. */
+        /* Only run mpr_net_housekeeping() again if it is due or more than 100ms have elapsed. */
         elapsed_ms = (mpr_get_current_time() - then) * 1000;
-        if ((elapsed_ms - admin_elapsed_ms) > 100 && (block_ms - elapsed_ms) > 50) {
+        if (   (!housekeeping_ms || (elapsed_ms - admin_elapsed_ms) > 100)
+            && (block_ms - elapsed_ms) > 50) {
             mpr_graph_housekeeping(net->graph);
             mpr_net_housekeeping(net, 0);
             admin_elapsed_ms = elapsed_ms;
@@ -1104,6 +1746,56 @@ int mpr_net_poll(mpr_net net, int block_ms)
     return mpr_net_poll_internal(net, block_ms);
 }
 
+/* The number of servers handled by the caller of mpr_net_poll(), which excludes the device
+ * servers while they are serviced by the data thread. */
+MPR_INLINE static int get_num_polled_servers(mpr_net net)
+{
+#ifdef MPR_DATA_THREAD
+    if (net->data.active)
+        return NUM_NET_SERVERS;
+#endif
+    return net->num_servers;
+}
+
+int mpr_net_get_fds(mpr_net net, int *fds, int num)
+{
+    int i, num_servers = get_num_polled_servers(net);
+    for (i = 0; i < num_servers && i < num; i++)
+        fds[i] = lo_server_get_socket_fd(net->servers[i]);
+    return num_servers;
+}
+
+int mpr_net_get_deadline(mpr_net net)
+{
+    int i, ms = get_housekeeping_ms(net);
+    if (get_num_polled_servers(net) == NUM_NET_SERVERS)
+        return ms;
+    for (i = 0; i < net->num_devs; i++)
+        ms = mpr_min(ms, mpr_local_dev_get_deadline(net->devs[i]));
+    return ms;
+}
+
+int mpr_net_process(mpr_net net)
+{
+    int i, num, count;
+    if (net->thread_data || net->polling) {
+        trace("Network polling already in process.\n");
+        return 0;
+    }
+    count = mpr_net_poll_internal(net, -1);
+    RETURN_ARG_UNLESS(get_num_polled_servers(net) > NUM_NET_SERVERS, count);
+
+    /* Updates from co-located devices only wake the caller's loop through our sockets if the
+     * producer knows we are about to block, so mark the rings as waiting before returning. */
+    do {
+        num = 0;
+        for (i = 0; i < net->num_devs; i++)
+            num += mpr_local_dev_recv_rings(net->devs[i], 1);
+        count += num;
+    } while (num);
+    return count;
+}
+
 #ifdef HAVE_LIBPTHREAD
 static void *net_thread_func(void *data)
 {
@@ -1203,6 +1895,194 @@ int mpr_net_stop_polling(mpr_net net)
     return result;
 }
 
+#ifdef MPR_DATA_THREAD
+/* Gather the sockets of the servers of the shard's devices and its wake pipe. Called with the
+ * shard lock held. */
+static int get_data_pfds(net_shard shard)
+{
+    mpr_net net = shard->net;
+    int i, j, num = 1, stride = net->data.num_shards;
+    int max = (net->num_devs / stride + 1) * NUM_DEV_SERVERS + 1;
+    if (max > shard->num_pfds) {
+        shard->pfds = realloc(shard->pfds, max * sizeof(struct pollfd));
+        shard->num_pfds = max;
+    }
+    shard->pfds[0].fd = shard->wake[0];
+    for (i = shard->idx; i < net->num_devs; i += stride) {
+        for (j = 0; j < NUM_DEV_SERVERS; j++) {
+            lo_server server = net->servers[NUM_NET_SERVERS + i * NUM_DEV_SERVERS + j];
+            shard->pfds[num++].fd = lo_server_get_socket_fd(server);
+        }
+    }
+    for (i = 0; i < num; i++) {
+        shard->pfds[i].events = POLLIN;
+        shard->pfds[i].revents = 0;
+    }
+    return num;
+}
+
+static void *data_thread_func(void *data)
+{
+    net_shard shard = (net_shard)data;
+    mpr_net net = shard->net;
+    int stride = net->data.num_shards;
+    char buf[64];
+    int i, num, left_ms;
+
+    /* route the locks, buffers and bundle times used by handlers to this shard */
+    pthread_setspecific(net->data.shard, shard);
+
+    while (!net->data.stopping) {
+        pthread_mutex_lock(&shard->lock);
+        left_ms = DATA_POLL_MS;
+        for (i = shard->idx; i < net->num_devs; i += stride)
+            left_ms = mpr_min(left_ms, mpr_local_dev_update_maps(net->devs[i]));
+
+        /* dispatch updates from co-located devices, other shards and other threads; don't block
+         * if any were received */
+        for (i = shard->idx; i < net->num_devs; i += stride) {
+            if (   mpr_local_dev_recv_rings(net->devs[i], left_ms > 0)
+                || mpr_local_dev_recv_updates(net->devs[i], left_ms > 0))
+                left_ms = 0;
+        }
+        num = get_data_pfds(shard);
+        pthread_mutex_unlock(&shard->lock);
+
+        /* Wait without the lock so the admin plane can run in the meantime. The sockets are only
+         * read through liblo once the lock is taken again, so servers replaced during the wait
+         * can at worst cause a spurious wakeup. */
+        if (left_ms > 0 && poll(shard->pfds, num, left_ms) > 0 && shard->pfds[0].revents) {
+            while (read(shard->wake[0], buf, sizeof(buf)) > 0) {}
+        }
+
+        pthread_mutex_lock(&shard->lock);
+        for (i = shard->idx; i < net->num_devs; i += stride) {
+            int idx = NUM_NET_SERVERS + i * NUM_DEV_SERVERS;
+#ifdef HAVE_RECVMMSG
+            recv_udp(net, net->servers[idx + SERVER_DATA_UDP]);
+#endif
+            if (   lo_servers_recv_noblock(net->servers + idx, net->server_status + idx,
+                                           NUM_DEV_SERVERS, 0)
+                && net->server_status[idx + SERVER_DATA_TCP] > 0)
+                net->tcp_active = 1;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return 0;
+}
+
+static void free_shards(mpr_net net, int num)
+{
+    int i;
+    for (i = 0; i < num; i++) {
+        net_shard shard = &net->data.shards[i];
+        pthread_mutex_destroy(&shard->lock);
+        close(shard->wake[0]);
+        close(shard->wake[1]);
+        FUNC_IF(free, shard->pfds);
+        free_io(&shard->io);
+    }
+    free(net->data.shards);
+    net->data.shards = 0;
+}
+
+/* Ask the data threads to exit and wait for them. */
+static int join_shards(mpr_net net, int num)
+{
+    int i, result = 0;
+    net->data.stopping = 1;
+    mpr_net_wake_data(net, NULL);
+    for (i = 0; i < num; i++) {
+        if (pthread_join(net->data.shards[i].thread, NULL)) {
+            printf("Network error: failed to stop data thread (pthread_join).\n");
+            result = -1;
+        }
+    }
+    return result;
+}
+#endif /* MPR_DATA_THREAD */
+
+int mpr_net_start_data_thread(mpr_net net, int num_threads)
+{
+#ifdef MPR_DATA_THREAD
+    pthread_mutexattr_t attr;
+    int i, result = 0;
+    RETURN_ARG_UNLESS(!net->data.active, 0);
+    if (net->thread_data || net->polling) {
+        trace("data thread must be started before polling.\n");
+        return -1;
+    }
+    if (num_threads < 1)
+        num_threads = 1;
+
+    net->data.shards = (net_shard)calloc(num_threads, sizeof(net_shard_t));
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    for (i = 0; i < num_threads; i++) {
+        net_shard shard = &net->data.shards[i];
+        if (pipe(shard->wake)) {
+            trace("couldn't create pipe for data thread.\n");
+            free_shards(net, i);
+            pthread_mutexattr_destroy(&attr);
+            return -1;
+        }
+        fcntl(shard->wake[0], F_SETFL, O_NONBLOCK);
+        fcntl(shard->wake[1], F_SETFL, O_NONBLOCK);
+        pthread_mutex_init(&shard->lock, &attr);
+        shard->net = net;
+        shard->idx = i;
+    }
+    pthread_mutexattr_destroy(&attr);
+
+    trace("starting %d data thread%s.\n", num_threads, num_threads > 1 ? "s" : "");
+    /* the shards are published with the lock held so that callers of mpr_net_lock() take either
+     * none or all of their locks */
+    pthread_mutex_lock(&net->data.lock);
+    net->data.num_shards = num_threads;
+    net->data.active = 1;
+    for (i = 0; i < num_threads; i++) {
+        if ((result = pthread_create(&net->data.shards[i].thread, 0, data_thread_func,
+                                     &net->data.shards[i])))
+            break;
+    }
+    pthread_mutex_unlock(&net->data.lock);
+    if (result) {
+        printf("Network error: couldn't create data thread.\n");
+        join_shards(net, i);
+        pthread_mutex_lock(&net->data.lock);
+        net->data.active = net->data.stopping = 0;
+        net->data.num_shards = 0;
+        free_shards(net, num_threads);
+        pthread_mutex_unlock(&net->data.lock);
+        return -result;
+    }
+    return 0;
+#else
+    printf("error: data thread is not available.\n");
+    return -1;
+#endif /* MPR_DATA_THREAD */
+}
+
+int mpr_net_stop_data_thread(mpr_net net)
+{
+#ifdef MPR_DATA_THREAD
+    int result;
+    RETURN_ARG_UNLESS(net->data.active, 0);
+
+    trace("stopping data threads.\n");
+    result = join_shards(net, net->data.num_shards);
+    /* the device servers are only handed back to the poll loop once the threads have exited */
+    pthread_mutex_lock(&net->data.lock);
+    net->data.active = net->data.stopping = 0;
+    free_shards(net, net->data.num_shards);
+    net->data.num_shards = 0;
+    pthread_mutex_unlock(&net->data.lock);
+    return result;
+#else
+    return 0;
+#endif /* MPR_DATA_THREAD */
+}
+
 /**********************************/
 /* Internal OSC message handlers. */
 /**********************************/
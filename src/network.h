@@ -4,9 +4,13 @@
 
 typedef struct _mpr_net *mpr_net;
 
+/*! A resolved UDP address for sending pre-serialized data without going through liblo. */
+typedef struct _mpr_udp_dst *mpr_udp_dst;
+
 #include <lo/lo.h>
 
 #include "device.h"
+#include "expression.h"
 #include "graph.h"
 #include "mpr_time.h"
 #include "mpr_inline.h"
@@ -28,6 +32,14 @@ MPR_INLINE static void mpr_net_set_bundle_time(mpr_net net, mpr_time time)
     mpr_net_bundle_start(time, net);
 }
 
+/*! Get the expression evaluation buffer of the calling thread, grown to fit an expression.
+ *  Each data thread has its own buffer so that maps on different shards can be evaluated
+ *  concurrently; other threads share a buffer and must hold the network lock.
+ *  \param net          The network structure.
+ *  \param expr         The expression about to be evaluated.
+ *  \return             The evaluation buffer. */
+mpr_expr_eval_buffer mpr_net_get_expr_eval_buffer(mpr_net net, mpr_expr expr);
+
 void mpr_net_add_dev(mpr_net n, mpr_local_dev d);
 
 void mpr_net_remove_dev(mpr_net n, mpr_local_dev d);
@@ -36,17 +48,90 @@ int mpr_net_get_num_devs(mpr_net net);
 
 lo_server mpr_net_get_dev_server(mpr_net net, mpr_local_dev dev, dev_server_t idx);
 
-void mpr_net_add_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path,
-                                   lo_method_handler h, void *data);
-
-void mpr_net_remove_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path);
-
 int mpr_net_poll(mpr_net n, int block_ms);
 
+/*! Retrieve the sockets of all servers, see mpr_graph_get_fds(). */
+int mpr_net_get_fds(mpr_net net, int *fds, int num);
+
+/*! Get the number of milliseconds until the network next needs processing, see
+ *  mpr_graph_get_deadline(). */
+int mpr_net_get_deadline(mpr_net net);
+
+/*! Handle all pending messages and due work without blocking, see mpr_graph_process_fds(). */
+int mpr_net_process(mpr_net net);
+
+/*! Resolve a UDP destination address.
+ *  \param host         The destination hostname or address.
+ *  \param port         The destination port.
+ *  \return             The resolved destination, or NULL if it could not be resolved. */
+mpr_udp_dst mpr_udp_dst_new(const char *host, const char *port);
+
+void mpr_udp_dst_free(mpr_udp_dst dst);
+
+/*! Send the same serialized data to several UDP destinations from the mesh server socket, so
+ *  that replies reach the mesh server. Datagrams are passed to the kernel in batches where
+ *  sendmmsg() is available.
+ *  \param net          The network structure.
+ *  \param data         The serialized bundle or message.
+ *  \param len          The length of the data in bytes.
+ *  \param dsts         An array of resolved destinations.
+ *  \param num          The number of destinations. */
+void mpr_net_send_udp(mpr_net net, const char *data, size_t len, mpr_udp_dst *dsts, int num);
+
+/*! Serialize a bundle and queue it for sending with mpr_net_flush_udp(), so that the bundles
+ *  generated for many destinations in one processing cycle are sent with a single system call.
+ *  \param net          The network structure.
+ *  \param bundle       The bundle to send; it may be cleared once this function returns.
+ *  \param dst          The resolved destination.
+ *  \return             Zero if the bundle was queued, or nonzero if batching is unavailable and
+ *                      the bundle should be sent directly. */
+int mpr_net_queue_udp(mpr_net net, lo_bundle bundle, mpr_udp_dst dst);
+
+/*! Send the bundles queued with mpr_net_queue_udp().
+ *  \param net          The network structure.
+ *  \param from         The UDP server whose socket the bundles are sent from. */
+void mpr_net_flush_udp(mpr_net net, lo_server from);
+
 int mpr_net_start_polling(mpr_net net, int block_ms);
 
 int mpr_net_stop_polling(mpr_net net);
 
+/*! Service the device servers on separate threads, see mpr_graph_start_data_threads().
+ *  \param net          The network structure.
+ *  \param num_threads  The number of threads, each servicing a share of the local devices.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_net_start_data_thread(mpr_net net, int num_threads);
+
+int mpr_net_stop_data_thread(mpr_net net);
+
+/*! Acquire the lock guarding graph, map, and server state while data threads are running. The
+ *  lock is recursive and is held by the polling and data threads while they call handlers. Called
+ *  from a data thread it only covers the devices serviced by that thread. */
+void mpr_net_lock(mpr_net net);
+
+void mpr_net_unlock(mpr_net net);
+
+/*! Acquire the lock guarding the state of a single local device, which does not hold up the data
+ *  threads servicing other devices.
+ *  \param net          The network structure.
+ *  \param dev          The local device.
+ *  \return             Zero if the lock was acquired, or nonzero if the caller is the data thread
+ *                      of another device and must hand the work over instead. */
+int mpr_net_lock_dev(mpr_net net, mpr_local_dev dev);
+
+void mpr_net_unlock_dev(mpr_net net, mpr_local_dev dev);
+
+/*! Check whether two local devices are serviced by the same data thread, or by the thread
+ *  polling the network, and can therefore call each other's handlers directly. */
+int mpr_net_get_is_same_shard(mpr_net net, mpr_local_dev dev1, mpr_local_dev dev2);
+
+/*! Wake the data thread servicing a device, if any, so that updates queued by another thread are
+ *  sent promptly.
+ *  \param net          The network structure.
+ *  \param dev          The local device, or NULL to wake all data threads. It may only be given
+ *                      while the device is locked. */
+void mpr_net_wake_data(mpr_net net, mpr_local_dev dev);
+
 int mpr_net_init(mpr_net n, const char *iface, const char *group, int port);
 
 void mpr_net_use_local(mpr_net n);
@@ -73,6 +158,9 @@ const char *mpr_net_get_interface(mpr_net net);
 
 const char *mpr_net_get_address(mpr_net net);
 
+/*! Check whether a host address refers to the host of the network interface in use. */
+int mpr_net_get_is_host_local(mpr_net net, const char *host);
+
 #define NEW_LO_MSG(VARNAME, FAIL)           \
 lo_message VARNAME = lo_message_new();      \
 if (!VARNAME) {                             \
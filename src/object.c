@@ -25,6 +25,11 @@ void mpr_obj_free(mpr_obj o)
     FUNC_IF(mpr_tbl_free, o->props.synced);
 }
 
+void mpr_obj_set_id(mpr_obj o, mpr_id id)
+{
+    mpr_graph_set_obj_id(o->graph, o, id);
+}
+
 mpr_graph mpr_obj_get_graph(mpr_obj o)
 {
     return o ? o->graph : 0;
@@ -249,12 +254,22 @@ mpr_list mpr_obj_get_prop_as_list(mpr_obj o, mpr_prop p, const char *s)
     return (mpr_list)val;
 }
 
-mpr_prop mpr_obj_set_prop(mpr_obj o, mpr_prop p, const char *s, int len,
-                          mpr_type type, const void *val, int publish)
+/* The local device whose data thread may read the properties of an object, or NULL. */
+static mpr_local_dev get_local_dev(mpr_obj o)
+{
+    RETURN_ARG_UNLESS(o->is_local, 0);
+    if (MPR_DEV == o->type)
+        return (mpr_local_dev)o;
+    if (MPR_SIG == o->type)
+        return (mpr_local_dev)mpr_sig_get_dev((mpr_sig)o);
+    return 0;
+}
+
+static mpr_prop set_prop(mpr_obj o, mpr_prop p, const char *s, int len,
+                         mpr_type type, const void *val, int publish)
 {
     int flags, updated;
     mpr_tbl tbl;
-    RETURN_ARG_UNLESS(o, 0);
     if (MPR_PROP_UNKNOWN == p || MPR_PROP_EXTRA == p || !MASK_PROP_BITFLAGS(p)) {
         if (!s)
             return MPR_PROP_UNKNOWN;
@@ -295,7 +310,23 @@ mpr_prop mpr_obj_set_prop(mpr_obj o, mpr_prop p, const char *s, int len,
     return updated ? p : MPR_PROP_UNKNOWN;
 }
 
-int mpr_obj_remove_prop(mpr_obj o, mpr_prop p, const char *s)
+mpr_prop mpr_obj_set_prop(mpr_obj o, mpr_prop p, const char *s, int len,
+                          mpr_type type, const void *val, int publish)
+{
+    mpr_net net;
+    mpr_local_dev dev;
+    RETURN_ARG_UNLESS(o, 0);
+    if (!(dev = get_local_dev(o)))
+        return set_prop(o, p, s, len, type, val, publish);
+    net = mpr_graph_get_net(o->graph);
+    TRACE_RETURN_UNLESS(!mpr_net_lock_dev(net, dev), MPR_PROP_UNKNOWN, "properties of local "
+                        "objects cannot be set from the data thread of another device.\n");
+    p = set_prop(o, p, s, len, type, val, publish);
+    mpr_net_unlock_dev(net, dev);
+    return p;
+}
+
+static int remove_prop(mpr_obj o, mpr_prop p, const char *s)
 {
     int updated = 0, public = 0;
 
@@ -320,6 +351,22 @@ int mpr_obj_remove_prop(mpr_obj o, mpr_prop p, const char *s)
     return updated ? 1 : 0;
 }
 
+int mpr_obj_remove_prop(mpr_obj o, mpr_prop p, const char *s)
+{
+    int updated;
+    mpr_net net;
+    mpr_local_dev dev;
+    RETURN_ARG_UNLESS(o, 0);
+    if (!(dev = get_local_dev(o)))
+        return remove_prop(o, p, s);
+    net = mpr_graph_get_net(o->graph);
+    TRACE_RETURN_UNLESS(!mpr_net_lock_dev(net, dev), 0, "properties of local objects cannot "
+                        "be removed from the data thread of another device.\n");
+    updated = remove_prop(o, p, s);
+    mpr_net_unlock_dev(net, dev);
+    return updated;
+}
+
 void mpr_obj_push(mpr_obj o)
 {
     mpr_net n;
@@ -38,8 +38,8 @@ void mpr_obj_incr_version(mpr_obj obj);
 MPR_INLINE static mpr_id mpr_obj_get_id(mpr_obj obj)
     { return obj->id; }
 
-MPR_INLINE static void mpr_obj_set_id(mpr_obj obj, mpr_id id)
-    { obj->id = id; }
+/*! Set the id of an object, updating the graph's index of object ids. */
+void mpr_obj_set_id(mpr_obj obj, mpr_id id);
 
 MPR_INLINE static void mpr_obj_set_status(mpr_obj obj, int add, int remove)
     { obj->status = (obj->status | add) & ~remove; }
@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "queue.h"
+#include "mpr_atomic.h"
+#include "mpr_debug.h"
+
+#define QUEUE_CACHE_LINE 64
+
+/* Each record is preceded by a header holding its sequence number. A slot at position `pos` is
+ * free for the producer claiming `pos` when its sequence equals `pos`, and holds a published
+ * record for the consumer when its sequence equals `pos + 1`. */
+typedef struct _mpr_queue_hdr {
+    volatile uint32_t seq;
+    uint32_t pos;                       /*!< The position the slot was claimed for. */
+} mpr_queue_hdr_t, *mpr_queue_hdr;
+
+typedef struct _mpr_queue {
+    char *slots;
+    size_t stride;
+    uint32_t mask;
+    char pad0[QUEUE_CACHE_LINE];
+    volatile uint32_t head;             /*!< Next position to be claimed by a producer. */
+    char pad1[QUEUE_CACHE_LINE - 4];
+    uint32_t tail;                      /*!< Next position to be read by the consumer. */
+    volatile uint32_t waiting;          /*!< 1 if the consumer may be blocked. */
+    char pad2[QUEUE_CACHE_LINE - 8];
+} mpr_queue_t;
+
+#define SLOT(Q, POS) ((mpr_queue_hdr)((Q)->slots + ((POS) & (Q)->mask) * (Q)->stride))
+
+mpr_queue mpr_queue_new(unsigned int size, size_t rec_size)
+{
+    mpr_queue q = (mpr_queue)calloc(1, sizeof(mpr_queue_t));
+    uint32_t i, cap = 2;
+    while (cap < size)
+        cap <<= 1;
+    q->stride = sizeof(mpr_queue_hdr_t) + ((rec_size + 7) & ~7);
+    q->slots = (char*)calloc(cap, q->stride);
+    q->mask = cap - 1;
+    for (i = 0; i < cap; i++)
+        SLOT(q, i)->seq = i;
+    return q;
+}
+
+void mpr_queue_free(mpr_queue q)
+{
+    RETURN_UNLESS(q);
+    free(q->slots);
+    free(q);
+}
+
+void *mpr_queue_reserve(mpr_queue q)
+{
+    uint32_t pos = mpr_atomic_load(&q->head);
+    while (1) {
+        mpr_queue_hdr hdr = SLOT(q, pos);
+        int32_t diff = (int32_t)(mpr_atomic_load(&hdr->seq) - pos);
+        if (!diff) {
+            /* the slot is free: try to claim it; on failure `pos` is updated to the new head */
+            if (mpr_atomic_cas(&q->head, &pos, pos + 1)) {
+                hdr->pos = pos;
+                return hdr + 1;
+            }
+        }
+        else if (diff < 0) {
+            /* the slot still holds a record from the previous lap */
+            return 0;
+        }
+        else
+            pos = mpr_atomic_load(&q->head);
+    }
+}
+
+int mpr_queue_commit(mpr_queue q, void *rec)
+{
+    mpr_queue_hdr hdr = (mpr_queue_hdr)rec - 1;
+    mpr_atomic_store(&hdr->seq, hdr->pos + 1);
+    /* order the publication before reading the flag; pairs with mpr_queue_wait() */
+    mpr_atomic_fence();
+    RETURN_ARG_UNLESS(mpr_atomic_load(&q->waiting), 0);
+    return mpr_atomic_swap(&q->waiting, 0);
+}
+
+void *mpr_queue_read(mpr_queue q)
+{
+    mpr_queue_hdr hdr = SLOT(q, q->tail);
+    RETURN_ARG_UNLESS(mpr_atomic_load(&hdr->seq) == q->tail + 1, 0);
+    return hdr + 1;
+}
+
+void mpr_queue_release(mpr_queue q)
+{
+    /* hand the slot to the producer that will claim it on the next lap */
+    mpr_atomic_store(&SLOT(q, q->tail)->seq, q->tail + q->mask + 1);
+    ++q->tail;
+}
+
+int mpr_queue_wait(mpr_queue q)
+{
+    mpr_atomic_store(&q->waiting, 1);
+    /* order the flag before checking for records; pairs with mpr_queue_commit() */
+    mpr_atomic_fence();
+    return mpr_atomic_load(&SLOT(q, q->tail)->seq) != q->tail + 1;
+}
@@ -0,0 +1,47 @@
+#ifndef __MPR_QUEUE_H__
+#define __MPR_QUEUE_H__
+
+#include <stddef.h>
+
+/*! A bounded queue of fixed-size records with any number of producers and a single consumer.
+ *  Producers claim and publish records without locks or memory allocation, so records can be
+ *  added from real-time threads. Records are read in the order they were claimed. */
+typedef struct _mpr_queue *mpr_queue;
+
+/*! Create a queue.
+ *  \param size         The number of records, rounded up to a power of two.
+ *  \param rec_size     The size of each record in bytes.
+ *  \return             The new queue. */
+mpr_queue mpr_queue_new(unsigned int size, size_t rec_size);
+
+/*! Free a queue. No producer or consumer may be using it. */
+void mpr_queue_free(mpr_queue queue);
+
+/*! Claim the next record. May be called from any thread.
+ *  \param queue        The queue to write to.
+ *  \return             A pointer to 8-byte aligned space for the record, or NULL if the queue is
+ *                      full. The record is not visible to the consumer until it is passed to
+ *                      mpr_queue_commit(). */
+void *mpr_queue_reserve(mpr_queue queue);
+
+/*! Publish a record claimed with mpr_queue_reserve().
+ *  \param queue        The queue to write to.
+ *  \param rec          The record to publish.
+ *  \return             1 if the consumer needs to be woken, see mpr_queue_wait(). */
+int mpr_queue_commit(mpr_queue queue, void *rec);
+
+/*! Retrieve the next published record. Must only be called by the consumer.
+ *  \param queue        The queue to read from.
+ *  \return             A pointer to the record, or NULL if the queue is empty. The record remains
+ *                      valid until mpr_queue_release() is called. */
+void *mpr_queue_read(mpr_queue queue);
+
+/*! Release the record retrieved with mpr_queue_read() so it can be reused. */
+void mpr_queue_release(mpr_queue queue);
+
+/*! Tell producers that the consumer is about to block waiting on other events.
+ *  \return             1 if the queue is still empty and it is safe to block, 0 if new records
+ *                      arrived in the meantime. */
+int mpr_queue_wait(mpr_queue queue);
+
+#endif /* __MPR_QUEUE_H__ */
@@ -0,0 +1,242 @@
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef HAVE_SHM_OPEN
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+#endif
+
+#include "ring.h"
+#include "mpr_debug.h"
+
+#ifdef HAVE_SHM_OPEN
+
+#define RING_MAGIC      0x6d707231  /* "mpr1" */
+#define RING_CACHE_LINE 64
+#define RING_WRAP       0xFFFFFFFF  /* record length marking a skip to the start of the ring */
+#define RING_MIN_SIZE   4096
+
+/* records consist of an 8-byte header holding the length followed by the padded payload */
+#define RING_REC_SIZE(LEN) ((8 + (uint32_t)(LEN) + 7) & ~7U)
+
+/*! Shared header at the start of the memory segment. The counters increase monotonically and
+ *  wrap around; the producer and consumer counters are kept on separate cache lines. */
+typedef struct _mpr_ring_hdr {
+    uint32_t magic;
+    uint32_t size;                      /*!< Capacity of the data area, a power of two. */
+    uint32_t attached;                  /*!< 1 if a consumer is attached. */
+    uint32_t waiting;                   /*!< 1 if the consumer may be blocked on a socket. */
+    char pad0[RING_CACHE_LINE - 16];
+    uint32_t head;                      /*!< Written by the producer. */
+    char pad1[RING_CACHE_LINE - 4];
+    uint32_t tail;                      /*!< Written by the consumer. */
+    char pad2[RING_CACHE_LINE - 4];
+} mpr_ring_hdr_t, *mpr_ring_hdr;
+
+typedef struct _mpr_ring {
+    mpr_ring_hdr hdr;
+    char *data;
+    char *name;                         /*!< Segment name, only kept by the producer. */
+    size_t map_size;
+    uint32_t mask;
+    uint32_t pos;                       /*!< Local copy of our own counter. */
+    uint32_t rec_size;                  /*!< Size of the record currently reserved or read. */
+} mpr_ring_t;
+
+static mpr_ring map_ring(int fd, size_t map_size)
+{
+    mpr_ring ring;
+    void *mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    RETURN_ARG_UNLESS(MAP_FAILED != mem, 0);
+    ring = (mpr_ring)calloc(1, sizeof(mpr_ring_t));
+    ring->hdr = (mpr_ring_hdr)mem;
+    ring->data = (char*)mem + sizeof(mpr_ring_hdr_t);
+    ring->map_size = map_size;
+    return ring;
+}
+
+mpr_ring mpr_ring_new(const char *name, size_t size)
+{
+    mpr_ring ring;
+    size_t cap = RING_MIN_SIZE;
+    int fd;
+
+    while (cap < size)
+        cap <<= 1;
+
+    /* never replace an existing segment: it may belong to a live process */
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        trace("couldn't create shared memory ring '%s'\n", name);
+        return 0;
+    }
+    if (ftruncate(fd, sizeof(mpr_ring_hdr_t) + cap) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+    if (!(ring = map_ring(fd, sizeof(mpr_ring_hdr_t) + cap))) {
+        shm_unlink(name);
+        return 0;
+    }
+    ring->name = strdup(name);
+    ring->mask = cap - 1;
+    ring->hdr->size = cap;
+    /* publish the magic number last so consumers never see a partially initialized header */
+    __atomic_store_n(&ring->hdr->magic, RING_MAGIC, __ATOMIC_RELEASE);
+    return ring;
+}
+
+mpr_ring mpr_ring_open(const char *name)
+{
+    mpr_ring ring;
+    struct stat st;
+    uint32_t expected = 0;
+    int fd = shm_open(name, O_RDWR, 0);
+    RETURN_ARG_UNLESS(fd >= 0, 0);
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)(sizeof(mpr_ring_hdr_t) + RING_MIN_SIZE)) {
+        close(fd);
+        return 0;
+    }
+    RETURN_ARG_UNLESS(ring = map_ring(fd, st.st_size), 0);
+    if (   RING_MAGIC != __atomic_load_n(&ring->hdr->magic, __ATOMIC_ACQUIRE)
+        || ring->hdr->size + sizeof(mpr_ring_hdr_t) > ring->map_size
+        || !__atomic_compare_exchange_n(&ring->hdr->attached, &expected, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        munmap(ring->hdr, ring->map_size);
+        free(ring);
+        return 0;
+    }
+    ring->mask = ring->hdr->size - 1;
+    ring->pos = __atomic_load_n(&ring->hdr->tail, __ATOMIC_ACQUIRE);
+    return ring;
+}
+
+void mpr_ring_free(mpr_ring ring)
+{
+    RETURN_UNLESS(ring);
+    if (ring->name) {
+        shm_unlink(ring->name);
+        free(ring->name);
+    }
+    else
+        __atomic_store_n(&ring->hdr->attached, 0, __ATOMIC_RELEASE);
+    munmap(ring->hdr, ring->map_size);
+    free(ring);
+}
+
+int mpr_ring_get_is_attached(mpr_ring ring)
+{
+    return __atomic_load_n(&ring->hdr->attached, __ATOMIC_RELAXED);
+}
+
+void *mpr_ring_reserve(mpr_ring ring, size_t len)
+{
+    uint32_t size = ring->mask + 1, need = RING_REC_SIZE(len), off = ring->pos & ring->mask;
+    uint32_t avail = size - (ring->pos - __atomic_load_n(&ring->hdr->tail, __ATOMIC_ACQUIRE));
+    RETURN_ARG_UNLESS(len < size / 2, 0);
+
+    if (size - off < need) {
+        /* not enough contiguous space before the end: skip to the start of the ring */
+        RETURN_ARG_UNLESS(avail >= size - off + need, 0);
+        *(uint32_t*)(ring->data + off) = RING_WRAP;
+        ring->pos += size - off;
+        off = 0;
+    }
+    else
+        RETURN_ARG_UNLESS(avail >= need, 0);
+
+    *(uint32_t*)(ring->data + off) = (uint32_t)len;
+    ring->rec_size = need;
+    return ring->data + off + 8;
+}
+
+void mpr_ring_commit(mpr_ring ring)
+{
+    ring->pos += ring->rec_size;
+    ring->rec_size = 0;
+    __atomic_store_n(&ring->hdr->head, ring->pos, __ATOMIC_RELEASE);
+}
+
+int mpr_ring_wake(mpr_ring ring)
+{
+    /* order the preceding head update before reading the flag; pairs with mpr_ring_wait() */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    RETURN_ARG_UNLESS(__atomic_load_n(&ring->hdr->waiting, __ATOMIC_RELAXED), 0);
+    return __atomic_exchange_n(&ring->hdr->waiting, 0, __ATOMIC_RELAXED);
+}
+
+const void *mpr_ring_read(mpr_ring ring, size_t *len)
+{
+    uint32_t head = __atomic_load_n(&ring->hdr->head, __ATOMIC_ACQUIRE), size = ring->mask + 1;
+    while (ring->pos != head) {
+        uint32_t off = ring->pos & ring->mask, rec_len = *(uint32_t*)(ring->data + off);
+        uint32_t avail = head - ring->pos;
+        if (RING_WRAP == rec_len) {
+            if (avail < size - off)
+                break;
+            ring->pos += size - off;
+            continue;
+        }
+        /* the header is shared with another process, so never trust it to stay within the
+         * published records */
+        if (rec_len >= size / 2 || RING_REC_SIZE(rec_len) > avail
+            || RING_REC_SIZE(rec_len) > size - off)
+            break;
+        *len = rec_len;
+        ring->rec_size = RING_REC_SIZE(rec_len);
+        return ring->data + off + 8;
+    }
+    if (ring->pos != head) {
+        trace("discarding corrupt records in shared memory ring\n");
+        ring->pos = head;
+        ring->rec_size = 0;
+        __atomic_store_n(&ring->hdr->tail, ring->pos, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+void mpr_ring_release(mpr_ring ring)
+{
+    ring->pos += ring->rec_size;
+    ring->rec_size = 0;
+    __atomic_store_n(&ring->hdr->tail, ring->pos, __ATOMIC_RELEASE);
+}
+
+int mpr_ring_wait(mpr_ring ring)
+{
+    __atomic_store_n(&ring->hdr->waiting, 1, __ATOMIC_RELAXED);
+    /* order the flag before reading the head; pairs with mpr_ring_wake() */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&ring->hdr->head, __ATOMIC_ACQUIRE) == ring->pos;
+}
+
+#else /* !HAVE_SHM_OPEN */
+
+mpr_ring mpr_ring_new(const char *name, size_t size) { return 0; }
+
+mpr_ring mpr_ring_open(const char *name) { return 0; }
+
+void mpr_ring_free(mpr_ring ring) {}
+
+int mpr_ring_get_is_attached(mpr_ring ring) { return 0; }
+
+void *mpr_ring_reserve(mpr_ring ring, size_t len) { return 0; }
+
+void mpr_ring_commit(mpr_ring ring) {}
+
+int mpr_ring_wake(mpr_ring ring) { return 0; }
+
+const void *mpr_ring_read(mpr_ring ring, size_t *len) { return 0; }
+
+void mpr_ring_release(mpr_ring ring) {}
+
+int mpr_ring_wait(mpr_ring ring) { return 1; }
+
+#endif /* HAVE_SHM_OPEN */
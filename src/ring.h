@@ -0,0 +1,63 @@
+#ifndef __MPR_RING_H__
+#define __MPR_RING_H__
+
+#include <stddef.h>
+
+/*! A single-producer single-consumer ring of variable-length records in POSIX shared memory,
+ *  used to pass data between co-located processes without going through loopback sockets.
+ *  The producer creates the ring and the consumer attaches to it by name. Records are published
+ *  and released with lock-free head and tail counters so neither side makes system calls in
+ *  the steady state. If shared memory is not available mpr_ring_new() and mpr_ring_open()
+ *  always return NULL. */
+typedef struct _mpr_ring *mpr_ring;
+
+/*! Create a shared-memory ring for writing. Fails if a segment with the same name already
+ *  exists, since only the process that created a segment may remove it.
+ *  \param name         The name of the shared memory segment, starting with a slash.
+ *  \param size         The capacity of the ring in bytes, rounded up to a power of two.
+ *  \return             The new ring, or NULL if it could not be created. */
+mpr_ring mpr_ring_new(const char *name, size_t size);
+
+/*! Attach to an existing shared-memory ring for reading. Only one consumer may be attached.
+ *  \param name         The name of the shared memory segment.
+ *  \return             The ring, or NULL if it does not exist or already has a consumer. */
+mpr_ring mpr_ring_open(const char *name);
+
+/*! Detach from a ring. The producer also removes the shared memory segment name. */
+void mpr_ring_free(mpr_ring ring);
+
+/*! Check whether a consumer is currently attached to a ring created with mpr_ring_new(). */
+int mpr_ring_get_is_attached(mpr_ring ring);
+
+/*! Reserve contiguous space for the next record. The record is not visible to the consumer
+ *  until mpr_ring_commit() is called.
+ *  \param ring         The ring to write to.
+ *  \param len          The length of the record in bytes.
+ *  \return             A pointer to 8-byte aligned space for the record, or NULL if the ring
+ *                      is full. */
+void *mpr_ring_reserve(mpr_ring ring, size_t len);
+
+/*! Publish the record reserved with mpr_ring_reserve(). */
+void mpr_ring_commit(mpr_ring ring);
+
+/*! Check and clear the flag set by a consumer that is about to block.
+ *  \return             1 if the consumer needs to be woken after the latest commit. */
+int mpr_ring_wake(mpr_ring ring);
+
+/*! Retrieve the next record from a ring opened with mpr_ring_open(). Records whose length does
+ *  not fit within the published part of the ring are discarded along with everything after them.
+ *  \param ring         The ring to read from.
+ *  \param len          Set to the length of the record in bytes.
+ *  \return             A pointer to the record, or NULL if the ring is empty. The record
+ *                      remains valid until mpr_ring_release() is called. */
+const void *mpr_ring_read(mpr_ring ring, size_t *len);
+
+/*! Release the record retrieved with mpr_ring_read() so its space can be reused. */
+void mpr_ring_release(mpr_ring ring);
+
+/*! Tell the producer that the consumer is about to block waiting on other events.
+ *  \return             1 if the ring is still empty and it is safe to block, 0 if new records
+ *                      arrived in the meantime. */
+int mpr_ring_wait(mpr_ring ring);
+
+#endif /* __MPR_RING_H__ */
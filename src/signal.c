@@ -8,10 +8,13 @@
 #include "bitflags.h"
 #include "device.h"
 #include "graph.h"
+#include "hash.h"
+#include "mpr_atomic.h"
 #include "mpr_signal.h"
 #include "object.h"
 #include "path.h"
 #include "property.h"
+#include "snapshot.h"
 #include "table.h"
 #include "mpr_set_coerced.h"
 
@@ -21,7 +24,7 @@
 #include <malloc.h>
 #endif
 
-#define MAX_INST 128
+#define MAX_INST UINT16_MAX
 #define BUFFSIZE 512
 
 /* Signals and signal instances
@@ -50,7 +53,11 @@ static int get_inst_by_ids(mpr_local_sig lsig, mpr_id *LID, mpr_id *GID);
     int ephemeral;              /*!< 1 if signal is ephemeral, 0 otherwise. */          \
     int num_maps_in;            /* TODO: use dynamic query instead? */                  \
     int num_maps_out;           /* TODO: use dynamic query instead? */                  \
+    mpr_map *maps;              /*!< Maps connected to this signal. */                  \
+    int num_maps;                                                                       \
+    void *queries;              /*!< Queries over the map array. */                     \
     mpr_steal_type steal_mode;  /*!< Type of voice stealing to perform. */              \
+    int alias;                  /*!< Alias for addressing data messages, or 0. */       \
     mpr_type type;              /*!< The type of this signal. */
 
 /*! A record that describes properties of a signal. */
@@ -69,7 +76,7 @@ typedef struct _mpr_sig_inst
     mpr_time created;               /*!< The instance's creation timestamp. */
 
     uint16_t status;                /*!< Status of this instance. */
-    uint8_t idx;                    /*!< Index for accessing value history. */
+    uint16_t idx;                   /*!< Index for accessing value history. */
 } mpr_sig_inst_t;
 
 /* plan: remove inst, add map/slot resource index (is this the same for all source signals?) */
@@ -87,6 +94,7 @@ typedef struct _mpr_local_sig
     mpr_local_dev dev;
 
     mpr_sig_id_map id_maps;         /*!< ID maps and active instances. */
+    mpr_hash id_maps_by_LID;        /*!< Index of id_maps entries with an instance, by LID. */
     mpr_value value;
     unsigned int num_id_maps;
     mpr_sig_inst *inst;             /*!< Array of pointers to the signal insts. */
@@ -104,6 +112,9 @@ typedef struct _mpr_local_sig
     mpr_sig_group group;            /* TODO: replace with hierarchical instancing */
     uint8_t locked;
     uint8_t updated;                /* TODO: fold into updated_inst bitflags. */
+
+    mpr_snapshot snapshot;          /*!< Latest values readable from other threads, or NULL. */
+    mpr_snapshot retired;           /*!< Disabled snapshot that readers may still hold. */
 } mpr_local_sig_t;
 
 size_t mpr_sig_get_struct_size(int is_local)
@@ -111,9 +122,58 @@ size_t mpr_sig_get_struct_size(int is_local)
     return is_local ? sizeof(mpr_local_sig_t) : sizeof(mpr_sig_t);
 }
 
+/* Copy the current value of an instance to the snapshot, if enabled. */
+static void publish_inst(mpr_local_sig lsig, mpr_sig_inst si)
+{
+    RETURN_UNLESS(lsig->snapshot);
+    mpr_snapshot_write(lsig->snapshot, si->idx, si->id,
+                       mpr_value_get_value(lsig->value, si->idx, 0),
+                       mpr_value_get_time(lsig->value, si->idx, 0));
+}
+
+/* Bring the snapshot up to date after instances were added, removed or renumbered. */
+static void publish_all(mpr_local_sig lsig)
+{
+    unsigned int i, num_slots;
+    RETURN_UNLESS(lsig->snapshot);
+    if (lsig->num_inst > mpr_snapshot_get_num_inst(lsig->snapshot)) {
+        mpr_atomic_store_ptr(&lsig->snapshot, mpr_snapshot_grow(lsig->snapshot, lsig->num_inst));
+    }
+    num_slots = mpr_snapshot_get_num_inst(lsig->snapshot);
+    for (i = 0; i < lsig->num_inst; i++) {
+        mpr_sig_inst si = lsig->inst[i];
+        if (si->status & MPR_STATUS_HAS_VALUE)
+            publish_inst(lsig, si);
+        else
+            mpr_snapshot_clear(lsig->snapshot, si->idx);
+    }
+    for (i = lsig->num_inst; i < num_slots; i++)
+        mpr_snapshot_clear(lsig->snapshot, i);
+}
+
+/* Lock the device of a local signal against the data threads before changing its instances,
+ * maps or handler. Returns nonzero without locking if called from the data thread of another
+ * device, which cannot wait for the lock. */
+static int lock_sig(mpr_local_sig lsig)
+{
+    mpr_net net = mpr_graph_get_net(lsig->obj.graph);
+    TRACE_RETURN_UNLESS(!mpr_net_lock_dev(net, (mpr_local_dev)lsig->dev), 1, "signal '%s' "
+                        "cannot be modified from the data thread of another device.\n",
+                        lsig->name);
+    return 0;
+}
+
+static void unlock_sig(mpr_local_sig lsig)
+{
+    mpr_net net = mpr_graph_get_net(lsig->obj.graph);
+    mpr_net_wake_data(net, (mpr_local_dev)lsig->dev);
+    mpr_net_unlock_dev(net, (mpr_local_dev)lsig->dev);
+}
+
 static int _compare_inst_ids(const void *l, const void *r)
 {
-    return (*(mpr_sig_inst*)l)->id - (*(mpr_sig_inst*)r)->id;
+    mpr_id l_id = (*(mpr_sig_inst*)l)->id, r_id = (*(mpr_sig_inst*)r)->id;
+    return l_id < r_id ? -1 : l_id > r_id;
 }
 
 static mpr_sig_inst _find_inst_by_id(mpr_local_sig lsig, mpr_id id)
@@ -127,11 +187,65 @@ static mpr_sig_inst _find_inst_by_id(mpr_local_sig lsig, mpr_id id)
     return (sipp && *sipp) ? *sipp : 0;
 }
 
+/* Change the id of an instance, moving it to keep the instance array sorted by id. */
+static void _set_inst_id(mpr_local_sig lsig, mpr_sig_inst si, mpr_id id)
+{
+    int i;
+    si->id = id;
+    for (i = 0; i < lsig->num_inst && lsig->inst[i] != si; i++) {}
+    RETURN_UNLESS(i < lsig->num_inst);
+    for (; i > 0 && lsig->inst[i - 1]->id > id; i--)
+        lsig->inst[i] = lsig->inst[i - 1];
+    for (; i < lsig->num_inst - 1 && lsig->inst[i + 1]->id < id; i++)
+        lsig->inst[i] = lsig->inst[i + 1];
+    lsig->inst[i] = si;
+}
+
 MPR_INLINE static mpr_sig_inst _get_inst_by_id_map_idx(mpr_local_sig sig, int id_map_idx)
 {
     return sig->id_maps[id_map_idx].inst;
 }
 
+/* The LID index holds the first id_maps entry that has both an instance and an id_map for each
+ * LID, so lookups return the same entry as a linear scan of the array. */
+static void _index_id_map(mpr_local_sig lsig, int id_map_idx)
+{
+    mpr_sig_id_map smap = &lsig->id_maps[id_map_idx], prev;
+    RETURN_UNLESS(smap->inst && smap->id_map);
+    prev = (mpr_sig_id_map)mpr_hash_get_id(lsig->id_maps_by_LID, smap->id_map->LID);
+    if (!prev || prev > smap)
+        mpr_hash_add_id(lsig->id_maps_by_LID, smap->id_map->LID, smap);
+}
+
+static void _reindex_id_maps(mpr_local_sig lsig)
+{
+    int i;
+    mpr_hash_clear(lsig->id_maps_by_LID);
+    for (i = 0; i < lsig->num_id_maps; i++)
+        _index_id_map(lsig, i);
+}
+
+/* Call before clearing the instance or id_map of an id_maps entry. */
+static void _unindex_id_map(mpr_local_sig lsig, int id_map_idx)
+{
+    int i;
+    mpr_id LID;
+    mpr_sig_id_map smap = &lsig->id_maps[id_map_idx];
+    RETURN_UNLESS(smap->inst && smap->id_map);
+    LID = smap->id_map->LID;
+    RETURN_UNLESS(mpr_hash_get_id(lsig->id_maps_by_LID, LID) == smap);
+    mpr_hash_remove_id(lsig->id_maps_by_LID, LID);
+
+    /* another entry may share this LID */
+    for (i = id_map_idx + 1; i < lsig->num_id_maps; i++) {
+        smap = &lsig->id_maps[i];
+        if (smap->inst && smap->id_map && smap->id_map->LID == LID) {
+            mpr_hash_add_id(lsig->id_maps_by_LID, LID, smap);
+            break;
+        }
+    }
+}
+
 /*! Helper to check if a type character is valid. */
 MPR_INLINE static int check_sig_length(int length)
 {
@@ -355,66 +469,24 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
  * - flexible input (mapping something new to the persistent instances) is handled
  *   by using dynamic proxy id_maps */
 
-int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
-                        lo_message msg, void *data)
+/* Apply a single update to a local signal. Arguments are passed as an array of pointers to
+ * elements with matching types; elements with type MPR_NULL have no value. Returns the number of
+ * arguments consumed, or -1 if the remainder of the update should be discarded. */
+static int handle_update(mpr_local_sig sig, int slot_id, mpr_id GID, const mpr_type *types,
+                         void **argv, int argc, mpr_time time)
 {
-    mpr_local_sig sig = (mpr_local_sig)data;
-    mpr_local_dev dev;
+    mpr_local_dev dev = sig->dev;
     mpr_sig_inst si;
-    mpr_net net = mpr_graph_get_net(sig->obj.graph);
-    int i, offset = 0, val_len = 0, vals = 0;
-    int id_map_idx, inst_idx, slot_id = -1, map_manages_inst = 0;
-    mpr_id GID = 0;
+    int i, val_len = 0, vals = 0;
+    int id_map_idx, inst_idx, map_manages_inst = 0;
     mpr_id_map id_map, remote_id_map = 0;
     mpr_local_map map = 0;
     mpr_local_slot slot = 0;
     mpr_sig slot_sig = 0;
-    mpr_time time;
-
-    assert(sig);
-    dev = sig->dev;
-
-#ifdef DEBUG
-    trace("<%s> '%s:%s' received update: ",
-          lo_address_get_protocol(lo_message_get_source(msg)) == LO_TCP ? "TCP" : "UDP",
-          mpr_dev_get_name((mpr_dev)dev), sig->name);
-    lo_message_pp(msg);
-#endif
-
-    TRACE_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->name);
-    RETURN_ARG_UNLESS(argc, 0);
-
-    time = mpr_net_get_bundle_time(net);
 
-    /* We need to consider that there may be properties prepended to the msg
-     * check length and find properties if any */
-    if (types[0] == MPR_STR) {
-        if ((strcmp(&argv[0]->s, "@sl") == 0) && argc >= 2) {
-            TRACE_RETURN_UNLESS(types[1] == MPR_INT32, 0,
-                                "error in mpr_sig_osc_handler: bad arguments for 'slot' prop.\n")
-            slot_id = argv[1]->i32;
-            trace("retrieved slot id %d\n", slot_id);
-            offset += 2;
-        }
-    }
-again:
-    if (types[offset] == MPR_STR) {
-        if ((strcmp(&argv[offset]->s, "@in") == 0) && argc >= offset + 2) {
-            TRACE_RETURN_UNLESS(types[offset + 1] == MPR_INT64, 0,
-                                "error in mpr_sig_osc_handler: bad arguments for 'instance' prop.\n")
-            GID = argv[offset + 1]->i64;
-            trace("retrieved GUID %"PR_MPR_ID"\n", GID);
-            offset += 2;
-        }
-        else {
-            trace("error in mpr_sig_osc_handler: unknown property name '%s'.\n", &argv[offset]->s);
-            return 0;
-        }
-    }
-    val_len = offset;
-    while (val_len < argc && types[val_len] != MPR_STR)
+    /* values end at the next property key or, for aliased updates, the next instance GID */
+    while (val_len < argc && types[val_len] != MPR_STR && types[val_len] != MPR_INT64)
         ++val_len;
-    val_len -= offset;
 
     if (slot_id >= 0) {
         mpr_expr expr;
@@ -424,28 +496,28 @@ again:
             if ((slot = (mpr_local_slot)mpr_map_get_src_slot_by_id((mpr_map)map, slot_id)))
                 break;
         }
-        TRACE_RETURN_UNLESS(slot, 0, "error in mpr_sig_osc_handler: slot %d not found.\n", slot_id);
+        TRACE_RETURN_UNLESS(slot, -1, "error in mpr_sig_osc_handler: slot %d not found.\n", slot_id);
         slot_sig = mpr_slot_get_sig((mpr_slot)slot);
         TRACE_RETURN_UNLESS(   (mpr_obj_get_status((mpr_obj)map, 0)
                              & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED)) == MPR_STATUS_ACTIVE,
-                            0, "error in mpr_sig_osc_handler: map not yet ready.\n");
+                            -1, "error in mpr_sig_osc_handler: map not yet ready.\n");
         if ((expr = mpr_local_map_get_expr(map)) && MPR_LOC_BOTH != mpr_map_get_locality((mpr_map)map)) {
-            vals = check_types(types + offset, val_len, slot_sig->type, slot_sig->len);
+            vals = check_types(types, val_len, slot_sig->type, slot_sig->len);
             val_len = slot_sig->len;
             map_manages_inst = mpr_expr_get_manages_inst(expr);
         }
         else if (MPR_LOC_SRC == mpr_map_get_locality((mpr_map)map)) {
             /* value has already been processed at source device */
             map = 0;
-            vals = check_types(types + offset, val_len, sig->type, sig->len);
+            vals = check_types(types, val_len, sig->type, sig->len);
             val_len = sig->len;
         }
     }
     else {
-        vals = check_types(types + offset, val_len, sig->type, sig->len);
+        vals = check_types(types, val_len, sig->type, sig->len);
         val_len = sig->len;
     }
-    RETURN_ARG_UNLESS(vals >= 0, 0);
+    RETURN_ARG_UNLESS(vals >= 0, -1);
 
     /* TODO: optionally discard out-of-order messages
      * requires timebase sync for many-to-one mappings or local updates
@@ -548,7 +620,7 @@ again:
                     if (src_slot != (mpr_slot)slot) {
                         mpr_sig src_sig = mpr_slot_get_sig(src_slot);
                         if (src_sig->use_inst) {
-                            mpr_slot_set_value(slot, 0, argv[offset], time);
+                            mpr_slot_set_value(slot, 0, argv[0], time);
                             goto done;
                         }
                     }
@@ -609,7 +681,7 @@ again:
             trace_dev(dev, "error in mpr_sig_osc_handler: partial vector update "
                       "applied to convergent mapping slot.");
 #endif
-            return 0;
+            return -1;
         }
         /* Setting to local timestamp here */
         time = mpr_dev_get_time((mpr_dev)dev);
@@ -620,7 +692,7 @@ again:
         if ((si = _get_inst_by_id_map_idx(sig, id_map_idx)) && (si->status & MPR_STATUS_ACTIVE)) {
             inst_idx = si->idx;
             /* TODO: jitter mitigation etc. */
-            if (mpr_slot_set_value(slot, inst_idx, argv[offset], time)) {
+            if (mpr_slot_set_value(slot, inst_idx, argv[0], time)) {
                 mpr_local_map_set_updated(map, inst_idx);
                 mpr_local_dev_set_receiving(dev);
             }
@@ -647,7 +719,7 @@ again:
             else {
                 mpr_value_cpy_next(sig->value, si->idx, time);
             }
-            for (i = offset; i < offset + sig->len; i++) {
+            for (i = 0; i < sig->len; i++) {
                 if (types[i] == MPR_NULL)
                     continue;
                 if (mpr_value_set_element(sig->value, si->idx, i, argv[i]))
@@ -656,6 +728,7 @@ again:
             if (mpr_value_get_has_value(sig->value, si->idx)) {
                 si->status |= (MPR_STATUS_HAS_VALUE | MPR_STATUS_UPDATE_REM | status);
                 sig->obj.status |= si->status;
+                publish_inst(sig, si);
                 mpr_bitflags_unset(sig->updated_inst, si->idx);
                 mpr_sig_call_handler(sig, MPR_STATUS_UPDATE_REM, id_map->LID, si->idx);
                 /* Pass this update downstream if signal is an input and was not updated in handler. */
@@ -669,12 +742,142 @@ again:
             break;
     }
 done:
-    offset += val_len;
-    if (offset < argc)
-        goto again;
+    return val_len;
+}
+
+int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                        lo_message msg, void *data)
+{
+    mpr_local_sig sig = (mpr_local_sig)data;
+    mpr_net net = mpr_graph_get_net(sig->obj.graph);
+    int offset = 0, slot_id = -1, val_len;
+    mpr_id GID = 0;
+    mpr_time time;
+
+    assert(sig);
+
+#ifdef DEBUG
+    trace("<%s> '%s:%s' received update: ",
+          lo_address_get_protocol(lo_message_get_source(msg)) == LO_TCP ? "TCP" : "UDP",
+          mpr_dev_get_name((mpr_dev)sig->dev), sig->name);
+    lo_message_pp(msg);
+#endif
+
+    TRACE_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->name);
+    RETURN_ARG_UNLESS(argc, 0);
+
+    time = mpr_net_get_bundle_time(net);
+
+    /* We need to consider that there may be properties prepended to the msg
+     * check length and find properties if any */
+    if (types[0] == MPR_STR) {
+        if ((strcmp(&argv[0]->s, "@sl") == 0) && argc >= 2) {
+            TRACE_RETURN_UNLESS(types[1] == MPR_INT32, 0,
+                                "error in mpr_sig_osc_handler: bad arguments for 'slot' prop.\n")
+            slot_id = argv[1]->i32;
+            trace("retrieved slot id %d\n", slot_id);
+            offset += 2;
+        }
+    }
+    do {
+        if (types[offset] == MPR_STR) {
+            if ((strcmp(&argv[offset]->s, "@in") == 0) && argc >= offset + 2) {
+                TRACE_RETURN_UNLESS(types[offset + 1] == MPR_INT64, 0,
+                                    "error in mpr_sig_osc_handler: bad arguments for 'instance' prop.\n")
+                GID = argv[offset + 1]->i64;
+                trace("retrieved GUID %"PR_MPR_ID"\n", GID);
+                offset += 2;
+            }
+            else {
+                trace("error in mpr_sig_osc_handler: unknown property name '%s'.\n", &argv[offset]->s);
+                return 0;
+            }
+        }
+        val_len = handle_update(sig, slot_id, GID, (const mpr_type*)types + offset,
+                                (void**)argv + offset, argc - offset, time);
+        RETURN_ARG_UNLESS(val_len >= 0, 0);
+        offset += val_len;
+    } while (offset < argc);
     return 0;
 }
 
+/* Updates addressed to a signal path are resolved through the device's signal name index.
+ * Aliased updates use the path "/@<alias>" or "/@<alias>.<slot id>" and carry no property keys;
+ * each update is optionally preceded by its 64-bit instance GID, e.g.
+ * "/@12.1" ,hfffhff 1234 1.0 2.0 3.0 5678 4.0 5.0 */
+int mpr_sig_data_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                         lo_message msg, void *data)
+{
+    mpr_local_dev dev = (mpr_local_dev)data;
+    mpr_local_sig sig;
+    mpr_net net;
+    int offset = 0, slot_id = -1, val_len;
+    mpr_id GID = 0;
+    mpr_time time;
+    char *end;
+    long alias;
+
+    if ('@' != path[1]) {
+        sig = (mpr_local_sig)mpr_dev_get_sig_by_name((mpr_dev)dev, path);
+        TRACE_RETURN_UNLESS(sig, 0, "no signal found for path '%s'.\n", path);
+        return mpr_sig_osc_handler(path, types, argv, argc, msg, sig);
+    }
+
+    alias = strtol(path + 2, &end, 10);
+    if ('.' == *end)
+        slot_id = strtol(end + 1, NULL, 10);
+    sig = mpr_local_dev_get_sig_by_alias(dev, alias);
+    TRACE_RETURN_UNLESS(sig, 0, "no signal found for alias %ld.\n", alias);
+
+#ifdef DEBUG
+    trace("<%s> '%s:%s' received aliased update: ",
+          lo_address_get_protocol(lo_message_get_source(msg)) == LO_TCP ? "TCP" : "UDP",
+          mpr_dev_get_name((mpr_dev)sig->dev), sig->name);
+    lo_message_pp(msg);
+#endif
+
+    TRACE_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->name);
+    RETURN_ARG_UNLESS(argc, 0);
+
+    net = mpr_graph_get_net(sig->obj.graph);
+    time = mpr_net_get_bundle_time(net);
+
+    do {
+        if (MPR_INT64 == types[offset]) {
+            GID = argv[offset]->i64;
+            RETURN_ARG_UNLESS(++offset < argc, 0);
+        }
+        val_len = handle_update(sig, slot_id, GID, (const mpr_type*)types + offset,
+                                (void**)argv + offset, argc - offset, time);
+        RETURN_ARG_UNLESS(val_len >= 0, 0);
+        offset += val_len;
+    } while (offset < argc);
+    return 0;
+}
+
+void mpr_local_sig_handle_update(mpr_local_sig sig, int slot_id, mpr_id GID, int len,
+                                 const mpr_type *types, const void *vals, mpr_time time)
+{
+    /* short vectors use the stack, longer ones are allocated */
+    void *argv_stack[16], **argv = argv_stack;
+    size_t size = 0;
+    int i;
+
+    RETURN_UNLESS(sig->num_inst && len > 0 && len <= MPR_MAX_VECTOR_LEN);
+    if (len > 16)
+        argv = malloc(sizeof(void*) * len);
+
+    for (i = 0; i < len && !size; i++) {
+        if (MPR_NULL != types[i])
+            size = mpr_type_get_size(types[i]);
+    }
+    for (i = 0; i < len; i++)
+        argv[i] = (char*)vals + i * size;
+    handle_update(sig, slot_id, GID, types, argv, len, time);
+    if (argv != argv_stack)
+        free(argv);
+}
+
 /* Add a signal to a parent object. */
 mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
                     mpr_type type, const char *unit, const void *min,
@@ -682,6 +885,7 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
                     int events)
 {
     mpr_graph g;
+    mpr_net net;
     mpr_local_sig lsig;
 
     /* For now we only allow adding signals to devices. */
@@ -694,26 +898,24 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
     TRACE_RETURN_UNLESS(dir == MPR_DIR_IN || dir == MPR_DIR_OUT, 0,
                         "signal direction must be either input or output.\n")
 
-    if ((lsig = (mpr_local_sig)mpr_dev_get_sig_by_name(dev, name)))
-        return (mpr_sig)lsig;
-
     g = mpr_obj_get_graph((mpr_obj)dev);
+    net = mpr_graph_get_net(g);
+    TRACE_RETURN_UNLESS(!mpr_net_lock_dev(net, (mpr_local_dev)dev), 0, "signals cannot be "
+                        "added from the data thread of another device.\n");
 
-    lsig = (mpr_local_sig)mpr_graph_add_obj(g, MPR_SIG, 1);
-    lsig->obj.id = mpr_dev_generate_unique_id(dev);
-    lsig->handler = (void*)h;
-    lsig->event_flags = events;
-    mpr_sig_init((mpr_sig)lsig, dev, 1, dir, name, len, type, unit, min, max, num_inst);
+    if (!(lsig = (mpr_local_sig)mpr_dev_get_sig_by_name(dev, name))) {
+        lsig = (mpr_local_sig)mpr_graph_add_obj(g, MPR_SIG, 1);
+        mpr_obj_set_id((mpr_obj)lsig, mpr_dev_generate_unique_id(dev));
+        lsig->handler = (void*)h;
+        lsig->event_flags = events;
+        mpr_sig_init((mpr_sig)lsig, dev, 1, dir, name, len, type, unit, min, max, num_inst);
 
-    mpr_local_dev_add_sig((mpr_local_dev)dev, lsig, dir);
+        mpr_local_dev_add_sig((mpr_local_dev)dev, lsig, dir);
+    }
+    mpr_net_unlock_dev(net, (mpr_local_dev)dev);
     return (mpr_sig)lsig;
 }
 
-void mpr_local_sig_add_to_net(mpr_local_sig sig, mpr_net net)
-{
-    mpr_net_add_dev_server_method(net, sig->dev, sig->path, mpr_sig_osc_handler, sig);
-}
-
 void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const char *name, int len,
                   mpr_type type, const char *unit, const void *min, const void *max, int *num_inst)
 {
@@ -722,6 +924,7 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
     RETURN_UNLESS(name);
 
     sig->dev = dev;
+    mpr_dev_add_adj_sig(dev, sig);
 
     name = mpr_path_skip_slash(name);
     str_len = strlen(name)+2;
@@ -789,6 +992,7 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
         /* Reserve one instance id map */
         lsig->num_id_maps = 1;
         lsig->id_maps = calloc(1, sizeof(struct _mpr_sig_id_map));
+        lsig->id_maps_by_LID = mpr_hash_new();
     }
     else {
         sig->num_inst = 1;
@@ -807,10 +1011,10 @@ void mpr_sig_free(mpr_sig sig)
     RETURN_UNLESS(sig && sig->obj.is_local);
     ldev = (mpr_local_dev)sig->dev;
     net = mpr_graph_get_net(sig->obj.graph);
+    RETURN_UNLESS(!lock_sig(lsig));
 
-    /* release associated OSC methods */
-    mpr_net_remove_dev_server_method(net, ldev, lsig->path);
-    net = mpr_graph_get_net(sig->obj.graph);
+    /* apply updates queued by other threads that may refer to this signal */
+    mpr_local_dev_recv_updates(ldev, 0);
 
     /* release active instances */
     for (i = 0; i < lsig->num_id_maps; i++) {
@@ -822,16 +1026,21 @@ void mpr_sig_free(mpr_sig sig)
         /* Notify subscribers */
         int dir = (sig->dir == MPR_DIR_IN) ? MPR_SIG_IN : MPR_SIG_OUT;
         char sig_name[BUFFSIZE];
-        NEW_LO_MSG(msg, return);
-        RETURN_UNLESS(mpr_sig_full_name((mpr_sig)lsig, sig_name, BUFFSIZE));
-        mpr_net_use_subscribers(net, ldev, dir);
-        lo_message_add_string(msg, sig_name);
-        mpr_net_add_msg(mpr_graph_get_net(lsig->obj.graph), 0, MSG_SIG_REM, msg);
+        lo_message msg;
+        if (!mpr_sig_full_name((mpr_sig)lsig, sig_name, BUFFSIZE)) {
+            trace("couldn't notify subscribers of removal of signal '%s'.\n", sig->name);
+        }
+        else if ((msg = lo_message_new())) {
+            mpr_net_use_subscribers(net, ldev, dir);
+            lo_message_add_string(msg, sig_name);
+            mpr_net_add_msg(net, 0, MSG_SIG_REM, msg);
+        }
     }
 
     mpr_dev_remove_sig(sig->dev, sig);
     /* mark for removal, but leave final freeing to graph housekeeping routines */
     sig->obj.status |= MPR_STATUS_REMOVED;
+    unlock_sig(lsig);
 }
 
 void mpr_sig_free_internal(mpr_sig sig)
@@ -841,16 +1050,23 @@ void mpr_sig_free_internal(mpr_sig sig)
     if (sig->obj.is_local) {
         mpr_local_sig lsig = (mpr_local_sig)sig;
         free(lsig->id_maps);
+        mpr_hash_free(lsig->id_maps_by_LID);
         for (i = 0; i < lsig->num_inst; i++) {
             free(lsig->inst[i]);
         }
         free(lsig->inst);
         mpr_bitflags_free(lsig->updated_inst);
         mpr_value_free(lsig->value);
+        FUNC_IF(mpr_snapshot_free, lsig->snapshot);
+        FUNC_IF(mpr_snapshot_free, lsig->retired);
 
         FUNC_IF(free, lsig->slots_in);
         FUNC_IF(free, lsig->slots_out);
     }
+    if (sig->dev)
+        mpr_dev_remove_adj_sig(sig->dev, sig);
+    mpr_list_adj_release(&sig->queries);
+    FUNC_IF(free, sig->maps);
 
     mpr_obj_free(&sig->obj);
     FUNC_IF(free, sig->path);
@@ -1021,13 +1237,8 @@ static int get_inst_by_ids(mpr_local_sig lsig, mpr_id *LID, mpr_id *GID)
 
     return -1;
 done:
-    if (LID) {
-        si->id = *LID;
-        /* TODO: we don't really need to use qsort here since the list is already sorted
-         * just need to insert new inst at correct position */
-        /* also we're calling qsort in return */
-        qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
-    }
+    if (LID)
+        _set_inst_id(lsig, si, *LID);
     if (!id_map) {
         /* Claim id map locally */
         id_map = mpr_dev_add_id_map(lsig->dev, lsig->group, si->id, GID ? *GID : 0, 0);
@@ -1129,16 +1340,20 @@ static int mpr_sig_get_id_map_with_LID(mpr_local_sig lsig, mpr_id LID, int flags
                                        uint8_t activate, uint8_t call_handler_on_activate)
 {
     mpr_sig_handler *h;
+    mpr_sig_id_map sig_id_map;
     int i;
 
     if (!lsig->use_inst)
         LID = MPR_DEFAULT_INST_LID;
     h = (mpr_sig_handler*)lsig->handler;
-    for (i = 0; i < lsig->num_id_maps; i++) {
-        mpr_sig_id_map sig_id_map = &lsig->id_maps[i];
-        if (sig_id_map->inst && sig_id_map->id_map && sig_id_map->id_map->LID == LID)
-            return (sig_id_map->status & ~flags) ? -1 : i;
-    }
+    sig_id_map = (mpr_sig_id_map)mpr_hash_get_id(lsig->id_maps_by_LID, LID);
+    if (sig_id_map && (!sig_id_map->inst || sig_id_map->id_map->LID != LID)) {
+        /* the device recycled an id_map still referenced by this signal */
+        _reindex_id_maps(lsig);
+        sig_id_map = (mpr_sig_id_map)mpr_hash_get_id(lsig->id_maps_by_LID, LID);
+    }
+    if (sig_id_map)
+        return (sig_id_map->status & ~flags) ? -1 : sig_id_map - lsig->id_maps;
     RETURN_ARG_UNLESS(activate, -1);
 
     /* No instance with that id exists - need to try to activate instance and
@@ -1282,7 +1497,7 @@ mpr_id_map mpr_local_sig_get_id_map_by_inst_idx(mpr_local_sig sig, unsigned int
 
 static int _reserve_inst(mpr_local_sig lsig, mpr_id *id, void *data)
 {
-    int i, cont;
+    int i, lo, hi;
     mpr_sig_inst si;
     RETURN_ARG_UNLESS(lsig->num_inst < MAX_INST, -1);
 
@@ -1290,36 +1505,38 @@ static int _reserve_inst(mpr_local_sig lsig, mpr_id *id, void *data)
     if (id && _find_inst_by_id(lsig, *id))
         return -1;
 
-    /* reallocate array of instances */
-    lsig->inst = realloc(lsig->inst, sizeof(mpr_sig_inst) * (lsig->num_inst + 1));
-    lsig->inst[lsig->num_inst] = (mpr_sig_inst) calloc(1, sizeof(struct _mpr_sig_inst));
-    si = lsig->inst[lsig->num_inst];
+    si = (mpr_sig_inst) calloc(1, sizeof(struct _mpr_sig_inst));
     si->status = MPR_STATUS_STAGED;
 
     if (id)
         si->id = *id;
     else {
-        /* find lowest unused id */
+        /* find lowest unused id - the instance array is sorted by id */
         mpr_id lowest_id = 0;
-        cont = 1;
-        while (cont) {
-            cont = 0;
-            for (i = 0; i < lsig->num_inst; i++) {
-                if (lsig->inst[i]->id == lowest_id) {
-                    cont = 1;
-                    break;
-                }
-            }
-            lowest_id += cont;
+        for (i = 0; i < lsig->num_inst && lsig->inst[i]->id <= lowest_id; i++) {
+            if (lsig->inst[i]->id == lowest_id)
+                ++lowest_id;
         }
         si->id = lowest_id;
     }
     si->idx = lsig->num_inst;
     si->data = data;
 
+    /* insert the new instance in sorted position */
+    lo = 0;
+    hi = lsig->num_inst;
+    while (lo < hi) {
+        i = (lo + hi) / 2;
+        if (lsig->inst[i]->id < si->id)
+            lo = i + 1;
+        else
+            hi = i;
+    }
+    lsig->inst = realloc(lsig->inst, sizeof(mpr_sig_inst) * (lsig->num_inst + 1));
+    memmove(&lsig->inst[lo + 1], &lsig->inst[lo], sizeof(mpr_sig_inst) * (lsig->num_inst - lo));
+    lsig->inst[lo] = si;
+
     ++lsig->num_inst;
-    /* TODO: move this qsort out to call with multiple ids */
-    qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
     return lsig->num_inst - 1;
 }
 
@@ -1340,9 +1557,11 @@ static void realloc_maps(mpr_local_sig sig, int size)
 
 int mpr_sig_reserve_inst(mpr_sig sig, int num, mpr_id *ids, void **data)
 {
-    int i = 0, count = 0, highest = -1, result, old_num = sig->num_inst;
+    int i = 0, count = 0, highest = -1, result, old_num;
     mpr_local_sig lsig = (mpr_local_sig)sig;
     RETURN_ARG_UNLESS(sig && sig->obj.is_local && num, 0);
+    RETURN_ARG_UNLESS(!lock_sig(lsig), 0);
+    old_num = sig->num_inst;
 
     if (!sig->use_inst && lsig->num_inst == 1 && !lsig->inst[0]->id && !lsig->inst[0]->data) {
         /* we will overwrite the default instance first */
@@ -1365,18 +1584,19 @@ int mpr_sig_reserve_inst(mpr_sig sig, int num, mpr_id *ids, void **data)
         realloc_maps(lsig, highest + 1);
 
     mpr_value_realloc(lsig->value, lsig->len, lsig->type, 1, lsig->num_inst, 0);
+    publish_all(lsig);
 
     mpr_obj_incr_version((mpr_obj)lsig);
 
-    if (old_num > 0 && (lsig->num_inst / 8) == (old_num / 8))
-        return count;
-
-    /* reallocate instance update bitflags */
-    if (!lsig->updated_inst)
-        lsig->updated_inst = mpr_bitflags_new(lsig->num_inst);
-    else {
-        lsig->updated_inst = mpr_bitflags_realloc(lsig->updated_inst, lsig->num_inst);
+    if (old_num <= 0 || (lsig->num_inst / 8) != (old_num / 8)) {
+        /* reallocate instance update bitflags */
+        if (!lsig->updated_inst)
+            lsig->updated_inst = mpr_bitflags_new(lsig->num_inst);
+        else {
+            lsig->updated_inst = mpr_bitflags_realloc(lsig->updated_inst, lsig->num_inst);
+        }
     }
+    unlock_sig(lsig);
     return count;
 }
 
@@ -1436,17 +1656,13 @@ done:
     FUNC_IF(lo_address_free, addr);
 }
 
-void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+void mpr_local_sig_set_value(mpr_local_sig lsig, mpr_id id, int len, mpr_type type,
+                             const void *val)
 {
     mpr_time time;
     int id_map_idx, status = MPR_STATUS_HAS_VALUE | MPR_STATUS_UPDATE_LOC;
-    mpr_local_sig lsig = (mpr_local_sig)sig;
+    mpr_sig sig = (mpr_sig)lsig;
     mpr_sig_inst si;
-    RETURN_UNLESS(sig);
-    if (!sig->obj.is_local) {
-        _mpr_remote_sig_set_value(sig, len, type, val);
-        return;
-    }
     if (!len || !val) {
         mpr_sig_release_inst(sig, id);
         return;
@@ -1486,6 +1702,7 @@ void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const voi
     }
     si->status |= status;
     sig->obj.status |= status;
+    publish_inst(lsig, si);
 
     /* mark instance as updated */
     mpr_local_sig_set_updated(lsig, si->idx);
@@ -1493,16 +1710,59 @@ void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const voi
     process_maps(lsig, id_map_idx);
 }
 
+void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+{
+    mpr_net net;
+    mpr_local_dev dev;
+    RETURN_UNLESS(sig);
+    if (!sig->obj.is_local) {
+        _mpr_remote_sig_set_value(sig, len, type, val);
+        return;
+    }
+    /* the maps may also be processed by a data thread */
+    net = mpr_graph_get_net(sig->obj.graph);
+    dev = (mpr_local_dev)sig->dev;
+    if (mpr_net_lock_dev(net, dev)) {
+        /* called from the data thread of another device */
+        if (mpr_local_dev_queue_update(dev, (mpr_local_sig)sig, id, len, type, val, MPR_NOW))
+            trace("couldn't hand over update of signal '%s'.\n", sig->name);
+        return;
+    }
+    mpr_local_sig_set_value((mpr_local_sig)sig, id, len, type, val);
+    mpr_net_wake_data(net, dev);
+    mpr_net_unlock_dev(net, dev);
+}
+
+int mpr_sig_queue_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val,
+                        mpr_time time)
+{
+    RETURN_ARG_UNLESS(sig && sig->obj.is_local && mpr_type_get_is_num(type), -1);
+    return mpr_local_dev_queue_update((mpr_local_dev)sig->dev, (mpr_local_sig)sig, id, len,
+                                      type, val, time);
+}
+
 void mpr_sig_release_inst(mpr_sig sig, mpr_id id)
 {
     mpr_sig_inst si;
+    mpr_net net;
+    mpr_local_dev dev;
     RETURN_UNLESS(sig && sig->obj.is_local && sig->ephemeral);
+    net = mpr_graph_get_net(sig->obj.graph);
+    dev = (mpr_local_dev)sig->dev;
+    if (mpr_net_lock_dev(net, dev)) {
+        /* called from the data thread of another device */
+        if (mpr_local_dev_queue_update(dev, (mpr_local_sig)sig, id, 0, sig->type, NULL, MPR_NOW))
+            trace("couldn't hand over release of signal '%s'.\n", sig->name);
+        return;
+    }
     si = _find_inst_by_id((mpr_local_sig)sig, id);
     if (si) {
         int id_map_idx = _get_id_map_idx_by_inst_idx((mpr_local_sig)sig, si->idx);
         if (id_map_idx >= 0)
             mpr_sig_release_inst_internal((mpr_local_sig)sig, id_map_idx);
     }
+    mpr_net_wake_data(net, dev);
+    mpr_net_unlock_dev(net, dev);
 }
 
 static void mpr_sig_release_inst_internal(mpr_local_sig lsig, int id_map_idx)
@@ -1518,7 +1778,10 @@ static void mpr_sig_release_inst_internal(mpr_local_sig lsig, int id_map_idx)
 
     time = mpr_dev_get_time((mpr_dev)lsig->dev);
     mpr_value_reset_inst(lsig->value, smap->inst->idx, time);
+    if (lsig->snapshot)
+        mpr_snapshot_clear(lsig->snapshot, smap->inst->idx);
     process_maps(lsig, id_map_idx);
+    _unindex_id_map(lsig, id_map_idx);
     if (smap->id_map && mpr_dev_LID_decref((mpr_local_dev)lsig->dev, lsig->group, smap->id_map)) {
         smap->id_map = 0;
     }
@@ -1565,11 +1828,15 @@ void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
     int i, remove_idx;
     mpr_local_sig lsig = (mpr_local_sig)sig;
     RETURN_UNLESS(sig && sig->obj.is_local && sig->use_inst);
+    RETURN_UNLESS(!lock_sig(lsig));
     for (i = 0; i < lsig->num_inst; i++) {
         if (lsig->inst[i]->id == id)
             break;
     }
-    RETURN_UNLESS(i < lsig->num_inst);
+    if (i >= lsig->num_inst) {
+        unlock_sig(lsig);
+        return;
+    }
 
     if (lsig->inst[i]->status & MPR_STATUS_ACTIVE) {
        /* First release instance */
@@ -1598,7 +1865,9 @@ void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
         if (lsig->inst[i]->idx > remove_idx)
             --lsig->inst[i]->idx;
     }
+    publish_all(lsig);
     mpr_obj_incr_version((mpr_obj)sig);
+    unlock_sig(lsig);
 }
 
 const void *mpr_sig_get_value(mpr_sig sig, mpr_id id, mpr_time *time)
@@ -1625,6 +1894,48 @@ const void *mpr_sig_get_value(mpr_sig sig, mpr_id id, mpr_time *time)
     return mpr_value_get_value(lsig->value, si->idx, 0);
 }
 
+int mpr_sig_set_snapshot(mpr_sig sig, int enable)
+{
+    mpr_local_sig lsig = (mpr_local_sig)sig;
+    mpr_net net;
+    RETURN_ARG_UNLESS(sig && sig->obj.is_local, -1);
+    net = mpr_graph_get_net(sig->obj.graph);
+    mpr_net_lock(net);
+    if (enable && !lsig->snapshot) {
+        /* readers may still hold a previously disabled snapshot so it is reused, never freed */
+        mpr_snapshot snap = lsig->retired;
+        if (!snap)
+            snap = mpr_snapshot_new(lsig->num_inst, lsig->len, lsig->type);
+        lsig->retired = 0;
+        mpr_atomic_store_ptr(&lsig->snapshot, snap);
+        publish_all(lsig);
+    }
+    else if (!enable && lsig->snapshot) {
+        lsig->retired = lsig->snapshot;
+        mpr_atomic_store_ptr(&lsig->snapshot, 0);
+    }
+    mpr_net_unlock(net);
+    return 0;
+}
+
+int mpr_sig_read_snapshot(mpr_sig sig, mpr_id id, void *value, mpr_time *time)
+{
+    mpr_snapshot snap;
+    RETURN_ARG_UNLESS(sig && sig->obj.is_local && value, 0);
+    snap = mpr_atomic_load_ptr(&((mpr_local_sig)sig)->snapshot);
+    RETURN_ARG_UNLESS(snap, 0);
+    return mpr_snapshot_read(snap, sig->use_inst ? &id : NULL, value, time);
+}
+
+int mpr_sig_read_snapshots(mpr_sig sig, int num, mpr_id *ids, void *values, mpr_time *times)
+{
+    mpr_snapshot snap;
+    RETURN_ARG_UNLESS(sig && sig->obj.is_local && num > 0 && ids && values, 0);
+    snap = mpr_atomic_load_ptr(&((mpr_local_sig)sig)->snapshot);
+    RETURN_ARG_UNLESS(snap, 0);
+    return mpr_snapshot_read_all(snap, num, ids, values, times);
+}
+
 int mpr_sig_get_num_inst_internal(mpr_sig sig)
 {
     return sig->num_inst;
@@ -1677,8 +1988,10 @@ int mpr_sig_activate_inst(mpr_sig sig, mpr_id id)
     int id_map_idx;
     mpr_time time;
     RETURN_ARG_UNLESS(sig && sig->obj.is_local && sig->use_inst, 0);
+    RETURN_ARG_UNLESS(!lock_sig((mpr_local_sig)sig), 0);
     time = mpr_dev_get_time(sig->dev);
     id_map_idx = mpr_sig_get_id_map_with_LID((mpr_local_sig)sig, id, 0, time, 1, 0);
+    unlock_sig((mpr_local_sig)sig);
     return id_map_idx >= 0;
 }
 
@@ -1686,9 +1999,11 @@ void mpr_sig_set_inst_data(mpr_sig sig, mpr_id id, const void *data)
 {
     mpr_sig_inst si;
     RETURN_UNLESS(sig && sig->obj.is_local && sig->use_inst);
+    RETURN_UNLESS(!lock_sig((mpr_local_sig)sig));
     si = _find_inst_by_id((mpr_local_sig)sig, id);
     if (si)
         si->data = (void*)data;
+    unlock_sig((mpr_local_sig)sig);
 }
 
 void *mpr_sig_get_inst_data(mpr_sig sig, mpr_id id)
@@ -1724,8 +2039,10 @@ void mpr_sig_set_cb(mpr_sig sig, mpr_sig_handler *h, int events)
 {
     mpr_local_sig lsig = (mpr_local_sig)sig;
     RETURN_UNLESS(sig && sig->obj.is_local);
+    RETURN_UNLESS(!lock_sig(lsig));
     lsig->handler = (void*)h;
     lsig->event_flags = events;
+    unlock_sig(lsig);
 }
 
 /**** Signal Properties ****/
@@ -1761,7 +2078,26 @@ static int cmp_qry_maps(const void *context_data, mpr_map map)
 mpr_list mpr_sig_get_maps(mpr_sig sig, mpr_dir dir)
 {
     RETURN_ARG_UNLESS(sig, 0);
-    return mpr_graph_new_query(sig->obj.graph, 1, MPR_MAP, (void*)cmp_qry_maps, "vi", &sig, dir);
+    return mpr_graph_new_adj_query(sig->obj.graph, 1, MPR_MAP, &sig->maps, &sig->num_maps,
+                                   &sig->queries, (void*)cmp_qry_maps, "vi", &sig, dir);
+}
+
+void mpr_sig_add_adj_map(mpr_sig sig, mpr_map map)
+{
+    mpr_list_adj_add((void***)&sig->maps, &sig->num_maps, map);
+    mpr_dev_add_adj_map(sig->dev, map);
+}
+
+void mpr_sig_remove_adj_map(mpr_sig sig, mpr_map map)
+{
+    mpr_list_adj_remove((void***)&sig->maps, &sig->num_maps, map);
+    if (sig->dev)
+        mpr_dev_remove_adj_map(sig->dev, map);
+}
+
+void mpr_sig_clear_dev(mpr_sig sig)
+{
+    sig->dev = 0;
 }
 
 static int _init_and_add_id_map(mpr_local_sig lsig, mpr_sig_inst si,
@@ -1790,14 +2126,16 @@ static int _init_and_add_id_map(mpr_local_sig lsig, mpr_sig_inst si,
         lsig->num_id_maps = lsig->num_id_maps ? lsig->num_id_maps * 2 : 1;
         lsig->id_maps = realloc(lsig->id_maps, (lsig->num_id_maps * sizeof(struct _mpr_sig_id_map)));
         memset(lsig->id_maps + i, 0, ((lsig->num_id_maps - i) * sizeof(struct _mpr_sig_id_map)));
+
+        /* entries have moved - rebuild the LID index */
+        _reindex_id_maps(lsig);
     }
     lsig->id_maps[i].id_map = id_map;
     lsig->id_maps[i].inst = si;
     lsig->id_maps[i].status = 0;
+    _index_id_map(lsig, i);
 
-    si->id = id_map->LID;
-    /* same comment wrt qsort here */
-    qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
+    _set_inst_id(lsig, si, id_map->LID);
 
     /* return id_map index */
     return i;
@@ -1882,7 +2220,7 @@ int mpr_sig_set_from_msg(mpr_sig sig, mpr_msg msg)
             case MPR_PROP_ID:
                 if (types[0] == 'h') {
                     if (sig->obj.id != (vals[0])->i64) {
-                        sig->obj.id = (vals[0])->i64;
+                        mpr_obj_set_id((mpr_obj)sig, (vals[0])->i64);
                         ++updated;
                     }
                 }
@@ -1944,6 +2282,16 @@ const char *mpr_sig_get_path(mpr_sig sig)
     return sig->path;
 }
 
+int mpr_sig_get_alias(mpr_sig sig)
+{
+    return sig->alias;
+}
+
+void mpr_sig_set_alias(mpr_sig sig, int alias)
+{
+    sig->alias = alias;
+}
+
 int mpr_sig_get_full_name(mpr_sig sig, char *name, int len)
 {
     return snprintf(name, len, "%s/%s", mpr_dev_get_name(sig->dev), sig->name);
@@ -1971,7 +2319,7 @@ void mpr_sig_copy_props(mpr_sig to, mpr_sig from)
 {
     mpr_dev dev = to->dev;
     if (!to->obj.id) {
-        to->obj.id = from->obj.id;
+        mpr_obj_set_id((mpr_obj)to, from->obj.id);
         to->dir = from->dir;
         to->len = from->len;
         to->type = from->type;
@@ -2031,7 +2379,8 @@ void mpr_local_sig_set_inst_value(mpr_local_sig sig, const void *value, int inst
                     /* instance was released in previous handler call */
                     assert(map_manages_inst);
                     /* try to re-activate with a new GID */
-                    id_map->GID = mpr_dev_generate_unique_id((mpr_dev)sig->dev);
+                    mpr_dev_set_id_map_GID(sig->dev, sig->group, id_map,
+                                           mpr_dev_generate_unique_id((mpr_dev)sig->dev));
                     id_map_idx = mpr_sig_get_id_map_with_GID(sig, id_map->GID, RELEASED_LOCALLY, time, 1);
                     if (id_map_idx < 0) {
                         trace("error: couldn't find id_map for signal instance idx %d (3)\n", id_map_idx);
@@ -2045,6 +2394,7 @@ void mpr_local_sig_set_inst_value(mpr_local_sig sig, const void *value, int inst
                     si->status |= MPR_STATUS_NEW_VALUE;
                 mpr_value_set_next(sig->value, si->idx, value, time);
                 sig->obj.status |= si->status;
+                publish_inst(sig, si);
                 mpr_bitflags_unset(sig->updated_inst, si->idx);
                 mpr_sig_call_handler(sig, MPR_STATUS_UPDATE_REM, si->id, si->idx);
 
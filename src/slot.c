@@ -22,7 +22,7 @@
 #define MPR_SLOT_STRUCT_ITEMS                                                   \
     mpr_sig sig;                    /*!< Pointer to parent signal */            \
     int id;                                                                     \
-    uint8_t num_inst;                                                           \
+    uint16_t num_inst;                                                          \
     char dir;                       /*!< `DI_INCOMING` or `DI_OUTGOING` */      \
     char causes_update;             /*!< 1 if causes update, 0 otherwise. */    \
     char is_local;
@@ -40,9 +40,21 @@ typedef struct _mpr_local_slot {
     mpr_value val;                  /*!< Value histories for each signal instance. */
     mpr_link link;
     lo_message msg;
+    char alias_path[24];            /*!< Path of `msg` if it is aliased, or empty. */
+
+    /* typed updates used instead of `msg` when the link is local-only */
+    struct {
+        mpr_id *GIDs;               /*!< Instance GID for each update, or 0. */
+        mpr_type *types;            /*!< Element types for each update. */
+        char *vals;                 /*!< Element values for each update. */
+        int num;
+        int size;
+    } updates;
+
     uint16_t num_msg;
     uint8_t sending;
     uint8_t is_used;
+    uint8_t direct;                 /*!< 1 if updates are delivered in-process. */
 } mpr_local_slot_t;
 
 mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, mpr_dir dir,
@@ -54,6 +66,7 @@ mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, mpr_dir dir,
     mpr_slot slot = (mpr_slot)calloc(1, size);
     slot->map = map;
     slot->sig = sig;
+    mpr_sig_add_adj_map(sig, map);
     slot->is_local = is_local ? 1 : 0;
     slot->num_inst = num_inst > 1 ? num_inst : 1;
     if (MPR_DIR_UNDEFINED == dir)
@@ -95,12 +108,21 @@ void mpr_slot_set_map_ptr(mpr_slot slot, mpr_map map)
 
 void mpr_slot_free(mpr_slot slot)
 {
+    mpr_sig_remove_adj_map(slot->sig, slot->map);
     if (slot->is_local) {
         mpr_local_slot lslot = (mpr_local_slot)slot;
         FUNC_IF(mpr_value_free, lslot->val);
         if (mpr_obj_get_is_local((mpr_obj)slot->sig))
             mpr_local_sig_remove_slot((mpr_local_sig)slot->sig, lslot, lslot->dir);
-        if (lslot->sending) {
+        if (lslot->direct) {
+            if (lslot->sending)
+                mpr_link_remove_slot_updates(lslot->link, lslot);
+            FUNC_IF(free, lslot->updates.GIDs);
+            FUNC_IF(free, lslot->updates.types);
+            FUNC_IF(free, lslot->updates.vals);
+            lo_message_free(lslot->msg);
+        }
+        else if (lslot->sending) {
             /* message has already been added to a bundle */
             lo_message_decref(lslot->msg);
         }
@@ -118,13 +140,24 @@ MPR_INLINE static int slot_mask(mpr_slot slot)
 
 int mpr_slot_set_from_msg(mpr_slot slot, mpr_msg msg)
 {
-    int updated = 0, mask;
+    int i, updated = 0, mask;
     mpr_msg_atom a;
     mpr_tbl tbl;
     RETURN_ARG_UNLESS(slot && !mpr_slot_get_sig_if_local(slot), 0);
     mask = slot_mask(slot);
     tbl = mpr_obj_get_prop_tbl((mpr_obj)slot->sig);
 
+    /* the alias assigned to the signal by its device is sent as a non-standard slot property */
+    for (i = 0; i < mpr_msg_get_num_atoms(msg); i++) {
+        a = mpr_msg_get_atom(msg, i);
+        if (   (MPR_PROP_EXTRA | mask) == mpr_msg_atom_get_prop(a)
+            && !strcmp(mpr_msg_atom_get_key(a), "alias")
+            && 1 == mpr_msg_atom_get_len(a) && MPR_INT32 == mpr_msg_atom_get_types(a)[0]) {
+            mpr_sig_set_alias(slot->sig, mpr_msg_atom_get_values(a)[0]->i32);
+            break;
+        }
+    }
+
     a = mpr_msg_get_prop(msg, MPR_PROP_LEN | mask);
     if (a) {
         mpr_prop prop = mpr_msg_atom_get_prop(a);
@@ -196,6 +229,13 @@ void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dst)
         snprintf(temp+len, 32-len, "%s", mpr_prop_as_str(MPR_PROP_NUM_INST, 0));
         lo_message_add_string(msg, temp);
         lo_message_add_int32(msg, slot->num_inst);
+
+        /* include alias for addressing data messages to the signal */
+        if (mpr_sig_get_alias(slot->sig)) {
+            snprintf(temp+len, 32-len, "@alias");
+            lo_message_add_string(msg, temp);
+            lo_message_add_int32(msg, mpr_sig_get_alias(slot->sig));
+        }
     }
 }
 
@@ -303,6 +343,7 @@ mpr_link mpr_slot_get_link(mpr_slot slot)
 void mpr_local_slot_set_link(mpr_local_slot slot, mpr_link link)
 {
     slot->link = link;
+    slot->direct = link && mpr_link_get_is_local_only(link);
 }
 
 mpr_map mpr_slot_get_map(mpr_slot slot)
@@ -398,18 +439,77 @@ int mpr_slot_get_status(mpr_local_slot slot)
     return status;
 }
 
-void mpr_local_slot_send_msg(mpr_local_slot slot, lo_message msg, mpr_time time, mpr_proto proto)
+/* The signal receiving the messages built by a slot: messages built by source slots of local
+ * signals are forwarded to the map destination, others are sent to the slot's own signal. */
+static mpr_sig get_msg_target(mpr_local_slot slot)
 {
-    if (slot->link) {
-        if (!msg) {
-            if (slot->num_msg > 0 && !slot->sending) {
-                msg = slot->msg;
-                slot->sending = 1;
-            }
-            else
-                return;
-        }
-        mpr_link_add_msg(slot->link, mpr_sig_get_path((mpr_sig)slot->sig), msg, time, proto);
+    if (mpr_obj_get_is_local((mpr_obj)slot->sig))
+        return mpr_slot_get_sig(mpr_map_get_dst_slot((mpr_map)slot->map));
+    return slot->sig;
+}
+
+MPR_INLINE static const char *get_msg_path(mpr_local_slot slot)
+{
+    return slot->alias_path[0] ? slot->alias_path : mpr_sig_get_path(get_msg_target(slot));
+}
+
+void mpr_local_slot_send_msg(mpr_local_slot slot, mpr_local_slot src, mpr_time time,
+                             mpr_proto proto)
+{
+    RETURN_UNLESS(slot->link);
+    if (src) {
+        /* forward the message prepared by another slot of the same map */
+        lo_message msg = mpr_slot_get_msg(src);
+        if (msg)
+            mpr_link_add_msg(slot->link, get_msg_path(src), msg, time, proto);
+        return;
+    }
+    RETURN_UNLESS(slot->num_msg > 0 && !slot->sending);
+    slot->sending = 1;
+    if (slot->direct)
+        mpr_link_add_slot_updates(slot->link, slot, time, proto);
+    else
+        mpr_link_add_msg(slot->link, get_msg_path(slot), slot->msg, time, proto);
+}
+
+void mpr_local_slot_deliver(mpr_local_slot slot, mpr_time time)
+{
+    mpr_local_sig sig = (mpr_local_sig)slot->sig;
+    int i, len, size, slot_id;
+
+    if (!slot->direct) {
+        lo_message msg = mpr_slot_get_msg(slot);
+        RETURN_UNLESS(msg);
+        mpr_sig_osc_handler(NULL, lo_message_get_types(msg), lo_message_get_argv(msg),
+                            lo_message_get_argc(msg), msg, (void*)sig);
+        return;
+    }
+
+    /* destination slots have id: -1 */
+    slot_id = (MPR_DIR_OUT == slot->dir && slot->id >= 0) ? slot->id : -1;
+    len = mpr_sig_get_len(slot->sig);
+    size = mpr_type_get_size(mpr_sig_get_type(slot->sig));
+    for (i = 0; i < slot->updates.num; i++) {
+        mpr_local_sig_handle_update(sig, slot_id, slot->updates.GIDs[i], len,
+                                    slot->updates.types + i * len,
+                                    slot->updates.vals + i * len * size, time);
+    }
+}
+
+void mpr_local_slot_handoff(mpr_local_slot slot, mpr_time time)
+{
+    mpr_local_sig sig = (mpr_local_sig)slot->sig;
+    mpr_local_dev dev = (mpr_local_dev)mpr_sig_get_dev(slot->sig);
+    int i, len, size, slot_id;
+
+    /* destination slots have id: -1 */
+    slot_id = (MPR_DIR_OUT == slot->dir && slot->id >= 0) ? slot->id : -1;
+    len = mpr_sig_get_len(slot->sig);
+    size = mpr_type_get_size(mpr_sig_get_type(slot->sig));
+    for (i = 0; i < slot->updates.num; i++) {
+        mpr_local_dev_queue_slot_update(dev, sig, slot_id, slot->updates.GIDs[i], len,
+                                        slot->updates.types + i * len,
+                                        slot->updates.vals + i * len * size, time);
     }
 }
 
@@ -434,27 +534,87 @@ lo_address mpr_slot_get_addr(mpr_slot slot)
 
 void mpr_slot_clear_msg(mpr_local_slot slot)
 {
+    mpr_sig target;
+    int alias, slot_id;
+
     /* run if slot has msg or is uninitialized (num_msg == -1) */
     RETURN_UNLESS(slot->num_msg);
 
+    if (slot->direct) {
+        slot->updates.num = 0;
+        slot->num_msg = slot->sending = 0;
+        return;
+    }
+
     lo_message_clear(slot->msg);
     /* destination slots have id: -1 */
-    if (MPR_DIR_OUT == slot->dir && slot->id >= 0) {
-        /* add slot id to msg */
-        lo_message_add_string(slot->msg, "@sl");
-        lo_message_add_int32(slot->msg, slot->id);
+    slot_id = (MPR_DIR_OUT == slot->dir && slot->id >= 0) ? slot->id : -1;
+    target = get_msg_target(slot);
+    alias = mpr_obj_get_is_local((mpr_obj)target) ? 0 : mpr_sig_get_alias(target);
+    if (alias) {
+        /* address the remote signal and slot by alias instead of adding property keys */
+        if (slot_id >= 0)
+            snprintf(slot->alias_path, sizeof(slot->alias_path), "/@%d.%d", alias, slot_id);
+        else
+            snprintf(slot->alias_path, sizeof(slot->alias_path), "/@%d", alias);
+    }
+    else {
+        slot->alias_path[0] = 0;
+        if (slot_id >= 0) {
+            /* add slot id to msg */
+            lo_message_add_string(slot->msg, "@sl");
+            lo_message_add_int32(slot->msg, slot->id);
+        }
     }
     slot->num_msg = slot->sending = 0;
 }
 
+static void build_update(mpr_local_slot slot, mpr_value val, unsigned int idx, mpr_id_map id_map)
+{
+    int i, len = mpr_sig_get_len(slot->sig);
+    mpr_type type = mpr_sig_get_type(slot->sig), *types;
+    size_t size = mpr_type_get_size(type);
+
+    if (slot->updates.num >= slot->updates.size) {
+        slot->updates.size = slot->updates.size ? slot->updates.size * 2 : 2;
+        slot->updates.GIDs = realloc(slot->updates.GIDs, slot->updates.size * sizeof(mpr_id));
+        slot->updates.types = realloc(slot->updates.types, slot->updates.size * len);
+        slot->updates.vals = realloc(slot->updates.vals, slot->updates.size * len * size);
+    }
+    types = slot->updates.types + slot->updates.num * len;
+
+    if (val) {
+        assert(mpr_value_get_vlen(val) == len && mpr_value_get_type(val) == type);
+        /* instances without a value are skipped, matching mpr_value_add_to_msg() */
+        RETURN_UNLESS(mpr_value_cpy_typed(val, idx, types,
+                                          slot->updates.vals + slot->updates.num * len * size));
+    }
+    else {
+        for (i = 0; i < len; i++)
+            types[i] = MPR_NULL;
+    }
+    slot->updates.GIDs[slot->updates.num++] = id_map ? id_map->GID : 0;
+}
+
 void mpr_slot_build_msg(mpr_local_slot slot, mpr_value val, unsigned int idx, mpr_id_map id_map)
 {
     int i;
     lo_message msg = slot->msg;
 
+    /* the map must be processed for the message to be sent */
+    mpr_local_map_enqueue(slot->map);
+
+    if (slot->direct) {
+        /* bypass serialization for in-process delivery */
+        build_update(slot, val, idx, id_map);
+        ++slot->num_msg;
+        return;
+    }
+
     if (id_map) {
-        /* add instance GID */
-        lo_message_add_string(msg, "@in");
+        /* add instance GID, preceded by a property key unless the message is aliased */
+        if (!slot->alias_path[0])
+            lo_message_add_string(msg, "@in");
         lo_message_add_int64(msg, id_map->GID);
     }
 
@@ -69,7 +69,25 @@ mpr_value mpr_slot_get_value(mpr_local_slot slot);
 
 int mpr_slot_set_value(mpr_local_slot slot, unsigned int inst_idx, const void *value, mpr_time time);
 
-void mpr_local_slot_send_msg(mpr_local_slot slot, lo_message msg, mpr_time time, mpr_proto proto);
+/*! Add the pending message of a slot to the bundle of its link.
+ *  \param slot     The slot whose link is used.
+ *  \param src      Another slot of the same map whose message should be forwarded instead, or
+ *                  NULL to send the message of `slot`.
+ *  \param time     Timetag of the message.
+ *  \param proto    The protocol to use. */
+void mpr_local_slot_send_msg(mpr_local_slot slot, mpr_local_slot src, mpr_time time,
+                             mpr_proto proto);
+
+/*! Deliver the pending updates of a slot directly to its local signal.
+ *  \param slot     The slot holding the updates. Its signal must be local.
+ *  \param time     Timetag of the updates. */
+void mpr_local_slot_deliver(mpr_local_slot slot, mpr_time time);
+
+/*! Hand the pending updates of a slot over to the data thread servicing the device of its local
+ *  signal, for slots on local-only links between devices serviced by different threads.
+ *  \param slot     The slot holding the updates. Its signal must be local.
+ *  \param time     Timetag of the updates. */
+void mpr_local_slot_handoff(mpr_local_slot slot, mpr_time time);
 
 int mpr_slot_compare_names(mpr_slot l, mpr_slot r);
 
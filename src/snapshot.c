@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "mpr_atomic.h"
+#include "mpr_debug.h"
+
+/* Each slot is a header followed by the value, padded to 8 bytes. */
+typedef struct _mpr_snapshot_slot {
+    volatile uint32_t seq;              /*!< Odd while the slot is being written. */
+    uint32_t active;
+    mpr_id id;
+    mpr_time time;
+} mpr_snapshot_slot_t, *mpr_snapshot_slot;
+
+typedef struct _mpr_snapshot {
+    struct _mpr_snapshot *replaced;     /*!< Older snapshot that readers may still hold. */
+    char *slots;
+    size_t size;                        /*!< Size of a value in bytes. */
+    size_t stride;
+    unsigned int num_inst;
+} mpr_snapshot_t;
+
+#define SLOT(S, IDX) ((mpr_snapshot_slot)((S)->slots + (IDX) * (S)->stride))
+
+mpr_snapshot mpr_snapshot_new(unsigned int num_inst, unsigned int vlen, mpr_type type)
+{
+    mpr_snapshot snap = (mpr_snapshot)calloc(1, sizeof(mpr_snapshot_t));
+    snap->size = vlen * mpr_type_get_size(type);
+    snap->stride = sizeof(mpr_snapshot_slot_t) + ((snap->size + 7) & ~7);
+    snap->num_inst = num_inst;
+    snap->slots = (char*)calloc(num_inst ? num_inst : 1, snap->stride);
+    return snap;
+}
+
+mpr_snapshot mpr_snapshot_grow(mpr_snapshot snap, unsigned int num_inst)
+{
+    mpr_snapshot grown;
+    RETURN_ARG_UNLESS(num_inst > snap->num_inst, snap);
+    grown = (mpr_snapshot)calloc(1, sizeof(mpr_snapshot_t));
+    grown->size = snap->size;
+    grown->stride = snap->stride;
+    grown->num_inst = num_inst;
+    grown->slots = (char*)calloc(num_inst, snap->stride);
+    /* only the writer calls this, so the slots are not being modified */
+    memcpy(grown->slots, snap->slots, snap->num_inst * snap->stride);
+    grown->replaced = snap;
+    return grown;
+}
+
+void mpr_snapshot_free(mpr_snapshot snap)
+{
+    while (snap) {
+        mpr_snapshot replaced = snap->replaced;
+        free(snap->slots);
+        free(snap);
+        snap = replaced;
+    }
+}
+
+unsigned int mpr_snapshot_get_num_inst(mpr_snapshot snap)
+{
+    return snap->num_inst;
+}
+
+void mpr_snapshot_write(mpr_snapshot snap, unsigned int idx, mpr_id id, const void *val,
+                        mpr_time time)
+{
+    mpr_snapshot_slot slot;
+    RETURN_UNLESS(idx < snap->num_inst);
+    slot = SLOT(snap, idx);
+    mpr_atomic_store(&slot->seq, slot->seq + 1);
+    /* order the odd sequence number before the contents */
+    mpr_atomic_fence();
+    slot->active = 1;
+    slot->id = id;
+    slot->time = time;
+    memcpy(slot + 1, val, snap->size);
+    mpr_atomic_store(&slot->seq, slot->seq + 1);
+}
+
+void mpr_snapshot_clear(mpr_snapshot snap, unsigned int idx)
+{
+    mpr_snapshot_slot slot;
+    RETURN_UNLESS(idx < snap->num_inst && SLOT(snap, idx)->active);
+    slot = SLOT(snap, idx);
+    mpr_atomic_store(&slot->seq, slot->seq + 1);
+    mpr_atomic_fence();
+    slot->active = 0;
+    mpr_atomic_store(&slot->seq, slot->seq + 1);
+}
+
+/* Copy a slot, retrying while it is modified. Returns 1 if the slot was active and, if `id` is
+ * given, holds that instance. */
+static int read_slot(mpr_snapshot snap, unsigned int idx, mpr_id *id, mpr_id *id_out,
+                     void *val, mpr_time *time)
+{
+    mpr_snapshot_slot slot = SLOT(snap, idx);
+    uint32_t seq;
+    int found;
+    do {
+        while ((seq = mpr_atomic_load(&slot->seq)) & 1) {}
+        found = slot->active && (!id || slot->id == *id);
+        if (found) {
+            if (id_out)
+                *id_out = slot->id;
+            if (time)
+                *time = slot->time;
+            memcpy(val, slot + 1, snap->size);
+        }
+        /* order the copies before checking the sequence number again */
+        mpr_atomic_fence();
+    } while (mpr_atomic_load(&slot->seq) != seq);
+    return found;
+}
+
+int mpr_snapshot_read(mpr_snapshot snap, mpr_id *id, void *val, mpr_time *time)
+{
+    unsigned int i;
+    if (!id)
+        return snap->num_inst ? read_slot(snap, 0, 0, 0, val, time) : 0;
+    for (i = 0; i < snap->num_inst; i++) {
+        if (read_slot(snap, i, id, 0, val, time))
+            return 1;
+    }
+    return 0;
+}
+
+int mpr_snapshot_read_all(mpr_snapshot snap, int num, mpr_id *ids, void *vals, mpr_time *times)
+{
+    unsigned int i;
+    int count = 0;
+    for (i = 0; i < snap->num_inst && count < num; i++) {
+        count += read_slot(snap, i, 0, &ids[count], (char*)vals + count * snap->size,
+                           times ? &times[count] : 0);
+    }
+    return count;
+}
@@ -0,0 +1,62 @@
+#ifndef __MPR_SNAPSHOT_H__
+#define __MPR_SNAPSHOT_H__
+
+#include "id.h"
+#include "mpr_time.h"
+#include "mpr_type.h"
+
+/*! A copy of the latest value of each instance of a signal that can be read from any thread.
+ *  Each instance slot is protected by a sequence lock: the single writer makes the sequence
+ *  number odd while it updates a slot, and readers retry until they copy a slot without the
+ *  sequence number changing, so neither side ever blocks. */
+typedef struct _mpr_snapshot *mpr_snapshot;
+
+/*! Create a snapshot with room for a number of instances.
+ *  \param num_inst     The number of instance slots.
+ *  \param vlen         The vector length of the signal.
+ *  \param type         The data type of the signal.
+ *  \return             The new snapshot. */
+mpr_snapshot mpr_snapshot_new(unsigned int num_inst, unsigned int vlen, mpr_type type);
+
+/*! Create a larger copy of a snapshot. Readers may still hold the old snapshot, so it is kept
+ *  until the new one is freed.
+ *  \param snap         The snapshot to copy.
+ *  \param num_inst     The new number of instance slots.
+ *  \return             The new snapshot. */
+mpr_snapshot mpr_snapshot_grow(mpr_snapshot snap, unsigned int num_inst);
+
+/*! Free a snapshot along with any snapshots it replaced. No reader may be using them. */
+void mpr_snapshot_free(mpr_snapshot snap);
+
+unsigned int mpr_snapshot_get_num_inst(mpr_snapshot snap);
+
+/*! Publish the value of an instance. Must only be called by the writer.
+ *  \param snap         The snapshot to update.
+ *  \param idx          The instance slot.
+ *  \param id           The instance id.
+ *  \param val          The value, of the vector length and type of the snapshot.
+ *  \param time         The time of the value. */
+void mpr_snapshot_write(mpr_snapshot snap, unsigned int idx, mpr_id id, const void *val,
+                        mpr_time time);
+
+/*! Mark an instance slot as inactive. Must only be called by the writer. */
+void mpr_snapshot_clear(mpr_snapshot snap, unsigned int idx);
+
+/*! Copy the value of an instance. May be called from any thread.
+ *  \param snap         The snapshot to read.
+ *  \param id           The instance id, or NULL to read the first slot.
+ *  \param val          Storage for the value.
+ *  \param time         Storage for the time of the value, or NULL.
+ *  \return             1 if the instance has a value, 0 otherwise. */
+int mpr_snapshot_read(mpr_snapshot snap, mpr_id *id, void *val, mpr_time *time);
+
+/*! Copy the values of all active instances. May be called from any thread.
+ *  \param snap         The snapshot to read.
+ *  \param num          The maximum number of instances to copy.
+ *  \param ids          Storage for `num` instance ids.
+ *  \param vals         Storage for `num` values.
+ *  \param times        Storage for `num` times, or NULL.
+ *  \return             The number of instances copied. */
+int mpr_snapshot_read_all(mpr_snapshot snap, int num, mpr_id *ids, void *vals, mpr_time *times);
+
+#endif /* __MPR_SNAPSHOT_H__ */
@@ -3,7 +3,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "hash.h"
 #include "list.h"
+#include "mpr_atomic.h"
 #include "mpr_type.h"
 #include "path.h"
 #include "property.h"
@@ -13,8 +15,6 @@
 #include "table.h"
 #include <mapper/mapper.h>
 
-#define MPR_TBL_MAX_RECORDS 128
-
 /*! Used to hold look-up table records. */
 typedef struct _mpr_tbl_record {
     const char *key;
@@ -25,29 +25,38 @@ typedef struct _mpr_tbl_record {
     mpr_type type;
 } mpr_tbl_record_t;
 
-/*! Used to hold look-up tables. */
+/*! Used to hold look-up tables. Records keep the position they were added at until removed
+ *  records are cleared, so they can be indexed by position. */
 typedef struct _mpr_tbl {
     mpr_tbl_record rec;
+    int *order;         /*!< Record positions, with indexed records sorted before keyed records. */
+    mpr_hash keys;      /*!< Positions + 1 of keyed records by key, created when first needed. */
     int count;
     int alloced;
+    int num_wild;       /*!< Number of keyed records with wildcards in their keys. */
     char dirty;
+    int prop_pos[MPR_TBL_NUM_PROP_IDX]; /*!< Positions + 1 of indexed records, or 0. */
+    uint32_t *changes;  /*!< Change counters by property index, or NULL. */
 } mpr_tbl_t;
 
+MPR_INLINE static void count_change(mpr_tbl t, mpr_prop prop)
+{
+    if (t->changes)
+        mpr_atomic_incr(&t->changes[PROP_TO_INDEX(prop)]);
+}
+
+static const char *skip_at(const char *key)
+{
+    return key ? key + ('@' == key[0]) : "";
+}
+
 /* we will sort so that indexed records come before keyed records */
-static int compare_rec(const void *l, const void *r)
+static int compare_rec(mpr_tbl_record rec_l, mpr_tbl_record rec_r)
 {
-    mpr_tbl_record rec_l = (mpr_tbl_record)l;
-    mpr_tbl_record rec_r = (mpr_tbl_record)r;
     int idx_l = MASK_PROP_BITFLAGS(rec_l->prop);
     int idx_r = MASK_PROP_BITFLAGS(rec_r->prop);
-    if ((idx_l == MPR_PROP_EXTRA) && (idx_r == MPR_PROP_EXTRA)) {
-        const char *str_l = rec_l->key, *str_r = rec_r->key;
-        if (str_l[0] == '@')
-            ++str_l;
-        if (str_r[0] == '@')
-            ++str_r;
-        return mpr_path_match(str_l, str_r);
-    }
+    if ((idx_l == MPR_PROP_EXTRA) && (idx_r == MPR_PROP_EXTRA))
+        return strcmp(skip_at(rec_l->key), skip_at(rec_r->key));
     if (idx_l == MPR_PROP_EXTRA)
         return 1;
     if (idx_r == MPR_PROP_EXTRA)
@@ -55,9 +64,44 @@ static int compare_rec(const void *l, const void *r)
     return idx_l - idx_r;
 }
 
-void mpr_tbl_sort(mpr_tbl t)
+static void index_record(mpr_tbl t, int pos)
 {
-    qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
+    mpr_tbl_record rec = &t->rec[pos];
+    if (MPR_PROP_EXTRA != MASK_PROP_BITFLAGS(rec->prop)) {
+        t->prop_pos[PROP_TO_INDEX(rec->prop)] = pos + 1;
+        return;
+    }
+    if (!t->keys)
+        t->keys = mpr_hash_new();
+    mpr_hash_add_str(t->keys, skip_at(rec->key), (void*)(intptr_t)(pos + 1));
+    if (rec->key && strchr(rec->key, '*'))
+        ++t->num_wild;
+}
+
+static void reindex(mpr_tbl t)
+{
+    int i;
+    memset(t->prop_pos, 0, sizeof(t->prop_pos));
+    t->num_wild = 0;
+    if (t->keys)
+        mpr_hash_clear(t->keys);
+    for (i = 0; i < t->count; i++)
+        index_record(t, i);
+}
+
+/* Insert the last record into the sort order using a binary search. */
+static void insert_order(mpr_tbl t)
+{
+    int pos = t->count - 1, lo = 0, hi = t->count - 1, mid;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (compare_rec(&t->rec[t->order[mid]], &t->rec[pos]) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    memmove(t->order + lo + 1, t->order + lo, (t->count - 1 - lo) * sizeof(int));
+    t->order[lo] = pos;
 }
 
 mpr_tbl mpr_tbl_new(void)
@@ -67,6 +111,7 @@ mpr_tbl mpr_tbl_new(void)
     t->count = 0;
     t->alloced = 1;
     t->rec = (mpr_tbl_record)calloc(1, sizeof(mpr_tbl_record_t));
+    t->order = (int*)calloc(1, sizeof(int));
     return t;
 }
 
@@ -108,12 +153,16 @@ void mpr_tbl_clear(mpr_tbl t)
     }
     t->count = 0;
     t->rec = realloc(t->rec, sizeof(mpr_tbl_record_t));
+    t->order = realloc(t->order, sizeof(int));
     t->alloced = 1;
+    reindex(t);
 }
 
 void mpr_tbl_free(mpr_tbl t)
 {
     mpr_tbl_clear(t);
+    mpr_hash_free(t->keys);
+    free(t->order);
     free(t->rec);
     free(t);
 }
@@ -122,12 +171,12 @@ static mpr_tbl_record add_record_internal(mpr_tbl t, mpr_prop prop, const char *
                                           int len, mpr_type type, void *val, int flags)
 {
     mpr_tbl_record rec;
-    RETURN_ARG_UNLESS(t->count < MPR_TBL_MAX_RECORDS, NULL);
     t->count += 1;
     if (t->count > t->alloced) {
         while (t->count > t->alloced)
             t->alloced *= 2;
         t->rec = realloc(t->rec, t->alloced * sizeof(mpr_tbl_record_t));
+        t->order = realloc(t->order, t->alloced * sizeof(int));
     }
     rec = &t->rec[t->count-1];
     if (MPR_PROP_EXTRA == prop) {
@@ -143,6 +192,8 @@ static mpr_tbl_record add_record_internal(mpr_tbl t, mpr_prop prop, const char *
     rec->type = type;
     rec->val = val;
     rec->flags = flags;
+    index_record(t, t->count - 1);
+    insert_order(t);
     return rec;
 }
 
@@ -163,23 +214,53 @@ int mpr_tbl_get_num_records(mpr_tbl t)
     return count;
 }
 
+/* Find the first keyed record in sort order whose key matches a string. If `key_is_pattern` the
+ * string may contain wildcards and removed records are skipped, otherwise the keys of the records
+ * may contain wildcards. */
+static mpr_tbl_record match_record(mpr_tbl t, const char *str, int key_is_pattern)
+{
+    int i;
+    for (i = 0; i < t->count; i++) {
+        mpr_tbl_record rec = &t->rec[t->order[i]];
+        if (MPR_PROP_EXTRA != MASK_PROP_BITFLAGS(rec->prop) || !rec->key)
+            continue;
+        if (key_is_pattern && (rec->prop & PROP_REMOVE))
+            continue;
+        if (key_is_pattern ? !mpr_path_match(skip_at(rec->key), str)
+                           : !mpr_path_match(str, skip_at(rec->key)))
+            return rec;
+    }
+    return 0;
+}
+
 static mpr_tbl_record mpr_tbl_get_record(mpr_tbl t, mpr_prop prop, const char *key)
 {
-    mpr_tbl_record_t tmp;
-    mpr_tbl_record rec = 0;
-    RETURN_ARG_UNLESS(key || (MPR_PROP_EXTRA != prop), 0);
-    tmp.prop = prop;
-    tmp.key = key;
-    rec = bsearch(&tmp, t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
-    return rec;
+    int pos;
+    prop = MASK_PROP_BITFLAGS(prop);
+    if (MPR_PROP_EXTRA != prop)
+        pos = t->prop_pos[PROP_TO_INDEX(prop)];
+    else {
+        RETURN_ARG_UNLESS(key && t->keys, 0);
+        key = skip_at(key);
+        pos = (int)(intptr_t)mpr_hash_get_str(t->keys, key);
+        /* records with wildcards in their keys match any key fitting the pattern */
+        if (!pos && t->num_wild)
+            return match_record(t, key, 0);
+    }
+    return pos ? &t->rec[pos - 1] : 0;
 }
 
 mpr_prop mpr_tbl_get_record_by_key(mpr_tbl t, const char *key, int *len, mpr_type *type,
                                    const void **val, int *pub)
 {
     int found = 1;
-    mpr_prop prop = mpr_prop_from_str(key);
-    mpr_tbl_record rec = mpr_tbl_get_record(t, prop, key);
+    mpr_prop prop;
+    /* try the keyed records first so that extra property names are not parsed */
+    mpr_tbl_record rec = mpr_tbl_get_record(t, MPR_PROP_EXTRA, key);
+    if (!rec && key && strchr(key, '*'))
+        rec = match_record(t, skip_at(key), 1);
+    if (!rec && MPR_PROP_EXTRA != (prop = mpr_prop_from_str(key)))
+        rec = mpr_tbl_get_record(t, prop, NULL);
 
     if (!rec || (rec->prop & PROP_REMOVE) || (rec->flags & MPR_TBL_HIDDEN))
         found = 0;
@@ -230,7 +311,7 @@ mpr_prop mpr_tbl_get_record_by_idx(mpr_tbl t, int prop, const char **key, int *l
         prop &= 0xFF;
         if (prop < t->count && t->count > 0) {
             for (i = 0; i < t->count; i++) {
-                rec = &t->rec[i];
+                rec = &t->rec[t->order[i]];
                 if (   !rec->val
                     || (rec->flags & MPR_TBL_HIDDEN)
                     || ((rec->flags & MPR_TBL_INDIRECT) && !(*rec->val)))
@@ -291,73 +372,101 @@ int mpr_tbl_get_record_is_writable(mpr_tbl t, mpr_prop prop)
     return rec ? (rec->flags & MPR_TBL_MOD_ANY) : 1;
 }
 
-int mpr_tbl_remove_record(mpr_tbl t, mpr_prop prop, const char *key, int flags)
+static int remove_record(mpr_tbl t, mpr_tbl_record rec, int flags)
 {
-    int i, ret = 0;
-
-    do {
-        mpr_tbl_record rec = mpr_tbl_get_record(t, prop, key);
-        RETURN_ARG_UNLESS(rec && (flags & rec->flags & MPR_TBL_MOD_ANY) && rec->val, ret);
-        prop = MASK_PROP_BITFLAGS(prop);
-        if (   prop != MPR_PROP_EXTRA
-            && prop != MPR_PROP_LINKED
-            && prop != MPR_PROP_ALLOW_ORIGIN
-            && prop != MPR_PROP_BLOCK_ORIGIN
-            && prop != MPR_PROP_MAX
-            && prop != MPR_PROP_MIN) {
-            if (rec->flags & MPR_TBL_INDIRECT) {
-                /* set value to null rather than removing */
-                if (rec->val && *rec->val && rec->type != MPR_PTR) {
-                    if (rec->flags & MPR_TBL_OWNED)
-                        free(*rec->val);
-                    *rec->val = 0;
-                }
-                rec->prop |= PROP_REMOVE;
-                return 1;
-            }
-            else {
-                trace("Cannot remove static property [%d] '%s'\n", prop,
-                      key ? key : mpr_prop_as_str(prop, 1));
+    int i;
+    mpr_prop prop;
+    RETURN_ARG_UNLESS(rec && (flags & rec->flags & MPR_TBL_MOD_ANY) && rec->val, 0);
+    prop = MASK_PROP_BITFLAGS(rec->prop);
+    if (   prop != MPR_PROP_EXTRA
+        && prop != MPR_PROP_LINKED
+        && prop != MPR_PROP_ALLOW_ORIGIN
+        && prop != MPR_PROP_BLOCK_ORIGIN
+        && prop != MPR_PROP_MAX
+        && prop != MPR_PROP_MIN) {
+        if (rec->flags & MPR_TBL_INDIRECT) {
+            /* set value to null rather than removing */
+            if (rec->val && *rec->val && rec->type != MPR_PTR) {
+                if (rec->flags & MPR_TBL_OWNED)
+                    free(*rec->val);
+                *rec->val = 0;
             }
-            return 0;
+            rec->prop |= PROP_REMOVE;
+            count_change(t, rec->prop);
+            return 1;
+        }
+        else {
+            trace("Cannot remove static property [%d] '%s'\n", prop, mpr_prop_as_str(prop, 1));
         }
+        return 0;
+    }
 
-        if (rec->val && rec->type != MPR_PTR && rec->type != MPR_VAL) {
-            if (rec->flags & MPR_TBL_OWNED) {
-                if ((MPR_STR == rec->type) && rec->len > 1) {
-                    char **vals = (char**)rec->val;
-                    for (i = 0; i < rec->len; i++)
-                        FUNC_IF(free, vals[i]);
-                }
-                if (MPR_LIST == rec->type)
-                    mpr_list_free((mpr_list)rec->val);
-                else
-                    free(rec->val);
+    if (rec->val && rec->type != MPR_PTR && rec->type != MPR_VAL) {
+        if (rec->flags & MPR_TBL_OWNED) {
+            if ((MPR_STR == rec->type) && rec->len > 1) {
+                char **vals = (char**)rec->val;
+                for (i = 0; i < rec->len; i++)
+                    FUNC_IF(free, vals[i]);
             }
-            rec->val = 0;
+            if (MPR_LIST == rec->type)
+                mpr_list_free((mpr_list)rec->val);
+            else
+                free(rec->val);
         }
-        rec->prop |= PROP_REMOVE;
-        ret = 1;
-    } while (prop == MPR_PROP_EXTRA && strchr(key, '*'));
+        rec->val = 0;
+    }
+    rec->prop |= PROP_REMOVE;
+    count_change(t, rec->prop);
+    return 1;
+}
+
+int mpr_tbl_remove_record(mpr_tbl t, mpr_prop prop, const char *key, int flags)
+{
+    int i, ret = 0;
+    if (MPR_PROP_EXTRA != MASK_PROP_BITFLAGS(prop) || !key || !strchr(key, '*'))
+        return remove_record(t, mpr_tbl_get_record(t, prop, key), flags);
+
+    /* remove every keyed record matching the wildcard pattern */
+    key = skip_at(key);
+    for (i = 0; i < t->count; i++) {
+        mpr_tbl_record rec = &t->rec[i];
+        if (   MPR_PROP_EXTRA == MASK_PROP_BITFLAGS(rec->prop)
+            && 0 == mpr_path_match(skip_at(rec->key), key))
+            ret |= remove_record(t, rec, flags);
+    }
     return ret;
 }
 
 void mpr_tbl_clear_empty_records(mpr_tbl t)
 {
-    int i, j;
+    int i, j = 0, k = 0, *new_pos;
     mpr_tbl_record rec;
+    RETURN_UNLESS(t->count);
+    new_pos = (int*)malloc(t->count * sizeof(int));
     for (i = 0; i < t->count; i++) {
         rec = &t->rec[i];
-        if (rec->val || !(rec->prop & PROP_REMOVE))
-            continue;
-        rec->prop &= ~PROP_REMOVE;
-        if (MASK_PROP_BITFLAGS(rec->prop) != MPR_PROP_EXTRA)
-            continue;
-        free((char*)rec->key);
-        for (j = rec - t->rec + 1; j < t->count; j++)
-            t->rec[j-1] = t->rec[j];
-        --t->count;
+        if (!rec->val && (rec->prop & PROP_REMOVE)) {
+            rec->prop &= ~PROP_REMOVE;
+            if (MASK_PROP_BITFLAGS(rec->prop) == MPR_PROP_EXTRA) {
+                free((char*)rec->key);
+                new_pos[i] = 0;
+                continue;
+            }
+        }
+        if (i != j)
+            t->rec[j] = *rec;
+        new_pos[i] = ++j;
     }
+    if (j < t->count) {
+        /* the remaining records have moved, so the order and indexes must be updated */
+        for (i = 0; i < t->count; i++) {
+            if (new_pos[t->order[i]])
+                t->order[k++] = new_pos[t->order[i]] - 1;
+        }
+        t->count = j;
+        reindex(t);
+    }
+    free(new_pos);
 }
 
 /* For unknown reasons, strcpy crashes here with -O2, so we'll use memcpy
@@ -565,9 +674,10 @@ static int set_internal(mpr_tbl t, mpr_prop prop, const char *key, int len,
             update_elements(rec, len, type, val);
         else
             rec->prop |= PROP_REMOVE;
-        mpr_tbl_sort(t);
         updated = t->dirty = 1;
     }
+    if (updated)
+        count_change(t, rec->prop);
     return updated;
 }
 
@@ -603,6 +713,7 @@ void mpr_tbl_link_value(mpr_tbl t, mpr_prop prop, int len, mpr_type type, void *
         }
         /* update value */
         rec->val = val;
+        count_change(t, prop);
     }
     else {
         add_record_internal(t, prop, NULL, len, type, val, flags);
@@ -694,9 +805,10 @@ int mpr_tbl_add_record_from_msg_atom(mpr_tbl t, mpr_msg_atom atom, int flags)
             return 0;
         rec->val = 0;
         update_elements_osc(rec, len, types, mpr_msg_atom_get_values(atom));
-        mpr_tbl_sort(t);
         updated = t->dirty = 1;
     }
+    if (updated)
+        count_change(t, rec->prop);
     return updated;
 }
 
@@ -867,17 +979,23 @@ void mpr_tbl_add_to_msg(mpr_tbl tbl, mpr_tbl new, lo_message msg)
     /* add all the updates */
     if (new) {
         for (i = 0; i < new->count; i++)
-            mpr_record_add_to_msg(&new->rec[i], msg);
+            mpr_record_add_to_msg(&new->rec[new->order[i]], msg);
     }
     RETURN_UNLESS(tbl);
     /* add remaining records */
     for (i = 0; i < tbl->count; i++) {
+        mpr_tbl_record rec = &tbl->rec[tbl->order[i]];
         /* check if updated version exists */
-        if (!new || !mpr_tbl_get_record(new, tbl->rec[i].prop, tbl->rec[i].key))
-            mpr_record_add_to_msg(&tbl->rec[i], msg);
+        if (!new || !mpr_tbl_get_record(new, rec->prop, rec->key))
+            mpr_record_add_to_msg(rec, msg);
     }
 }
 
+void mpr_tbl_set_change_counters(mpr_tbl tbl, uint32_t *changes)
+{
+    tbl->changes = changes;
+}
+
 int mpr_tbl_get_is_dirty(mpr_tbl tbl)
 {
     return tbl->dirty;
@@ -974,14 +1092,12 @@ void mpr_tbl_print_record(mpr_tbl_record rec)
 
 void mpr_tbl_print(mpr_tbl t)
 {
-    printf("<table %p with %d records>\n", t, t->count);
-    mpr_tbl_record rec = t->rec;
     int i;
+    printf("<table %p with %d records>\n", t, t->count);
     for (i = 0; i < t->count; i++) {
         printf("  ");
-        mpr_tbl_print_record(rec);
+        mpr_tbl_print_record(&t->rec[t->order[i]]);
         printf("\n");
-        ++rec;
     }
 }
 #endif
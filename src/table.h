@@ -23,12 +23,12 @@ typedef struct _mpr_tbl_record *mpr_tbl_record;
 #define MPR_TBL_SET         0x0080    /* 0000000010000000 */
 #define MPR_TBL_HIDDEN      0x0100    /* 0000000100000000 */
 
+/* PROP_TO_INDEX() of any property is below this */
+#define MPR_TBL_NUM_PROP_IDX 64
+
 /*! Create a new string table. */
 mpr_tbl mpr_tbl_new(void);
 
-/*! Sort a string table. */
-void mpr_tbl_sort(mpr_tbl t);
-
 /*! Clear the contents of a string table.
  * \param tbl Table to free. */
 void mpr_tbl_clear(mpr_tbl tbl);
@@ -88,7 +88,7 @@ int mpr_tbl_get_record_is_writable(mpr_tbl tbl, mpr_prop prop);
 int mpr_tbl_remove_record(mpr_tbl tbl, mpr_prop prop, const char *key, int flags);
 
 /*! Update a value in a table if the key already exists, or add it otherwise.
- *  Returns 0 if no add took place.  Sorts the table before exiting.
+ *  Returns 0 if no add took place.
  *  \param tbl          Table to update.
  *  \param prop         Index to store.
  *  \param key          Key to store if not already indexed.
@@ -100,8 +100,7 @@ int mpr_tbl_remove_record(mpr_tbl tbl, mpr_prop prop, const char *key, int flags
 int mpr_tbl_add_record(mpr_tbl tbl, int prop, const char *key, int len,
                        mpr_type type, const void *args, int flags);
 
-/*! Sync an existing value with a table. Records added using this method must
- *  be added in alphabetical order since `table_sort()` will not be called.
+/*! Sync an existing value with a table.
  *  Key and value will not be copied by the table, and will not be freed when
  *  the table is cleared or deleted. */
 void mpr_tbl_link_value(mpr_tbl tbl, mpr_prop prop, int length, mpr_type type,
@@ -127,6 +126,14 @@ void mpr_tbl_add_to_msg(mpr_tbl tbl, mpr_tbl updates, lo_message msg);
  *  removal to propagate to subscribed graph instances and peer devices. */
 void mpr_tbl_clear_empty_records(mpr_tbl tbl);
 
+/*! Count changes to the records of a table, used to detect when cached indexes of its values
+ *  are stale.
+ *  \param tbl          The table.
+ *  \param changes      An array of `MPR_TBL_NUM_PROP_IDX` counters, one of which is incremented
+ *                      atomically at `PROP_TO_INDEX()` of the property whenever a record is
+ *                      changed, relinked or removed, or NULL to stop counting. */
+void mpr_tbl_set_change_counters(mpr_tbl tbl, uint32_t *changes);
+
 int mpr_tbl_get_is_dirty(mpr_tbl tbl);
 
 void mpr_tbl_set_is_dirty(mpr_tbl tbl, int is_dirty);
@@ -12,24 +12,32 @@
 
 #define GET_BUFFER() &v->inst[inst_idx % v->num_inst]
 
+/* Sample, time and known-element storage for all instances is held in three slabs owned by the
+ * mpr_value. Samples and times are indexed by [history position][instance] so that the same
+ * history position of every instance is contiguous, and adding or removing instances does not
+ * require per-instance allocations. */
+
 typedef struct _mpr_value_buffer
 {
     mpr_time start;             /*!< Time at which this instance was activated. */
-    void *samps;                /*!< Value for each sample of stored history. */
-    mpr_time *times;            /*!< Time for each sample of stored history. */
-    mpr_bitflags known;         /*!< Bitflags indicating which value elements are known. */
     int16_t pos;                /*!< Current position in the circular buffer. */
     uint8_t full;               /*!< Indicates whether complete buffer contains valid data. */
 } mpr_value_buffer_t, *mpr_value_buffer;
 
 typedef struct _mpr_value
 {
-    mpr_value_buffer inst;      /*!< Array of value histories for each signal instance. */
-    uint8_t vlen;               /*!< Vector length. */
-    uint8_t num_inst;           /*!< Number of instances. */
-    uint8_t num_active_inst;    /*!< Number of active instances. */
-    mpr_type type;              /*!< The type of this signal. */
+    mpr_value_buffer inst;      /*!< Array of history state for each signal instance. */
+    void *samps;                /*!< Sample slab indexed by [history position][instance]. */
+    mpr_time *times;            /*!< Time slab indexed by [history position][instance]. */
+    char *known;                /*!< Slab of bitflags indicating which elements are known. */
+    size_t samp_size;           /*!< Size in bytes of a single vector sample. */
+    size_t known_size;          /*!< Size in bytes of the bitflags for a single instance. */
+    uint16_t vlen;              /*!< Vector length. */
     uint16_t mlen;              /*!< History size of the buffer. */
+    uint16_t num_inst;          /*!< Number of instances. */
+    uint16_t num_active_inst;   /*!< Number of active instances. */
+    uint16_t inst_cap;          /*!< Number of instances allocated in each history row. */
+    mpr_type type;              /*!< The type of this signal. */
 
     float period;               /*!< Estimate of the update rate of this value. */
     float jitter;               /*!< Estimate of the timing jitter of this value. */
@@ -38,6 +46,21 @@ typedef struct _mpr_value
 
 MPR_INLINE static int _min(int a, int b) { return a < b ? a : b; }
 
+MPR_INLINE static char *_get_samp(mpr_value v, mpr_value_buffer b, int pos)
+{
+    return (char*)v->samps + ((size_t)pos * v->inst_cap + (b - v->inst)) * v->samp_size;
+}
+
+MPR_INLINE static mpr_time *_get_time(mpr_value v, mpr_value_buffer b, int pos)
+{
+    return &v->times[(size_t)pos * v->inst_cap + (b - v->inst)];
+}
+
+MPR_INLINE static mpr_bitflags _get_known(mpr_value v, mpr_value_buffer b)
+{
+    return v->known + (b - v->inst) * v->known_size;
+}
+
 mpr_value mpr_value_new(unsigned int vlen, mpr_type type, unsigned int mlen, unsigned int num_inst)
 {
     mpr_value v = (mpr_value) calloc(1, sizeof(mpr_value_t));
@@ -51,151 +74,179 @@ mpr_value mpr_value_new(unsigned int vlen, mpr_type type, unsigned int mlen, uns
 }
 
 void mpr_value_free(mpr_value v) {
-    int i;
     RETURN_UNLESS(v && v->inst);
-    for (i = 0; i < v->num_inst; i++) {
-        mpr_value_buffer b = &v->inst[i];
-        FUNC_IF(free, b->samps);
-        FUNC_IF(free, b->times);
-        FUNC_IF(mpr_bitflags_free, b->known);
-    }
+    free(v->samps);
+    free(v->times);
+    free(v->known);
     free(v->inst);
     free(v);
 }
 
-void mpr_value_realloc(mpr_value v, unsigned int vlen, mpr_type type, unsigned int mlen,
-                       unsigned int num_inst, int reset)
+/* Clear the stored history of an instance without touching the activity count. */
+static void _clear_inst(mpr_value v, mpr_value_buffer b)
 {
-    int i, samp_size;
-    mpr_value_buffer_t *b, tmp;
-    RETURN_UNLESS(v);
-    if (vlen <= 0)
-        vlen = v->vlen;
-    if (mlen <= 0)
-        mlen = v->mlen;
-    samp_size = vlen * mpr_type_get_size(type);
-
-    if (!v->inst || num_inst > v->num_inst) {
-        if (v->inst)
-            v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * num_inst);
-        else {
-            v->inst = malloc(sizeof(mpr_value_buffer_t) * num_inst);
-            v->num_inst = 0;
-        }
-        /* initialize new instances */
-        for (i = v->num_inst; i < num_inst; i++) {
-            b = &v->inst[i];
-            b->samps = calloc(1, mlen * samp_size);
-            b->times = calloc(1, mlen * sizeof(mpr_time));
-            b->known = mpr_bitflags_new(vlen);
-            b->pos = -1;
-            b->full = 0;
-        }
+    int i;
+    for (i = 0; i < v->mlen; i++) {
+        memset(_get_samp(v, b, i), 0, v->samp_size);
+        memset(_get_time(v, b, i), 0, sizeof(mpr_time));
     }
+    mpr_bitflags_init(_get_known(v, b), v->vlen);
+    b->pos = -1;
+    b->full = 0;
+}
 
-    if (reset || vlen != v->vlen || type != v->type) {
-        /* reallocate old instances (v->num_inst has not yet been updated) */
-        for (i = 0; i < v->num_inst; i++) {
-            b = &v->inst[i];
-            b->samps = realloc(b->samps, mlen * samp_size);
-            b->times = realloc(b->times, mlen * sizeof(mpr_time));
-            b->known = b->known ? mpr_bitflags_realloc(b->known, vlen) : mpr_bitflags_new(vlen);
-            /* Initialize entire value to 0 */
-            memset(b->samps, 0, mlen * samp_size);
-            memset(b->times, 0, mlen * sizeof(mpr_time));
-            mpr_bitflags_clear(b->known);
-            if (b->pos >= 0)
-                --v->num_active_inst;
-            b->pos = -1;
-            b->full = 0;
-        }
-        goto done;
+/* Replace the slabs with new zeroed storage, discarding all stored values. */
+static void _alloc_slabs(mpr_value v, unsigned int vlen, mpr_type type, unsigned int mlen,
+                         unsigned int inst_cap)
+{
+    int i;
+    if (!inst_cap)
+        inst_cap = 1;
+    v->samp_size = vlen * mpr_type_get_size(type);
+    v->known_size = mpr_bitflags_get_size(vlen);
+    FUNC_IF(free, v->samps);
+    FUNC_IF(free, v->times);
+    FUNC_IF(free, v->known);
+    v->samps = calloc(1, (size_t)mlen * inst_cap * v->samp_size);
+    v->times = calloc((size_t)mlen * inst_cap, sizeof(mpr_time));
+    v->known = malloc(inst_cap * v->known_size);
+    for (i = 0; i < inst_cap; i++)
+        mpr_bitflags_init(v->known + i * v->known_size, vlen);
+    v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * inst_cap);
+    for (i = 0; i < inst_cap; i++) {
+        v->inst[i].pos = -1;
+        v->inst[i].full = 0;
     }
+    v->num_active_inst = 0;
+    v->inst_cap = inst_cap;
+}
 
-    if (!v->mlen || mlen == v->mlen)
-        goto done;
+/* Widen each history row to hold inst_cap instances, keeping the stored values. */
+static void _grow_slabs(mpr_value v, unsigned int inst_cap)
+{
+    int i;
+    char *samps = calloc(1, (size_t)v->mlen * inst_cap * v->samp_size);
+    mpr_time *times = calloc((size_t)v->mlen * inst_cap, sizeof(mpr_time));
+    for (i = 0; i < v->mlen; i++) {
+        memcpy(samps + (size_t)i * inst_cap * v->samp_size,
+               (char*)v->samps + (size_t)i * v->inst_cap * v->samp_size,
+               v->num_inst * v->samp_size);
+        memcpy(&times[(size_t)i * inst_cap], &v->times[(size_t)i * v->inst_cap],
+               v->num_inst * sizeof(mpr_time));
+    }
+    free(v->samps);
+    free(v->times);
+    v->samps = samps;
+    v->times = times;
 
-    /* only the memory size is different */
+    /* bitflags are indexed by instance only so the slab can simply be extended */
+    v->known = realloc(v->known, inst_cap * v->known_size);
+    for (i = v->inst_cap; i < inst_cap; i++)
+        mpr_bitflags_init(v->known + i * v->known_size, v->vlen);
+    v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * inst_cap);
+    v->inst_cap = inst_cap;
+}
 
+/* Change the history size, keeping the most recent samples of each instance in order. */
+static void _resize_hist(mpr_value v, unsigned int mlen)
+{
+    int i, j;
+    char *samps = calloc(1, (size_t)mlen * v->inst_cap * v->samp_size);
+    mpr_time *times = calloc((size_t)mlen * v->inst_cap, sizeof(mpr_time));
     for (i = 0; i < v->num_inst; i++) {
-        b = &v->inst[i];
-        tmp.samps = malloc(samp_size * mlen);
-        tmp.times = calloc(1, sizeof(mpr_time) * mlen);
-
+        mpr_value_buffer b = &v->inst[i];
+        int num_samps, opos;
         if (b->pos < 0) {
-            /* no value to copy */
-            if (b->times) {
-                /* copy reset timestamp from/to idx 0 */
-                memcpy(tmp.times, &b->times[0], sizeof(mpr_time));
-            }
+            /* no value to copy, keep the reset timestamp at idx 0 */
+            times[i] = *_get_time(v, b, 0);
+            continue;
         }
-        else if (mlen > v->mlen) {
-            int offset = 0, len;
-            if (b->full) {
-                /* copy from [b->pos : v->mlen] to [0 : v->mlen - v->pos] */
-                int len = v->mlen - b->pos;
-                memcpy(tmp.samps, (char*)b->samps + b->pos * samp_size, len * samp_size);
-                memcpy(tmp.times, &b->times[b->pos], len * sizeof(mpr_time));
-                offset = len;
-            }
+        num_samps = _min(b->full ? v->mlen : b->pos + 1, mlen);
+        /* copy from oldest to newest sample */
+        opos = b->pos - num_samps + 1;
+        if (opos < 0)
+            opos += v->mlen;
+        for (j = 0; j < num_samps; j++) {
+            memcpy(samps + ((size_t)j * v->inst_cap + i) * v->samp_size, _get_samp(v, b, opos),
+                   v->samp_size);
+            times[(size_t)j * v->inst_cap + i] = *_get_time(v, b, opos);
+            if (++opos >= v->mlen)
+                opos = 0;
+        }
+        b->pos = num_samps - 1;
+        b->full = num_samps >= mlen;
+    }
+    free(v->samps);
+    free(v->times);
+    v->samps = samps;
+    v->times = times;
+}
 
-            /* copy from [0 : v->pos] to [v->mlen - v->pos : v->mlen] */
-            memcpy((char*)tmp.samps + offset * samp_size, b->samps, (b->pos + 1) * samp_size);
-            memcpy(&tmp.times[offset], b->times, (b->pos + 1) * sizeof(mpr_time));
+void mpr_value_realloc(mpr_value v, unsigned int vlen, mpr_type type, unsigned int mlen,
+                       unsigned int num_inst, int reset)
+{
+    int i;
+    RETURN_UNLESS(v);
+    if (vlen <= 0)
+        vlen = v->vlen;
+    if (mlen <= 0)
+        mlen = v->mlen;
 
-            /* set position to end of copied memory */
-            b->pos += offset;
+    if (!v->inst || reset || vlen != v->vlen || type != v->type) {
+        /* the sample layout has changed: reallocate and initialize entire value to 0 */
+        _alloc_slabs(v, vlen, type, mlen, num_inst > v->inst_cap ? num_inst : v->inst_cap);
+        v->vlen = vlen;
+        v->type = type;
+        v->mlen = mlen;
+        v->num_inst = num_inst;
+        return;
+    }
 
-            /* zero remainder */
-            len = mlen - b->pos - 1;
-            memset((char*)tmp.samps + (b->pos + 1) * samp_size, 0, len * samp_size);
-            memset(&tmp.times[b->pos + 1], 0, len * sizeof(mpr_time));
-            b->full = 0;
-        }
-        else {
-            int opos = b->pos;
-            int len = _min(v->mlen - opos, mlen);
-            memcpy(tmp.samps, (char*)b->samps + opos * samp_size, len * samp_size);
-            memcpy(tmp.times, &b->times[opos], len * sizeof(mpr_time));
-            if (mlen > len) {
-                memcpy((char*)tmp.samps + len * samp_size, b->samps, (mlen - len) * samp_size);
-                memcpy(&tmp.times[len], b->times, (mlen - len) * sizeof(mpr_time));
-            }
-            b->full |= (b->pos >= mlen);
-            b->pos = len - 1;
-        }
+    /* deactivate any truncated instances */
+    for (i = num_inst; i < v->num_inst; i++) {
+        if (v->inst[i].pos >= 0)
+            --v->num_active_inst;
+    }
 
-        free(b->samps);
-        free(b->times);
-        b->samps = tmp.samps;
-        b->times = tmp.times;
+    if (num_inst > v->inst_cap) {
+        /* grow geometrically so that adding instances one at a time stays cheap */
+        unsigned int inst_cap = v->inst_cap * 2;
+        if (inst_cap < num_inst)
+            inst_cap = num_inst;
+        else if (inst_cap > UINT16_MAX)
+            inst_cap = UINT16_MAX;
+        _grow_slabs(v, inst_cap);
     }
 
-done:
-    v->vlen = vlen;
-    v->type = type;
+    if (v->mlen && mlen != v->mlen)
+        _resize_hist(v, mlen);
     v->mlen = mlen;
+
+    /* initialize new instances */
+    for (i = v->num_inst; i < num_inst; i++)
+        _clear_inst(v, &v->inst[i]);
     v->num_inst = num_inst;
 }
 
 int mpr_value_remove_inst(mpr_value v, unsigned int idx)
 {
-    int i;
-    mpr_value_buffer_t *b;
+    int i, num_move;
     RETURN_ARG_UNLESS(idx >= 0 && idx < v->num_inst, v->num_inst);
-    b = &v->inst[idx];
-    free(b->samps);
-    free(b->times);
-    FUNC_IF(mpr_bitflags_free, b->known);
-    if (b->pos >= 0)
+    if (v->inst[idx].pos >= 0)
         --v->num_active_inst;
-    for (i = idx + 1; i < v->num_inst; i++) {
-        /* shift values down */
-        memcpy(&(v->inst[i-1]), &(v->inst[i]), sizeof(mpr_value_buffer_t));
+
+    /* shift values down within each history row; storage is kept for reuse */
+    num_move = v->num_inst - idx - 1;
+    for (i = 0; i < v->mlen; i++) {
+        size_t row = (size_t)i * v->inst_cap;
+        memmove((char*)v->samps + (row + idx) * v->samp_size,
+                (char*)v->samps + (row + idx + 1) * v->samp_size, num_move * v->samp_size);
+        memmove(&v->times[row + idx], &v->times[row + idx + 1], num_move * sizeof(mpr_time));
     }
+    memmove(v->known + idx * v->known_size, v->known + (idx + 1) * v->known_size,
+            num_move * v->known_size);
+    memmove(&v->inst[idx], &v->inst[idx + 1], num_move * sizeof(mpr_value_buffer_t));
     --v->num_inst;
-    assert(v->num_inst >= 0);
-    v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * v->num_inst);
     return v->num_inst;
 }
 
@@ -204,16 +255,11 @@ void mpr_value_reset_inst(mpr_value v, unsigned int idx, mpr_time t)
     mpr_value_buffer b;
     RETURN_UNLESS(v->inst && idx < v->num_inst);
     b = &v->inst[idx];
-    memset(b->samps, 0, v->mlen * v->vlen * mpr_type_get_size(v->type));
-    /* store the reset time at idx 0 */
-    memset(b->times, 0, v->mlen * sizeof(mpr_time));
-    memcpy(b->times, &t, sizeof(mpr_time));
-    mpr_bitflags_clear(b->known);
-
     if (b->pos >= 0)
         --v->num_active_inst;
-    b->pos = -1;
-    b->full = 0;
+    _clear_inst(v, b);
+    /* store the reset time at idx 0 */
+    memcpy(_get_time(v, b, 0), &t, sizeof(mpr_time));
 }
 
 static void update_timing_stats(mpr_value v, mpr_time t)
@@ -252,7 +298,7 @@ void* mpr_value_get_value(mpr_value v, unsigned int inst_idx, int hist_idx)
     RETURN_ARG_UNLESS(b->pos >= 0, NULL);
     if (idx < 0)
         idx += v->mlen;
-    return (char*)b->samps + idx * v->vlen * mpr_type_get_size(v->type);
+    return _get_samp(v, b, idx);
 }
 
 mpr_time mpr_value_get_lowest_time(mpr_value v)
@@ -262,7 +308,7 @@ mpr_time mpr_value_get_lowest_time(mpr_value v)
     for (i = 0; i < v->num_inst; i++) {
         mpr_value_buffer b = &v->inst[i];
         if (b->pos >= 0) {
-            mpr_time t = b->times[b->pos];
+            mpr_time t = *_get_time(v, b, b->pos);
             if ((t.sec < lowest.sec) || ((t.sec == lowest.sec) && (t.frac < lowest.frac))) {
                 memcpy(&lowest, &t, sizeof(mpr_time));
             }
@@ -280,7 +326,7 @@ static mpr_time* mpr_value_get_time_internal(mpr_value v, unsigned int inst_idx,
         if (idx < 0)
             idx += v->mlen;
     }
-    return &b->times[idx];
+    return _get_time(v, b, idx);
 }
 
 /* here we return the time at idx 0 even if the value has been reset */
@@ -309,19 +355,19 @@ int mpr_value_set_next(mpr_value v, unsigned int inst_idx, const void *s, mpr_ti
     void *mem;
     RETURN_ARG_UNLESS(s, 0);
 
-    if (mpr_bitflags_get_all(b->known)) {
+    if (mpr_bitflags_get_all(_get_known(v, b))) {
         /* we can compare to last value */
-        cmp = memcmp(mpr_value_get_value(v, inst_idx, 0), s, v->vlen * mpr_type_get_size(v->type));
+        cmp = memcmp(mpr_value_get_value(v, inst_idx, 0), s, v->samp_size);
     }
     else {
-        mpr_bitflags_set_all(b->known);
+        mpr_bitflags_set_all(_get_known(v, b));
     }
 
     mpr_value_incr_idx(v, inst_idx, t);
 
     mem = (void*) mpr_value_get_value(v, inst_idx, 0);
     if (s != mem)
-        memcpy(mem, s, v->vlen * mpr_type_get_size(v->type));
+        memcpy(mem, s, v->samp_size);
     memcpy(mpr_value_get_time_internal(v, inst_idx, 0), &t, sizeof(mpr_time));
 
     return cmp != 0;
@@ -335,8 +381,8 @@ void mpr_value_cpy_next(mpr_value v, unsigned int inst_idx, mpr_time t)
     if (b->pos < 0) {
         mpr_value_incr_idx(v, inst_idx, t);
     }
-    else if (mpr_bitflags_get_all(b->known)) {
-        s = (char*)b->samps + b->pos * v->vlen * mpr_type_get_size(v->type);
+    else if (mpr_bitflags_get_all(_get_known(v, b))) {
+        s = _get_samp(v, b, b->pos);
         mpr_value_set_next(v, inst_idx, s, t);
     }
 }
@@ -356,9 +402,9 @@ int mpr_value_set_element(mpr_value v, unsigned int inst_idx, int el_idx, void *
         el_idx += v->vlen;
 
     /* set bitflag indicating this element has a value */
-    mpr_bitflags_set(b->known, el_idx);
+    mpr_bitflags_set(_get_known(v, b), el_idx);
 
-    old = (char*)b->samps + b->pos * v->vlen * size;
+    old = _get_samp(v, b, b->pos);
     RETURN_ARG_UNLESS(old, 0);
 
     if (memcmp(old + el_idx * size, new, size)) {
@@ -373,26 +419,28 @@ void mpr_value_set_elements_known(mpr_value v, unsigned int inst_idx, int start,
 {
     mpr_value_buffer b = GET_BUFFER();
     int i = start, vlen = v->vlen;
-    if (num > vlen)
-        num = vlen;
+    if (num >= vlen) {
+        mpr_bitflags_set_all(_get_known(v, b));
+        return;
+    }
     for (i = start; num > 0; i++, num--) {
         if (i >= vlen)
             i = 0;
-        mpr_bitflags_set(b->known, i);
+        mpr_bitflags_set(_get_known(v, b), i);
     }
 }
 
 mpr_bitflags mpr_value_get_elements_known(mpr_value v, unsigned int inst_idx)
 {
     mpr_value_buffer b = GET_BUFFER();
-    return b->known;
+    return _get_known(v, b);
 }
 
 /* TODO: use an extra 'value known' bitflag for faster comparison? */
 int mpr_value_get_has_value(mpr_value v, unsigned int inst_idx)
 {
     mpr_value_buffer b = GET_BUFFER();
-    return b->pos >= 0 && mpr_bitflags_get_all(b->known);
+    return b->pos >= 0 && mpr_bitflags_get_all(_get_known(v, b));
 }
 
 int mpr_value_set_next_coerced(mpr_value v, unsigned int inst_idx, unsigned int len,
@@ -403,7 +451,7 @@ int mpr_value_set_next_coerced(mpr_value v, unsigned int inst_idx, unsigned int
     status = mpr_set_coerced(len, type, s, v->vlen, v->type, mpr_value_get_value(v, inst_idx, 0));
     if (status >= 0) {
         mpr_value_buffer b = GET_BUFFER();
-        mpr_bitflags_set_all(b->known);
+        mpr_bitflags_set_all(_get_known(v, b));
         memcpy(mpr_value_get_time_internal(v, inst_idx, 0), &t, sizeof(mpr_time));
     }
     return status;
@@ -415,7 +463,7 @@ void mpr_value_set_time(mpr_value v, unsigned int inst_idx, int hist_idx, mpr_ti
     int idx = (b->pos + v->mlen + hist_idx) % v->mlen;
     if (idx < 0)
         idx += v->mlen;
-    memcpy(&b->times[idx], &t, sizeof(mpr_time));
+    memcpy(_get_time(v, b, idx), &t, sizeof(mpr_time));
     if (0 == hist_idx)
         update_timing_stats(v, t);
 }
@@ -423,7 +471,7 @@ void mpr_value_set_time(mpr_value v, unsigned int inst_idx, int hist_idx, mpr_ti
 int mpr_value_cmp(mpr_value v, unsigned int inst_idx, int hist_idx, const void *ptr)
 {
     const void *s = mpr_value_get_value(v, inst_idx, hist_idx);
-    return !s || memcmp(s, ptr, v->vlen * mpr_type_get_size(v->type));
+    return !s || memcmp(s, ptr, v->samp_size);
 }
 
 void mpr_value_incr_idx(mpr_value v, unsigned int inst_idx, mpr_time t)
@@ -431,9 +479,9 @@ void mpr_value_incr_idx(mpr_value v, unsigned int inst_idx, mpr_time t)
     mpr_value_buffer b = GET_BUFFER();
     if (b->pos < 0) {
         ++v->num_active_inst;
-        b->start = b->times[0] = t;
+        b->start = *_get_time(v, b, 0) = t;
     }
-    else if (!mpr_bitflags_get_all(b->known)) {
+    else if (!mpr_bitflags_get_all(_get_known(v, b))) {
         /* don't advance position until all vector elements are known */
         return;
     }
@@ -486,16 +534,26 @@ void mpr_value_add_to_msg(mpr_value v, unsigned int inst_idx, lo_message msg)
 {
     /* value of vector elements can be <type> or NULL */
     mpr_value_buffer b = GET_BUFFER();
+    mpr_bitflags known;
     void *val;
+    int all_known;
     RETURN_UNLESS(b->pos >= 0);
-    val = (char*)b->samps + b->pos * v->vlen * mpr_type_get_size(v->type);
+    val = _get_samp(v, b, b->pos);
+    known = _get_known(v, b);
+    all_known = mpr_bitflags_get_all(known);
 
     switch (v->type) {
 #define TYPED_CASE(MTYPE, TYPE, CAST)                               \
         case MTYPE: {                                               \
             int i;                                                  \
+            if (all_known) {                                        \
+                /* skip per-element checks for complete vectors */  \
+                for (i = 0; i < v->vlen; i++)                       \
+                    lo_message_add_##TYPE(msg, ((CAST*)val)[i]);    \
+                break;                                              \
+            }                                                       \
             for (i = 0; i < v->vlen; i++) {                         \
-                if (mpr_bitflags_get(b->known, i))                  \
+                if (mpr_bitflags_get(known, i))                     \
                     lo_message_add_##TYPE(msg, ((CAST*)val)[i]);    \
                 else                                                \
                     lo_message_add_nil(msg);                        \
@@ -511,11 +569,23 @@ void mpr_value_add_to_msg(mpr_value v, unsigned int inst_idx, lo_message msg)
     }
 }
 
+int mpr_value_cpy_typed(mpr_value v, unsigned int inst_idx, mpr_type *types, void *samps)
+{
+    /* value of vector elements can be <type> or NULL */
+    mpr_value_buffer b = GET_BUFFER();
+    mpr_bitflags known = _get_known(v, b);
+    int i;
+    RETURN_ARG_UNLESS(b->pos >= 0, 0);
+    memcpy(samps, _get_samp(v, b, b->pos), v->samp_size);
+    for (i = 0; i < v->vlen; i++)
+        types[i] = mpr_bitflags_get(known, i) ? v->type : MPR_NULL;
+    return 1;
+}
+
 void mpr_value_link_to_tbl(mpr_value val, mpr_tbl tbl)
 {
     mpr_tbl_link_value(tbl, MPR_PROP_PERIOD, 1, MPR_FLT, &val->period, MPR_TBL_MOD_NONE | MPR_TBL_SET);
     mpr_tbl_link_value(tbl, MPR_PROP_JITTER, 1, MPR_FLT, &val->jitter, MPR_TBL_MOD_NONE | MPR_TBL_SET);
-    mpr_tbl_sort(tbl);
 }
 
 #ifdef DEBUG
@@ -546,9 +616,9 @@ static void _value_print(mpr_value v, unsigned int inst_idx, int hist_idx) {
     }
 
     if (v->vlen > 1)
-        printf("\b\b] @%p -> %p\n", v->inst[inst_idx].samps, s);
+        printf("\b\b] @%p -> %p\n", v->samps, s);
     else
-        printf("\b\b @%p -> %p\n", v->inst[inst_idx].samps, s);
+        printf("\b\b @%p -> %p\n", v->samps, s);
 }
 
 int mpr_value_print_inst(mpr_value v, unsigned int inst_idx) {
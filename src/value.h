@@ -8,7 +8,7 @@
 #include "mpr_type.h"
 #include "bitflags.h"
 
-#define MPR_MAX_VECTOR_LEN 128
+#define MPR_MAX_VECTOR_LEN 4096
 
 /*! A structure that stores the current and historical values of a signal. The
  *  size of the history array is determined by the needs of mapping expressions.
@@ -78,6 +78,15 @@ int mpr_value_cmp(mpr_value v, unsigned int inst_idx, int hist_idx, const void *
 
 void mpr_value_add_to_msg(mpr_value val, unsigned int inst_idx, lo_message msg);
 
+/*! Copy the current sample of an instance without serializing it to a message.
+ *  \param v        The value to copy from.
+ *  \param inst_idx Index of the value instance to copy.
+ *  \param types    Array of length vlen, filled with the value type or MPR_NULL for each
+ *                  element depending on whether the element is known.
+ *  \param samps    Buffer of at least vlen elements of the value type.
+ *  \return         1 if the instance has a value, 0 otherwise. */
+int mpr_value_cpy_typed(mpr_value v, unsigned int inst_idx, mpr_type *types, void *samps);
+
 void mpr_value_link_to_tbl(mpr_value val, mpr_tbl tbl);
 
 #ifdef DEBUG
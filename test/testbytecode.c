@@ -0,0 +1,355 @@
+#include "../src/bitflags.h"
+#include "../src/expression.h"
+#include "../src/mpr_time.h"
+#include "../src/value.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <mapper/mapper.h>
+
+/* Differential test for compiled expressions: each expression is parsed twice, one copy is
+ * evaluated using its compiled register program and the other using the token interpreter. Both
+ * are given identical random inputs and must produce identical status, output values, known
+ * elements and user variables. Compiled programs are also evaluated for several instances at once
+ * and compared with evaluating each instance separately. testparser also compares every compiled
+ * expression in its corpus with the interpreter. */
+
+#define MAX_SRC 3
+#define MAX_LEN 4
+#define MAX_VARS 8
+#define NUM_INST 5
+
+int verbose = 1;
+int iterations = 10000;
+int num_compiled = 0;
+int num_batched = 0;
+
+typedef struct {
+    const char *str;
+    int num_src;
+    mpr_type src_type;
+    unsigned int src_len;
+    mpr_type dst_type;
+    unsigned int dst_len;
+    int compiled;           /* whether we expect this expression to be compiled */
+} test_expr_t;
+
+test_expr_t exprs[] = {
+    /* arithmetic and multiply-add fusion */
+    { "y=x*2+1",                            1, MPR_FLT,   1, MPR_FLT,   1, 1 },
+    { "y=3+x*x",                            1, MPR_DBL,   2, MPR_DBL,   2, 1 },
+    { "y=x*0.5-x*0.25",                     1, MPR_FLT,   3, MPR_FLT,   3, 1 },
+    { "y=1-x*x",                            1, MPR_INT32, 2, MPR_INT32, 2, 1 },
+    { "y=x$0*x$1+x$2",                      3, MPR_FLT,   2, MPR_FLT,   2, 1 },
+    { "y=x/3.5+x%2",                        1, MPR_DBL,   1, MPR_DBL,   1, 1 },
+    { "y=100/x",                            1, MPR_INT32, 1, MPR_INT32, 1, 1 },
+    { "y=(x&255)|((x>>2)^3)",               1, MPR_INT32, 1, MPR_INT32, 1, 1 },
+    /* clamping fusion */
+    { "y=min(max(x,-1),1)",                 1, MPR_FLT,   3, MPR_FLT,   3, 1 },
+    { "y=max(min(x,10),-10)",               1, MPR_INT32, 2, MPR_INT32, 2, 1 },
+    /* functions and arithmetic errors */
+    { "y=sin(x)*cos(x)+sqrt(abs(x))",       1, MPR_FLT,   2, MPR_FLT,   2, 1 },
+    { "y=log(x)",                           1, MPR_DBL,   1, MPR_DBL,   1, 1 },
+    { "y=pow(x,2)*3",                       1, MPR_DBL,   2, MPR_DBL,   2, 1 },
+    /* conditionals, vectors and casts */
+    { "y=(x>1)?[1,2,3]:[2,4,6]",            1, MPR_FLT,   3, MPR_INT32, 3, 1 },
+    { "y=(x>0)?x:-x",                       1, MPR_FLT,   1, MPR_FLT,   1, 1 },
+    { "y=[x*-2+1,0]",                       1, MPR_INT32, 2, MPR_DBL,   3, 1 },
+    { "y=x",                                1, MPR_INT32, 3, MPR_FLT,   3, 1 },
+    /* user variables and multiple statements */
+    { "a=x*2;y=a+1",                        1, MPR_FLT,   2, MPR_FLT,   2, 1 },
+    { "a=log(x);y=a*2",                     1, MPR_FLT,   1, MPR_FLT,   1, 1 },
+    /* constructs left to the interpreter */
+    { "y=x+y{-1}",                          1, MPR_FLT,   1, MPR_FLT,   1, 0 },
+    { "y=x.mean()",                         1, MPR_FLT,   3, MPR_FLT,   1, 0 },
+};
+
+int num_exprs = sizeof(exprs) / sizeof(test_expr_t);
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static void randomize(void *buffer, mpr_type type, int len)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        /* use a small range so integer expressions stay defined */
+        int r = rand() % 200 - 100;
+        switch (type) {
+            case MPR_INT32: ((int*)buffer)[i] = r;                                  break;
+            case MPR_FLT:   ((float*)buffer)[i] = r * 0.37f;                        break;
+            case MPR_DBL:   ((double*)buffer)[i] = r ? r * 0.37 : -INFINITY;        break;
+        }
+    }
+}
+
+typedef struct {
+    mpr_expr expr;
+    mpr_value out;
+    mpr_value vars[MAX_VARS];
+    mpr_value next;
+} test_eval_t;
+
+static void setup_eval(test_eval_t *t, test_expr_t *te, mpr_time time, int num_inst)
+{
+    int i, j, mlen;
+    mlen = mpr_expr_get_dst_mlen(t->expr, 0);
+    t->out = mpr_value_new(te->dst_len, te->dst_type, mlen, num_inst);
+    t->next = mpr_value_new(te->dst_len, te->dst_type, mlen, num_inst);
+    for (j = 0; j < num_inst; j++) {
+        mpr_value_reset_inst(t->out, j, time);
+        mpr_value_reset_inst(t->next, j, time);
+    }
+    for (i = 0; i < mpr_expr_get_num_vars(t->expr) && i < MAX_VARS; i++) {
+        int var_num_inst = mpr_expr_get_var_is_instanced(t->expr, i) ? num_inst : 1;
+        t->vars[i] = mpr_value_new(mpr_expr_get_var_vlen(t->expr, i),
+                                   mpr_expr_get_var_type(t->expr, i), 1, var_num_inst);
+        for (j = 0; j < var_num_inst; j++) {
+            mpr_value_reset_inst(t->vars[i], j, time);
+            mpr_value_incr_idx(t->vars[i], j, time);
+        }
+    }
+}
+
+static void free_eval(test_eval_t *t)
+{
+    int i;
+    for (i = 0; i < mpr_expr_get_num_vars(t->expr) && i < MAX_VARS; i++)
+        mpr_value_free(t->vars[i]);
+    mpr_value_free(t->out);
+    mpr_value_free(t->next);
+}
+
+static int compare_values(mpr_value a, mpr_value b, int inst_idx)
+{
+    int len = mpr_value_get_vlen(a);
+    size_t size = mpr_type_get_size(mpr_value_get_type(a)) * len;
+    if (memcmp(mpr_value_get_value(a, inst_idx, 0), mpr_value_get_value(b, inst_idx, 0), size))
+        return 1;
+    return mpr_bitflags_compare(mpr_value_get_elements_known(a, inst_idx),
+                                mpr_value_get_elements_known(b, inst_idx));
+}
+
+/* Evaluate a compiled expression for several instances at once, skipping a different instance
+ * each iteration, and compare with evaluating the same instances one at a time. */
+int run_batch(test_expr_t *te, test_eval_t *ref, test_eval_t *prog, mpr_expr_eval_buffer buff)
+{
+    mpr_value src[MAX_SRC];
+    char src_buff[MAX_LEN * sizeof(double)];
+    int inst_idx[NUM_INST], status[NUM_INST];
+    mpr_time time;
+    int i, j, k, num, result = 0, num_vars = mpr_expr_get_num_vars(ref->expr);
+
+    mpr_time_set(&time, MPR_NOW);
+    for (i = 0; i < te->num_src; i++)
+        src[i] = mpr_value_new(te->src_len, te->src_type,
+                               mpr_expr_get_src_mlen(ref->expr, i), NUM_INST);
+    setup_eval(ref, te, time, NUM_INST);
+    setup_eval(prog, te, time, NUM_INST);
+
+    for (i = 0; i < iterations && !result; i++) {
+        mpr_time_add_dbl(&time, 0.001);
+        for (j = 0, num = 0; j < NUM_INST; j++) {
+            if (j == i % NUM_INST)
+                continue;
+            inst_idx[num++] = j;
+            for (k = 0; k < te->num_src; k++) {
+                randomize(src_buff, te->src_type, te->src_len);
+                mpr_value_set_next(src[k], j, src_buff, time);
+            }
+        }
+        if (!mpr_expr_eval_batch(prog->expr, src, prog->vars, prog->out, &time, inst_idx, num,
+                                 status)) {
+            /* nothing to compare */
+            break;
+        }
+        for (j = 0; j < num && !result; j++) {
+            int ref_status = mpr_expr_eval(ref->expr, buff, src, ref->vars, ref->out, &time,
+                                           ref->next, inst_idx[j]);
+            if (status[j] < 0)
+                status[j] = mpr_expr_eval(prog->expr, buff, src, prog->vars, prog->out, &time,
+                                          prog->next, inst_idx[j]);
+            if (ref_status != status[j]) {
+                eprintf("batch status mismatch at iteration %d instance %d (%d != %d)\n", i,
+                        inst_idx[j], status[j], ref_status);
+                result = 1;
+            }
+            else if (compare_values(ref->out, prog->out, inst_idx[j])) {
+                eprintf("batch output mismatch at iteration %d instance %d\n", i, inst_idx[j]);
+                result = 1;
+            }
+            for (k = 0; k < num_vars && k < MAX_VARS && !result; k++) {
+                if (compare_values(ref->vars[k], prog->vars[k], inst_idx[j])) {
+                    eprintf("batch variable %d mismatch at iteration %d instance %d\n", k, i,
+                            inst_idx[j]);
+                    result = 1;
+                }
+            }
+        }
+    }
+    if (i) {
+        eprintf("batched... ");
+        ++num_batched;
+    }
+
+    for (i = 0; i < te->num_src; i++)
+        mpr_value_free(src[i]);
+    free_eval(prog);
+    free_eval(ref);
+    return result;
+}
+
+int run_expr(int idx)
+{
+    test_expr_t *te = &exprs[idx];
+    test_eval_t ref, prog;
+    mpr_expr_eval_buffer buff;
+    mpr_type src_types[MAX_SRC];
+    unsigned int src_lens[MAX_SRC];
+    mpr_value src[MAX_SRC];
+    char src_buff[MAX_LEN * sizeof(double)];
+    mpr_time time;
+    int i, j, result = 0, compiled, num_vars;
+
+    eprintf("Expression %d: '%s'... ", idx, te->str);
+    for (i = 0; i < te->num_src; i++) {
+        src_types[i] = te->src_type;
+        src_lens[i] = te->src_len;
+    }
+    ref.expr = mpr_expr_new_from_str(te->str, te->num_src, src_types, src_lens, 1,
+                                     &te->dst_type, &te->dst_len);
+    prog.expr = mpr_expr_new_from_str(te->str, te->num_src, src_types, src_lens, 1,
+                                      &te->dst_type, &te->dst_len);
+    if (!ref.expr || !prog.expr) {
+        eprintf("parser FAILED\n");
+        if (ref.expr)
+            mpr_expr_free(ref.expr);
+        if (prog.expr)
+            mpr_expr_free(prog.expr);
+        return 1;
+    }
+    mpr_expr_set_use_program(ref.expr, 0);
+    compiled = mpr_expr_set_use_program(prog.expr, 1);
+    eprintf("%s... ", compiled ? "compiled" : "interpreted");
+    if (compiled != te->compiled) {
+        eprintf("error: expected %s\n", te->compiled ? "compiled" : "interpreted");
+        result = 1;
+        goto free_exprs;
+    }
+    num_compiled += compiled;
+
+    buff = mpr_expr_new_eval_buffer(ref.expr);
+    mpr_time_set(&time, MPR_NOW);
+    for (i = 0; i < te->num_src; i++) {
+        src[i] = mpr_value_new(te->src_len, te->src_type, mpr_expr_get_src_mlen(ref.expr, i), 1);
+        mpr_value_reset_inst(src[i], 0, time);
+    }
+    setup_eval(&ref, te, time, 1);
+    setup_eval(&prog, te, time, 1);
+    num_vars = mpr_expr_get_num_vars(ref.expr);
+
+    for (i = 0; i < iterations && !result; i++) {
+        int ref_status, prog_status;
+        mpr_time_add_dbl(&time, 0.001);
+        for (j = 0; j < te->num_src; j++) {
+            randomize(src_buff, te->src_type, te->src_len);
+            mpr_value_set_next(src[j], 0, src_buff, time);
+        }
+        ref_status = mpr_expr_eval(ref.expr, buff, src, ref.vars, ref.out, &time, ref.next, 0);
+        prog_status = mpr_expr_eval(prog.expr, buff, src, prog.vars, prog.out, &time, prog.next, 0);
+        if (ref_status != prog_status) {
+            eprintf("status mismatch at iteration %d (%d != %d)\n", i, prog_status, ref_status);
+            result = 1;
+        }
+        else if (mpr_value_get_num_samps(ref.out, 0) != mpr_value_get_num_samps(prog.out, 0)) {
+            eprintf("history mismatch at iteration %d\n", i);
+            result = 1;
+        }
+        else if (compare_values(ref.out, prog.out, 0)) {
+            eprintf("output mismatch at iteration %d\n", i);
+            result = 1;
+        }
+        for (j = 0; j < num_vars && j < MAX_VARS && !result; j++) {
+            if (compare_values(ref.vars[j], prog.vars[j], 0)) {
+                eprintf("variable %d mismatch at iteration %d\n", j, i);
+                result = 1;
+            }
+        }
+    }
+
+    for (i = 0; i < te->num_src; i++)
+        mpr_value_free(src[i]);
+    free_eval(&prog);
+    free_eval(&ref);
+
+    if (!result && compiled)
+        result = run_batch(te, &ref, &prog, buff);
+    if (!result)
+        eprintf("OK\n");
+    mpr_expr_free_eval_buffer(buff);
+
+  free_exprs:
+    mpr_expr_free(ref.expr);
+    mpr_expr_free(prog.expr);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testbytecode.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (reduce iterations), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        iterations = 500;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    srand(time(NULL));
+
+    for (i = 0; i < num_exprs && !result; i++)
+        result = run_expr(i);
+
+    if (!result && !num_compiled) {
+        eprintf("No expressions were compiled.\n");
+        result = 1;
+    }
+    if (!result && !num_batched) {
+        eprintf("No expressions were evaluated in batches.\n");
+        result = 1;
+    }
+
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,244 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Services the data servers of two mapped devices on their own threads while the main thread
+ * only polls for administrative messages, and measures the latency of signal updates. The main
+ * thread also creates and frees signals and instances while the updates are being delivered. */
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 1000;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+mpr_sig sendinst = 0;
+mpr_sig recvinst = 0;
+
+int num_inst = 4;
+int sent = 0;
+int churned = 0;
+volatile int received = 0;
+volatile int received_inst = 0;
+double total_latency = 0, max_latency = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/* called on the data thread of the destination graph */
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    mpr_time now;
+    double latency;
+    if (!value)
+        return;
+    mpr_time_set(&now, MPR_NOW);
+    mpr_time_sub(&now, t);
+    latency = mpr_time_as_dbl(now);
+    total_latency += latency;
+    if (latency > max_latency)
+        max_latency = latency;
+    ++received;
+}
+
+/* called on the data thread of the destination graph */
+void inst_handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+                  mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received_inst;
+}
+
+int setup_devs(void)
+{
+    src = mpr_dev_new("testdatathread-send", 0);
+    dst = mpr_dev_new("testdatathread-recv", 0);
+    if (!src || !dst)
+        return 1;
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL, NULL, NULL, NULL,
+                          NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL, NULL, NULL, NULL,
+                          handler, MPR_SIG_UPDATE);
+    sendinst = mpr_sig_new(src, MPR_DIR_OUT, "outinst", 1, MPR_FLT, NULL, NULL, NULL,
+                           &num_inst, NULL, 0);
+    recvinst = mpr_sig_new(dst, MPR_DIR_IN, "ininst", 1, MPR_FLT, NULL, NULL, NULL,
+                           &num_inst, inst_handler, MPR_SIG_UPDATE);
+    if (!sendsig || !recvsig || !sendinst || !recvinst)
+        return 1;
+    if (   mpr_graph_start_data_thread(mpr_obj_get_graph((mpr_obj)src))
+        || mpr_graph_start_data_thread(mpr_obj_get_graph((mpr_obj)dst))) {
+        /* not supported on this platform */
+        return 2;
+    }
+    return 0;
+}
+
+void poll_devs(int block_ms)
+{
+    mpr_dev_poll(src, 0);
+    mpr_dev_poll(dst, block_ms);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst)))
+        poll_devs(25);
+    eprintf("Devices are ready.\n");
+    return done;
+}
+
+int setup_map(void)
+{
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_map inst_map = mpr_map_new(1, &sendinst, 1, &recvinst);
+    mpr_obj_push((mpr_obj)map);
+    mpr_obj_push((mpr_obj)inst_map);
+    while (!done && !(mpr_map_get_is_ready(map) && mpr_map_get_is_ready(inst_map)))
+        poll_devs(25);
+    eprintf("Maps are ready.\n");
+    return done;
+}
+
+/* Create and free signals and instances of both devices while their data threads may be
+ * delivering updates to the same devices. */
+void churn(int i)
+{
+    mpr_id id = num_inst + i;
+    char name[16];
+    mpr_sig sig;
+
+    snprintf(name, 16, "churn%d", i % 8);
+    sig = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_FLT, NULL, NULL, NULL, &num_inst,
+                      inst_handler, MPR_SIG_UPDATE);
+    mpr_sig_set_cb(recvinst, inst_handler, MPR_SIG_UPDATE);
+    mpr_sig_reserve_inst(recvinst, 1, &id, NULL);
+    mpr_sig_reserve_inst(sendinst, 1, &id, NULL);
+    mpr_sig_remove_inst(sendinst, id);
+    mpr_sig_remove_inst(recvinst, id);
+    mpr_sig_free(sig);
+    ++churned;
+}
+
+void loop(void)
+{
+    int i = 0, stalled = 0;
+    eprintf("Sending updates from the main thread...\n");
+    while ((!terminate || i < iterations) && !done) {
+        if (sent == received) {
+            float f = (float)i;
+            mpr_sig_set_value(sendinst, i % num_inst, 1, MPR_FLT, &f);
+            mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &i);
+            ++sent;
+            churn(i);
+            ++i;
+            stalled = 0;
+        }
+        else if (++stalled > 500) {
+            eprintf("Update %d was not received.\n", i - 1);
+            break;
+        }
+        /* the admin plane is polled with a long timeout, which must not delay the updates */
+        poll_devs(10);
+    }
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testdatathread.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    switch (setup_devs()) {
+        case 0:
+            break;
+        case 2:
+            eprintf("Data thread is not available, skipping.\n");
+            goto done;
+        default:
+            eprintf("Error initializing devices.\n");
+            result = 1;
+            goto done;
+    }
+
+    if (wait_ready() || setup_map()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    if (sent != received) {
+        eprintf("Not all sent messages were received.\n");
+        eprintf("Updated value %d time%s, but received %d of them.\n",
+                sent, sent == 1 ? "" : "s", received);
+        result = 1;
+    }
+    else if (received) {
+        eprintf("Received %d updates with mean latency %f and maximum latency %f seconds.\n",
+                received, total_latency / received, max_latency);
+    }
+    if (   mpr_obj_get_prop_as_int32((mpr_obj)sendinst, MPR_PROP_NUM_INST, NULL) != num_inst
+        || mpr_obj_get_prop_as_int32((mpr_obj)recvinst, MPR_PROP_NUM_INST, NULL) != num_inst) {
+        eprintf("Instances reserved during updates were not all removed.\n");
+        result = 1;
+    }
+    else {
+        eprintf("Created and freed %d signals and instances while receiving %d instance "
+                "updates.\n", churned, received_inst);
+    }
+
+  done:
+    if (dst)
+        mpr_dev_free(dst);
+    if (src)
+        mpr_dev_free(src);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
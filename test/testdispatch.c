@@ -0,0 +1,174 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <lo/lo.h>
+
+/* Measures the rate at which a device receives and dispatches updates addressed to signal paths
+ * as the number of signals grows. The receive path resolves each message through a single
+ * wildcard handler, so the throughput should stay roughly flat as signals are added. */
+
+#define NUM_COUNTS 5
+#define BUNDLE_SIZE 64
+
+int verbose = 1;
+int iterations = 100000;    /* number of updates sent for each signal count */
+int done = 0;
+
+int sig_counts[NUM_COUNTS] = { 1, 10, 100, 1000, 5000 };
+
+mpr_dev dev = 0;
+int received = 0;
+int mismatched = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    /* each signal receives its own index as the value */
+    if (*(int*)value != (int)(size_t)mpr_obj_get_prop_as_ptr((mpr_obj)sig, MPR_PROP_DATA, NULL))
+        ++mismatched;
+    ++received;
+}
+
+int run_count(int num_sigs)
+{
+    char name[32];
+    lo_address addr;
+    lo_bundle b = 0;
+    mpr_sig *sigs;
+    mpr_time start, elapsed;
+    int i, port, sent = 0, result = 0, polls = 0;
+
+    sigs = (mpr_sig*)calloc(1, sizeof(mpr_sig) * num_sigs);
+    for (i = 0; i < num_sigs; i++) {
+        snprintf(name, 32, "in/%d", i);
+        sigs[i] = mpr_sig_new(dev, MPR_DIR_IN, name, 1, MPR_INT32, NULL, NULL, NULL, NULL,
+                              handler, MPR_SIG_UPDATE);
+        mpr_obj_set_prop((mpr_obj)sigs[i], MPR_PROP_DATA, NULL, 1, MPR_PTR,
+                         (void*)(size_t)i, 0);
+    }
+    mpr_dev_poll(dev, 0);
+
+    port = mpr_obj_get_prop_as_int32((mpr_obj)dev, MPR_PROP_PORT, NULL);
+    snprintf(name, 32, "%d", port);
+    addr = lo_address_new("127.0.0.1", name);
+
+    received = mismatched = 0;
+    mpr_time_set(&start, MPR_NOW);
+    while (!done && received < iterations) {
+        /* keep a bounded number of updates in flight so the socket buffer does not overflow */
+        while (sent < iterations && sent - received < BUNDLE_SIZE * 4) {
+            lo_message m = lo_message_new();
+            int idx = sent % num_sigs;
+            if (!b)
+                b = lo_bundle_new(LO_TT_IMMEDIATE);
+            lo_message_add_int32(m, idx);
+            snprintf(name, 32, "/in/%d", idx);
+            lo_bundle_add_message(b, name, m);
+            if (++sent % BUNDLE_SIZE == 0 || sent == iterations) {
+                lo_send_bundle(addr, b);
+                lo_bundle_free_recursive(b);
+                b = 0;
+            }
+        }
+        mpr_dev_poll(dev, 0);
+        if (++polls > iterations * 10) {
+            eprintf("Timed out waiting for updates.\n");
+            result = 1;
+            break;
+        }
+    }
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+
+    if (b)
+        lo_bundle_free_recursive(b);
+    lo_address_free(addr);
+
+    if (mismatched) {
+        eprintf("%d updates were dispatched to the wrong signal.\n", mismatched);
+        result = 1;
+    }
+    else if (!result) {
+        double secs = mpr_time_as_dbl(elapsed);
+        eprintf("  %5d signals: %d updates in %f seconds (%.0f updates/sec)\n",
+                num_sigs, received, secs, secs > 0 ? received / secs : 0);
+    }
+
+    for (i = 0; i < num_sigs; i++)
+        mpr_sig_free(sigs[i]);
+    free(sigs);
+    return result;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testdispatch.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (reduce iterations), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        iterations = 5000;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    dev = mpr_dev_new("testdispatch", 0);
+    if (!dev) {
+        eprintf("Error creating device.\n");
+        result = 1;
+        goto done;
+    }
+    while (!done && !mpr_dev_get_is_ready(dev))
+        mpr_dev_poll(dev, 25);
+
+    eprintf("Receive throughput by number of signals:\n");
+    for (i = 0; i < NUM_COUNTS && !done && !result; i++)
+        result = run_count(sig_counts[i]);
+
+  done:
+    if (dev)
+        mpr_dev_free(dev);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
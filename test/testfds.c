@@ -0,0 +1,241 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+
+/* Drives two mapped devices from an external poll() loop using the file descriptors and
+ * deadlines exported by their graphs instead of calling mpr_dev_poll(). */
+
+#define MAX_FDS 16
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 100;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+mpr_map map = 0;
+
+int sent = 0;
+int received = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value) {
+        eprintf("handler: Got %d\n", *(int*)value);
+        ++received;
+    }
+}
+
+/* Wait on the sockets of both devices for up to timeout_ms and process them. */
+int wait_fds(int timeout_ms)
+{
+    struct pollfd pfds[MAX_FDS * 2];
+    int fds[MAX_FDS], i, num, num_pfds = 0, deadline;
+    mpr_dev devs[2];
+    devs[0] = src;
+    devs[1] = dst;
+
+    for (i = 0; i < 2; i++) {
+        mpr_graph g = mpr_obj_get_graph((mpr_obj)devs[i]);
+        int j;
+        num = mpr_graph_get_fds(g, fds, MAX_FDS);
+        if (num > MAX_FDS) {
+            eprintf("Too many file descriptors (%d).\n", num);
+            return 1;
+        }
+        for (j = 0; j < num; j++) {
+            pfds[num_pfds].fd = fds[j];
+            pfds[num_pfds].events = POLLIN;
+            pfds[num_pfds].revents = 0;
+            ++num_pfds;
+        }
+        deadline = mpr_graph_get_deadline(g);
+        if (deadline < timeout_ms)
+            timeout_ms = deadline;
+    }
+    poll(pfds, num_pfds, timeout_ms);
+
+    for (i = 0; i < 2; i++)
+        mpr_graph_process_fds(mpr_obj_get_graph((mpr_obj)devs[i]));
+    return 0;
+}
+
+int setup_devs(void)
+{
+    src = mpr_dev_new("testfds-send", 0);
+    dst = mpr_dev_new("testfds-recv", 0);
+    if (!src || !dst)
+        return 1;
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL, NULL, NULL, NULL,
+                          NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL, NULL, NULL, NULL,
+                          handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig;
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        if (wait_fds(100))
+            return 1;
+    }
+    eprintf("Devices are ready.\n");
+    return done;
+}
+
+int setup_map(void)
+{
+    map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        if (wait_fds(100))
+            return 1;
+    }
+    eprintf("Map is ready.\n");
+    return done;
+}
+
+void loop(void)
+{
+    int i = 0, stalled = 0;
+    eprintf("Polling devices through exported file descriptors...\n");
+    while ((!terminate || i < iterations) && !done) {
+        if (sent == received) {
+            eprintf("Updating signal %s to %d\n", "outsig", i);
+            mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &i);
+            ++sent;
+            ++i;
+            stalled = 0;
+        }
+        else if (++stalled > 50) {
+            eprintf("Update %d was not received.\n", i - 1);
+            break;
+        }
+        if (wait_fds(100))
+            break;
+    }
+}
+
+/* Updates to a muted map are dropped, and must not leave it queued for processing. Otherwise
+ * the deadline stays at zero and an external loop spins. */
+int test_muted(void)
+{
+    int i, muted = 1, num_received = received, idle = 0;
+    mpr_graph g = mpr_obj_get_graph((mpr_obj)src);
+    eprintf("Muting map...\n");
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_MUTED, NULL, 1, MPR_BOOL, &muted, 1);
+    mpr_obj_push((mpr_obj)map);
+    for (i = 0; i < 50 && !mpr_obj_get_prop_as_int32((mpr_obj)map, MPR_PROP_MUTED, NULL); i++) {
+        if (wait_fds(100))
+            return 1;
+    }
+    if (!mpr_obj_get_prop_as_int32((mpr_obj)map, MPR_PROP_MUTED, NULL)) {
+        eprintf("Map was not muted.\n");
+        return 1;
+    }
+
+    mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
+    for (i = 0; i < 10 && !idle; i++) {
+        mpr_graph_process_fds(g);
+        idle = mpr_graph_get_deadline(g) > 0;
+    }
+    if (!idle) {
+        eprintf("Processing deadline of muted map stayed at zero.\n");
+        return 1;
+    }
+    wait_fds(100);
+    if (received != num_received) {
+        eprintf("Muted map delivered an update.\n");
+        return 1;
+    }
+    eprintf("Muted map was dequeued.\n");
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testfds.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs()) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready() || setup_map()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    if (sent != received) {
+        eprintf("Not all sent messages were received.\n");
+        eprintf("Updated value %d time%s, but received %d of them.\n",
+                sent, sent == 1 ? "" : "s", received);
+        result = 1;
+    }
+    else if (!done && test_muted())
+        result = 1;
+
+  done:
+    if (dst)
+        mpr_dev_free(dst);
+    if (src)
+        mpr_dev_free(src);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -33,7 +33,7 @@ int main(int argc, char **argv)
     mpr_msg props;
     uint64_t id = 1;
     mpr_graph graph;
-    mpr_list devlist, siglist, maplist, maplist2;
+    mpr_list devlist, siglist, siglist2, maplist, maplist2;
     mpr_dev dev;
     mpr_sig sig;
     mpr_map map;
@@ -894,6 +894,38 @@ int main(int argc, char **argv)
 
     /*********/
 
+    eprintf("\nIndex materialized list of signals:\n");
+
+    siglist = mpr_list_materialize(mpr_graph_get_list(graph, MPR_SIG));
+    count = mpr_list_get_size(siglist);
+    if (count != mpr_list_get_size(mpr_graph_get_list(graph, MPR_SIG))) {
+        eprintf("Materialized list holds %d signals.\n", count);
+        result = 1;
+        mpr_list_free(siglist);
+        goto done;
+    }
+    for (i = count - 1; i >= 0; i--) {
+        /* compare with the items found by iterating a copy of the list from the start */
+        mpr_list cpy = mpr_list_start(mpr_list_get_cpy(siglist));
+        for (j = 0; j < i; j++)
+            cpy = mpr_list_get_next(cpy);
+        if (!cpy || mpr_list_get_idx(siglist, i) != *cpy) {
+            eprintf("Signal %d does not match iteration order.\n", i);
+            result = 1;
+        }
+        mpr_list_free(cpy);
+    }
+    if (mpr_list_get_idx(siglist, count)) {
+        eprintf("Found signal beyond the end of the list.\n");
+        result = 1;
+    }
+    mpr_list_free(siglist);
+    if (result)
+        goto done;
+    eprintf("  indexed %d signals.\n", count);
+
+    /*********/
+
     eprintf("\nFind maps for device 'testgraph.1', source 'out1':\n");
 
     devlist = mpr_graph_get_list(graph, MPR_DEV);
@@ -1193,6 +1225,43 @@ int main(int argc, char **argv)
 
     /*********/
 
+    eprintf("\n--- removal during queries ---\n");
+
+    eprintf("\nRemove device 'testgraph.1' while its signals are being queried:\n");
+
+    devlist = mpr_graph_get_list(graph, MPR_DEV);
+    devlist = mpr_list_filter(devlist, MPR_PROP_NAME, NULL, 1, MPR_STR, "testgraph.1", MPR_OP_EQ);
+    if (!devlist || !(dev = (mpr_dev)*devlist)) {
+        eprintf("failed to find device 'testgraph.1'.\n");
+        result = 1;
+        goto done;
+    }
+    mpr_list_free(devlist);
+
+    siglist = mpr_dev_get_sigs(dev, MPR_DIR_ANY);
+    if (!siglist) {
+        eprintf("signal query returned 0.\n");
+        result = 1;
+        goto done;
+    }
+    siglist = mpr_list_get_next(siglist);
+    siglist2 = mpr_list_get_cpy(siglist);
+
+    /* the queries must end rather than read the freed signal array */
+    mpr_graph_remove_dev(graph, dev, MPR_STATUS_REMOVED);
+    siglist = mpr_list_get_next(siglist);
+    siglist2 = mpr_list_get_next(siglist2);
+    if (siglist || siglist2) {
+        eprintf("Queries continued after their device was removed.\n");
+        mpr_list_free(siglist);
+        mpr_list_free(siglist2);
+        result = 1;
+        goto done;
+    }
+    eprintf("queries ended.\n");
+
+    /*********/
+
     /* skipping allow/block origin query – not currently working! */
     goto done;
 
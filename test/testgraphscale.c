@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <lo/lo_lowlevel.h>
+
+#include "../src/graph.h"
+#include "../src/message.h"
+#include <mapper/mapper.h>
+
+/* Loads a synthetic graph of remote devices, signals and maps the way the admin message handlers
+ * do, then measures how quickly the graph handles a resync: a repeated /signal message for every
+ * signal and an id lookup for every map, as performed by handler_sig() and find_map(). Filters the
+ * signals using the property indexes and checks the results against filters that test every
+ * signal. Finally removes half of the devices and checks that their objects can no longer be
+ * found. */
+
+#define MAPS_PER_DEV 44
+#define NUM_TAGS 4
+
+int verbose = 1;
+int num_devs = 800;         /* 800 devices, 64000 signals and 35200 maps */
+int sigs_per_dev = 80;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double get_time(void)
+{
+    mpr_time t;
+    mpr_time_set(&t, MPR_NOW);
+    return mpr_time_as_dbl(t);
+}
+
+static mpr_id get_sig_id(int dev_idx, int sig_idx)
+{
+    return ((mpr_id)(dev_idx + 1) << 32) | (mpr_id)(sig_idx + 1);
+}
+
+static mpr_id get_map_id(int dev_idx, int map_idx)
+{
+    return ((mpr_id)(dev_idx + 1) << 32) | (mpr_id)(sigs_per_dev + map_idx + 1);
+}
+
+static mpr_msg new_sig_props(lo_message lom, mpr_id id, int tag)
+{
+    lo_message_add_string(lom, "@direction");
+    lo_message_add_string(lom, "output");
+    lo_message_add_string(lom, "@tag");
+    lo_message_add_int32(lom, tag);
+    lo_message_add_string(lom, "@type");
+    lo_message_add_char(lom, 'f');
+    lo_message_add_string(lom, "@length");
+    lo_message_add_int32(lom, 1);
+    lo_message_add_string(lom, "@id");
+    lo_message_add_int64(lom, id);
+    return mpr_msg_parse_props(lo_message_get_argc(lom), lo_message_get_types(lom),
+                               lo_message_get_argv(lom));
+}
+
+static int add_sigs(mpr_graph graph)
+{
+    char dev_name[32], sig_name[32];
+    int i, j;
+    for (i = 0; i < num_devs; i++) {
+        snprintf(dev_name, 32, "testgraphscale.%d", i + 1);
+        for (j = 0; j < sigs_per_dev; j++) {
+            lo_message lom = lo_message_new();
+            mpr_msg props = new_sig_props(lom, get_sig_id(i, j), j % NUM_TAGS);
+            snprintf(sig_name, 32, "sig%d", j);
+            if (!mpr_graph_add_sig(graph, sig_name, dev_name, props)) {
+                eprintf("Error adding signal %s/%s\n", dev_name, sig_name);
+                return 1;
+            }
+            mpr_msg_free(props);
+            lo_message_free(lom);
+        }
+    }
+    return 0;
+}
+
+static int add_maps(mpr_graph graph)
+{
+    char src_name[64], dst_name[64];
+    const char *src_names[1] = {src_name};
+    int i, j;
+    for (i = 0; i < num_devs; i++) {
+        for (j = 0; j < MAPS_PER_DEV; j++) {
+            snprintf(src_name, 64, "testgraphscale.%d/sig%d", i + 1, j);
+            snprintf(dst_name, 64, "testgraphscale.%d/sig%d", (i + 1) % num_devs + 1, j);
+            if (!mpr_graph_add_map(graph, get_map_id(i, j), 1, src_names, dst_name)) {
+                eprintf("Error adding map %s -> %s\n", src_name, dst_name);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Look up the objects of a range of devices, returning the number that were found if they were
+ * not expected or missing if they were. */
+static int find_objs(mpr_graph graph, int first_dev, int last_dev, int expected)
+{
+    char dev_name[32];
+    int i, j, errors = 0;
+    for (i = first_dev; i < last_dev; i++) {
+        mpr_dev dev;
+        snprintf(dev_name, 32, "testgraphscale.%d", i + 1);
+        dev = mpr_graph_get_dev_by_name(graph, dev_name);
+        errors += !dev != !expected;
+        for (j = 0; j < sigs_per_dev; j++) {
+            mpr_obj sig = mpr_graph_get_obj(graph, get_sig_id(i, j), MPR_SIG);
+            if (!expected)
+                errors += sig != 0;
+            else if (   !sig || mpr_obj_get_id(sig) != get_sig_id(i, j)
+                     || mpr_sig_get_dev((mpr_sig)sig) != dev)
+                ++errors;
+        }
+        for (j = 0; j < MAPS_PER_DEV; j++) {
+            mpr_obj map = mpr_graph_get_obj(graph, get_map_id(i, j), MPR_MAP);
+            errors += !map != !expected;
+        }
+    }
+    return errors;
+}
+
+/* Filter the signals of the graph using the indexes, then filter a materialized copy of the list
+ * that cannot use them and check that both filters find the same signals. Returns the number of
+ * signals found, or -1 if the results differ. */
+static int filter_sigs(mpr_graph graph, mpr_prop prop, const char *key, mpr_type type,
+                       const void *val, mpr_op op)
+{
+    mpr_list indexed, scanned;
+    int count = 0;
+    indexed = mpr_list_filter(mpr_graph_get_list(graph, MPR_SIG), prop, key, 1, type, val, op);
+    scanned = mpr_list_materialize(mpr_graph_get_list(graph, MPR_SIG));
+    scanned = mpr_list_filter(scanned, prop, key, 1, type, val, op);
+    while (indexed && scanned && *indexed == *scanned) {
+        ++count;
+        indexed = mpr_list_get_next(indexed);
+        scanned = mpr_list_get_next(scanned);
+    }
+    if (indexed || scanned) {
+        mpr_list_free(indexed);
+        mpr_list_free(scanned);
+        return -1;
+    }
+    return count;
+}
+
+static int filter_all(mpr_graph graph)
+{
+    int tag = 1, num_sigs = num_devs * sigs_per_dev, errors = 0;
+    mpr_type type = MPR_FLT;
+    mpr_dev dev = mpr_graph_get_dev_by_name(graph, "testgraphscale.1");
+    errors += filter_sigs(graph, MPR_PROP_NAME, NULL, MPR_STR, "sig7", MPR_OP_EQ) != num_devs;
+    errors += filter_sigs(graph, MPR_PROP_NAME, NULL, MPR_STR, "sig7*", MPR_OP_EQ) < num_devs;
+    errors += filter_sigs(graph, MPR_PROP_DEV, NULL, MPR_PTR, dev, MPR_OP_EQ) != sigs_per_dev;
+    errors += filter_sigs(graph, MPR_PROP_TYPE, NULL, MPR_TYPE, &type, MPR_OP_EQ) != num_sigs;
+    errors += filter_sigs(graph, MPR_PROP_EXTRA, "tag", MPR_INT32, &tag,
+                          MPR_OP_EQ) != num_sigs / NUM_TAGS;
+    errors += filter_sigs(graph, MPR_PROP_EXTRA, "tag", MPR_INT32, &tag,
+                          MPR_OP_GT) != num_sigs / NUM_TAGS * 2;
+    errors += filter_sigs(graph, MPR_PROP_EXTRA, "tag", MPR_INT32, &tag,
+                          MPR_OP_LTE) != num_sigs / NUM_TAGS * 2;
+    return errors;
+}
+
+static int get_count(mpr_graph graph, int type)
+{
+    return mpr_list_get_size(mpr_graph_get_list(graph, type));
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, num_objs, errors = 0, new_tag = NUM_TAGS;
+    double start, elapsed;
+    mpr_graph graph;
+    mpr_list list;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testgraphscale.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (reduce graph size), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        num_devs = 80;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    graph = mpr_graph_new(0);
+    num_objs = num_devs * (1 + sigs_per_dev + MAPS_PER_DEV);
+    eprintf("Loading %d devices, %d signals and %d maps...\n", num_devs,
+            num_devs * sigs_per_dev, num_devs * MAPS_PER_DEV);
+
+    start = get_time();
+    if (add_sigs(graph) || add_maps(graph)) {
+        result = 1;
+        goto done;
+    }
+    elapsed = get_time() - start;
+    eprintf("  loaded %d objects in %f seconds (%.0f objects/sec)\n", num_objs, elapsed,
+            num_objs / elapsed);
+
+    if (   get_count(graph, MPR_DEV) != num_devs
+        || get_count(graph, MPR_SIG) != num_devs * sigs_per_dev
+        || get_count(graph, MPR_MAP) != num_devs * MAPS_PER_DEV) {
+        eprintf("Error: graph holds %d devices, %d signals and %d maps.\n",
+                get_count(graph, MPR_DEV), get_count(graph, MPR_SIG), get_count(graph, MPR_MAP));
+        result = 1;
+        goto done;
+    }
+
+    /* a resync repeats the metadata for every signal and map already in the graph */
+    eprintf("Handling resync...\n");
+    start = get_time();
+    if (add_sigs(graph) || (errors = find_objs(graph, 0, num_devs, 1))) {
+        eprintf("Error: %d objects not found after resync.\n", errors);
+        result = 1;
+        goto done;
+    }
+    elapsed = get_time() - start;
+    num_objs = num_devs * (sigs_per_dev * 2 + MAPS_PER_DEV + 1);
+    eprintf("  handled %d messages and lookups in %f seconds (%.0f/sec)\n", num_objs, elapsed,
+            num_objs / elapsed);
+
+    eprintf("Filtering signals...\n");
+    mpr_graph_add_index(graph, MPR_SIG, MPR_PROP_EXTRA, "tag");
+    if ((errors = filter_all(graph))) {
+        eprintf("Error: %d filters did not match.\n", errors);
+        result = 1;
+        goto done;
+    }
+    start = get_time();
+    for (i = 0; i < 100; i++) {
+        int tag = i % NUM_TAGS;
+        mpr_list_free(mpr_list_filter(mpr_graph_get_list(graph, MPR_SIG), MPR_PROP_EXTRA, "tag", 1,
+                                      MPR_INT32, &tag, MPR_OP_EQ));
+    }
+    elapsed = get_time() - start;
+    eprintf("  filtered %d signals 100 times in %f seconds\n", num_devs * sigs_per_dev, elapsed);
+
+    /* the index must follow changes made through the property tables, while properties that are
+     * maintained outside of the tables cannot be indexed */
+    list = mpr_graph_get_list(graph, MPR_SIG);
+    mpr_obj_set_prop(*list, MPR_PROP_EXTRA, "tag", 1, MPR_INT32, &new_tag, 0);
+    mpr_list_free(list);
+    if (   filter_sigs(graph, MPR_PROP_EXTRA, "tag", MPR_INT32, &new_tag, MPR_OP_EQ) != 1
+        || mpr_graph_add_index(graph, MPR_SIG, MPR_PROP_NUM_INST, NULL)) {
+        eprintf("Error: index is stale or accepted an unindexable property.\n");
+        result = 1;
+        goto done;
+    }
+
+    eprintf("Removing half of the devices...\n");
+    for (i = num_devs / 2; i < num_devs; i++) {
+        char dev_name[32];
+        snprintf(dev_name, 32, "testgraphscale.%d", i + 1);
+        mpr_graph_remove_dev(graph, mpr_graph_get_dev_by_name(graph, dev_name),
+                             MPR_STATUS_REMOVED);
+    }
+    /* maps from the last remaining device led to a removed one */
+    if (   get_count(graph, MPR_DEV) != num_devs / 2
+        || find_objs(graph, num_devs / 2, num_devs, 0)
+        || find_objs(graph, 0, num_devs / 2 - 1, 1)
+        || filter_sigs(graph, MPR_PROP_NAME, NULL, MPR_STR, "sig7", MPR_OP_EQ) != num_devs / 2) {
+        eprintf("Error: indexes do not match the graph after removing devices.\n");
+        result = 1;
+    }
+
+  done:
+    mpr_graph_free(graph);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,155 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Measures the cost of looking up an active signal instance by id as the number of active
+ * instances grows. Instance lookup should stay flat rather than scaling with the instance count. */
+
+#define NUM_SIZES 5
+
+int verbose = 1;
+int shared_graph = 0;
+int iterations = 100000;
+int done = 0;
+
+mpr_dev dev = 0;
+
+int sizes[NUM_SIZES] = {1, 10, 100, 1000, 10000};
+double times[NUM_SIZES];
+int num_active[NUM_SIZES];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/* Activate `num_inst` instances of a new signal and time updates to random active instances.
+ * Returns the number of mismatched values read back, or -1 on error. */
+int run_trial(int trial)
+{
+    int i, num_inst = sizes[trial], *expected, errors = 0;
+    char name[32];
+    mpr_sig sig;
+    mpr_time start, elapsed;
+
+    snprintf(name, 32, "sig%d", num_inst);
+    sig = mpr_sig_new(dev, MPR_DIR_OUT, name, 1, MPR_INT32, NULL, NULL, NULL, &num_inst, NULL, 0);
+    if (!sig)
+        return -1;
+
+    /* the number of reserved instances may be capped by the library */
+    num_inst = mpr_obj_get_prop_as_int32((mpr_obj)sig, MPR_PROP_NUM_INST, NULL);
+    expected = (int*)calloc(1, sizeof(int) * num_inst);
+
+    /* activate all instances */
+    for (i = 0; i < num_inst; i++) {
+        expected[i] = i;
+        mpr_sig_set_value(sig, i, 1, MPR_INT32, &expected[i]);
+    }
+    num_active[trial] = mpr_sig_get_num_inst(sig, MPR_STATUS_ACTIVE);
+
+    srand(trial);
+    mpr_time_set(&start, MPR_NOW);
+    for (i = 0; i < iterations && !done; i++) {
+        int id = rand() % num_inst;
+        ++expected[id];
+        mpr_sig_set_value(sig, id, 1, MPR_INT32, &expected[id]);
+    }
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+    times[trial] = mpr_time_as_dbl(elapsed) / iterations;
+
+    /* check that every update reached the right instance */
+    for (i = 0; i < num_inst; i++) {
+        const int *val = (const int*)mpr_sig_get_value(sig, i, NULL);
+        if (!val || *val != expected[i]) {
+            eprintf("error: instance %d has value %d, expected %d\n", i, val ? *val : -1,
+                    expected[i]);
+            ++errors;
+        }
+    }
+
+    free(expected);
+    mpr_sig_free(sig);
+    return errors;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    mpr_graph g;
+
+    /* process flags for -v verbose, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testidmap.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (execute quickly), "
+                               "-s shared (use one mpr_graph only), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 10000;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 's':
+                        shared_graph = 1;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    g = shared_graph ? mpr_graph_new(0) : 0;
+
+    dev = mpr_dev_new("testidmap", g);
+    if (!dev) {
+        eprintf("Error creating device.\n");
+        result = 1;
+        goto done;
+    }
+
+    for (i = 0; i < NUM_SIZES && !done; i++) {
+        int errors = run_trial(i);
+        if (errors) {
+            eprintf("Trial with %d instances failed.\n", sizes[i]);
+            result = 1;
+        }
+        else
+            eprintf("%5d instances requested, %5d active: %f usec per update\n",
+                    sizes[i], num_active[i], times[i] * 1000000);
+    }
+
+  done:
+    if (dev)
+        mpr_dev_free(dev);
+    if (g)
+        mpr_graph_free(g);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -29,6 +29,8 @@
 int verbose = 1;
 char str[MAX_STR_LEN];
 mpr_expr e;
+mpr_expr e_interp;
+int num_compared = 0;
 int iterations = 20000;
 int expression_count = 1;
 int token_count = 0;
@@ -53,6 +55,9 @@ mpr_expr_eval_buffer eval_buff = 0;
 
 /* signal_history structures */
 mpr_value inh[MAX_SRC_ARRAY_LEN], outh, user_vars[MAX_VARS], time_next;
+
+/* histories for the interpreted copy of expressions that are compiled */
+mpr_value outh_interp, user_vars_interp[MAX_VARS], time_next_interp;
 mpr_type src_types[MAX_NUM_SRC], dst_type;
 unsigned int src_lens[MAX_NUM_SRC], n_sources, dst_len;
 
@@ -279,6 +284,56 @@ void setup_test(mpr_type in_type, int in_len, mpr_type out_type, int out_len)
     setup_test_multisource(1, &in_type, &in_len, out_type, out_len);
 }
 
+static int compare_values(mpr_value a, mpr_value b)
+{
+    const void *val_a = mpr_value_get_value(a, 0, 0), *val_b = mpr_value_get_value(b, 0, 0);
+    mpr_time time_a, time_b;
+    if (!val_a || !val_b)
+        return val_a != val_b;
+    if (memcmp(val_a, val_b, mpr_type_get_size(mpr_value_get_type(a)) * mpr_value_get_vlen(a)))
+        return 1;
+    time_a = mpr_value_get_time(a, 0, 0);
+    time_b = mpr_value_get_time(b, 0, 0);
+    if (memcmp(&time_a, &time_b, sizeof(mpr_time)))
+        return 1;
+    return mpr_bitflags_compare(mpr_value_get_elements_known(a, 0),
+                                mpr_value_get_elements_known(b, 0));
+}
+
+/* Evaluate the expression. If it was compiled, also evaluate its interpreted copy with the same
+ * inputs and random seed, and check that the status, output and user variables are bit-identical.
+ * Returns the status of the expression, or -1 if the results differ. */
+static int eval_and_compare(void)
+{
+    int i, status, interp_status;
+    unsigned int seed;
+
+    if (!e_interp)
+        return mpr_expr_eval(e, eval_buff, inh, user_vars, outh, &time_in, time_next, 0);
+
+    seed = rand();
+    srand(seed);
+    status = mpr_expr_eval(e, eval_buff, inh, user_vars, outh, &time_in, time_next, 0);
+    srand(seed);
+    interp_status = mpr_expr_eval(e_interp, eval_buff, inh, user_vars_interp, outh_interp,
+                                  &time_in, time_next_interp, 0);
+    if (status != interp_status) {
+        eprintf("compiled status %d differs from interpreted status %d\n", status, interp_status);
+        return -1;
+    }
+    if (compare_values(outh, outh_interp)) {
+        eprintf("compiled output differs from interpreted output\n");
+        return -1;
+    }
+    for (i = 0; i < mpr_expr_get_num_vars(e); i++) {
+        if (compare_values(user_vars[i], user_vars_interp[i])) {
+            eprintf("compiled variable %d differs from interpreted variable\n", i);
+            return -1;
+        }
+    }
+    return status;
+}
+
 #define PARSE_SUCCESS   0x00
 #define PARSE_FAILURE   0x01
 #define EVAL_SUCCESS    0x00
@@ -316,6 +371,14 @@ int parse_and_eval(int expectation, int check_val, int exp_updates,
         goto free;
     }
     mpr_expr_realloc_eval_buffer(e, eval_buff);
+
+    /* compare compiled expressions with an interpreted copy */
+    if (mpr_expr_set_use_program(e, 1)) {
+        e_interp = mpr_expr_new_from_str(str, n_sources, src_types, src_lens, 1, &dst_type,
+                                         &dst_len);
+        mpr_expr_set_use_program(e_interp, 0);
+        ++num_compared;
+    }
     mpr_time_set(&time_in, MPR_NOW);
     for (i = 0; i < n_sources; i++) {
         mlen = mpr_expr_get_src_mlen(e, i);
@@ -342,6 +405,13 @@ int parse_and_eval(int expectation, int check_val, int exp_updates,
     mpr_value_realloc(time_next, dst_len, dst_type, mlen, 1, 1);
     mpr_value_reset_inst(time_next, 0, time_in);
 
+    if (e_interp) {
+        mpr_value_realloc(outh_interp, dst_len, dst_type, mlen, 1, 1);
+        mpr_value_reset_inst(outh_interp, 0, time_in);
+        mpr_value_realloc(time_next_interp, dst_len, dst_type, mlen, 1, 1);
+        mpr_value_reset_inst(time_next_interp, 0, time_in);
+    }
+
     if (mpr_expr_get_num_vars(e) > MAX_VARS) {
         eprintf("Maximum variables exceeded.\n");
         if (!(PARSE_FAILURE & expectation))
@@ -356,6 +426,11 @@ int parse_and_eval(int expectation, int check_val, int exp_updates,
         mpr_value_realloc(user_vars[i], vlen, type, 1, 1, 0);
         mpr_value_reset_inst(user_vars[i], 0, time_in);
         mpr_value_incr_idx(user_vars[i], 0, MPR_NOW);
+        if (e_interp) {
+            mpr_value_realloc(user_vars_interp[i], vlen, type, 1, 1, 0);
+            mpr_value_reset_inst(user_vars_interp[i], 0, time_in);
+            mpr_value_incr_idx(user_vars_interp[i], 0, MPR_NOW);
+        }
     }
 
     num_subexpr = mpr_expr_get_num_subexpr(e);
@@ -384,9 +459,13 @@ int parse_and_eval(int expectation, int check_val, int exp_updates,
     updated_values = mpr_bitflags_new(MAX_DST_ARRAY_LEN);
 
     eprintf("Try evaluation once... ");
-    status = mpr_expr_eval(e, eval_buff, inh, user_vars, outh, &time_in, time_next, 0);
+    status = eval_and_compare();
 
-    if (!status) {
+    if (status < 0) {
+        result = 1;
+        goto free;
+    }
+    else if (!status) {
         eprintf("FAILED.\n");
         if (!(EVAL_FAILURE & expectation))
             result = 1;
@@ -428,7 +507,11 @@ int parse_and_eval(int expectation, int check_val, int exp_updates,
                     assert(0);
             }
         }
-        status = mpr_expr_eval(e, eval_buff, inh, user_vars, outh, &time_in, time_next, 0);
+        status = eval_and_compare();
+        if (status < 0) {
+            result = 1;
+            goto free;
+        }
         if (status & EXPR_UPDATE) {
             ++update_count;
             mpr_bitflags_clear(updated_values);
@@ -464,6 +547,10 @@ free:
     mpr_expr_free(e);
 
 fail:
+    if (e_interp) {
+        mpr_expr_free(e_interp);
+        e_interp = 0;
+    }
     return result;
 }
 
@@ -2118,9 +2205,13 @@ int main(int argc, char **argv)
     for (i = 0; i < MAX_SRC_ARRAY_LEN; i++)
         inh[i] = mpr_value_new(1, MPR_INT32, 1, 0);
     outh = mpr_value_new(1, MPR_INT32, 1, 0);
+    outh_interp = mpr_value_new(1, MPR_INT32, 1, 0);
     time_next = mpr_value_new(1, MPR_DBL, 1, 0);
-    for (i = 0; i < MAX_VARS; i++)
+    time_next_interp = mpr_value_new(1, MPR_DBL, 1, 0);
+    for (i = 0; i < MAX_VARS; i++) {
         user_vars[i] = mpr_value_new(1, MPR_INT32, 1, 0);
+        user_vars_interp[i] = mpr_value_new(1, MPR_INT32, 1, 0);
+    }
 
     eprintf("**********************************\n");
     seed_srand();
@@ -2149,12 +2240,22 @@ int main(int argc, char **argv)
     eval_buff = mpr_expr_new_eval_buffer(NULL);
     result = run_tests();
     mpr_expr_free_eval_buffer(eval_buff);
+    if (!result && start_index < 0 && !num_compared) {
+        eprintf("No expressions were compiled.\n");
+        result = 1;
+    }
+    eprintf("Compared %d compiled expressions with the interpreter.\n", num_compared);
 
     for (i = 0; i < MAX_SRC_ARRAY_LEN; i++)
         mpr_value_free(inh[i]);
     mpr_value_free(outh);
-    for (i = 0; i < MAX_VARS; i++)
+    mpr_value_free(outh_interp);
+    mpr_value_free(time_next);
+    mpr_value_free(time_next_interp);
+    for (i = 0; i < MAX_VARS; i++) {
         mpr_value_free(user_vars[i]);
+        mpr_value_free(user_vars_interp[i]);
+    }
 
     eprintf("**********************************\n");
     printf("\r..................................................Test %s\x1B[0m.",
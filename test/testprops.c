@@ -1327,6 +1327,33 @@ int main(int argc, char **argv)
     else
         eprintf("OK\n");
 
+    eprintf("Test 49: removing extra properties matching 'wild*'... ");
+    mpr_obj_set_prop(sig, MPR_PROP_EXTRA, "wild1", 1, MPR_INT32, &int_value, 1);
+    mpr_obj_set_prop(sig, MPR_PROP_EXTRA, "wild2", 1, MPR_INT32, &int_value, 1);
+    if (   !mpr_obj_remove_prop(sig, MPR_PROP_EXTRA, "wild*")
+        || mpr_obj_get_prop_by_key(sig, "wild1", NULL, NULL, NULL, NULL)
+        || mpr_obj_get_prop_by_key(sig, "wild2", NULL, NULL, NULL, NULL)
+        || !mpr_obj_get_prop_by_key(sig, "x", NULL, NULL, NULL, NULL)) {
+        eprintf("ERROR\n");
+        result = 1;
+        goto cleanup;
+    }
+    else
+        eprintf("OK\n");
+
+    eprintf("Test 50: looking up an extra property matching 'wil*'... ");
+    int_value = 50;
+    mpr_obj_set_prop(sig, MPR_PROP_EXTRA, "wild3", 1, MPR_INT32, &int_value, 1);
+    if (   MPR_PROP_EXTRA != mpr_obj_get_prop_by_key(sig, "wil*", &length, &type, &value, NULL)
+        || 1 != length || MPR_INT32 != type || 50 != *(int*)value
+        || mpr_obj_get_prop_by_key(sig, "wix*", NULL, NULL, NULL, NULL)) {
+        eprintf("ERROR\n");
+        result = 1;
+        goto cleanup;
+    }
+    else
+        eprintf("OK\n");
+
   cleanup:
     if (dev) mpr_dev_free(dev);
     if (graph) mpr_graph_free(graph);
@@ -0,0 +1,234 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+
+/* Hammers a signal with updates queued by several producer threads using mpr_sig_queue_value()
+ * while the main thread polls the devices. Each producer updates its own instance with a vector
+ * holding its index and a sequence number repeated across the remaining elements, so the
+ * destination can check that updates are neither torn nor reordered. */
+
+#define NUM_PRODUCERS 4
+#define VEC_LEN 4
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 100000;    /* number of updates queued by each producer */
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+volatile int queued[NUM_PRODUCERS];
+int rejected[NUM_PRODUCERS];
+int last_received[NUM_PRODUCERS];
+int received = 0;
+int errors = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    const int *v = (const int*)value;
+    int i;
+    if (!value)
+        return;
+    ++received;
+    if (v[0] < 0 || v[0] >= NUM_PRODUCERS) {
+        ++errors;
+        return;
+    }
+    for (i = 2; i < VEC_LEN; i++) {
+        if (v[i] != v[1]) {
+            eprintf("Torn update from producer %d: %d != %d\n", v[0], v[i], v[1]);
+            ++errors;
+        }
+    }
+    /* intermediate values may be skipped but never reordered */
+    if (v[1] <= last_received[v[0]]) {
+        eprintf("Update %d from producer %d arrived after %d\n", v[1], v[0],
+                last_received[v[0]]);
+        ++errors;
+    }
+    last_received[v[0]] = v[1];
+}
+
+void *producer(void *arg)
+{
+    int idx = (int)(size_t)arg, i, v[VEC_LEN];
+    v[0] = idx;
+    for (i = 1; i <= iterations && !done; i++) {
+        int j;
+        for (j = 1; j < VEC_LEN; j++)
+            v[j] = i;
+        /* retry until there is space in the queue */
+        while (mpr_sig_queue_value(sendsig, idx, VEC_LEN, MPR_INT32, v, MPR_NOW)) {
+            if (done)
+                return 0;
+            ++rejected[idx];
+            sched_yield();
+        }
+        queued[idx] = i;
+    }
+    return 0;
+}
+
+int setup_devs(void)
+{
+    int num_inst = NUM_PRODUCERS;
+    src = mpr_dev_new("testqueue-send", 0);
+    dst = mpr_dev_new("testqueue-recv", 0);
+    if (!src || !dst)
+        return 1;
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", VEC_LEN, MPR_INT32, NULL, NULL, NULL,
+                          &num_inst, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", VEC_LEN, MPR_INT32, NULL, NULL, NULL,
+                          &num_inst, handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig;
+}
+
+void poll_devs(int block_ms)
+{
+    mpr_dev_poll(src, 0);
+    mpr_dev_poll(dst, block_ms);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst)))
+        poll_devs(25);
+    eprintf("Devices are ready.\n");
+    return done;
+}
+
+int setup_map(void)
+{
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map))
+        poll_devs(25);
+    eprintf("Map is ready.\n");
+    return done;
+}
+
+int run(void)
+{
+    pthread_t threads[NUM_PRODUCERS];
+    int i, finished, caught_up, stalled = 0;
+
+    eprintf("Queueing %d updates from each of %d threads...\n", iterations, NUM_PRODUCERS);
+    for (i = 0; i < NUM_PRODUCERS; i++) {
+        if (pthread_create(&threads[i], 0, producer, (void*)(size_t)i)) {
+            eprintf("Error creating producer thread.\n");
+            done = 1;
+            while (--i >= 0)
+                pthread_join(threads[i], NULL);
+            return 1;
+        }
+    }
+
+    /* poll until every producer has finished and its last update has arrived */
+    do {
+        poll_devs(1);
+        for (i = 0, finished = 0, caught_up = 1; i < NUM_PRODUCERS; i++) {
+            finished += queued[i] == iterations;
+            caught_up &= last_received[i] == queued[i];
+        }
+        caught_up &= finished == NUM_PRODUCERS;
+        if (finished == NUM_PRODUCERS && !caught_up && ++stalled > 5000) {
+            eprintf("Timed out waiting for the last updates.\n");
+            break;
+        }
+    } while (!done && !caught_up);
+
+    done = 1;
+    for (i = 0; i < NUM_PRODUCERS; i++)
+        pthread_join(threads[i], NULL);
+
+    for (i = 0; i < NUM_PRODUCERS; i++) {
+        eprintf("  producer %d: queued %d updates, %d retries, last received %d\n",
+                i, queued[i], rejected[i], last_received[i]);
+    }
+    eprintf("Received %d updates in total.\n", received);
+    return !caught_up || errors;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testqueue.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-f fast (reduce iterations), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case 'f':
+                        iterations = 5000;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs()) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready() || setup_map()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = run();
+
+  done:
+    if (dst)
+        mpr_dev_free(dst);
+    if (src)
+        mpr_dev_free(src);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,274 @@
+#include "../src/ring.h"
+
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Exercises the shared-memory ring used between co-located devices: records wrapping around
+ * the end of the ring, a full ring refusing further records, consumers detaching and attaching
+ * again, the wakeup handshake, and corrupt record lengths written by a misbehaving producer. */
+
+#define RING_SIZE 4096
+
+int verbose = 1;
+int iterations = 10000;
+
+char name[32];
+mpr_ring prod = 0;
+mpr_ring cons = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/* records hold their sequence number followed by a pattern derived from it */
+static size_t rec_len(int seq)
+{
+    return sizeof(int) + (seq * 37) % 300;
+}
+
+static int write_rec(int seq)
+{
+    size_t i, len = rec_len(seq);
+    char *rec = mpr_ring_reserve(prod, len);
+    if (!rec)
+        return 0;
+    memcpy(rec, &seq, sizeof(int));
+    for (i = sizeof(int); i < len; i++)
+        rec[i] = (char)(seq + i);
+    mpr_ring_commit(prod);
+    return 1;
+}
+
+/* returns 0 if the ring is empty, 1 if the expected record was read, and -1 on error */
+static int read_rec(int seq)
+{
+    size_t i, len;
+    int val;
+    const char *rec = mpr_ring_read(cons, &len);
+    if (!rec)
+        return 0;
+    memcpy(&val, rec, sizeof(int));
+    if (val != seq || len != rec_len(seq)) {
+        eprintf("Read record %d with length %d, expected record %d with length %d\n",
+                val, (int)len, seq, (int)rec_len(seq));
+        return -1;
+    }
+    for (i = sizeof(int); i < len; i++) {
+        if (rec[i] != (char)(seq + i)) {
+            eprintf("Record %d is corrupt at byte %d\n", seq, (int)i);
+            return -1;
+        }
+    }
+    mpr_ring_release(cons);
+    return 1;
+}
+
+/* The consumer lags behind the producer by a varying number of records, so records are placed
+ * at every offset and regularly wrap around the end of the ring. */
+int test_wraparound(void)
+{
+    int written = 0, read = 0, ret;
+    eprintf("Testing wraparound...\n");
+    while (read < iterations) {
+        int burst = rand() % 16;
+        while (burst-- && written < iterations && write_rec(written))
+            ++written;
+        burst = rand() % 16;
+        while (burst-- && (ret = read_rec(read))) {
+            if (ret < 0)
+                return 1;
+            ++read;
+        }
+        if (read == written && written < iterations && !write_rec(written++)) {
+            eprintf("Empty ring refused a record\n");
+            return 1;
+        }
+    }
+    if (read_rec(read)) {
+        eprintf("Ring holds more records than were written\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* A full ring refuses records without overwriting unread ones, and accepts them again once
+ * the consumer has caught up. Senders drop records refused by a full ring rather than sending
+ * them by other means, since those could overtake the records still in the ring. */
+int test_full(void)
+{
+    int i, written = 0, ret;
+    eprintf("Testing full ring...\n");
+    while (write_rec(written))
+        ++written;
+    if (written < 2 || written * (int)sizeof(int) > RING_SIZE) {
+        eprintf("Ring accepted %d records\n", written);
+        return 1;
+    }
+    for (i = 0; i < written; i++) {
+        if ((ret = read_rec(i)) <= 0) {
+            if (!ret)
+                eprintf("Record %d of %d was lost\n", i, written);
+            return 1;
+        }
+    }
+    if (read_rec(written)) {
+        eprintf("Refused record was written\n");
+        return 1;
+    }
+    if (!write_rec(0) || read_rec(0) <= 0) {
+        eprintf("Drained ring refused a record\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* Records written while no consumer is attached wait for the next consumer, and only one
+ * consumer may be attached at a time. */
+int test_attach(void)
+{
+    int i;
+    mpr_ring other;
+    eprintf("Testing attach and detach...\n");
+    if (!mpr_ring_get_is_attached(prod)) {
+        eprintf("Consumer is not attached\n");
+        return 1;
+    }
+    if ((other = mpr_ring_open(name))) {
+        eprintf("Second consumer was attached\n");
+        mpr_ring_free(other);
+        return 1;
+    }
+    for (i = 0; i < 3; i++)
+        write_rec(i);
+    if (read_rec(0) <= 0)
+        return 1;
+    mpr_ring_free(cons);
+    if (mpr_ring_get_is_attached(prod)) {
+        cons = 0;
+        eprintf("Consumer is still attached after detaching\n");
+        return 1;
+    }
+    if (!(cons = mpr_ring_open(name))) {
+        eprintf("Consumer could not attach again\n");
+        return 1;
+    }
+    for (i = 1; i < 3; i++) {
+        if (read_rec(i) <= 0) {
+            eprintf("Record %d was lost while detached\n", i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* The producer only needs to wake a consumer that declared it is about to block, and only
+ * once per wait. */
+int test_wake(void)
+{
+    eprintf("Testing wakeups...\n");
+    if (mpr_ring_wake(prod)) {
+        eprintf("Wakeup requested by a consumer that is not waiting\n");
+        return 1;
+    }
+    if (!mpr_ring_wait(cons)) {
+        eprintf("Consumer may not block on an empty ring\n");
+        return 1;
+    }
+    write_rec(0);
+    if (!mpr_ring_wake(prod) || mpr_ring_wake(prod)) {
+        eprintf("Waiting consumer was not woken exactly once\n");
+        return 1;
+    }
+    if (mpr_ring_wait(cons)) {
+        eprintf("Consumer may block on a ring holding records\n");
+        return 1;
+    }
+    mpr_ring_wake(prod);
+    return read_rec(0) <= 0;
+}
+
+/* Record lengths are read from memory shared with another process, so a corrupt length must
+ * not lead the consumer outside the ring. */
+int test_corrupt(void)
+{
+    uint32_t bad[] = {100, RING_SIZE / 2, RING_SIZE - 4, 0x7FFFFFF8, 0xFFFFFFF0};
+    int i;
+    eprintf("Testing corrupt records...\n");
+    for (i = 0; i < 5; i++) {
+        size_t len;
+        char *rec = mpr_ring_reserve(prod, 8);
+        if (!rec)
+            return 1;
+        mpr_ring_commit(prod);
+        /* the length is stored in the 8-byte header preceding the record */
+        *(uint32_t*)(rec - 8) = bad[i];
+        if (mpr_ring_read(cons, &len)) {
+            eprintf("Record with length %u was read\n", bad[i]);
+            return 1;
+        }
+    }
+    /* the ring is usable again once the corrupt records have been discarded */
+    if (!write_rec(0) || read_rec(0) <= 0)
+        return 1;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -q quiet, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testring.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    snprintf(name, 32, "/mpr.testring.%d", (int)getpid());
+    if (!(prod = mpr_ring_new(name, RING_SIZE))) {
+        eprintf("Shared memory is not available, skipping.\n");
+        goto done;
+    }
+    if (mpr_ring_get_is_attached(prod) || !(cons = mpr_ring_open(name))) {
+        eprintf("Error attaching to ring.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = test_wraparound() || test_full() || test_attach() || test_wake() || test_corrupt();
+
+  done:
+    if (cons)
+        mpr_ring_free(cons);
+    if (prod)
+        mpr_ring_free(prod);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,302 @@
+#include <mapper/mapper.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Exercises the scheduling of self-timed maps by their processing device: maps with different
+ * periods must fire in the order of their scheduled times, removing a map must cancel its pending
+ * evaluations, and a muted map must resume its schedule once it is unmuted. Each map outputs the
+ * time its evaluation was scheduled for, so the received values can be checked against the
+ * schedule. */
+
+#define NUM_MAPS 4
+#define MAX_RECS 1024
+
+/* Scheduled times are offset by a multiple of 10ms for each map and do not coincide, so the
+ * order of evaluations is fully determined by the schedule. */
+#define PHASE 0.01
+#define START 10.0
+#define EPSILON 0.0001
+
+int verbose = 1;
+int done = 0;
+
+double periods[NUM_MAPS] = { 0.04, 0.08, 0.12, 0.16 };
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsigs[NUM_MAPS];
+mpr_sig recvsigs[NUM_MAPS];
+mpr_map maps[NUM_MAPS];
+
+/* received values, in order of arrival, and the times they were processed */
+int rec_idx[MAX_RECS];
+double rec_time[MAX_RECS];
+double rec_proc[MAX_RECS];
+int num_recs = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    if (!value || num_recs >= MAX_RECS)
+        return;
+    for (i = 0; i < NUM_MAPS; i++) {
+        if (sig == recvsigs[i]) {
+            rec_idx[num_recs] = i;
+            rec_proc[num_recs] = mpr_time_as_dbl(t);
+            rec_time[num_recs++] = *(double*)value;
+            eprintf("map %d fired at %.3f\n", i, fmod(*(double*)value, 100));
+            return;
+        }
+    }
+}
+
+/* Poll both devices for the given duration. */
+void poll_for(double sec)
+{
+    mpr_time start, now;
+    mpr_time_set(&start, MPR_NOW);
+    do {
+        mpr_dev_poll(src, 1);
+        mpr_dev_poll(dst, 0);
+        mpr_time_set(&now, MPR_NOW);
+    } while (!done && mpr_time_as_dbl(now) - mpr_time_as_dbl(start) < sec);
+}
+
+int count_recs(int idx)
+{
+    int i, count = 0;
+    for (i = 0; i < num_recs; i++)
+        count += (rec_idx[i] == idx);
+    return count;
+}
+
+int setup(void)
+{
+    int i;
+    char name[16];
+    double zero = 0;
+
+    src = mpr_dev_new("testscheduler-send", 0);
+    dst = mpr_dev_new("testscheduler-recv", 0);
+    if (!src || !dst)
+        return 1;
+    for (i = 0; i < NUM_MAPS; i++) {
+        snprintf(name, 16, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_DBL, NULL, NULL, NULL, NULL,
+                                  NULL, 0);
+        snprintf(name, 16, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_DBL, NULL, NULL, NULL, NULL,
+                                  handler, MPR_SIG_UPDATE);
+        mpr_sig_set_value(sendsigs[i], 0, 1, MPR_DBL, &zero);
+    }
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int setup_maps(void)
+{
+    int i, ready = 0;
+    char expr[128];
+    for (i = 0; i < NUM_MAPS; i++) {
+        /* output the scheduled time of this evaluation, then schedule the next one */
+        snprintf(expr, 128, "y=next; next=periodic(%g,%g);", periods[i], START + i * PHASE);
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_set_prop((mpr_obj)maps[i], MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (i = 0, ready = 1; i < NUM_MAPS; i++)
+            ready &= mpr_map_get_is_ready(maps[i]);
+    }
+    return done;
+}
+
+/* Checks that the received values follow the schedule: each map fires at whole multiples of its
+ * period, and evaluations of different maps arrive in the order they were scheduled. Updates
+ * processed together share a bundle whose order is not checked. The first value received from
+ * each map was scheduled when its expression was set and is skipped. */
+int check_schedule(int first)
+{
+    int i, seen[NUM_MAPS] = {0};
+    double last[NUM_MAPS], prev = 0, prev_proc = 0;
+    for (i = first; i < num_recs; i++) {
+        int idx = rec_idx[i];
+        double t = rec_time[i], n;
+        if (!seen[idx]++) {
+            last[idx] = t;
+            continue;
+        }
+        n = floor((t - last[idx]) / periods[idx] + 0.5);
+        if (n < 1 || fabs(t - last[idx] - n * periods[idx]) > EPSILON) {
+            eprintf("Map %d fired %gs after its previous evaluation, expected a multiple of %gs\n",
+                    idx, t - last[idx], periods[idx]);
+            return 1;
+        }
+        if (t < prev - EPSILON && rec_proc[i] != prev_proc) {
+            eprintf("Map %d fired out of order, %gs before the previous evaluation\n",
+                    idx, prev - t);
+            return 1;
+        }
+        last[idx] = t;
+        if (t > prev)
+            prev = t;
+        prev_proc = rec_proc[i];
+    }
+    return 0;
+}
+
+int test_order(void)
+{
+    int i;
+    eprintf("Testing firing order...\n");
+    poll_for(periods[NUM_MAPS - 1] * 8);
+    for (i = 0; i < NUM_MAPS; i++) {
+        if (count_recs(i) < 4) {
+            eprintf("Map %d fired %d times\n", i, count_recs(i));
+            return 1;
+        }
+    }
+    return check_schedule(0);
+}
+
+/* Removes a map while its next evaluation is pending; the remaining maps keep their schedule. */
+int test_remove(void)
+{
+    int i;
+    mpr_id id = mpr_obj_get_prop_as_int64((mpr_obj)maps[1], MPR_PROP_ID, NULL);
+    mpr_graph g = mpr_obj_get_graph((mpr_obj)src);
+    eprintf("Testing removal of a scheduled map...\n");
+    mpr_map_release(maps[1]);
+    for (i = 0; i < 100 && mpr_graph_get_obj(g, id, MPR_MAP); i++)
+        poll_for(0.01);
+    if (mpr_graph_get_obj(g, id, MPR_MAP)) {
+        eprintf("Map was not removed\n");
+        return 1;
+    }
+    maps[1] = 0;
+
+    /* discard updates that were already sent */
+    poll_for(0.05);
+    num_recs = 0;
+    poll_for(periods[1] * 4);
+    if (count_recs(1)) {
+        eprintf("Removed map fired %d times\n", count_recs(1));
+        return 1;
+    }
+    if (count_recs(0) < 4 || count_recs(3) < 1) {
+        eprintf("Remaining maps stopped firing\n");
+        return 1;
+    }
+    return check_schedule(0);
+}
+
+int set_muted(mpr_map map, int muted)
+{
+    int i;
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_MUTED, NULL, 1, MPR_BOOL, &muted, 1);
+    mpr_obj_push((mpr_obj)map);
+    for (i = 0; i < 100; i++) {
+        if (mpr_obj_get_prop_as_int32((mpr_obj)map, MPR_PROP_MUTED, NULL) == muted)
+            return 0;
+        poll_for(0.01);
+    }
+    eprintf("Map was not %s\n", muted ? "muted" : "unmuted");
+    return 1;
+}
+
+/* A muted map stops firing, and resumes its schedule once it is unmuted. */
+int test_unmute(void)
+{
+    int first;
+    eprintf("Testing muting and unmuting a scheduled map...\n");
+    if (set_muted(maps[2], 1))
+        return 1;
+    poll_for(0.05);
+    num_recs = 0;
+    poll_for(periods[2] * 4);
+    if (count_recs(2)) {
+        eprintf("Muted map fired %d times\n", count_recs(2));
+        return 1;
+    }
+
+    if (set_muted(maps[2], 0))
+        return 1;
+    first = num_recs;
+    poll_for(periods[2] * 4);
+    if (count_recs(2) < 2) {
+        eprintf("Unmuted map fired %d times\n", count_recs(2));
+        return 1;
+    }
+    return check_schedule(first);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -q quiet, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testscheduler.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup() || setup_maps()) {
+        eprintf("Error initializing devices and maps.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = test_order() || test_remove() || test_unmute();
+
+  done:
+    if (dst)
+        mpr_dev_free(dst);
+    if (src)
+        mpr_dev_free(src);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,237 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Services several devices sharing a graph with a pool of data threads. Each source device is
+ * mapped to a destination device serviced by another thread, so updates must be handed over
+ * between the threads. Sources are spread over both threads, and half of the maps use an
+ * expression that cannot be compiled so that the interpreter runs on both threads at once. */
+
+#define NUM_PAIRS 4
+#define NUM_THREADS 2
+
+/* referencing history leaves the expression to the interpreter, the result is still x */
+#define INTERPRETED_EXPR "y=x+x{-1}*2-x{-1}*2"
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 1000;
+
+mpr_graph graph = 0;
+mpr_dev srcs[NUM_PAIRS];
+mpr_dev dsts[NUM_PAIRS];
+mpr_sig sendsigs[NUM_PAIRS];
+mpr_sig recvsigs[NUM_PAIRS];
+
+int sent = 0;
+volatile int received[NUM_PAIRS];
+int errors = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/* called on the data thread servicing the destination device */
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    if (!value)
+        return;
+    for (i = 0; i < NUM_PAIRS; i++) {
+        if (sig != recvsigs[i])
+            continue;
+        if (*(const int*)value != received[i]) {
+            eprintf("Pair %d received %d, expected %d\n", i, *(const int*)value, received[i]);
+            ++errors;
+        }
+        ++received[i];
+    }
+}
+
+int setup_devs(void)
+{
+    int i;
+    char name[32];
+    graph = mpr_graph_new(0);
+    /* devices are assigned to the data threads in turn, so each pair spans two threads; odd
+     * pairs are created in reverse order so that sources are processed on both threads */
+    for (i = 0; i < NUM_PAIRS; i++) {
+        if (i % 2) {
+            snprintf(name, 32, "testshards-recv%d", i);
+            if (!(dsts[i] = mpr_dev_new(name, graph)))
+                return 1;
+        }
+        snprintf(name, 32, "testshards-send%d", i);
+        if (!(srcs[i] = mpr_dev_new(name, graph)))
+            return 1;
+        if (!(i % 2)) {
+            snprintf(name, 32, "testshards-recv%d", i);
+            if (!(dsts[i] = mpr_dev_new(name, graph)))
+                return 1;
+        }
+        sendsigs[i] = mpr_sig_new(srcs[i], MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL, NULL, NULL,
+                                  NULL, NULL, 0);
+        recvsigs[i] = mpr_sig_new(dsts[i], MPR_DIR_IN, "insig", 1, MPR_INT32, NULL, NULL, NULL,
+                                  NULL, handler, MPR_SIG_UPDATE);
+        if (!sendsigs[i] || !recvsigs[i])
+            return 1;
+    }
+    if (mpr_graph_start_data_threads(graph, NUM_THREADS)) {
+        /* not supported on this platform */
+        return 2;
+    }
+    return 0;
+}
+
+int wait_ready(void)
+{
+    int i, ready = 0;
+    while (!done && !ready) {
+        mpr_graph_poll(graph, 25);
+        for (i = 0, ready = 1; i < NUM_PAIRS; i++)
+            ready &= mpr_dev_get_is_ready(srcs[i]) && mpr_dev_get_is_ready(dsts[i]);
+    }
+    eprintf("Devices are ready.\n");
+    return done;
+}
+
+int setup_maps(void)
+{
+    mpr_map maps[NUM_PAIRS];
+    int i, ready = 0;
+    for (i = 0; i < NUM_PAIRS; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        if (i >= NUM_PAIRS / 2)
+            mpr_obj_set_prop((mpr_obj)maps[i], MPR_PROP_EXPR, NULL, 1, MPR_STR,
+                             INTERPRETED_EXPR, 1);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        mpr_graph_poll(graph, 25);
+        for (i = 0, ready = 1; i < NUM_PAIRS; i++)
+            ready &= mpr_map_get_is_ready(maps[i]);
+    }
+    eprintf("Maps are ready.\n");
+    return done;
+}
+
+int caught_up(void)
+{
+    int i;
+    for (i = 0; i < NUM_PAIRS; i++) {
+        if (received[i] != sent)
+            return 0;
+    }
+    return 1;
+}
+
+void loop(void)
+{
+    int i, stalled = 0;
+    eprintf("Sending updates from the main thread...\n");
+    while ((!terminate || sent < iterations) && !done) {
+        if (caught_up()) {
+            for (i = 0; i < NUM_PAIRS; i++)
+                mpr_sig_set_value(sendsigs[i], 0, 1, MPR_INT32, &sent);
+            ++sent;
+            stalled = 0;
+        }
+        else if (++stalled > 500) {
+            eprintf("Update %d was not received.\n", sent - 1);
+            break;
+        }
+        mpr_graph_poll(graph, 10);
+    }
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testshards.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    switch (setup_devs()) {
+        case 0:
+            break;
+        case 2:
+            eprintf("Data threads are not available, skipping.\n");
+            goto done;
+        default:
+            eprintf("Error initializing devices.\n");
+            result = 1;
+            goto done;
+    }
+
+    if (wait_ready() || setup_maps()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    if (!caught_up() || errors) {
+        eprintf("Sent %d updates to each pair, but received", sent);
+        for (i = 0; i < NUM_PAIRS; i++)
+            eprintf(" %d", received[i]);
+        eprintf(" with %d errors.\n", errors);
+        result = 1;
+    }
+    else
+        eprintf("Received %d updates on each of %d pairs.\n", sent, NUM_PAIRS);
+
+  done:
+    for (i = 0; i < NUM_PAIRS; i++) {
+        if (dsts[i])
+            mpr_dev_free(dsts[i]);
+        if (srcs[i])
+            mpr_dev_free(srcs[i]);
+    }
+    if (graph)
+        mpr_graph_free(graph);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,192 @@
+#include "../src/expression.h"
+#include "../src/mpr_time.h"
+#include "../src/value.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <mapper/mapper.h>
+
+/* Compares the vectorized and scalar evaluation of vector expressions over a range of vector
+ * lengths and element types. Results must match exactly, including reductions, which are always
+ * accumulated in element order. */
+
+#define NUM_LENS 13
+#define MAX_LEN 4096
+
+int verbose = 1;
+int elements = 1 << 22;     /* number of elements to process for each timing */
+
+typedef struct {
+    const char *str;
+    int reduce;             /* the result is a reduction to a single element */
+    int float_only;
+} test_expr_t;
+
+test_expr_t exprs[] = {
+    { "y=x*x+x",                0, 0 },
+    { "y=max(x+x*x,x-3)",       0, 0 },
+    { "y=min(max(x,-1),1)",     0, 0 },
+    { "y=(x>=0)*x-(x<0)",       0, 0 },
+    { "y=x/3-sqrt(abs(x))",     0, 1 },
+    { "y=x.sum()",              1, 0 },
+    { "y=x.norm()",             1, 1 },
+    { "y=dot(x,x)",             1, 0 },
+};
+
+int num_exprs = sizeof(exprs) / sizeof(test_expr_t);
+
+mpr_type types[] = { MPR_INT32, MPR_FLT, MPR_DBL };
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static void randomize(void *buffer, mpr_type type, int len)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        /* use a small range so integer expressions do not overflow */
+        int r = rand() % 200 - 100;
+        switch (type) {
+            case MPR_INT32: ((int*)buffer)[i] = r;              break;
+            case MPR_FLT:   ((float*)buffer)[i] = r * 0.37f;    break;
+            case MPR_DBL:   ((double*)buffer)[i] = r * 0.37;    break;
+        }
+    }
+}
+
+/* Evaluate an expression repeatedly and return the time per evaluation. */
+static double time_eval(mpr_expr expr, mpr_expr_eval_buffer buff, mpr_value *src,
+                        mpr_value out, mpr_time *time, int iterations)
+{
+    int i;
+    mpr_time start, elapsed;
+    mpr_time_set(&start, MPR_NOW);
+    for (i = 0; i < iterations; i++) {
+        mpr_time_add_dbl(time, 0.001);
+        mpr_expr_eval(expr, buff, src, 0, out, time, 0, 0);
+    }
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+    return mpr_time_as_dbl(elapsed) / iterations;
+}
+
+int run_expr(test_expr_t *te, mpr_type type, int len, int use_program)
+{
+    mpr_expr expr;
+    mpr_expr_eval_buffer buff;
+    mpr_value src, out;
+    mpr_type out_type = type;
+    unsigned int src_len = len, out_len = te->reduce ? 1 : len;
+    char src_buff[MAX_LEN * sizeof(double)], ref_buff[MAX_LEN * sizeof(double)];
+    double scalar_time, simd_time;
+    mpr_time time;
+    int iterations, result = 0, size;
+
+    expr = mpr_expr_new_from_str(te->str, 1, &type, &src_len, 1, &out_type, &out_len);
+    if (!expr) {
+        eprintf("%s: parser FAILED for length %d\n", te->str, len);
+        return 1;
+    }
+    mpr_expr_set_use_program(expr, use_program);
+    buff = mpr_expr_new_eval_buffer(expr);
+    mpr_time_set(&time, MPR_NOW);
+    src = mpr_value_new(len, type, mpr_expr_get_src_mlen(expr, 0), 1);
+    mpr_value_reset_inst(src, 0, time);
+    out = mpr_value_new(out_len, type, mpr_expr_get_dst_mlen(expr, 0), 1);
+    mpr_value_reset_inst(out, 0, time);
+    size = mpr_type_get_size(type) * out_len;
+
+    randomize(src_buff, type, len);
+    mpr_value_set_next(src, 0, src_buff, time);
+
+    /* reference result using the scalar loops */
+    mpr_expr_set_use_simd(0);
+    mpr_expr_eval(expr, buff, &src, 0, out, &time, 0, 0);
+    memcpy(ref_buff, mpr_value_get_value(out, 0, 0), size);
+
+    mpr_expr_set_use_simd(1);
+    mpr_time_add_dbl(&time, 0.001);
+    mpr_expr_eval(expr, buff, &src, 0, out, &time, 0, 0);
+    if (memcmp(ref_buff, mpr_value_get_value(out, 0, 0), size)) {
+        eprintf("%s: output mismatch for type '%c' and length %d\n", te->str, type, len);
+        result = 1;
+        goto done;
+    }
+
+    iterations = elements / len;
+    mpr_expr_set_use_simd(0);
+    scalar_time = time_eval(expr, buff, &src, out, &time, iterations);
+    mpr_expr_set_use_simd(1);
+    simd_time = time_eval(expr, buff, &src, out, &time, iterations);
+    eprintf("  %c %4d: %10.3f %10.3f usec %6.2fx\n", type, len, scalar_time * 1000000,
+            simd_time * 1000000, simd_time > 0 ? scalar_time / simd_time : 0);
+
+  done:
+    mpr_value_free(src);
+    mpr_value_free(out);
+    mpr_expr_free_eval_buffer(buff);
+    mpr_expr_free(expr);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, k, len, use_program, result = 0;
+    const char *isa;
+
+    /* process flags for -v verbose, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsimd.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (reduce iterations), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        elements = 1 << 14;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    srand(0);
+    isa = mpr_expr_set_use_simd(1);
+    eprintf("Using '%s' kernels.\n", isa);
+
+    for (use_program = 1; use_program >= 0 && !result; use_program--) {
+        eprintf("%s:\n", use_program ? "Compiled programs" : "Interpreter");
+        for (i = 0; i < num_exprs && !result; i++) {
+            eprintf("Expression '%s'             scalar       simd\n", exprs[i].str);
+            for (j = 0; j < 3 && !result; j++) {
+                if (exprs[i].float_only && MPR_INT32 == types[j])
+                    continue;
+                for (k = 0, len = 1; k < NUM_LENS && !result; k++, len *= 2)
+                    result = run_expr(&exprs[i], types[j], len, use_program);
+            }
+        }
+    }
+
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,160 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+/* Updates a vector signal from the main thread while a reader thread copies its published
+ * snapshot with mpr_sig_read_snapshot(). Every element of each update holds the same sequence
+ * number, so the reader can check that copies are neither torn nor go backwards. */
+
+#define VEC_LEN 8
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 1000000;
+
+mpr_dev dev = 0;
+mpr_sig sig = 0;
+
+volatile int finished = 0;
+int reads = 0;
+int errors = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void *reader(void *arg)
+{
+    int v[VEC_LEN], i, last = 0;
+    while (!finished && !done) {
+        if (!mpr_sig_read_snapshot(sig, 0, v, NULL))
+            continue;
+        ++reads;
+        for (i = 1; i < VEC_LEN; i++) {
+            if (v[i] != v[0]) {
+                eprintf("Torn snapshot: %d != %d\n", v[i], v[0]);
+                ++errors;
+                break;
+            }
+        }
+        if (v[0] < last) {
+            eprintf("Snapshot %d read after %d\n", v[0], last);
+            ++errors;
+        }
+        last = v[0];
+    }
+    return 0;
+}
+
+int run(void)
+{
+    pthread_t thread;
+    int v[VEC_LEN], i, j;
+
+    if (mpr_sig_read_snapshot(sig, 0, v, NULL)) {
+        eprintf("Snapshot should not have a value before it is enabled.\n");
+        return 1;
+    }
+    mpr_sig_set_snapshot(sig, 1);
+
+    if (pthread_create(&thread, 0, reader, 0)) {
+        eprintf("Error creating reader thread.\n");
+        return 1;
+    }
+    eprintf("Publishing %d updates...\n", iterations);
+    for (i = 1; i <= iterations && !done; i++) {
+        for (j = 0; j < VEC_LEN; j++)
+            v[j] = i;
+        mpr_sig_set_value(sig, 0, VEC_LEN, MPR_INT32, v);
+        if (!(i % 1000))
+            mpr_dev_poll(dev, 0);
+    }
+    finished = 1;
+    pthread_join(thread, NULL);
+    eprintf("Reader copied %d snapshots.\n", reads);
+
+    if (!mpr_sig_read_snapshot(sig, 0, v, NULL) || v[0] != iterations) {
+        eprintf("Snapshot does not hold the last update.\n");
+        ++errors;
+    }
+    mpr_sig_set_snapshot(sig, 0);
+    if (mpr_sig_read_snapshot(sig, 0, v, NULL)) {
+        eprintf("Snapshot should not have a value after it is disabled.\n");
+        ++errors;
+    }
+    return errors != 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsnapshot.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-f fast (reduce iterations), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case 'f':
+                        iterations = 50000;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    dev = mpr_dev_new("testsnapshot", 0);
+    sig = mpr_sig_new(dev, MPR_DIR_OUT, "outsig", VEC_LEN, MPR_INT32, NULL, NULL, NULL, NULL,
+                      NULL, 0);
+    if (!dev || !sig) {
+        eprintf("Error initializing device.\n");
+        result = 1;
+        goto done;
+    }
+    while (!done && !mpr_dev_get_is_ready(dev))
+        mpr_dev_poll(dev, 25);
+    eprintf("Device is ready.\n");
+
+    result = run();
+
+  done:
+    if (dev)
+        mpr_dev_free(dev);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
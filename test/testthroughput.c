@@ -0,0 +1,148 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <lo/lo.h>
+
+/* Measures the rate at which a device receives updates that each arrive in their own datagram,
+ * with increasing numbers of datagrams waiting on the socket at once. Where recvmmsg() is
+ * available the waiting datagrams are read in batches, so the rate should improve with the
+ * number in flight. */
+
+#define NUM_WINDOWS 4
+
+int verbose = 1;
+int iterations = 200000;    /* number of datagrams sent for each window size */
+int done = 0;
+
+int windows[NUM_WINDOWS] = { 1, 8, 64, 256 };
+
+mpr_dev dev = 0;
+mpr_sig sig = 0;
+int received = 0;
+int mismatched = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    /* updates are sent with consecutive values */
+    if (*(int*)value != received)
+        ++mismatched;
+    ++received;
+}
+
+int run_window(lo_address addr, int window)
+{
+    mpr_time start, elapsed;
+    int sent = 0, stalled = 0;
+
+    received = mismatched = 0;
+    mpr_time_set(&start, MPR_NOW);
+    while (!done && received < iterations) {
+        int prev = received;
+        /* keep a bounded number of datagrams in flight so the socket buffer does not overflow */
+        while (sent < iterations && sent - received < window)
+            lo_send(addr, "/in", "i", sent++);
+        mpr_dev_poll(dev, 0);
+        if (received != prev)
+            stalled = 0;
+        else if (++stalled > 100000) {
+            eprintf("Timed out waiting for updates.\n");
+            return 1;
+        }
+    }
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+
+    if (mismatched) {
+        eprintf("%d updates were received out of order.\n", mismatched);
+        return 1;
+    }
+    if (!done) {
+        double secs = mpr_time_as_dbl(elapsed);
+        eprintf("  %3d in flight: %d datagrams in %f seconds (%.0f datagrams/sec)\n",
+                window, received, secs, secs > 0 ? received / secs : 0);
+    }
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char port[16];
+    lo_address addr = 0;
+
+    /* process flags for -v verbose, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testthroughput.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (reduce iterations), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        iterations = 5000;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    dev = mpr_dev_new("testthroughput", 0);
+    if (!dev) {
+        eprintf("Error creating device.\n");
+        result = 1;
+        goto done;
+    }
+    sig = mpr_sig_new(dev, MPR_DIR_IN, "in", 1, MPR_INT32, NULL, NULL, NULL, NULL,
+                      handler, MPR_SIG_UPDATE);
+    while (!done && !mpr_dev_get_is_ready(dev))
+        mpr_dev_poll(dev, 25);
+
+    snprintf(port, 16, "%d", mpr_obj_get_prop_as_int32((mpr_obj)dev, MPR_PROP_PORT, NULL));
+    addr = lo_address_new("127.0.0.1", port);
+
+    eprintf("Receive throughput by number of datagrams in flight:\n");
+    for (i = 0; i < NUM_WINDOWS && !done && !result; i++)
+        result = run_window(addr, windows[i]);
+
+  done:
+    if (addr)
+        lo_address_free(addr);
+    if (dev)
+        mpr_dev_free(dev);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}